@@ -2,7 +2,8 @@
 # ensure that all write caches are emptied in case hd0.img is mounted
 sync
 
-NUM_CPUS=2
+# override to measure the bring-up time with more processors
+NUM_CPUS=${NUM_CPUS:-2}
 
 if (($# >= 1 )); then
 	mode=$1
@@ -24,5 +25,5 @@ case "$mode" in
 		;;
 esac
 
-qemu-system-x86_64 "$@" $ARGS -smp $NUM_CPUS -m 128 hd0.img
+qemu-system-x86_64 "$@" $ARGS -serial stdio -smp $NUM_CPUS -m 128 hd0.img
 
@@ -0,0 +1,50 @@
+/**
+ * @file
+ * @author Fabian Thorand
+ * @date 19.10.2026
+ *
+ * @brief Memory layout of the binary trace buffers. Shared by the kernel and the host side decoder.
+ */
+
+#ifndef TRACEDEF_H_
+#define TRACEDEF_H_
+
+#include <stdint.h>
+
+/// marks an initialized trace buffer ("HeTrace\0")
+#define TRACE_MAGIC 0x0065636172546548ULL
+/// maximum number of arguments of one trace record
+#define TRACE_MAX_ARGS 5
+/// number of records in the buffer of one processor, must be a power of two
+#define TRACE_RECORDS 128
+/// rate of timestamps in nanoseconds in kHz
+#define TRACE_CLOCK_NS_KHZ 1000000
+
+/**
+ * @brief One trace event.
+ *
+ * A slot is only valid if \c sequence matches its position, so records that were
+ * being written when the buffer was dumped are recognized.
+ *
+ * Size: 64 bytes
+ */
+typedef struct {
+    uint64_t timestamp;             ///< value of the monotonic clock
+    uint64_t format;                ///< virtual address of the format string in the kernel image
+    uint64_t args[TRACE_MAX_ARGS];  ///< raw arguments, zero or sign extended to 64 bits
+    uint64_t sequence;              ///< position of the record in the buffer plus one, written last
+}__attribute__((packed)) trace_record_t;
+
+/**
+ * @brief Trace buffer of one processor. The records form a ring that overwrites the oldest entries.
+ */
+typedef struct {
+    uint64_t magic;                 ///< #TRACE_MAGIC when initialized
+    uint64_t cpu;                   ///< index of the owning processor
+    uint64_t head;                  ///< total number of records written, head modulo #TRACE_RECORDS is the next slot
+    uint64_t clock_khz;             ///< rate of the timestamps in kHz, zero if unknown
+    uint64_t reserved[4];
+    trace_record_t records[TRACE_RECORDS];
+}__attribute__((packed)) trace_buffer_t;
+
+#endif /* TRACEDEF_H_ */
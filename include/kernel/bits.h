@@ -9,6 +9,8 @@
 #ifndef BITS_H_
 #define BITS_H_
 
+#include <stdint.h>
+
 #define HAS_FLAG(val,flag) ((val)&(flag))
 #define SET_FLAG(val,flag) ((val)|(flag))
 #define UNSET_FLAG(val,flag) ((val)& ~(flag))
@@ -18,5 +20,20 @@
 #define ALIGN_FLOOR(addr,power) ((val)&((1<<(power))-1))
 #define ALIGN_CEIL(addr,power) ((val+((1<<(power))-1))&((1<<(power))-1))
 
+/**
+ * @brief Returns the number of set bits.
+ *
+ * Without \c popcnt, \c __builtin_popcountll compiles to a call into libgcc, which the
+ * kernel is not linked with. Clearing the lowest set bit takes one iteration per bit,
+ * which is cheap for the sparse processor masks it is used on.
+ */
+static inline unsigned int bits_popcount(uint64_t value) {
+    unsigned int count = 0;
+    for(; value; value &= value - 1) {
+        count++;
+    }
+    return count;
+}
+
 
 #endif /* BITS_H_ */
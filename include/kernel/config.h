@@ -18,6 +18,9 @@
 #define OS_TARGET_TRIPLE "x86_64-helium-elf"
 #define OS_COPYRIGHT "Copyright 2014 (c) Fabian Thorand"
 
+/// messages above this level are not compiled in, see log.h
+#define HE_LOG_LEVEL 3
+
 // Definitions for Idris-Runtime
 #define IDRIS_TARGET_OS "Helium"
 #define IDRIS_TARGET_TRIPLE "x86_64-helium-elf"
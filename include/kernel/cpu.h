@@ -12,6 +12,17 @@
 #include <stdint.h>
 
 #define CPUID_1_EDX_MSR (1<<5)
+#define CPUID_1_EDX_TSC (1<<4)
+#define CPUID_1_EDX_APIC (1<<9)
+#define CPUID_1_ECX_X2APIC (1<<21)
+#define CPUID_1_ECX_TSC_DEADLINE (1<<24)
+#define CPUID_B_EAX_SHIFT 0x1F
+#define CPUID_B_ECX_TYPE(ecx) (((ecx) >> 8) & 0xFF)
+#define CPUID_B_TYPE_SMT 1
+#define CPUID_B_TYPE_CORE 2
+#define CPUID_EXT_MAX 0x80000000
+#define CPUID_EXT_POWER 0x80000007
+#define CPUID_80000007_EDX_INVARIANT_TSC (1<<8)
 
 typedef struct {
     uint32_t eax;
@@ -29,6 +40,15 @@ typedef struct {
  */
 void cpuid(uint32_t code, cpu_id_t* result);
 
+/**
+ * @brief Executes the \c cpuid instruction using the function \c code and the sub-function \c sub.
+ *
+ * @param code The \c cpuid function code.
+ * @param sub The sub-function, passed in \c ecx.
+ * @param result Pointer to a #cpu_id_t structure receiving \c eax, \c ebx, \c ecx and \c edx.
+ */
+void cpuid_sub(uint32_t code, uint32_t sub, cpu_id_t* result);
+
 /**
  * @brief Writes the CPU vendor into the supplied buffer.
  *
@@ -70,4 +90,16 @@ void cpu_outb(uint16_t port, uint8_t value);
  */
 uint8_t cpu_inb(uint16_t port);
 
+/**
+ * @brief Reads the time stamp counter.
+ */
+uint64_t cpu_rdtsc();
+
+/**
+ * @brief Returns the index of the processor executing this function.
+ *
+ * The index is always smaller than #HE_MAX_CPUS.
+ */
+unsigned int cpu_index();
+
 #endif /* CPU_H_ */
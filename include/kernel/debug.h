@@ -9,6 +9,7 @@
 #define DEBUG_H_
 
 #include "kernel/panic.h"
+#include "kernel/log.h"
 
 #ifdef ASSERTIONS
 
@@ -26,18 +27,19 @@
 
 #ifdef DEBUG
 
-#define DEBUGF(...) {kputs("\x1b[33m"); kprintf( __VA_ARGS__); kputs("\x1b[0m"); }
 #define MAGIC_BREAK asm volatile ("xchg %%bx, %%bx" : : : )
 #define DEBUG_HALT { int foo = 1; while(foo); }
 
 #else
 
-#define DEBUGF(msg,...)
 #define MAGIC_BREAK
 #define DEBUG_HALT
 
 #endif
 
+/// debug message without category, see log.h
+#define DEBUGF(...) LOG_DEBUG(LOG_CAT_CORE, __VA_ARGS__)
+
 #define UNUSED(x) ((void)(x))
 
 /**
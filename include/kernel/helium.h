@@ -20,6 +20,12 @@
 #define HE_GDT_MAX_ENTRIES 512
 /// size of string table in bytes
 #define HE_STRING_TABLE_SIZE HE_PAGE_SIZE
+/// maximum number of processors supported by the kernel
+#define HE_MAX_CPUS 16
+/// maximum number of I/O APICs supported by the kernel
+#define HE_MAX_IOAPICS 8
+/// number of legacy ISA IRQs
+#define HE_ISA_IRQS 16
 
 /// virtual base address of kernel space (highest 2 GB)
 #define KERNEL_VMA 0xFFFFFFFF80000000L
@@ -62,6 +68,61 @@ typedef struct {
 } __attribute__((packed)) he_mmap_t;
 
 
+/**
+ * Contains information about a linear framebuffer with direct RGB colors.
+ *
+ * Size: 32 bytes
+ */
+typedef struct {
+    uint64_t paddr;         ///< physical address of the framebuffer, zero if there is none
+    uint32_t pitch;         ///< number of bytes per scanline
+    uint32_t width;         ///< width in pixels
+    uint32_t height;        ///< height in pixels
+    uint8_t  bpp;           ///< bits per pixel
+    uint8_t  red_shift;     ///< position of the red component in a pixel
+    uint8_t  red_size;      ///< number of bits of the red component
+    uint8_t  green_shift;   ///< position of the green component in a pixel
+    uint8_t  green_size;    ///< number of bits of the green component
+    uint8_t  blue_shift;    ///< position of the blue component in a pixel
+    uint8_t  blue_size;     ///< number of bits of the blue component
+    uint8_t  reserved[5];
+}__attribute__((packed)) he_framebuffer_t;
+
+/**
+ * Contains information about a processor listed by the firmware.
+ *
+ * Size: 16 bytes
+ */
+typedef struct {
+    uint32_t apic_id;   ///< local APIC ID
+    uint32_t acpi_id;   ///< ACPI processor UID
+    uint32_t enabled;   ///< 1 if the processor is usable, 0 if it must be brought online first
+    uint32_t reserved;
+}__attribute__((packed)) he_cpu_t;
+
+/**
+ * Contains information about an I/O APIC.
+ *
+ * Size: 16 bytes
+ */
+typedef struct {
+    uint64_t paddr;     ///< physical address of the register window
+    uint32_t id;        ///< I/O APIC ID
+    uint32_t gsi_base;  ///< first global system interrupt handled by this I/O APIC
+}__attribute__((packed)) he_ioapic_t;
+
+/**
+ * Describes how a legacy ISA IRQ is connected to the I/O APICs.
+ *
+ * Size: 8 bytes
+ */
+typedef struct {
+    uint32_t gsi;           ///< global system interrupt the IRQ is connected to
+    uint8_t  active_low;    ///< 1 if the line is active low
+    uint8_t  level;         ///< 1 if the line is level triggered
+    uint16_t reserved;
+}__attribute__((packed)) he_isa_irq_t;
+
 /**
  * Contains all information the loader is passing to the kernel.
  */
@@ -73,6 +134,15 @@ typedef struct {
     uint32_t  module_count;         ///< number of modules in module table
     uint32_t  mmap_count;           ///< number of entries in memory-map-table
     uint32_t  string_table_size;    ///< size of string table in bytes
+    he_framebuffer_t framebuffer;   ///< framebuffer set up by the loader
+    he_cpu_t*    cpu_table;         ///< linear address of processor table (see #he_cpu_t)
+    he_ioapic_t* ioapic_table;      ///< linear address of I/O APIC table (see #he_ioapic_t)
+    he_isa_irq_t* isa_irq_table;    ///< linear address of ISA IRQ table with #HE_ISA_IRQS entries (see #he_isa_irq_t)
+    uint32_t  cpu_count;            ///< number of entries in processor table
+    uint32_t  ioapic_count;         ///< number of entries in I/O APIC table
+    uint64_t  lapic_paddr;          ///< physical address of the local APICs reported by the firmware
+    uint64_t  hpet_paddr;           ///< physical address of the HPET registers, zero if there is none
+    uint32_t  rtc_century;          ///< index of the CMOS register holding the century, zero if there is none
 }__attribute__((packed)) he_info_t;
 
 
@@ -15,6 +15,12 @@ extern he_module_t info_modules[256];
 extern he_mmap_t info_mmap[256];
 /// memory region containing null terminated strings
 extern char info_strings[HE_STRING_TABLE_SIZE];
+/// table containing the processors listed in the ACPI MADT
+extern he_cpu_t info_cpus[HE_MAX_CPUS];
+/// table containing the I/O APICs listed in the ACPI MADT
+extern he_ioapic_t info_ioapics[HE_MAX_IOAPICS];
+/// table containing the connection of the ISA IRQs to the I/O APICs
+extern he_isa_irq_t info_isa_irqs[HE_ISA_IRQS];
 
 /**
  * @brief Parses the given multiboot module table and stores the results
@@ -40,6 +46,28 @@ void info_parse_modules(multiboot_mod_t* modules, int modcount);
  * @param mmap_size size of the multiboot mmap table in bytes
  */
 void info_parse_mmap(uintptr_t mmap_start, uint32_t mmap_size);
+/**
+ * @brief Stores the framebuffer set up by the bootloader in info_table.
+ *
+ * Only linear framebuffers with direct RGB colors are recorded, for all
+ * other modes the physical address remains zero.
+ *
+ * @param mbinfo the multiboot information structure
+ */
+void info_parse_framebuffer(multiboot_info_t* mbinfo);
+
+/**
+ * @brief Locates the ACPI MADT and stores the processors, I/O APICs and
+ * ISA IRQ overrides in info_cpus, info_ioapics and info_isa_irqs.
+ *
+ * ISA IRQs without override are identity mapped to global system interrupts.
+ * The address of the HPET and the CMOS century register are stored in info_table, if
+ * the firmware reports them.
+ *
+ * @return zero on success, -1 if there is no valid MADT.
+ */
+int info_parse_acpi();
+
 /**
  * @brief Allocates length+1 bytes in the string table.
  *
@@ -58,6 +86,8 @@ char* info_string_alloc(size_t length);
  *  - fills all fields of info_table
  *  - fills info_modules
  *  - fills info_mmap
+ *  - records the framebuffer
+ *  - fills info_cpus, info_ioapics and info_isa_irqs from ACPI
  */
 void info_init();
 
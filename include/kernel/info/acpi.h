@@ -0,0 +1,145 @@
+#ifndef ACPI_H_
+#define ACPI_H_
+
+#include <stdint.h>
+
+/// signature of the root system description pointer
+#define ACPI_RSDP_SIGNATURE "RSD PTR "
+/// signature of the multiple APIC description table
+#define ACPI_MADT_SIGNATURE "APIC"
+/// signature of the fixed ACPI description table
+#define ACPI_FADT_SIGNATURE "FACP"
+/// signature of the HPET description table
+#define ACPI_HPET_SIGNATURE "HPET"
+
+/// generic address structure: system memory address space
+#define ACPI_GAS_MEMORY 0
+
+/// MADT entry: processor local APIC
+#define ACPI_MADT_LAPIC 0
+/// MADT entry: I/O APIC
+#define ACPI_MADT_IOAPIC 1
+/// MADT entry: interrupt source override
+#define ACPI_MADT_OVERRIDE 2
+/// MADT entry: local APIC address override
+#define ACPI_MADT_LAPIC_ADDRESS 5
+/// MADT entry: processor local x2APIC
+#define ACPI_MADT_X2APIC 9
+
+/// the processor is enabled
+#define ACPI_MADT_LAPIC_ENABLED 0x1
+/// the processor can be enabled at runtime
+#define ACPI_MADT_LAPIC_ONLINE_CAPABLE 0x2
+
+/// MPS INTI flags: polarity mask
+#define ACPI_MPS_POLARITY_MASK 0x3
+/// MPS INTI flags: active low
+#define ACPI_MPS_POLARITY_LOW 0x3
+/// MPS INTI flags: trigger mode mask
+#define ACPI_MPS_TRIGGER_MASK 0xC
+/// MPS INTI flags: level triggered
+#define ACPI_MPS_TRIGGER_LEVEL 0xC
+
+typedef struct {
+    char     signature[8];
+    uint8_t  checksum;
+    char     oem_id[6];
+    uint8_t  revision;
+    uint32_t rsdt;
+    // ACPI 2.0
+    uint32_t length;
+    uint64_t xsdt;
+    uint8_t  extended_checksum;
+    uint8_t  reserved[3];
+}__attribute__((packed)) acpi_rsdp_t;
+
+typedef struct {
+    char     signature[4];
+    uint32_t length;
+    uint8_t  revision;
+    uint8_t  checksum;
+    char     oem_id[6];
+    char     oem_table_id[8];
+    uint32_t oem_revision;
+    uint32_t creator_id;
+    uint32_t creator_revision;
+}__attribute__((packed)) acpi_sdt_header_t;
+
+typedef struct {
+    acpi_sdt_header_t header;
+    uint32_t lapic_address;
+    uint32_t flags;
+}__attribute__((packed)) acpi_madt_t;
+
+typedef struct {
+    uint8_t type;
+    uint8_t length;
+}__attribute__((packed)) acpi_madt_entry_t;
+
+typedef struct {
+    acpi_madt_entry_t entry;
+    uint8_t  acpi_id;
+    uint8_t  apic_id;
+    uint32_t flags;
+}__attribute__((packed)) acpi_madt_lapic_t;
+
+typedef struct {
+    acpi_madt_entry_t entry;
+    uint8_t  ioapic_id;
+    uint8_t  reserved;
+    uint32_t address;
+    uint32_t gsi_base;
+}__attribute__((packed)) acpi_madt_ioapic_t;
+
+typedef struct {
+    acpi_madt_entry_t entry;
+    uint8_t  bus;
+    uint8_t  source;
+    uint32_t gsi;
+    uint16_t flags;
+}__attribute__((packed)) acpi_madt_override_t;
+
+typedef struct {
+    acpi_madt_entry_t entry;
+    uint16_t reserved;
+    uint64_t address;
+}__attribute__((packed)) acpi_madt_lapic_address_t;
+
+typedef struct {
+    acpi_madt_entry_t entry;
+    uint16_t reserved;
+    uint32_t x2apic_id;
+    uint32_t flags;
+    uint32_t acpi_uid;
+}__attribute__((packed)) acpi_madt_x2apic_t;
+
+/**
+ * @brief Generic address structure describing a register.
+ */
+typedef struct {
+    uint8_t  space_id;
+    uint8_t  bit_width;
+    uint8_t  bit_offset;
+    uint8_t  access_size;
+    uint64_t address;
+}__attribute__((packed)) acpi_gas_t;
+
+/**
+ * @brief Fixed ACPI description table, up to the CMOS century register.
+ */
+typedef struct {
+    acpi_sdt_header_t header;
+    uint8_t  reserved[72];
+    uint8_t  century;
+}__attribute__((packed)) acpi_fadt_t;
+
+typedef struct {
+    acpi_sdt_header_t header;
+    uint32_t event_timer_block_id;
+    acpi_gas_t address;
+    uint8_t  hpet_number;
+    uint16_t minimum_tick;
+    uint8_t  page_protection;
+}__attribute__((packed)) acpi_hpet_t;
+
+#endif
@@ -3,6 +3,11 @@
 
 #include <stdint.h>
 
+/// the framebuffer fields of #multiboot_info_t are valid
+#define MULTIBOOT_INFO_FRAMEBUFFER 0x1000
+/// framebuffer with direct RGB colors
+#define MULTIBOOT_FRAMEBUFFER_RGB 1
+
 typedef struct {
     uint32_t addr_start;
     uint32_t addr_end;
@@ -45,6 +50,29 @@ typedef struct {
     } syms;
     uint32_t mmap_len;
     uint32_t mmap;
+    uint32_t drives_len;
+    uint32_t drives;
+    uint32_t config_table;
+    uint32_t boot_loader_name;
+    uint32_t apm_table;
+    uint32_t vbe_control_info;
+    uint32_t vbe_mode_info;
+    uint16_t vbe_mode;
+    uint16_t vbe_interface_seg;
+    uint16_t vbe_interface_off;
+    uint16_t vbe_interface_len;
+    uint64_t framebuffer_addr;
+    uint32_t framebuffer_pitch;
+    uint32_t framebuffer_width;
+    uint32_t framebuffer_height;
+    uint8_t  framebuffer_bpp;
+    uint8_t  framebuffer_type;
+    uint8_t  red_field_position;
+    uint8_t  red_mask_size;
+    uint8_t  green_field_position;
+    uint8_t  green_mask_size;
+    uint8_t  blue_field_position;
+    uint8_t  blue_mask_size;
 }__attribute__((packed)) multiboot_info_t;
 
 #endif
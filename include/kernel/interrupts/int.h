@@ -4,20 +4,194 @@
  * @author fabian
  * @date   15.06.2014
  *
- * @brief 
+ * @brief General interrupt functionality.
+ *
+ * All 256 vectors enter the kernel through the stubs in \c isr.asm, which build an #int_frame_t
+ * and call #int_dispatch. The dispatcher counts the interrupt and calls the handler registered
+ * with #int_register.
+ *
+ * Vectors starting at #INT_VECTOR_FAST_BASE use a fast entry path that neither saves the callee
+ * saved registers nor the SSE state. It is meant for IPIs and timers. Handlers for these vectors
+ * must be declared with #INT_FAST_HANDLER and must not read the callee saved registers from the frame.
+ *
+ * Before returning to code with interrupts enabled, both paths call #int_return, which runs
+ * pending deferred work (see softirq.h) with interrupts enabled and switches to another thread
+ * when the scheduler asks for it (see sched.h). The fast path saves the SSE state only in this case.
  */
 #ifndef INT_H_
 #define INT_H_
 
+#include "kernel/panic.h"
+#include "kernel/interrupts/intstat.h"
+
+#include <stdint.h>
+
+/// interrupt flag in RFLAGS
+#define INT_RFLAGS_IF 0x200
+
+/// first vector that is not reserved for exceptions
+#define INT_VECTOR_IRQ_BASE 0x20
+/// first vector using the fast entry path, must match \c ISR_FAST_BASE in \c isr.asm
+#define INT_VECTOR_FAST_BASE 0xF0
+/// number of interrupt vectors
+#define INT_VECTORS 256
+/// distance between two entry stubs, must match \c ISR_STUB_SIZE in \c isr.asm
+#define INT_STUB_SIZE 16
+
+/// declares a function that does not use SSE registers, required for handlers of fast vectors
+#define INT_FAST_HANDLER __attribute__((target("general-regs-only")))
+
+#ifdef HE_INT_STATS
+
 /**
- * @brief Enables interrupts.
+ * @brief Enables interrupts and records the interrupts-disabled span, see intstat.h.
  */
-#define INT_ENABLE() asm volatile ("sti")
+#define INT_ENABLE() INTSTAT_INT_ENABLE()
 
 /**
- * @brief Disables interrupts.
+ * @brief Disables interrupts and starts an interrupts-disabled span, see intstat.h.
+ */
+#define INT_DISABLE() INTSTAT_INT_DISABLE(__FILE__, __LINE__)
+
+/**
+ * @brief Enables interrupts, records the interrupts-disabled span and halts until the next interrupt.
+ */
+#define INT_ENABLE_HALT() do { \
+    intstat_irq_on(); \
+    asm volatile ("sti; hlt" : : : "memory"); \
+} while(0)
+
+#else
+
+/**
+ * @brief Enables interrupts. Also a compiler barrier, like the variant with statistics.
+ */
+#define INT_ENABLE() asm volatile ("sti" : : : "memory")
+
+/**
+ * @brief Disables interrupts. Also a compiler barrier, like the variant with statistics.
+ */
+#define INT_DISABLE() asm volatile ("cli" : : : "memory")
+
+/**
+ * @brief Enables interrupts and halts until the next one.
+ *
+ * \c sti delays interrupts by one instruction, so no interrupt is handled between the
+ * checks made with interrupts disabled and \c hlt.
+ */
+#define INT_ENABLE_HALT() asm volatile ("sti; hlt" : : : "memory")
+
+#endif
+
+/**
+ * @brief Evaluates to non-zero, if interrupts are enabled on the current processor.
+ *
+ * A macro, so that it can be used on the fast interrupt path.
+ */
+#define INT_ENABLED() ({ \
+    uint64_t int_flags_; \
+    asm volatile ("pushfq; popq %0" : "=r"(int_flags_)); \
+    (int_flags_ & INT_RFLAGS_IF) != 0; })
+
+/**
+ * @brief Checks whether interrupts are enabled on the current processor.
+ */
+static inline int int_enabled() {
+    return INT_ENABLED();
+}
+
+/**
+ * @brief Register state of the interrupted code, as pushed by the entry stubs.
+ *
+ * The frame is 16 byte aligned. In frames of fast vectors, \c rbx, \c rbp and \c r12 to \c r15
+ * are not saved and contain garbage.
  */
-#define INT_DISABLE() asm volatile ("cli")
+typedef struct {
+    uint64_t r15;
+    uint64_t r14;
+    uint64_t r13;
+    uint64_t r12;
+    uint64_t r11;
+    uint64_t r10;
+    uint64_t r9;
+    uint64_t r8;
+    uint64_t rbp;
+    uint64_t rdi;
+    uint64_t rsi;
+    uint64_t rdx;
+    uint64_t rcx;
+    uint64_t rbx;
+    uint64_t rax;
+    uint64_t vector; ///< interrupt vector
+    uint64_t error;  ///< error code pushed by the CPU, zero for vectors without error code
+    uint64_t rip;
+    uint64_t cs;
+    uint64_t rflags;
+    uint64_t rsp;
+    uint64_t ss;
+} int_frame_t;
 
+/**
+ * @brief An interrupt handler.
+ *
+ * Handlers run with interrupts disabled. Handlers of hardware interrupts must
+ * signal the end of interrupt to their controller.
+ */
+typedef void (*int_handler_t)(int_frame_t* frame);
+
+/**
+ * @brief Emits #PANIC_SAVE_STATE, replaces the saved registers with those of \c frame and calls #_kpanicf.
+ */
+#define int_panicf(frame, ...) { PANIC_SAVE_STATE(); int_panic_frame(frame); _kpanicf(__VA_ARGS__); }
+
+/**
+ * @brief Installs the entry stubs for all vectors in the IDT.
+ */
+void int_init();
+
+/**
+ * @brief Registers the handler for a vector, replacing any previous handler.
+ *
+ * @param vector the interrupt vector
+ * @param handler the handler, it must be declared with #INT_FAST_HANDLER if \c vector is a fast vector
+ */
+void int_register(uint8_t vector, int_handler_t handler);
+
+/**
+ * @brief Removes the handler of a vector.
+ *
+ * The handler may still run on other processors until #rcu_synchronize returns.
+ */
+void int_unregister(uint8_t vector);
+
+/**
+ * @brief Returns how often a vector was raised since boot.
+ */
+uint64_t int_count(uint8_t vector);
+
+/**
+ * @brief Returns the name of an exception vector or NULL, if \c vector is not an exception.
+ */
+const char* int_exception_name(uint8_t vector);
+
+/**
+ * @brief Copies the registers in \c frame to the state saved by #PANIC_SAVE_STATE.
+ */
+void int_panic_frame(const int_frame_t* frame);
+
+/**
+ * @brief Called by the entry stubs to dispatch an interrupt to its handler.
+ *
+ * @return non-zero, if the stub must call #int_return before returning.
+ */
+int int_dispatch(int_frame_t* frame);
+
+/**
+ * @brief Runs deferred work and preempts the current thread, if requested.
+ *
+ * Called by the entry stubs with interrupts disabled and the SSE state saved, when
+ * returning to code with interrupts enabled.
+ */
+void int_return();
 
 #endif /* INT_H_ */
@@ -0,0 +1,120 @@
+/**
+ * @file intstat.h
+ *
+ * @author Fabian Thorand
+ * @date   19.10.2026
+ *
+ * @brief Histograms of interrupt handler durations, interrupts-disabled spans and timer latency.
+ *
+ * All histograms are per processor and use logarithmic buckets: bucket \c b counts
+ * events that took between 2^(b + #INTSTAT_MIN_SHIFT) and 2^(b + #INTSTAT_MIN_SHIFT + 1)
+ * TSC cycles, the first and last bucket also count everything below and above.
+ *
+ * The statistics are compiled in when \c HE_INT_STATS is defined. Timestamps are taken
+ * with \c rdtscp, which also returns the processor index from \c IA32_TSC_AUX, so recording
+ * an event costs two timestamps and a few increments of processor local memory.
+ * #intstat_dump writes all non-empty histograms with kprintf.
+ */
+#ifndef INTSTAT_H_
+#define INTSTAT_H_
+
+#include <stdint.h>
+
+/// number of buckets of each histogram
+#define INTSTAT_BUCKETS 24
+/// the first bucket ends at 2^(INTSTAT_MIN_SHIFT + 1) cycles
+#define INTSTAT_MIN_SHIFT 6
+
+/// IA32_TSC_AUX MSR, returned by rdtscp
+#define INTSTAT_MSR_TSC_AUX 0xC0000103
+
+/**
+ * @brief Allocates the histograms. Must be called once after the page frame allocator is initialized.
+ */
+void intstat_init();
+
+/**
+ * @brief Stores the index of the current processor in \c IA32_TSC_AUX. Must be called on every processor.
+ */
+void intstat_init_cpu();
+
+/**
+ * @brief Writes all non-empty histograms to kstdio.
+ */
+void intstat_dump();
+
+#ifdef HE_INT_STATS
+
+/// non-zero, when rdtscp is available
+extern int intstat_have_rdtscp;
+
+/**
+ * @brief Returns the TSC and the index of the current processor without rdtscp.
+ */
+uint64_t intstat_timestamp_slow(unsigned int* cpu);
+
+/**
+ * @brief Evaluates to the TSC and stores the index of the current processor in \c *cpu.
+ *
+ * A macro, so that it can be used on the fast interrupt path.
+ */
+#define INTSTAT_TIMESTAMP(cpu) ({ \
+    uint64_t intstat_now_; \
+    if(!intstat_have_rdtscp) { \
+        intstat_now_ = intstat_timestamp_slow(cpu); \
+    } else { \
+        uint32_t intstat_lo_, intstat_hi_, intstat_aux_; \
+        asm volatile ("rdtscp" : "=a"(intstat_lo_), "=d"(intstat_hi_), "=c"(intstat_aux_)); \
+        *(cpu) = intstat_aux_; \
+        intstat_now_ = ((uint64_t)intstat_hi_ << 32) | intstat_lo_; \
+    } \
+    intstat_now_; })
+
+/**
+ * @brief Records the duration of an interrupt handler.
+ */
+void intstat_record_handler(unsigned int cpu, uint8_t vector, uint64_t cycles);
+
+/**
+ * @brief Records the start of an interrupts-disabled span.
+ */
+void intstat_irq_off(const char* file, int line);
+
+/**
+ * @brief Records the end of an interrupts-disabled span, if its start was recorded.
+ */
+void intstat_irq_on();
+
+/**
+ * @brief Records the deadline the timer of the current processor was armed with.
+ */
+void intstat_timer_armed(uint64_t deadline);
+
+/**
+ * @brief Records the latency of a timer interrupt relative to its deadline.
+ */
+void intstat_timer_fired();
+
+/**
+ * @brief Disables interrupts and starts a span, if they were enabled. Use #INT_DISABLE instead.
+ *
+ * A macro, so that it can be used on the fast interrupt path.
+ */
+#define INTSTAT_INT_DISABLE(file, line) do { \
+    uint64_t intstat_flags_; \
+    asm volatile ("pushfq; popq %0; cli" : "=r"(intstat_flags_) : : "memory"); \
+    if(intstat_flags_ & 0x200) { \
+        intstat_irq_off(file, line); \
+    } } while(0)
+
+/**
+ * @brief Ends a span and enables interrupts. Use #INT_ENABLE instead.
+ */
+#define INTSTAT_INT_ENABLE() do { \
+    intstat_irq_on(); \
+    asm volatile ("sti" : : : "memory"); \
+    } while(0)
+
+#endif
+
+#endif /* INTSTAT_H_ */
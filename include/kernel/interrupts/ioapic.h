@@ -0,0 +1,110 @@
+/**
+ * @file ioapic.h
+ *
+ * @author Fabian Thorand
+ * @date   19.10.2026
+ *
+ * @brief Interface to I/O APICs.
+ *
+ * The I/O APICs are discovered through the ACPI MADT (see info.h). Global system
+ * interrupt \c gsi is delivered on vector #IOAPIC_VECTOR(gsi) to a single processor,
+ * its affinity. Handlers must signal the end of interrupt with #lapic_eoi.
+ */
+#ifndef IOAPIC_H_
+#define IOAPIC_H_
+
+#include "kernel/interrupts/int.h"
+
+#include <stdint.h>
+
+/// vector of the first global system interrupt, follows the vectors of the legacy PIC
+#define IOAPIC_VECTOR_BASE 0x30
+/// number of global system interrupts that can be routed
+#define IOAPIC_MAX_GSIS (INT_VECTOR_FAST_BASE - IOAPIC_VECTOR_BASE)
+/// vector a global system interrupt is delivered on
+#define IOAPIC_VECTOR(gsi) (IOAPIC_VECTOR_BASE + (gsi))
+
+/// offset of the register select register
+#define IOAPIC_IOREGSEL 0x00
+/// offset of the data window register
+#define IOAPIC_IOWIN 0x10
+
+/// I/O APIC ID register
+#define IOAPIC_REG_ID 0x00
+/// I/O APIC version register, contains the index of the last redirection entry
+#define IOAPIC_REG_VERSION 0x01
+/// low half of the first redirection entry, entry \c n is at \c IOAPIC_REG_REDTBL + 2 * n
+#define IOAPIC_REG_REDTBL 0x10
+
+/// redirection entry: input is active low
+#define IOAPIC_REDIR_ACTIVE_LOW 0x2000
+/// redirection entry: input is level triggered
+#define IOAPIC_REDIR_LEVEL 0x8000
+/// redirection entry: input is masked
+#define IOAPIC_REDIR_MASKED 0x10000
+
+/**
+ * @brief Masks all inputs of the I/O APICs listed in the MADT and disables the legacy PIC.
+ *
+ * @return zero on success, -1 if there is no I/O APIC.
+ */
+int ioapic_init();
+
+/**
+ * @brief Returns the global system interrupt an ISA IRQ is connected to.
+ */
+uint32_t ioapic_isa_gsi(uint8_t irq);
+
+/**
+ * @brief Routes a global system interrupt to a processor and unmasks it.
+ *
+ * @param gsi the global system interrupt
+ * @param active_low non-zero, if the input is active low
+ * @param level non-zero, if the input is level triggered
+ * @param apic_id local APIC ID of the processor receiving the interrupt
+ * @return the vector of the interrupt or -1, if no I/O APIC handles \c gsi.
+ */
+int ioapic_route(uint32_t gsi, int active_low, int level, uint32_t apic_id);
+
+/**
+ * @brief Routes an ISA IRQ, applying the overrides of the MADT.
+ *
+ * @see ioapic_route
+ */
+int ioapic_route_isa(uint8_t irq, uint32_t apic_id);
+
+/**
+ * @brief Masks a global system interrupt.
+ */
+void ioapic_mask(uint32_t gsi);
+
+/**
+ * @brief Unmasks a routed global system interrupt.
+ */
+void ioapic_unmask(uint32_t gsi);
+
+/**
+ * @brief Delivers a routed global system interrupt to another processor.
+ *
+ * @return zero on success, -1 if \c gsi is not routed.
+ */
+int ioapic_set_affinity(uint32_t gsi, uint32_t apic_id);
+
+/**
+ * @brief Returns the local APIC ID of the processor receiving a global system interrupt.
+ */
+uint32_t ioapic_get_affinity(uint32_t gsi);
+
+/**
+ * @brief Distributes the routed interrupts over the given processors.
+ *
+ * The interrupts are assigned in the order of their rate since the last call, each
+ * to the processor with the lowest load so far. Interrupts only move if that
+ * changes the load, so the assignment is stable when the rates are.
+ *
+ * @param apic_ids local APIC IDs of the processors that may receive interrupts
+ * @param count number of entries in \c apic_ids
+ */
+void ioapic_rebalance(const uint32_t* apic_ids, unsigned int count);
+
+#endif /* IOAPIC_H_ */
@@ -0,0 +1,203 @@
+/**
+ * @file lapic.h
+ *
+ * @author Fabian Thorand
+ * @date   19.10.2026
+ *
+ * @brief Interface to local APICs.
+ *
+ * The timer is programmed with absolute deadlines in TSC cycles. It uses the TSC-deadline
+ * mode when the processor supports it. Otherwise deadlines are converted to the one-shot
+ * mode of the APIC timer, whose frequency is calibrated against the TSC by #lapic_timer_init.
+ *
+ * When the processor supports it and \c HE_X2APIC is defined, the local APIC is switched to x2APIC
+ * mode. The registers are then accessed as MSRs and the interrupt command register is written
+ * with a single \c wrmsr instead of two MMIO writes followed by polling the delivery status.
+ */
+#ifndef LAPIC_H_
+#define LAPIC_H_
+
+#include "kernel/interrupts/int.h"
+
+#include <stdint.h>
+
+/// vector of the local APIC timer, uses the fast entry path
+#define LAPIC_VECTOR_TIMER 0xF0
+/// vector of the IPI used by #lapic_ipi_benchmark, uses the fast entry path
+#define LAPIC_VECTOR_PING 0xFE
+/// vector of spurious interrupts, the low four bits must be set on older processors
+#define LAPIC_VECTOR_SPURIOUS 0xFF
+
+/// local APIC ID register
+#define LAPIC_REG_ID 0x20
+/// local APIC version register
+#define LAPIC_REG_VERSION 0x30
+/// task priority register
+#define LAPIC_REG_TPR 0x80
+/// end of interrupt register
+#define LAPIC_REG_EOI 0xB0
+/// spurious interrupt vector register
+#define LAPIC_REG_SVR 0xF0
+/// error status register
+#define LAPIC_REG_ESR 0x280
+/// interrupt command register, low half
+#define LAPIC_REG_ICR_LOW 0x300
+/// interrupt command register, high half
+#define LAPIC_REG_ICR_HIGH 0x310
+/// LVT timer register
+#define LAPIC_REG_LVT_TIMER 0x320
+/// LVT LINT0 register
+#define LAPIC_REG_LVT_LINT0 0x350
+/// LVT LINT1 register
+#define LAPIC_REG_LVT_LINT1 0x360
+/// LVT error register
+#define LAPIC_REG_LVT_ERROR 0x370
+/// timer initial count register
+#define LAPIC_REG_TIMER_INITIAL 0x380
+/// timer current count register
+#define LAPIC_REG_TIMER_CURRENT 0x390
+/// timer divide configuration register
+#define LAPIC_REG_TIMER_DIVIDE 0x3E0
+
+/// APIC software enable bit in the spurious interrupt vector register
+#define LAPIC_SVR_ENABLE 0x100
+/// mask bit of LVT entries
+#define LAPIC_LVT_MASKED 0x10000
+/// ICR delivery status, set while an IPI is pending (xAPIC only)
+#define LAPIC_ICR_PENDING 0x1000
+/// ICR level: assert
+#define LAPIC_ICR_ASSERT 0x4000
+/// ICR delivery mode: INIT
+#define LAPIC_ICR_INIT 0x500
+/// ICR delivery mode: start-up, the vector is the page of the entry point
+#define LAPIC_ICR_STARTUP 0x600
+
+/// LVT timer mode: one-shot
+#define LAPIC_TIMER_ONESHOT 0x00000
+/// LVT timer mode: periodic
+#define LAPIC_TIMER_PERIODIC 0x20000
+/// LVT timer mode: TSC-deadline
+#define LAPIC_TIMER_TSC_DEADLINE 0x40000
+
+/// IA32_APIC_BASE MSR
+#define LAPIC_MSR_APIC_BASE 0x1B
+/// global enable bit in IA32_APIC_BASE
+#define LAPIC_APIC_BASE_ENABLE 0x800
+/// bootstrap processor flag in IA32_APIC_BASE
+#define LAPIC_APIC_BASE_BSP 0x100
+/// x2APIC enable bit in IA32_APIC_BASE
+#define LAPIC_APIC_BASE_X2APIC 0x400
+/// physical base address mask of IA32_APIC_BASE
+#define LAPIC_APIC_BASE_ADDR 0xFFFFFF000
+/// first MSR of the x2APIC register space
+#define LAPIC_X2APIC_MSR_BASE 0x800
+/// MSR of an x2APIC register, the MMIO offset divided by 16
+#define LAPIC_X2APIC_MSR(reg) (LAPIC_X2APIC_MSR_BASE + ((reg) >> 4))
+/// IA32_TSC_DEADLINE MSR
+#define LAPIC_MSR_TSC_DEADLINE 0x6E0
+
+/**
+ * @brief Called on every timer interrupt before the end of interrupt is signaled.
+ *
+ * The handler runs on the fast entry path and must be declared with #INT_FAST_HANDLER.
+ */
+typedef void (*lapic_timer_handler_t)(int_frame_t* frame);
+
+/**
+ * @brief Enables the local APIC of the current processor.
+ *
+ * @return zero on success, -1 if the processor has no local APIC.
+ */
+int lapic_init();
+
+/**
+ * @brief Returns the ID of the local APIC of the current processor.
+ */
+uint32_t lapic_id();
+
+/**
+ * @brief Returns non-zero, if the local APIC runs in x2APIC mode.
+ */
+int lapic_x2apic_enabled();
+
+/**
+ * @brief Sends a fixed interrupt to a single processor.
+ *
+ * @param apic_id the local APIC ID of the target processor
+ * @param vector the interrupt vector
+ */
+void lapic_send_ipi(uint32_t apic_id, uint8_t vector);
+
+/**
+ * @brief Sends an INIT IPI, which resets a processor into the wait-for-SIPI state.
+ */
+void lapic_send_init(uint32_t apic_id);
+
+/**
+ * @brief Sends a start-up IPI to a processor waiting for one.
+ *
+ * @param apic_id the local APIC ID of the target processor
+ * @param page the processor starts in real mode at physical address \c page * 4096
+ */
+void lapic_send_startup(uint32_t apic_id, uint8_t page);
+
+/**
+ * @brief Signals the end of interrupt to the local APIC.
+ */
+void lapic_eoi();
+
+/**
+ * @brief Calibrates the APIC timer against the TSC and selects the timer mode.
+ *
+ * Must be called once on the bootstrap processor after #lapic_init and #clock_init,
+ * with interrupts disabled.
+ */
+void lapic_timer_init();
+
+/**
+ * @brief Sets the function called on timer interrupts.
+ */
+void lapic_timer_set_handler(lapic_timer_handler_t handler);
+
+/**
+ * @brief Arms the timer of the current processor to fire once at an absolute TSC value.
+ *
+ * A deadline in the past fires immediately.
+ */
+void lapic_timer_oneshot(uint64_t deadline);
+
+/**
+ * @brief Lets the timer of the current processor fire periodically.
+ *
+ * @param period the period in TSC cycles
+ */
+void lapic_timer_periodic(uint64_t period);
+
+/**
+ * @brief Stops the timer of the current processor.
+ */
+void lapic_timer_stop();
+
+/**
+ * @brief Returns non-zero, if the timer uses the TSC-deadline mode.
+ */
+int lapic_timer_has_deadline();
+
+/**
+ * @brief Measures the round trip time of timer interrupts and logs the result.
+ *
+ * Interrupts must be enabled.
+ */
+void lapic_timer_benchmark();
+
+/**
+ * @brief Measures the round trip time of IPIs and logs the result.
+ *
+ * A round ends when the sender observes the write of the handler on the target processor.
+ * Interrupts must be enabled on both processors.
+ *
+ * @param apic_id the local APIC ID of the target processor, which may be the current processor
+ */
+void lapic_ipi_benchmark(uint32_t apic_id);
+
+#endif /* LAPIC_H_ */
@@ -0,0 +1,58 @@
+/**
+ * @file pic.h
+ *
+ * @author Fabian Thorand
+ * @date   19.10.2026
+ *
+ * @brief Interface to legacy PIC.
+ */
+#ifndef PIC_H_
+#define PIC_H_
+
+#include "kernel/interrupts/int.h"
+
+#include <stdint.h>
+
+/// I/O port of the command register of the master PIC
+#define PIC_MASTER_COMMAND 0x20
+/// I/O port of the data register of the master PIC
+#define PIC_MASTER_DATA 0x21
+/// I/O port of the command register of the slave PIC
+#define PIC_SLAVE_COMMAND 0xA0
+/// I/O port of the data register of the slave PIC
+#define PIC_SLAVE_DATA 0xA1
+
+/// end of interrupt command
+#define PIC_CMD_EOI 0x20
+
+/// vector of IRQ 0, the IRQs 0 to 15 are mapped to consecutive vectors
+#define PIC_VECTOR_BASE INT_VECTOR_IRQ_BASE
+/// number of IRQ lines
+#define PIC_IRQS 16
+
+/**
+ * @brief Remaps the PIC IRQs to #PIC_VECTOR_BASE, so they do not overlap with exceptions, and masks all of them.
+ */
+void pic_init();
+
+/**
+ * @brief Masks all IRQ lines including the cascade, used once the I/O APICs take over.
+ */
+void pic_disable();
+
+/**
+ * @brief Masks an IRQ line.
+ */
+void pic_mask(uint8_t irq);
+
+/**
+ * @brief Unmasks an IRQ line.
+ */
+void pic_unmask(uint8_t irq);
+
+/**
+ * @brief Signals the end of interrupt for an IRQ line.
+ */
+void pic_eoi(uint8_t irq);
+
+#endif /* PIC_H_ */
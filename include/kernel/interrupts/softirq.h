@@ -0,0 +1,99 @@
+/**
+ * @file softirq.h
+ *
+ * @author Fabian Thorand
+ * @date   19.10.2026
+ *
+ * @brief Deferred interrupt work with per-CPU queues.
+ *
+ * Interrupt handlers do the minimum with interrupts disabled and hand the rest to
+ * #softirq_raise. The work is queued on the current processor without locks and runs
+ * with interrupts enabled when the outermost interrupt returns to code that had
+ * interrupts enabled, on the stack of the interrupted code and with its SSE state saved.
+ *
+ * Each pass runs at most #SOFTIRQ_BUDGET items, so a flood of interrupts cannot keep the
+ * processor in interrupt context forever. Work left over stays queued for the next
+ * interrupt return or for #softirq_run, which idle loops and kernel threads call.
+ *
+ * Example:
+ *
+ *     static softirq_work_t rx_work = SOFTIRQ_WORK_INIT(rx_process);
+ *     ...
+ *     // in the interrupt handler
+ *     softirq_raise(&rx_work);
+ */
+#ifndef SOFTIRQ_H_
+#define SOFTIRQ_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// maximum number of work items run per pass
+#define SOFTIRQ_BUDGET 64
+
+struct softirq_work;
+
+/**
+ * @brief Function executing deferred work.
+ */
+typedef void (*softirq_func_t)(struct softirq_work* work);
+
+/**
+ * @brief A unit of deferred work. Usually embedded in the structure of a driver.
+ *
+ * A work item is queued at most once. Raising it again while it is pending has no effect,
+ * so the function must process everything that accumulated until it runs.
+ */
+typedef struct softirq_work {
+    struct softirq_work* volatile next; ///< next item in the queue
+    softirq_func_t func;                ///< function executing the work
+    volatile int pending;               ///< non-zero while the item is queued
+} softirq_work_t;
+
+/// static initializer of a #softirq_work_t
+#define SOFTIRQ_WORK_INIT(f) { NULL, (f), 0 }
+
+/**
+ * @brief Initializes a work item.
+ */
+void softirq_init_work(softirq_work_t* work, softirq_func_t func);
+
+/**
+ * @brief Queues a work item on the current processor, if it is not already pending.
+ *
+ * Safe to call from interrupt handlers, including those of fast vectors.
+ *
+ * @return non-zero, if the item was queued.
+ */
+int softirq_raise(softirq_work_t* work);
+
+/**
+ * @brief Runs one pass of pending work on the current processor with interrupts enabled.
+ *
+ * Does nothing, if the processor is already running deferred work.
+ * Must not be called from interrupt handlers.
+ */
+void softirq_run();
+
+/**
+ * @brief Checks whether any processor may have pending work.
+ *
+ * This is a cheap check for the interrupt return path.
+ */
+int softirq_maybe_pending();
+
+/**
+ * @brief Checks whether the current processor has pending work.
+ *
+ * Called with interrupts disabled, see #sched_idle.
+ */
+int softirq_pending();
+
+/**
+ * @brief Runs one pass of pending work when an interrupt returns.
+ *
+ * Called by #int_return with interrupts disabled and the SSE state saved.
+ */
+void softirq_run_irq();
+
+#endif /* SOFTIRQ_H_ */
@@ -0,0 +1,41 @@
+/**
+ * @file ansi.h
+ *
+ * @author Fabian Thorand
+ * @date   19.10.2026
+ *
+ * @brief Parser for the ANSI color escape sequences understood by the console backends.
+ *
+ * Colors are represented as VGA color bytes (see kstdio_screen.h), so all consoles
+ * share the same set of colors.
+ */
+#ifndef ANSI_H_
+#define ANSI_H_
+
+#include <stdint.h>
+
+/// the default console color, white on black
+#define ANSI_DEFAULT_COLOR 0x0F
+
+/**
+ * @brief State of an escape sequence parser.
+ */
+typedef struct {
+    uint8_t  state;     ///< 0: normal text, 1: after ESC, 2: inside a control sequence
+    uint16_t code;      ///< the parameter read so far
+} ansi_parser_t;
+
+/**
+ * @brief Feeds a character to the escape sequence parser.
+ *
+ * Select graphic rendition sequences (<tt>ESC [ n ; ... m</tt>) update \c color,
+ * all other sequences are ignored.
+ *
+ * @param parser the parser state, initially zero
+ * @param chr the next character of the output
+ * @param color the current VGA color byte
+ * @return non-zero if \c chr belongs to an escape sequence and must not be printed.
+ */
+int ansi_parse(ansi_parser_t* parser, int chr, uint8_t* color);
+
+#endif /* ANSI_H_ */
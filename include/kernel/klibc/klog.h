@@ -0,0 +1,96 @@
+/**
+ * @file klog.h
+ *
+ * @author Fabian Thorand
+ * @date   19.10.2026
+ *
+ * @brief Per-CPU kernel log ring buffers.
+ *
+ * Every processor owns one ring. Appending to a ring is lock-free and may be nested
+ * by interrupt handlers running on the same processor. A single consumer at a time
+ * drains all rings in timestamp order and writes the records to the kstdio backends.
+ */
+#ifndef KLOG_H_
+#define KLOG_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/// size of the log ring of one processor in bytes, must be a power of two
+#define KLOG_RING_SIZE 0x1000
+
+/// the record has been completely written and may be consumed
+#define KLOG_FLAG_COMMITTED 0x1
+/// the record only fills the space up to the end of the ring
+#define KLOG_FLAG_PADDING   0x2
+
+/**
+ * @brief Header of a record in a log ring. The text follows immediately after the header.
+ *
+ * Size: 16 bytes
+ */
+typedef struct {
+    uint64_t timestamp;     ///< value of the time stamp counter when the record was created
+    uint16_t length;        ///< length of the text in bytes
+    uint16_t size;          ///< size of the whole record including header and alignment
+    uint8_t  flags;         ///< combination of \c KLOG_FLAG_* values
+    uint8_t  cpu;           ///< index of the processor that created the record
+    uint16_t reserved;
+} klog_record_t;
+
+/**
+ * @brief Appends a record to the log ring of the current processor.
+ *
+ * @param msg the text of the record, it does not need to be null terminated
+ * @param length the number of bytes in \c msg
+ * @return zero on success, -1 if the record was dropped because the ring is full.
+ */
+int klog_append(const char* msg, size_t length);
+
+/**
+ * @brief Appends a record and, unless asynchronous draining is enabled, drains the rings.
+ *
+ * This is the function used by the kstdio output functions.
+ */
+void klog_write(const char* msg, size_t length);
+
+/**
+ * @brief Writes all committed records to the kstdio backends.
+ *
+ * Only one processor drains the rings at a time. If another processor is already
+ * draining, this function returns immediately and the other processor
+ * also outputs the records appended in the meantime.
+ */
+void klog_drain();
+
+/**
+ * @brief Writes all committed records to the kstdio backends, even if another processor
+ * is draining them.
+ *
+ * Used by the panic handler, whose processor may have been interrupted while draining.
+ * Records may be output twice if another processor is still draining.
+ */
+void klog_flush();
+
+/**
+ * @brief Starts a consumer thread on the current processor and switches to asynchronous draining.
+ *
+ * Must be called after #sched_start. Logging code then no longer waits for slow
+ * backends like the serial port.
+ *
+ * @return zero on success, -1 if the thread could not be created
+ */
+int klog_start();
+
+/**
+ * @brief Enables or disables asynchronous draining.
+ *
+ * In synchronous mode (the default), #klog_write also tries to drain the rings.
+ * In asynchronous mode, #klog_write only appends and a dedicated
+ * consumer must call #klog_drain. #klog_start sets up such a consumer.
+ *
+ * @param async non-zero to enable asynchronous mode
+ */
+void klog_set_async(int async);
+
+#endif /* KLOG_H_ */
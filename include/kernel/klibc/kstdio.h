@@ -7,6 +7,8 @@
 
 /// maximum resulting length of the format string in one call of printf
 #define KPRINTF_LINE_MAX 256
+/// maximum number of backends receiving output at the same time
+#define KSTDIO_MAX_BACKENDS 4
 
 /**
  * @brief this structure defines a backend for kernel print statements.
@@ -34,7 +36,8 @@ int vsnprintf(char* str, size_t strn, const char* format, va_list arglist);
  * @return
  *   * if the return value is negative, an error occured
  *   * if the return value greater than or equal to zero,
- *     it denotes the number of bytes that would have been written to \c str.
+ *     it denotes the number of bytes that would have been written to \c str,
+ *     not counting the terminating null character.
  *     When this number is greater than \c strn, the string returned in \c str is incomplete.
  *
  *  @todo implement floating point formatting
@@ -42,13 +45,39 @@ int vsnprintf(char* str, size_t strn, const char* format, va_list arglist);
 int snprintf(char* str, size_t strn, const char* format, ...);
 
 /**
- * @brief Sets the current backend for kstdio.
+ * @brief Sets the current backend for kstdio. All other backends are removed.
  *
  * @param new_backend The new backend that should be used by output functions.
  * @return The old backend.
  */
 kstdio_backend_t* kstdio_set_backend(kstdio_backend_t* new_backend);
 
+/**
+ * @brief Adds a backend that receives all subsequent output.
+ *
+ * @return zero on success, -1 if the maximum number of backends is reached.
+ */
+int kstdio_add_backend(kstdio_backend_t* backend);
+
+/**
+ * @brief Removes a backend previously added with #kstdio_add_backend.
+ */
+void kstdio_remove_backend(kstdio_backend_t* backend);
+
+/**
+ * @brief Enables or disables synchronous output.
+ *
+ * Normally, output is appended to the per-CPU log rings (see klog.h) and written to
+ * the backends when the rings are drained. Synchronous output bypasses the log rings
+ * and writes to the backends directly. It is used by the panic handler.
+ */
+void kstdio_set_synchronous(int sync);
+
+/**
+ * @brief Writes exactly \c length bytes to all backends, bypassing the log rings.
+ */
+void kstdio_write(const char* message, size_t length);
+
 /**
  * @brief writes a null terminated string to the VGA buffer.
  */
@@ -0,0 +1,111 @@
+/**
+ * @file kstdio_fbcon.h
+ *
+ * @author Fabian Thorand
+ * @date   19.10.2026
+ *
+ * @brief Backend for kstdio.h that renders text to a linear framebuffer.
+ */
+#ifndef KSTDIO_FBCON_H_
+#define KSTDIO_FBCON_H_
+
+#include "kernel/klibc/kstdio.h"
+#include "kernel/helium.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+/// width of a glyph in pixels
+#define FBCON_FONT_WIDTH  8
+/// height of a glyph in pixels
+#define FBCON_FONT_HEIGHT 16
+/// number of glyphs in #fbcon_font
+#define FBCON_FONT_GLYPHS 128
+/// first character that is rendered from the glyph cache
+#define FBCON_FIRST_CHAR 0x20
+/// number of characters in the glyph cache, everything else is drawn as '?'
+#define FBCON_CACHED_CHARS (FBCON_FONT_GLYPHS - FBCON_FIRST_CHAR)
+/// number of color pairs for which rendered glyphs are kept
+#define FBCON_CACHE_SLOTS 4
+/// maximum number of text columns
+#define FBCON_MAX_COLS 256
+/// maximum number of text rows
+#define FBCON_MAX_ROWS 96
+
+/// the font, one byte per row of a glyph with bit 7 being the leftmost pixel
+extern const uint8_t fbcon_font[FBCON_FONT_GLYPHS][FBCON_FONT_HEIGHT];
+
+/// framebuffer console backend for kstdio
+extern kstdio_backend_t kstdio_fbcon;
+
+/**
+ * @brief Initializes the console for the given framebuffer.
+ *
+ * @return zero on success, -1 if the framebuffer is not supported.
+ * Only 32 bits per pixel below 4 GiB are supported.
+ */
+int fbcon_init(const he_framebuffer_t* fb);
+
+/**
+ * @brief Checks whether the console has been initialized by #fbcon_init.
+ */
+int fbcon_enabled();
+
+/**
+ * @brief Returns the number of text columns and rows of the console.
+ */
+void fbcon_get_size(uint32_t* cols, uint32_t* rows);
+
+/**
+ * @brief Clears the screen and sets the default color for subsequent output.
+ *
+ * @param color a VGA color byte, see kstdio_screen.h
+ */
+void fbcon_clear(uint8_t color);
+
+/**
+ * @brief Scrolls the text one line up.
+ */
+void fbcon_scroll();
+
+/**
+ * @brief Draws all changed characters to the framebuffer.
+ */
+void fbcon_flush();
+
+/**
+ * @brief Replaces the whole screen contents.
+ *
+ * Only the characters that differ from the current contents are drawn.
+ *
+ * @param lines one line of characters in VGA format for each text row
+ * @param col,line the new cursor position
+ * @param color the new text color
+ */
+void fbcon_load(const uint16_t* const lines[], uint32_t col, uint32_t line, uint8_t color);
+
+/**
+ * @brief Copies the whole screen contents.
+ *
+ * @param lines receives one line of characters in VGA format for each text row
+ * @param col,line receive the cursor position
+ * @param color receives the text color
+ */
+void fbcon_save(uint16_t* const lines[], uint32_t* col, uint32_t* line, uint8_t* color);
+
+/**
+ * @brief Writes a character to the console.
+ */
+void fbcon_kputchar(int chr);
+
+/**
+ * @brief Writes a null terminated string to the console.
+ */
+void fbcon_kputs(const char* msg);
+
+/**
+ * @brief Writes \c length characters to the console and updates the framebuffer once.
+ */
+void fbcon_kputsn(const char* msg, size_t length);
+
+#endif /* KSTDIO_FBCON_H_ */
@@ -19,6 +19,19 @@
 #define ROWS    25
 /// size of VGA buffer in bytes
 #define VGASIZE (COLS*ROWS*sizeof(uint16_t))
+/// size of VGA memory available in text mode in bytes
+#define VGA_MEMSIZE 0x8000
+/// number of text lines fitting into VGA memory
+#define VGA_LINES (VGA_MEMSIZE / (COLS*sizeof(uint16_t)))
+
+/// CRTC index register port
+#define VGA_CRTC_INDEX 0x3D4
+/// CRTC data register port
+#define VGA_CRTC_DATA 0x3D5
+/// CRTC register containing the high byte of the start address
+#define VGA_CRTC_START_HIGH 0x0C
+/// CRTC register containing the low byte of the start address
+#define VGA_CRTC_START_LOW 0x0D
 
 
 /**
@@ -28,14 +41,14 @@
  *
  * @remark ATTENTION! does not perform bound checks.
  */
-#define VGAPTR(x,y) ((volatile uint16_t*)VGAMEM + y * COLS + x)
+#define VGAPTR(x,y) ((volatile uint16_t*)VGAMEM + (y) * COLS + (x))
 
 /**
  * Calculates a VGA color byte from fore- and background color.
  */
 #define VGACOLOR(BG,FG) (((BG) << 4) | ((FG) & 0x0F))
-#define VGASETFG(C,FG) ((C & 0xF0) | ((FG) & 0x0F))
-#define VGASETBG(C,BG) ((C & 0x0F) | ((BG) & 0xF0))
+#define VGASETFG(C,FG) (((C) & 0xF0) | ((FG) & 0x0F))
+#define VGASETBG(C,BG) (((C) & 0x0F) | (((BG) << 4) & 0xF0))
 /// the light color or blink bit
 #define LIGHT_OR_BLINK 0x8
 #define BLACK   0x0
@@ -83,13 +96,46 @@ int screen_pop_color();
 void screen_clear(uint8_t color);
 
 /**
- * @brief scrolls the VGA buffer one line up
+ * @brief scrolls the screen one line up
  */
 void screen_scroll();
 
 /**
- * @brief Writes a character directly to the screen.
+ * @brief Copies all changed lines from the shadow buffer to VGA memory.
+ */
+void screen_flush();
+
+/**
+ * @brief Replaces the whole screen contents.
+ *
+ * @param lines #ROWS lines of #COLS characters in VGA format
+ * @param col,line the new cursor position
+ * @param color the new text color
+ */
+void screen_load(const uint16_t* const lines[], uint32_t col, uint32_t line, uint8_t color);
+
+/**
+ * @brief Copies the whole screen contents.
+ *
+ * @param lines receives #ROWS lines of #COLS characters in VGA format
+ * @param col,line receive the cursor position
+ * @param color receives the text color
+ */
+void screen_save(uint16_t* const lines[], uint32_t* col, uint32_t* line, uint8_t* color);
+
+/**
+ * @brief Writes a character to the screen.
  */
 void screen_kputchar(int chr);
 
+/**
+ * @brief Writes a null terminated string to the screen.
+ */
+void screen_kputs(const char* msg);
+
+/**
+ * @brief Writes \c length characters to the screen and updates VGA memory once.
+ */
+void screen_kputsn(const char* msg, size_t length);
+
 #endif /* KSTDIO_SCREEN_H_ */
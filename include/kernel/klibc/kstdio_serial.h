@@ -0,0 +1,120 @@
+/**
+ * @file kstdio_serial.h
+ *
+ * @author Fabian Thorand
+ * @date   19.10.2026
+ *
+ * @brief Backend for kstdio.h that writes to a 16550 compatible UART.
+ */
+#ifndef KSTDIO_SERIAL_H_
+#define KSTDIO_SERIAL_H_
+
+#include "kernel/klibc/kstdio.h"
+
+#include <stddef.h>
+
+/// I/O port base of COM1
+#define SERIAL_COM1 0x3F8
+/// legacy IRQ line of COM1
+#define SERIAL_COM1_IRQ 4
+/// baud rate used for the kernel console
+#define SERIAL_BAUD 115200
+/// size of the transmit FIFO of a 16550A
+#define SERIAL_FIFO_SIZE 16
+/// size of the transmit ring in bytes, must be a power of two
+#define SERIAL_RING_SIZE 0x1000
+
+/// transmit/receive buffer (DLAB = 0)
+#define SERIAL_REG_DATA 0
+/// interrupt enable register (DLAB = 0)
+#define SERIAL_REG_IER  1
+/// interrupt identification (read) and FIFO control (write) register
+#define SERIAL_REG_IIR  2
+#define SERIAL_REG_FCR  2
+/// line control register
+#define SERIAL_REG_LCR  3
+/// modem control register
+#define SERIAL_REG_MCR  4
+/// line status register
+#define SERIAL_REG_LSR  5
+/// divisor latch low/high byte (DLAB = 1)
+#define SERIAL_REG_DLL  0
+#define SERIAL_REG_DLM  1
+
+/// IER: interrupt when the transmitter holding register is empty
+#define SERIAL_IER_THRE 0x02
+/// LCR: divisor latch access bit
+#define SERIAL_LCR_DLAB 0x80
+/// LCR: 8 data bits, no parity, one stop bit
+#define SERIAL_LCR_8N1  0x03
+/// FCR: enable and clear FIFOs, receive trigger level 14 bytes
+#define SERIAL_FCR_ENABLE 0xC7
+/// MCR: DTR, RTS and OUT2 (gates the IRQ line)
+#define SERIAL_MCR_DEFAULT 0x0B
+/// MCR: loopback mode for self test
+#define SERIAL_MCR_LOOPBACK 0x1E
+/// LSR: transmit FIFO is empty
+#define SERIAL_LSR_THRE 0x20
+/// IIR: no interrupt pending
+#define SERIAL_IIR_NONE 0x01
+/// IIR: mask for interrupt identification
+#define SERIAL_IIR_ID_MASK 0x0E
+/// IIR: transmitter holding register empty
+#define SERIAL_IIR_THRE 0x02
+
+/// serial backend for kstdio
+extern kstdio_backend_t kstdio_serial;
+
+/**
+ * @brief Initializes COM1 for output with #SERIAL_BAUD baud.
+ *
+ * @return zero on success, -1 if no UART was detected.
+ */
+int serial_init();
+
+/**
+ * @brief Switches from polled to interrupt driven transmission.
+ *
+ * Must be called after the interrupt handler #serial_interrupt
+ * has been installed for #SERIAL_COM1_IRQ.
+ */
+void serial_enable_irq();
+
+/**
+ * @brief Stops using the ring and writes all further output directly to the UART.
+ *
+ * Used by the panic handler, which may have interrupted a writer. Text still in the ring
+ * is sent first, the ring itself is left untouched. Bytes another processor is sending
+ * at the same time may appear twice.
+ */
+void serial_set_direct();
+
+/**
+ * @brief Interrupt handler of the UART, refills the transmit FIFO from the ring.
+ */
+void serial_interrupt();
+
+/**
+ * @brief Writes a character to the serial port.
+ */
+void serial_kputchar(int chr);
+
+/**
+ * @brief Writes a null terminated string to the serial port.
+ */
+void serial_kputs(const char* msg);
+
+/**
+ * @brief Writes \c length characters to the serial port.
+ */
+void serial_kputsn(const char* msg, size_t length);
+
+/**
+ * @brief Compares sending text through the ring with polling the line status before every byte,
+ * which is how characters were written before the ring existed, and logs the result.
+ *
+ * Both methods send the same lines to the serial port. Must be called with interrupts enabled.
+ */
+void serial_benchmark();
+
+#endif /* KSTDIO_SERIAL_H_ */
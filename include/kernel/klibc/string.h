@@ -13,6 +13,8 @@
 void* memset(void* ptr, int value, size_t num);
 void* memcpy(void* destination, const void* source, size_t num);
 void* memmove(void* destination, const void* source, size_t num);
+void* memchr(const void* ptr, int value, size_t num);
+int memcmp(const void* ptr1, const void* ptr2, size_t num);
 
 char* strcpy(char* destination, const char* source);
 char* strcat(char* destination, const char* source);
@@ -20,5 +22,6 @@ char* strcat(char* destination, const char* source);
 int strcmp(const char* str1, const char* str2);
 int strncmp(const char* s1, const char* s2, size_t n);
 size_t strlen(const char* str);
+size_t strnlen(const char* str, size_t maxlen);
 
 #endif /* STRING_H_ */
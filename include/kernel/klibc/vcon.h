@@ -0,0 +1,92 @@
+/**
+ * @file vcon.h
+ *
+ * @author Fabian Thorand
+ * @date   19.10.2026
+ *
+ * @brief Virtual consoles on top of the screen backends.
+ *
+ * Each virtual console keeps its text in a scrollback ring in RAM. Only the active
+ * console forwards its output to the display, writing to any other console does not
+ * touch video memory. Switching consoles copies the visible page to the display.
+ */
+#ifndef VCON_H_
+#define VCON_H_
+
+#include "kernel/klibc/kstdio.h"
+#include "kernel/klibc/ansi.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+/// number of virtual consoles
+#define VCON_COUNT 4
+/// number of lines kept by each console, must be a power of two
+#define VCON_LINES 256
+
+/**
+ * @brief The display showing the active virtual console.
+ */
+typedef struct {
+    /// backend receiving the output of the active console
+    kstdio_backend_t* backend;
+    /// number of text columns
+    uint32_t cols;
+    /// number of text rows
+    uint32_t rows;
+    /// replaces the display contents with \c rows lines, see #screen_load
+    void (*load)(const uint16_t* const lines[], uint32_t col, uint32_t line, uint8_t color);
+    /// copies the display contents to \c rows lines, see #screen_save
+    void (*save)(uint16_t* const lines[], uint32_t* col, uint32_t* line, uint8_t* color);
+} vcon_display_t;
+
+/**
+ * @brief State of a virtual console.
+ */
+typedef struct {
+    uint16_t* cells;        ///< #VCON_LINES lines of characters in VGA format
+    uint64_t  line;         ///< number of the cursor line since the console was created
+    uint32_t  col;          ///< cursor column
+    uint8_t   color;        ///< current text color
+    ansi_parser_t ansi;     ///< state of the escape sequence parser
+} vcon_t;
+
+/// kstdio backends writing to the virtual consoles
+extern kstdio_backend_t vcon_backends[VCON_COUNT];
+
+/**
+ * @brief Allocates the scrollback buffers and uses the framebuffer console as display
+ * if it is enabled, otherwise the VGA text screen. Console 0 is active afterwards and
+ * holds the current display contents.
+ *
+ * Must be called after #pfa_init.
+ * @return zero on success, -1 if there is not enough memory.
+ */
+int vcon_init();
+
+/**
+ * @brief Writes \c length characters to a virtual console.
+ *
+ * Writes to the same console must not happen concurrently.
+ */
+void vcon_write(unsigned int index, const char* msg, size_t length);
+
+/**
+ * @brief Shows the virtual console \c index on the display.
+ */
+void vcon_switch(unsigned int index);
+
+/**
+ * @brief Returns the index of the console shown on the display.
+ */
+unsigned int vcon_active();
+
+/**
+ * @brief Scrolls the view of the active console back into its history.
+ *
+ * @param lines number of lines to scroll back, negative values scroll forward.
+ * The view returns to the live output when it reaches the cursor line.
+ */
+void vcon_scroll_view(int lines);
+
+#endif /* VCON_H_ */
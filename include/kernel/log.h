@@ -0,0 +1,81 @@
+/**
+ * @file log.h
+ *
+ * @author Fabian Thorand
+ * @date   19.10.2026
+ *
+ * @brief Kernel logging with per-subsystem categories and levels.
+ *
+ * Messages above the compile time level \c HE_LOG_LEVEL (see config.h) are removed
+ * by the compiler including the evaluation of their arguments. The remaining messages
+ * are filtered at runtime by a level per category, see #log_set_level.
+ *
+ * Example:
+ *
+ *     LOG_DEBUG(LOG_CAT_MEM, "mapped %p to %p\n", vaddr, paddr);
+ */
+#ifndef LOG_H_
+#define LOG_H_
+
+#include "kernel/config.h"
+
+#include <stdint.h>
+
+#define LOG_LEVEL_ERROR 0   ///< failures the kernel may not recover from
+#define LOG_LEVEL_WARN  1   ///< unexpected conditions that are handled
+#define LOG_LEVEL_INFO  2   ///< progress messages
+#define LOG_LEVEL_DEBUG 3   ///< detailed information for debugging
+
+/// number of log levels
+#define LOG_LEVELS 4
+
+#ifndef HE_LOG_LEVEL
+#define HE_LOG_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+/**
+ * @brief Log categories, one per subsystem.
+ */
+typedef enum {
+    LOG_CAT_CORE,   ///< initialization and everything without a category
+    LOG_CAT_MEM,    ///< physical and virtual memory management
+    LOG_CAT_INT,    ///< interrupts and interrupt controllers
+    LOG_CAT_TIME,   ///< clocks and timers
+    LOG_CAT_SMP,    ///< multiprocessor bring-up and communication
+    LOG_CAT_SCHED,  ///< threads and scheduling
+    LOG_CAT_DEV,    ///< device drivers
+    LOG_CAT_COUNT
+} log_category_t;
+
+/// runtime level of each category, messages above it are discarded
+extern uint8_t log_levels[LOG_CAT_COUNT];
+
+/**
+ * @brief Writes a message if it passes both the compile time and the runtime filter.
+ */
+#define LOG(cat,level,...) \
+    do { \
+        if((level) <= HE_LOG_LEVEL && (level) <= log_levels[cat]) { \
+            log_printf(cat, level, __VA_ARGS__); \
+        } \
+    } while(0)
+
+#define LOG_ERROR(cat,...) LOG(cat, LOG_LEVEL_ERROR, __VA_ARGS__)
+#define LOG_WARN(cat,...)  LOG(cat, LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_INFO(cat,...)  LOG(cat, LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_DEBUG(cat,...) LOG(cat, LOG_LEVEL_DEBUG, __VA_ARGS__)
+
+/**
+ * @brief Formats a message with category prefix and level color and writes it
+ * as a single record. Use the \c LOG_* macros instead.
+ */
+void log_printf(log_category_t cat, int level, const char* format, ...) __attribute__((format(printf, 3, 4)));
+
+/**
+ * @brief Sets the runtime level of a category.
+ *
+ * Levels above \c HE_LOG_LEVEL have no effect because those messages are not compiled in.
+ */
+void log_set_level(log_category_t cat, int level);
+
+#endif /* LOG_H_ */
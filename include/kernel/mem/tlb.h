@@ -0,0 +1,102 @@
+/**
+ * @file tlb.h
+ *
+ * @author Fabian Thorand
+ * @date   19.10.2026
+ *
+ * @brief Batched TLB shootdown.
+ *
+ * After changing page tables, the stale translations must be invalidated on every
+ * processor that may have cached them. The pages of one operation are collected in a
+ * #tlb_batch_t and #tlb_batch_flush invalidates them with one IPI per processor that
+ * has the address space active. Kernel addresses are active everywhere. Batches of
+ * more than #TLB_BATCH_PAGES pages flush the whole TLB instead.
+ *
+ * #tlb_batch_flush does not wait for the other processors. Until #tlb_wait returns,
+ * they may still use the old translations, so the page frames and page tables that
+ * were unmapped must not be reused before that.
+ *
+ * Example:
+ *
+ *     tlb_batch_t batch;
+ *     tlb_batch_init(&batch, pml4t);
+ *     for(...) {
+ *         vmm_unmap(pml4t, vaddr);
+ *         tlb_batch_add(&batch, vaddr);
+ *     }
+ *     tlb_batch_flush(&batch);
+ *     ... // work not depending on the unmapped pages
+ *     tlb_wait();
+ *     ... // free the page frames
+ */
+#ifndef TLB_H_
+#define TLB_H_
+
+#include <stdint.h>
+
+/// vector of the shootdown IPI
+#define TLB_VECTOR_SHOOTDOWN 0xFC
+/// maximum number of pages invalidated one by one, larger batches flush the TLB
+#define TLB_BATCH_PAGES 32
+
+/**
+ * @brief Pages of one operation that must be invalidated.
+ */
+typedef struct {
+    uintptr_t pml4t;                    ///< physical address of the PML4T of the address space
+    int global;                         ///< non-zero, if a kernel address was added
+    int full;                           ///< non-zero, if the whole TLB must be flushed
+    unsigned int count;                 ///< number of entries in \c pages
+    uintptr_t pages[TLB_BATCH_PAGES];   ///< virtual addresses of the pages
+} tlb_batch_t;
+
+/**
+ * @brief Registers the shootdown handler and initializes the bootstrap processor.
+ */
+void tlb_init();
+
+/**
+ * @brief Records the active address space of the current processor. Must be called on every processor.
+ */
+void tlb_init_cpu();
+
+/**
+ * @brief Records that the current processor switched to another address space.
+ *
+ * @param pml4t physical address of the PML4T loaded into CR3
+ */
+void tlb_activate(uintptr_t pml4t);
+
+/**
+ * @brief Starts an empty batch for an address space.
+ */
+void tlb_batch_init(tlb_batch_t* batch, uintptr_t pml4t);
+
+/**
+ * @brief Adds a page to a batch.
+ */
+void tlb_batch_add(tlb_batch_t* batch, uintptr_t vaddr);
+
+/**
+ * @brief Invalidates the pages of a batch on all processors and empties it.
+ *
+ * The local TLB is invalidated on return, the other processors are only notified.
+ * Waits for the previous shootdown of this processor to complete.
+ */
+void tlb_batch_flush(tlb_batch_t* batch);
+
+/**
+ * @brief Waits until the last shootdown started on this processor completed everywhere.
+ *
+ * May be called with interrupts disabled, requests of other processors are served while waiting.
+ */
+void tlb_wait();
+
+/**
+ * @brief Measures the cost of unmapping pages with 1 to all online processors as targets.
+ *
+ * Must be called on the bootstrap processor after #smp_init.
+ */
+void tlb_benchmark();
+
+#endif /* TLB_H_ */
@@ -9,6 +9,9 @@
 #ifndef VMM_H_
 #define VMM_H_
 
+#include <stddef.h>
+#include <stdint.h>
+
 /// virtual base address of kernel space
 #define VMM_KERNEL_BASE 0xFFFFFFFF80000000
 
@@ -75,6 +78,65 @@
 /// Returns the address from a page table entry.
 #define VMM_PT_ADDR(entry) ((entry) & 0x000FFFFFFFFFF000)
 
+/**
+ * @brief returns the physical address of the current PML4T
+ */
+uintptr_t vmm_get_pml4t();
+
+/**
+ * @brief Sets the current PML4T.
+ *
+ * @param Physical address of PML4T.
+ * @remark Caution, only use a root page table where
+ * kernel space is mapped to the same location.
+ *
+ * Calling this function also flushes the TLB.
+ */
+void vmm_set_pml4t(uintptr_t pml4t);
+
+/**
+ * @brief Invalidates the given page on the current processor only.
+ * @param Virtual address of the invalidated page.
+ *
+ * Use #vmm_unmap_range or a tlb_batch_t when other processors may have the page cached.
+ */
+void vmm_invalidate(uintptr_t page);
+
+/**
+ * @brief Maps a virtual address to a physical page.
+ *
+ * @param pml4t_p physical address of PML4T
+ * @param paddr Physical address of the page frame.
+ * @param vaddr Virtual address where the page frame should be mapped
+ * @param level The level of the page mapping
+ * @param createFlags Flags for mapping newly created page tables. If this parameter is zero, no new page tables are created.
+ * @param mapFlags Flags of the mapping.
+ *
+ * @return \c 0 on success, a negative value on failure (see vmm.c).
+ */
+int vmm_map(uintptr_t pml4t_p, uintptr_t paddr, uintptr_t vaddr, int level, uint64_t createFlags, uint64_t mapFlags);
+
+/**
+ * @brief Unmaps a virtual address previously mapped with #vmm_map
+ *
+ * The TLBs are not invalidated, see tlb.h.
+ *
+ * @param pml4t_p Physical address of the PML4T.
+ * @param vaddr Virtual address to unmap.
+ */
+int vmm_unmap(uintptr_t pml4t_p, uintptr_t vaddr);
+
+/**
+ * @brief Unmaps consecutive pages and invalidates them on all processors.
+ *
+ * @param pml4t_p Physical address of the PML4T.
+ * @param vaddr Virtual address of the first page.
+ * @param count Number of 4 KiB pages.
+ *
+ * @return \c 0 on success, \c -1 if a page table did not exist.
+ */
+int vmm_unmap_range(uintptr_t pml4t_p, uintptr_t vaddr, size_t count);
+
 /**
  * @brief Initializes the virtual memory manager.
  */
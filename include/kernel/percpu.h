@@ -0,0 +1,97 @@
+/**
+ * @file percpu.h
+ *
+ * @author Fabian Thorand
+ * @date   19.10.2026
+ *
+ * @brief Per-CPU variables reached through the GS base.
+ *
+ * Variables defined with #PERCPU_DEFINE are placed in the \c .percpu section, which
+ * serves as template. #percpu_init gives every usable processor a copy and #percpu_init_cpu
+ * points its GS base to the copy, minus the start of the template. A variable is then
+ * addressed as \c %gs:var, so the accessors compile to a single instruction with the
+ * link-time address of the variable as displacement.
+ *
+ * The kernel GS base is active while in the kernel. The entry stubs execute \c swapgs
+ * when an interrupt arrives from or returns to user mode.
+ *
+ * Example:
+ *
+ *     PERCPU_DEFINE(uint64_t, ticks);
+ *     ...
+ *     PERCPU_INC(ticks);
+ *     uint64_t now = PERCPU_READ(ticks);
+ */
+#ifndef PERCPU_H_
+#define PERCPU_H_
+
+#include "kernel/helium.h"
+
+#include <stdint.h>
+
+/// IA32_GS_BASE MSR, the GS base in use
+#define PERCPU_MSR_GS_BASE 0xC0000101
+/// IA32_KERNEL_GS_BASE MSR, exchanged with the GS base by swapgs
+#define PERCPU_MSR_KERNEL_GS_BASE 0xC0000102
+
+/// defines a per-CPU variable, the initializer is copied to every processor
+#define PERCPU_DEFINE(type, name) __attribute__((section(".percpu"))) __typeof__(type) name
+/// declares a per-CPU variable defined in another file
+#define PERCPU_DECLARE(type, name) extern __typeof__(type) name
+
+/// reads a per-CPU variable of the current processor
+#define PERCPU_READ(var) ({ \
+    __typeof__(var) percpu_value_; \
+    asm volatile ("mov %%gs:%c1, %0" : "=q"(percpu_value_) : "i"(&(var))); \
+    percpu_value_; })
+
+/// writes a per-CPU variable of the current processor
+#define PERCPU_WRITE(var, value) \
+    asm volatile ("mov %1, %%gs:%c0" : : "i"(&(var)), "q"((__typeof__(var))(value)) : "memory")
+
+/// adds to a per-CPU integer of the current processor, atomic with respect to interrupts
+#define PERCPU_ADD(var, value) \
+    asm volatile ("add %1, %%gs:%c0" : : "i"(&(var)), "q"((__typeof__(var))(value)) : "memory", "cc")
+
+/// increments a per-CPU integer of the current processor
+#define PERCPU_INC(var) PERCPU_ADD(var, 1)
+
+/// decrements a per-CPU integer of the current processor
+#define PERCPU_DEC(var) PERCPU_ADD(var, -1)
+
+/// returns a pointer to a per-CPU variable of the current processor
+#define PERCPU_PTR(var) ((__typeof__(&(var))) (PERCPU_READ(percpu_offset) + (uintptr_t)&(var)))
+
+/// returns a pointer to a per-CPU variable of the processor with index \c cpu
+#define PERCPU_REMOTE(var, cpu) ((__typeof__(&(var))) (percpu_offsets[cpu] + (uintptr_t)&(var)))
+
+/// difference between the copy of the current processor and the template
+PERCPU_DECLARE(uintptr_t, percpu_offset);
+/// index of the current processor, see #percpu_cpu
+PERCPU_DECLARE(unsigned int, percpu_index);
+
+/// difference between the copy of each processor and the template, zero if there is none
+extern uintptr_t percpu_offsets[HE_MAX_CPUS];
+
+/**
+ * @brief Returns the index of the current processor.
+ *
+ * Same as cpu_index, but without executing \c cpuid. Only valid after #percpu_init_cpu.
+ */
+static inline unsigned int percpu_cpu() {
+    return PERCPU_READ(percpu_index);
+}
+
+/**
+ * @brief Copies the template for every usable processor and sets up the bootstrap processor.
+ *
+ * Must be called once after the page frame allocator is initialized and ACPI was parsed.
+ */
+void percpu_init();
+
+/**
+ * @brief Loads the GS base of the current processor. Must be called on every processor.
+ */
+void percpu_init_cpu();
+
+#endif /* PERCPU_H_ */
@@ -0,0 +1,63 @@
+/**
+ * @file deque.h
+ *
+ * @author Fabian Thorand
+ * @date   19.10.2026
+ *
+ * @brief Bounded lock-free work-stealing deque after Chase and Lev.
+ *
+ * Only the owner pushes items, at the bottom. Items are taken from the top by
+ * #deque_steal, both by the owner and by other processors, so the deque hands out its
+ * items in the order they were pushed. Takers race for the top with a compare-and-swap,
+ * the owner never waits for them.
+ *
+ * The array has a fixed size. A push fails instead of growing it, so slots are only
+ * reused after the item in them was taken.
+ */
+#ifndef DEQUE_H_
+#define DEQUE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// number of slots of a deque, a power of two
+#define DEQUE_SIZE 256
+
+/**
+ * @brief A work-stealing deque of pointers.
+ */
+typedef struct {
+    /// index of the oldest item, advanced by takers
+    volatile int64_t top;
+    /// index of the next push, advanced by the owner, on its own cache line
+    volatile int64_t bottom __attribute__((aligned(64)));
+    /// slots, indexed modulo #DEQUE_SIZE
+    void* volatile items[DEQUE_SIZE];
+} deque_t;
+
+/// static initializer of an empty #deque_t
+#define DEQUE_INIT { .top = 0, .bottom = 0 }
+
+/**
+ * @brief Evaluates to the number of items in a deque.
+ *
+ * The value may be stale, and even negative while a taker races with the owner.
+ * A macro, so that it can be used on the fast interrupt path.
+ */
+#define DEQUE_COUNT(deque) ((deque)->bottom - (deque)->top)
+
+/**
+ * @brief Appends an item at the bottom. Must only be called by the owner.
+ *
+ * @return non-zero on success, zero if the deque is full
+ */
+int deque_push(deque_t* deque, void* item);
+
+/**
+ * @brief Takes the oldest item from the top. May be called by any processor.
+ *
+ * @return the item, or \c NULL if the deque is empty
+ */
+void* deque_steal(deque_t* deque);
+
+#endif /* DEQUE_H_ */
@@ -0,0 +1,47 @@
+/**
+ * @file preempt.h
+ *
+ * @author Fabian Thorand
+ * @date   19.10.2026
+ *
+ * @brief Disabling preemption of kernel threads.
+ *
+ * Kernel threads are preempted when an interrupt returns to code with interrupts enabled.
+ * Code that must stay on the current processor without disabling interrupts, like the
+ * holder of a spinlock or an RCU reader, disables preemption instead. This only
+ * increments a per-CPU counter, so the sections may nest and cost no atomic operation.
+ * A preemption requested meanwhile happens on the next interrupt after the counter
+ * dropped to zero.
+ *
+ * The macros may be used on the fast interrupt path.
+ */
+#ifndef PREEMPT_H_
+#define PREEMPT_H_
+
+#include "kernel/percpu.h"
+
+/// number of nested sections disabling preemption on each processor
+PERCPU_DECLARE(unsigned int, preempt_count);
+
+/**
+ * @brief Disables preemption of the current thread.
+ */
+#define PREEMPT_DISABLE() do { \
+    PERCPU_INC(preempt_count); \
+    asm volatile ("" : : : "memory"); \
+} while(0)
+
+/**
+ * @brief Enables preemption again, if this ends the outermost section.
+ */
+#define PREEMPT_ENABLE() do { \
+    asm volatile ("" : : : "memory"); \
+    PERCPU_DEC(preempt_count); \
+} while(0)
+
+/**
+ * @brief Evaluates to non-zero, if the current thread may be preempted.
+ */
+#define PREEMPT_ENABLED() (PERCPU_READ(preempt_count) == 0)
+
+#endif /* PREEMPT_H_ */
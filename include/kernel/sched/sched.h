@@ -0,0 +1,210 @@
+/**
+ * @file sched.h
+ *
+ * @author Fabian Thorand
+ * @date   19.10.2026
+ *
+ * @brief Preemptive kernel threads with per-CPU run queues.
+ *
+ * Every processor has a run queue of ready threads served round robin, and an idle
+ * thread, which is the context that booted the processor. A thread runs until it
+ * yields, sleeps or exits, or until the timer tick ends its time slice while other
+ * threads are ready. Preemption happens when an interrupt returns to a thread with
+ * interrupts and preemption enabled (see preempt.h).
+ *
+ * The timer is programmed in one-shot mode for the next event of a processor only. It
+ * ticks while the running thread shares the processor with ready threads or RCU needs it,
+ * and otherwise fires only for the next tick of the timer wheel (see timer.h), which holds
+ * the sleep timeouts. So idle processors and processors running a single thread are not
+ * woken needlessly.
+ *
+ * Idle processors steal ready threads from busy ones, preferring those that share caches
+ * with them (see sched.c).
+ *
+ * A context switch only saves the callee saved registers and the stack pointer, because
+ * it is a function call. The SSE state of a preempted thread is saved by the interrupt
+ * entry path.
+ *
+ * #sched_sleep and #sched_wakeup work like a binary semaphore per thread: a wakeup sent
+ * before the thread sleeps makes the next sleep return immediately, so no wakeup is lost.
+ *
+ * Example:
+ *
+ *     static void worker(void* arg) {
+ *         while(1) {
+ *             sched_sleep(0);
+ *             ... // process the requests
+ *         }
+ *     }
+ *     ...
+ *     thread_t* thread = sched_create("worker", worker, NULL, percpu_cpu());
+ *     ...
+ *     sched_wakeup(thread);
+ */
+#ifndef SCHED_H_
+#define SCHED_H_
+
+#include "kernel/interrupts/int.h"
+#include "kernel/sched/timer.h"
+#include "kernel/percpu.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// size of the stack of a kernel thread in pages, the #thread_t is stored below it
+#define SCHED_STACK_PAGES 4
+/// period of the timer tick in microseconds while it runs, also the time slice of a thread
+#define SCHED_TICK_US 10000
+/// vector of the IPI that makes a processor reschedule
+#define SCHED_VECTOR_RESCHED 0xFB
+
+/**
+ * @brief States of a thread.
+ */
+typedef enum {
+    THREAD_READY,       ///< in the run queue, or the idle thread while it does not run
+    THREAD_RUNNING,     ///< the current thread of a processor
+    THREAD_SLEEPING,    ///< waiting for #sched_wakeup or its timeout
+    THREAD_DEAD         ///< exited, the stack is freed after the next switch
+} thread_state_t;
+
+/**
+ * @brief Function executed by a kernel thread. The thread exits when it returns.
+ */
+typedef void (*thread_func_t)(void* arg);
+
+/**
+ * @brief A kernel thread.
+ */
+typedef struct thread {
+    uintptr_t rsp;                  ///< saved stack pointer while the thread does not run
+    struct thread* next;            ///< next thread in the run queue list
+    volatile thread_state_t state;  ///< current state
+    unsigned int cpu;               ///< processor whose run queue holds the thread
+    uint64_t id;                    ///< unique number
+    const char* name;               ///< name for debugging
+    thread_func_t func;             ///< function executed by the thread
+    void* arg;                      ///< argument of \c func
+    timer_t timer;                  ///< timeout of #sched_sleep
+    volatile int wakeup;            ///< non-zero, if a wakeup arrived while the thread was not sleeping
+    int woken;                      ///< non-zero, if the last sleep was ended by #sched_wakeup
+} thread_t;
+
+/// non-zero, if the current processor should switch threads when the interrupt returns
+PERCPU_DECLARE(volatile int, sched_resched);
+
+/**
+ * @brief Evaluates to non-zero, if the current processor should switch threads.
+ *
+ * Used by #int_dispatch on the fast path.
+ */
+#define SCHED_RESCHED_PENDING() (PERCPU_READ(sched_resched) != 0)
+
+/**
+ * @brief Makes the boot context of the bootstrap processor its idle thread.
+ *
+ * Must be called after #percpu_init.
+ */
+void sched_init();
+
+/**
+ * @brief Makes the boot context of an application processor its idle thread.
+ */
+void sched_init_cpu();
+
+/**
+ * @brief Starts the timer tick and work stealing on all online processors.
+ *
+ * Must be called on the bootstrap processor after #smp_init. Without a tick, threads
+ * switch only when they yield, sleep or exit.
+ */
+void sched_start();
+
+/**
+ * @brief Reprograms the LAPIC timer of the current processor after its timer wheel changed.
+ *
+ * Called by timer.c with interrupts disabled.
+ */
+void sched_timer_rearm();
+
+/**
+ * @brief Makes busy processors without timer tick check whether they need it again.
+ *
+ * Used by RCU when a grace period starts that waits for them.
+ *
+ * @param cpus processors to check, others are ignored
+ */
+void sched_nohz_kick(uint64_t cpus);
+
+/**
+ * @brief Creates a thread and queues it on a processor.
+ *
+ * @param name name for debugging
+ * @param func function executed by the thread
+ * @param arg argument of \c func
+ * @param cpu index of the processor
+ * @return the thread, or \c NULL if no memory was available
+ */
+thread_t* sched_create(const char* name, thread_func_t func, void* arg, unsigned int cpu);
+
+/**
+ * @brief Returns the thread running on the current processor.
+ */
+thread_t* sched_current();
+
+/**
+ * @brief Lets the other ready threads of the current processor run first.
+ */
+void sched_yield();
+
+/**
+ * @brief Sleeps until #sched_wakeup is called or \c us microseconds passed.
+ *
+ * Returns immediately, if a wakeup arrived since the last sleep.
+ * Must not be called with preemption disabled.
+ *
+ * @param us timeout in microseconds, rounded up to a tick of the timer wheel, zero to sleep
+ * without timeout
+ * @return non-zero, if the thread was woken by #sched_wakeup
+ */
+int sched_sleep(uint64_t us);
+
+/**
+ * @brief Wakes a sleeping thread, or makes its next sleep return immediately.
+ *
+ * May be called with interrupts disabled, but not from fast interrupt handlers.
+ */
+void sched_wakeup(thread_t* thread);
+
+/**
+ * @brief Ends the current thread.
+ */
+void sched_exit() __attribute__((noreturn));
+
+/**
+ * @brief Runs the idle loop of the current processor. Called at the end of the boot code.
+ */
+void sched_idle() __attribute__((noreturn));
+
+/**
+ * @brief Switches threads when an interrupt returns, if it was requested and is allowed.
+ *
+ * Called by #int_return with interrupts disabled and the SSE state saved.
+ */
+void sched_preempt_irq();
+
+/**
+ * @brief Measures the cost of context switches on the current processor and the fork-join
+ * throughput with work stealing, and logs the results.
+ *
+ * Must be called before #sched_start.
+ */
+void sched_benchmark();
+
+/**
+ * @brief Writes the topology, the number of context switches and steals and the timer
+ * wakeups of each processor to kstdio.
+ */
+void sched_dump();
+
+#endif /* SCHED_H_ */
@@ -0,0 +1,131 @@
+/**
+ * @file timer.h
+ *
+ * @author Fabian Thorand
+ * @date   19.10.2026
+ *
+ * @brief Per-CPU hierarchical timer wheels for timeouts.
+ *
+ * Timers are kept in a wheel of #TIMER_LEVELS levels of #TIMER_SLOTS slots each. A slot
+ * of level 0 holds the timers of one tick of #TIMER_TICK_US, a slot of level \c n those
+ * of #TIMER_SLOTS^n ticks. When the wheel reaches a slot of a higher level, its timers are
+ * cascaded into the lower levels. Adding and cancelling a timer costs O(1), which suits
+ * timeouts that are mostly cancelled before they expire.
+ *
+ * The scheduler programs the LAPIC timer for the next tick that has work (see sched.h),
+ * so all timers of a tick share one interrupt. A timer may also allow some slack, which
+ * moves it to a round tick that other timers are likely to share.
+ *
+ * Callbacks run as deferred work (see softirq.h) on the processor the timer was added
+ * on, once #sched_start handed the LAPIC timer to the scheduler.
+ *
+ * Example:
+ *
+ *     static void request_timeout(timer_t* timer) {
+ *         request_t* request = (request_t*)((uintptr_t)timer - offsetof(request_t, timer));
+ *         ... // retransmit
+ *     }
+ *     ...
+ *     timer_init_timer(&request->timer, request_timeout);
+ *     uint64_t timeout = clock_ns_to_tsc(50 * CLOCK_NS_PER_US);
+ *     timer_add(&request->timer, cpu_rdtsc() + timeout, timeout / 8);
+ *     ...
+ *     timer_cancel(&request->timer);
+ */
+#ifndef TIMER_H_
+#define TIMER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// length of a tick of the wheels in microseconds
+#define TIMER_TICK_US 100
+/// number of bits of the slot index of each level
+#define TIMER_SLOT_BITS 6
+/// number of slots of each level
+#define TIMER_SLOTS (1 << TIMER_SLOT_BITS)
+/// number of levels, the wheels span #TIMER_SLOTS^#TIMER_LEVELS ticks
+#define TIMER_LEVELS 4
+
+struct timer;
+
+/**
+ * @brief Function called when a timer expires.
+ */
+typedef void (*timer_func_t)(struct timer* timer);
+
+/**
+ * @brief A timer. Usually embedded in the structure it belongs to.
+ */
+typedef struct timer {
+    struct timer* next;     ///< next timer in the same list
+    struct timer** pprev;   ///< link pointing to this timer, \c NULL if the timer is not pending
+    uint64_t expires;       ///< tick of the expiry
+    timer_func_t func;      ///< function called on expiry
+    unsigned int cpu;       ///< processor whose wheel holds the timer
+    unsigned int slot;      ///< slot in the wheel, level * #TIMER_SLOTS + index
+} timer_t;
+
+/// static initializer of a #timer_t
+#define TIMER_INIT(f) { NULL, NULL, 0, (f), 0, 0 }
+
+/**
+ * @brief Converts the tick length to TSC cycles. Must be called after #clock_init.
+ */
+void timer_init();
+
+/**
+ * @brief Initializes a timer.
+ */
+void timer_init_timer(timer_t* timer, timer_func_t func);
+
+/**
+ * @brief Adds a timer to the wheel of the current processor.
+ *
+ * The timer must not be pending. It expires on the first tick at or after \c deadline,
+ * or up to \c slack cycles later on a round tick.
+ *
+ * @param deadline TSC value of the expiry
+ * @param slack number of TSC cycles the expiry may be delayed for coalescing
+ */
+void timer_add(timer_t* timer, uint64_t deadline, uint64_t slack);
+
+/**
+ * @brief Removes a pending timer from its wheel.
+ *
+ * @return non-zero, if the timer was pending, zero if it expired or was not added
+ */
+int timer_cancel(timer_t* timer);
+
+/**
+ * @brief Removes a pending timer and waits until its callback finished, if it is running.
+ *
+ * Must not be called by the callback of the timer.
+ *
+ * @return non-zero, if the timer was pending
+ */
+int timer_cancel_sync(timer_t* timer);
+
+/**
+ * @brief Returns the TSC value of the next tick the wheel of the current processor must
+ * process, or zero if it is empty.
+ */
+uint64_t timer_next();
+
+/**
+ * @brief Runs the expired timers of the current processor as deferred work, if the next
+ * tick has come. Called on every LAPIC timer interrupt.
+ */
+void timer_interrupt();
+
+/**
+ * @brief Measures the cost of adding and cancelling one million timers and logs the result.
+ */
+void timer_benchmark();
+
+/**
+ * @brief Writes the number of timers, expiries and cascades of each processor to kstdio.
+ */
+void timer_dump();
+
+#endif /* TIMER_H_ */
@@ -0,0 +1,89 @@
+/**
+ * @file smp.h
+ *
+ * @author Fabian Thorand
+ * @date   19.10.2026
+ *
+ * @brief Start-up of the application processors.
+ *
+ * The application processors listed in the MADT are started in parallel with the
+ * INIT-SIPI-SIPI sequence. They enter real mode at #boot16_ap, switch to long mode
+ * on a scratch stack and continue in #main_ap on a stack allocated by #smp_init.
+ * After initializing their local APIC, they check in with #smp_ap_checkin.
+ */
+#ifndef SMP_H_
+#define SMP_H_
+
+#include "kernel/helium.h"
+
+#include <stdint.h>
+
+/// size of the kernel stack of an application processor in pages
+#define SMP_AP_STACK_PAGES 4
+/// number of entries in the stack table, boot32_ap uses the 8 bit initial APIC ID
+#define SMP_MAX_APIC_ID 256
+
+/// delay between the INIT and the first start-up IPI in microseconds
+#define SMP_INIT_DELAY_US 10000
+/// delay between the two start-up IPIs in microseconds
+#define SMP_STARTUP_DELAY_US 200
+/// time the application processors have to check in after the second start-up IPI
+#define SMP_CHECKIN_TIMEOUT_US 100000
+
+/// vector asking a processor to run the function passed to #smp_run
+#define SMP_VECTOR_RUN 0xFD
+
+/**
+ * @brief Function run on every processor by #smp_run.
+ */
+typedef void (*smp_func_t)(void* arg);
+
+/**
+ * @brief Starts all application processors and waits until they checked in.
+ *
+ * Must be called on the bootstrap processor after the local APIC timer was calibrated.
+ *
+ * @return the number of online processors, including the bootstrap processor.
+ */
+unsigned int smp_init();
+
+/**
+ * @brief Marks the current application processor as online.
+ *
+ * Called by #main_ap after the processor is initialized.
+ */
+void smp_ap_checkin(uint32_t apic_id);
+
+/**
+ * @brief Returns the number of online processors.
+ */
+unsigned int smp_cpu_count();
+
+/**
+ * @brief Returns a mask with bit \c i set, if the processor with index \c i is online.
+ */
+uint64_t smp_cpu_mask();
+
+/**
+ * @brief Returns the local APIC ID of the online processor with index \c index.
+ */
+uint32_t smp_apic_id(unsigned int index);
+
+/**
+ * @brief Stores the local APIC IDs of the online processors in the order of their index.
+ *
+ * @param ids receives the IDs
+ * @param max number of entries of \c ids
+ * @return the number of IDs stored
+ */
+unsigned int smp_apic_ids(uint32_t* ids, unsigned int max);
+
+/**
+ * @brief Runs a function on all online processors and waits until it returned everywhere.
+ *
+ * The other processors run the function as deferred work (see softirq.h) with
+ * interrupts enabled. Calls are serialized.
+ */
+void smp_run(smp_func_t func, void* arg);
+
+#endif /* SMP_H_ */
@@ -0,0 +1,155 @@
+/**
+ * @file rcu.h
+ *
+ * @author Fabian Thorand
+ * @date   19.10.2026
+ *
+ * @brief Quiescent-state-based read-copy-update.
+ *
+ * Readers of read-mostly structures take no lock and execute no atomic operation,
+ * they only disable preemption (see preempt.h).
+ * A writer publishes a new version with #RCU_ASSIGN and hands the old one to #rcu_call,
+ * which runs the callback after a grace period, once every processor passed a quiescent
+ * state. Readers only find the object inside a read-side critical section, so none can
+ * still reference it then.
+ *
+ * Readers cannot be preempted, so a processor is in a quiescent state whenever it is
+ * not running kernel code that may hold references:
+ * - when it enters the idle loop (#rcu_idle_enter), for the whole time it stays idle,
+ * - on a timer tick that interrupted user mode or preemptible kernel code (#rcu_tick),
+ * - whenever code outside of read-side critical sections calls #rcu_quiescent,
+ *   e.g. the scheduler on a context switch.
+ *
+ * Read-side critical sections must therefore not block, sleep, halt or call #rcu_quiescent.
+ * Interrupt handlers are read-side critical sections of their own.
+ *
+ * Processors without timer tick (see sched.h) keep it running while #rcu_pending, and
+ * are sent an IPI when a grace period starts, so they notice it.
+ *
+ * Example:
+ *
+ *     rcu_read_lock();
+ *     table_t* table = RCU_DEREFERENCE(current_table);
+ *     ... // use table
+ *     rcu_read_unlock();
+ *
+ *     // writer, serialized by a lock
+ *     table_t* old = current_table;
+ *     RCU_ASSIGN(current_table, new_table);
+ *     rcu_call(&old->rcu, table_free);
+ */
+#ifndef RCU_H_
+#define RCU_H_
+
+#include "kernel/percpu.h"
+#include "kernel/interrupts/int.h"
+#include "kernel/sched/preempt.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// reads a pointer protected by RCU
+#define RCU_DEREFERENCE(p) (*(__typeof__(p) volatile*)&(p))
+
+/// publishes a pointer protected by RCU after the stores initializing the object
+#define RCU_ASSIGN(p, value) do { \
+    asm volatile ("" : : : "memory"); \
+    *(__typeof__(p) volatile*)&(p) = (value); \
+} while(0)
+
+struct rcu_head;
+
+/**
+ * @brief Function called by #rcu_call after a grace period, usually frees the object.
+ */
+typedef void (*rcu_func_t)(struct rcu_head* head);
+
+/**
+ * @brief Callback of #rcu_call. Usually embedded in the object to be freed.
+ */
+typedef struct rcu_head {
+    struct rcu_head* next;  ///< next callback in the list of the processor
+    rcu_func_t func;        ///< function called after the grace period
+} rcu_head_t;
+
+/// zero while the current processor is idle and holds no references
+PERCPU_DECLARE(unsigned int, rcu_watching);
+
+/**
+ * @brief Starts a read-side critical section. Only increments the per-CPU preemption counter.
+ */
+#define rcu_read_lock() PREEMPT_DISABLE()
+
+/**
+ * @brief Ends a read-side critical section.
+ */
+#define rcu_read_unlock() PREEMPT_ENABLE()
+
+/**
+ * @brief Leaves the quiescent state of the idle loop when an interrupt arrives.
+ *
+ * Called by #int_dispatch before running any handler.
+ */
+INT_FAST_HANDLER static inline void rcu_irq_enter() {
+    if(!PERCPU_READ(rcu_watching)) {
+        PERCPU_WRITE(rcu_watching, 1);
+        // see rcu_gp_start, makes the store visible before the handler reads anything
+        asm volatile ("mfence" : : : "memory");
+    }
+}
+
+/**
+ * @brief Reports a quiescent state of the current processor.
+ *
+ * The caller must not be inside a read-side critical section. Costs one load
+ * unless a grace period waits for this processor.
+ */
+void rcu_quiescent();
+
+/**
+ * @brief Called on every timer tick.
+ *
+ * @param user non-zero, if the tick interrupted user mode, which is a quiescent state
+ */
+void rcu_tick(int user);
+
+/**
+ * @brief Returns non-zero, if RCU needs the timer tick on the current processor.
+ *
+ * This is the case while a grace period waits for the processor or it has callbacks.
+ */
+int rcu_pending();
+
+/**
+ * @brief Reports a quiescent state for as long as the current processor stays idle.
+ *
+ * Must be called with interrupts disabled right before halting.
+ */
+void rcu_idle_enter();
+
+/**
+ * @brief Leaves the quiescent state of the idle loop.
+ */
+void rcu_idle_exit();
+
+/**
+ * @brief Calls \c func after all read-side critical sections running now have ended.
+ *
+ * The callbacks run as deferred work (see softirq.h) on the current processor.
+ * May be called with interrupts disabled, but not from fast interrupt handlers.
+ */
+void rcu_call(rcu_head_t* head, rcu_func_t func);
+
+/**
+ * @brief Waits until all read-side critical sections running now have ended.
+ *
+ * Must not be called inside a read-side critical section.
+ */
+void rcu_synchronize();
+
+/**
+ * @brief Writes the grace period counters and the number of callbacks to kstdio.
+ */
+void rcu_dump();
+
+#endif /* RCU_H_ */
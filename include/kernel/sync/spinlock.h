@@ -0,0 +1,474 @@
+/**
+ * @file spinlock.h
+ *
+ * @author Fabian Thorand
+ * @date   19.10.2026
+ *
+ * @brief Ticket locks, MCS queue locks and reader-writer spinlocks.
+ *
+ * - #spinlock_t is a fair ticket lock. Waiters back off in proportion to their
+ *   distance from the owner, which keeps the cache line of the lock quiet.
+ * - #mcs_lock_t lets every waiter spin on its own #mcs_node_t, so contention does not
+ *   cause traffic on a shared cache line. Use it on heavily contended paths.
+ * - #rwlock_t admits many readers or one writer. Waiting writers keep new readers out.
+ *
+ * All locks disable preemption while they are held. The \c _irqsave variants also disable
+ * interrupts and must be used for locks that are also taken by interrupt handlers.
+ *
+ * With \c HE_LOCK_STATS defined, every lock belongs to a #lock_class_t that records the
+ * time spent waiting for and holding its locks. #lock_stats_dump writes them to kstdio.
+ *
+ * Example:
+ *
+ *     static LOCK_CLASS(table_class, "table");
+ *     static spinlock_t table_lock = SPINLOCK_INIT(&table_class);
+ *     ...
+ *     int enabled = spinlock_acquire_irqsave(&table_lock);
+ *     ...
+ *     spinlock_release_irqrestore(&table_lock, enabled);
+ */
+#ifndef SPINLOCK_H_
+#define SPINLOCK_H_
+
+#include "kernel/interrupts/int.h"
+#include "kernel/sched/preempt.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef HE_LOCK_STATS
+#include "kernel/cpu.h"
+#endif
+
+/// reader-writer lock: a writer holds the lock
+#define RWLOCK_WRITER 1
+/// reader-writer lock: a writer waits, new readers must not enter
+#define RWLOCK_WAITING 2
+/// reader-writer lock: increment of the reader count
+#define RWLOCK_READER 4
+
+/**
+ * @brief Statistics of all locks of one kind.
+ */
+typedef struct lock_class {
+    const char* name;                   ///< name printed by #lock_stats_dump
+    struct lock_class* next;            ///< next registered class
+    volatile int registered;            ///< non-zero once the class is in the list of classes
+    volatile uint64_t acquisitions;     ///< number of acquisitions
+    volatile uint64_t contended;        ///< number of acquisitions that had to wait
+    volatile uint64_t wait_cycles;      ///< total time spent waiting
+    volatile uint64_t wait_max;         ///< longest wait
+    volatile uint64_t hold_cycles;      ///< total time the locks were held exclusively
+    volatile uint64_t hold_max;         ///< longest exclusive hold
+} lock_class_t;
+
+/// static initializer of a #lock_class_t
+#define LOCK_CLASS_INIT(name) { (name), NULL, 0, 0, 0, 0, 0, 0, 0 }
+/// defines a lock class, which is unused when \c HE_LOCK_STATS is not defined
+#define LOCK_CLASS(var, name) lock_class_t var __attribute__((unused)) = LOCK_CLASS_INIT(name)
+
+/**
+ * @brief A fair ticket lock.
+ */
+typedef struct {
+    union {
+        volatile uint32_t value;        ///< both tickets, for #spinlock_try_acquire
+        struct {
+            volatile uint16_t owner;    ///< ticket allowed to hold the lock
+            volatile uint16_t next;     ///< ticket handed to the next acquirer
+        };
+    };
+#ifdef HE_LOCK_STATS
+    lock_class_t* cls;                  ///< statistics of this lock
+    uint64_t acquired;                  ///< TSC when the owner acquired the lock
+#endif
+} spinlock_t;
+
+/**
+ * @brief The queue entry of a processor waiting for or holding an #mcs_lock_t.
+ *
+ * Usually allocated on the stack of the caller. It must stay valid until the lock is released.
+ */
+typedef struct mcs_node {
+    struct mcs_node* volatile next;     ///< next waiter
+    volatile int locked;                ///< non-zero while waiting
+#ifdef HE_LOCK_STATS
+    uint64_t acquired;                  ///< TSC when the lock was acquired
+#endif
+} mcs_node_t;
+
+/**
+ * @brief An MCS queue lock.
+ */
+typedef struct {
+    mcs_node_t* volatile tail;          ///< last waiter or NULL, if the lock is free
+#ifdef HE_LOCK_STATS
+    lock_class_t* cls;                  ///< statistics of this lock
+#endif
+} mcs_lock_t;
+
+/**
+ * @brief A reader-writer spinlock preferring writers.
+ */
+typedef struct {
+    volatile uint32_t value;            ///< reader count and #RWLOCK_WRITER and #RWLOCK_WAITING flags
+#ifdef HE_LOCK_STATS
+    lock_class_t* cls;                  ///< statistics of this lock
+    uint64_t acquired;                  ///< TSC when the writer acquired the lock
+#endif
+} rwlock_t;
+
+#ifdef HE_LOCK_STATS
+
+#define SPINLOCK_INIT(cls) { { 0 }, (cls), 0 }
+#define MCS_LOCK_INIT(cls) { NULL, (cls) }
+#define RWLOCK_INIT(cls) { 0, (cls), 0 }
+
+/// starts timing the wait for a lock
+#define LOCK_STATS_WAIT() uint64_t lock_wait_start_ = cpu_rdtsc()
+/// records an acquisition and returns the TSC to pass to #lock_stats_released
+#define LOCK_STATS_ACQUIRED(cls, contended) lock_stats_acquired((cls), lock_wait_start_, (contended))
+/// records the end of an exclusive hold
+#define LOCK_STATS_RELEASED(cls, acquired) lock_stats_released((cls), (acquired))
+
+/**
+ * @brief Records an acquisition. Use #LOCK_STATS_ACQUIRED instead.
+ *
+ * @return the current TSC.
+ */
+uint64_t lock_stats_acquired(lock_class_t* cls, uint64_t wait_start, int contended);
+
+/**
+ * @brief Records the end of an exclusive hold. Use #LOCK_STATS_RELEASED instead.
+ */
+void lock_stats_released(lock_class_t* cls, uint64_t acquired);
+
+#else
+
+#define SPINLOCK_INIT(cls) { { 0 } }
+#define MCS_LOCK_INIT(cls) { NULL }
+#define RWLOCK_INIT(cls) { 0 }
+
+#define LOCK_STATS_WAIT()
+#define LOCK_STATS_ACQUIRED(cls, contended) 0
+#define LOCK_STATS_RELEASED(cls, acquired)
+
+#endif
+
+/// compiler barrier keeping the critical section inside the lock
+#define LOCK_BARRIER() asm volatile ("" ::: "memory")
+
+/**
+ * @brief Initializes a ticket lock.
+ *
+ * @param cls statistics of the lock, ignored without \c HE_LOCK_STATS
+ */
+static inline void spinlock_init(spinlock_t* lock, lock_class_t* cls) {
+    lock->value = 0;
+#ifdef HE_LOCK_STATS
+    lock->cls = cls;
+    lock->acquired = 0;
+#else
+    (void)cls;
+#endif
+}
+
+/**
+ * @brief Acquires a ticket lock.
+ */
+static inline void spinlock_acquire(spinlock_t* lock) {
+    PREEMPT_DISABLE();
+    LOCK_STATS_WAIT();
+    uint16_t ticket = __sync_fetch_and_add(&lock->next, 1);
+    uint16_t owner = lock->owner;
+    int contended = owner != ticket;
+    while(owner != ticket) {
+        // every waiter ahead holds the lock for a while
+        for(uint16_t i = ticket - owner; i > 0; i--) {
+            asm volatile ("pause");
+        }
+        owner = lock->owner;
+    }
+    LOCK_BARRIER();
+#ifdef HE_LOCK_STATS
+    lock->acquired = LOCK_STATS_ACQUIRED(lock->cls, contended);
+#else
+    (void)contended;
+#endif
+}
+
+/**
+ * @brief Acquires a ticket lock, if it is free.
+ *
+ * @return non-zero, if the lock was acquired.
+ */
+static inline int spinlock_try_acquire(spinlock_t* lock) {
+    PREEMPT_DISABLE();
+    LOCK_STATS_WAIT();
+    uint32_t value = lock->value;
+    // the next ticket is in the upper half, an overflow drops out of the word
+    if((value & 0xFFFF) != (value >> 16)
+            || !__sync_bool_compare_and_swap(&lock->value, value, value + 0x10000)) {
+        PREEMPT_ENABLE();
+        return 0;
+    }
+#ifdef HE_LOCK_STATS
+    lock->acquired = LOCK_STATS_ACQUIRED(lock->cls, 0);
+#endif
+    return 1;
+}
+
+/**
+ * @brief Releases a ticket lock.
+ */
+static inline void spinlock_release(spinlock_t* lock) {
+    LOCK_STATS_RELEASED(lock->cls, lock->acquired);
+    LOCK_BARRIER();
+    // only the owner writes this half, stores are not reordered with older stores
+    lock->owner = lock->owner + 1;
+    PREEMPT_ENABLE();
+}
+
+/**
+ * @brief Disables interrupts and acquires a ticket lock.
+ *
+ * @return non-zero, if interrupts were enabled before.
+ */
+static inline int spinlock_acquire_irqsave(spinlock_t* lock) {
+    int enabled = int_enabled();
+    INT_DISABLE();
+    spinlock_acquire(lock);
+    return enabled;
+}
+
+/**
+ * @brief Releases a ticket lock and enables interrupts, if they were enabled before.
+ */
+static inline void spinlock_release_irqrestore(spinlock_t* lock, int enabled) {
+    spinlock_release(lock);
+    if(enabled) {
+        INT_ENABLE();
+    }
+}
+
+/**
+ * @brief Initializes an MCS lock.
+ *
+ * @param cls statistics of the lock, ignored without \c HE_LOCK_STATS
+ */
+static inline void mcs_init(mcs_lock_t* lock, lock_class_t* cls) {
+    lock->tail = NULL;
+#ifdef HE_LOCK_STATS
+    lock->cls = cls;
+#else
+    (void)cls;
+#endif
+}
+
+/**
+ * @brief Acquires an MCS lock, queueing \c node.
+ */
+static inline void mcs_acquire(mcs_lock_t* lock, mcs_node_t* node) {
+    PREEMPT_DISABLE();
+    LOCK_STATS_WAIT();
+    node->next = NULL;
+    node->locked = 1;
+    // xchg is a full barrier, the node is initialized before it becomes visible
+    mcs_node_t* prev = __sync_lock_test_and_set(&lock->tail, node);
+    if(prev) {
+        prev->next = node;
+        while(node->locked) {
+            asm volatile ("pause");
+        }
+    }
+    LOCK_BARRIER();
+#ifdef HE_LOCK_STATS
+    node->acquired = LOCK_STATS_ACQUIRED(lock->cls, prev != NULL);
+#endif
+}
+
+/**
+ * @brief Releases an MCS lock acquired with \c node.
+ */
+static inline void mcs_release(mcs_lock_t* lock, mcs_node_t* node) {
+    LOCK_STATS_RELEASED(lock->cls, node->acquired);
+    LOCK_BARRIER();
+    if(!node->next) {
+        if(__sync_bool_compare_and_swap(&lock->tail, node, NULL)) {
+            PREEMPT_ENABLE();
+            return;
+        }
+        // a new waiter swapped the tail, but has not linked itself yet
+        while(!node->next) {
+            asm volatile ("pause");
+        }
+    }
+    node->next->locked = 0;
+    PREEMPT_ENABLE();
+}
+
+/**
+ * @brief Disables interrupts and acquires an MCS lock.
+ *
+ * @return non-zero, if interrupts were enabled before.
+ */
+static inline int mcs_acquire_irqsave(mcs_lock_t* lock, mcs_node_t* node) {
+    int enabled = int_enabled();
+    INT_DISABLE();
+    mcs_acquire(lock, node);
+    return enabled;
+}
+
+/**
+ * @brief Releases an MCS lock and enables interrupts, if they were enabled before.
+ */
+static inline void mcs_release_irqrestore(mcs_lock_t* lock, mcs_node_t* node, int enabled) {
+    mcs_release(lock, node);
+    if(enabled) {
+        INT_ENABLE();
+    }
+}
+
+/**
+ * @brief Initializes a reader-writer lock.
+ *
+ * @param cls statistics of the lock, ignored without \c HE_LOCK_STATS
+ */
+static inline void rwlock_init(rwlock_t* lock, lock_class_t* cls) {
+    lock->value = 0;
+#ifdef HE_LOCK_STATS
+    lock->cls = cls;
+    lock->acquired = 0;
+#else
+    (void)cls;
+#endif
+}
+
+/**
+ * @brief Acquires a reader-writer lock for reading.
+ *
+ * Readers only record their wait, the hold time is tracked for writers.
+ */
+static inline void rwlock_read_acquire(rwlock_t* lock) {
+    PREEMPT_DISABLE();
+    LOCK_STATS_WAIT();
+    int contended = 0;
+    while(1) {
+        uint32_t value = lock->value;
+        if(!(value & (RWLOCK_WRITER | RWLOCK_WAITING))
+                && __sync_bool_compare_and_swap(&lock->value, value, value + RWLOCK_READER)) {
+            break;
+        }
+        contended = 1;
+        asm volatile ("pause");
+    }
+    LOCK_BARRIER();
+#ifdef HE_LOCK_STATS
+    LOCK_STATS_ACQUIRED(lock->cls, contended);
+#else
+    (void)contended;
+#endif
+}
+
+/**
+ * @brief Releases a reader-writer lock acquired for reading.
+ */
+static inline void rwlock_read_release(rwlock_t* lock) {
+    __sync_fetch_and_sub(&lock->value, RWLOCK_READER);
+    PREEMPT_ENABLE();
+}
+
+/**
+ * @brief Acquires a reader-writer lock for writing.
+ */
+static inline void rwlock_write_acquire(rwlock_t* lock) {
+    PREEMPT_DISABLE();
+    LOCK_STATS_WAIT();
+    int contended = 0;
+    while(1) {
+        uint32_t value = lock->value;
+        // the waiting flag of other writers is taken over
+        if((value & ~RWLOCK_WAITING) == 0
+                && __sync_bool_compare_and_swap(&lock->value, value, RWLOCK_WRITER)) {
+            break;
+        }
+        if(!(value & RWLOCK_WAITING)) {
+            __sync_fetch_and_or(&lock->value, RWLOCK_WAITING);
+        }
+        contended = 1;
+        asm volatile ("pause");
+    }
+    LOCK_BARRIER();
+#ifdef HE_LOCK_STATS
+    lock->acquired = LOCK_STATS_ACQUIRED(lock->cls, contended);
+#else
+    (void)contended;
+#endif
+}
+
+/**
+ * @brief Releases a reader-writer lock acquired for writing.
+ */
+static inline void rwlock_write_release(rwlock_t* lock) {
+    LOCK_STATS_RELEASED(lock->cls, lock->acquired);
+    __sync_fetch_and_and(&lock->value, ~RWLOCK_WRITER);
+    PREEMPT_ENABLE();
+}
+
+/**
+ * @brief Disables interrupts and acquires a reader-writer lock for reading.
+ *
+ * @return non-zero, if interrupts were enabled before.
+ */
+static inline int rwlock_read_acquire_irqsave(rwlock_t* lock) {
+    int enabled = int_enabled();
+    INT_DISABLE();
+    rwlock_read_acquire(lock);
+    return enabled;
+}
+
+/**
+ * @brief Releases a reader-writer lock acquired for reading and restores interrupts.
+ */
+static inline void rwlock_read_release_irqrestore(rwlock_t* lock, int enabled) {
+    rwlock_read_release(lock);
+    if(enabled) {
+        INT_ENABLE();
+    }
+}
+
+/**
+ * @brief Disables interrupts and acquires a reader-writer lock for writing.
+ *
+ * @return non-zero, if interrupts were enabled before.
+ */
+static inline int rwlock_write_acquire_irqsave(rwlock_t* lock) {
+    int enabled = int_enabled();
+    INT_DISABLE();
+    rwlock_write_acquire(lock);
+    return enabled;
+}
+
+/**
+ * @brief Releases a reader-writer lock acquired for writing and restores interrupts.
+ */
+static inline void rwlock_write_release_irqrestore(rwlock_t* lock, int enabled) {
+    rwlock_write_release(lock);
+    if(enabled) {
+        INT_ENABLE();
+    }
+}
+
+/**
+ * @brief Writes the statistics of all lock classes that were used to kstdio.
+ */
+void lock_stats_dump();
+
+/**
+ * @brief Measures the throughput of the lock types with 1 to all online processors.
+ *
+ * Must be called on the bootstrap processor after #smp_init.
+ */
+void lock_benchmark();
+
+#endif /* SPINLOCK_H_ */
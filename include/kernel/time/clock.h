@@ -0,0 +1,74 @@
+/**
+ * @file clock.h
+ *
+ * @author Fabian Thorand
+ * @date   19.10.2026
+ *
+ * @brief Monotonic and wall clocks on a calibrated clocksource.
+ *
+ * #clock_init measures the TSC frequency against the HPET main counter, or against PIT
+ * channel 2 if there is no HPET. When the processor reports an invariant TSC, which
+ * ticks at a constant rate in all power states, the TSC is the clocksource and #clock_ns
+ * costs one \c rdtsc and a multiplication. Otherwise a 64 bit HPET is used, whose
+ * uncached reads take about a microsecond. The TSC of all processors is assumed to be
+ * synchronized by the firmware.
+ *
+ * The wall time is read once from the RTC and then advanced with the monotonic clock.
+ *
+ * Deadlines of the LAPIC timer and the timer wheels stay in TSC cycles,
+ * #clock_ns_to_tsc converts durations for them.
+ */
+#ifndef CLOCK_H_
+#define CLOCK_H_
+
+#include <stdint.h>
+
+/// nanoseconds per second
+#define CLOCK_NS_PER_SEC 1000000000ull
+/// nanoseconds per microsecond
+#define CLOCK_NS_PER_US 1000ull
+
+/**
+ * @brief Calibrates the TSC, selects the clocksource and reads the wall time.
+ *
+ * Must be called once on the bootstrap processor with interrupts disabled, after ACPI
+ * was parsed and before #lapic_timer_init.
+ */
+void clock_init();
+
+/**
+ * @brief Returns the nanoseconds since #clock_init, or zero before it was called.
+ */
+uint64_t clock_ns();
+
+/**
+ * @brief Returns the nanoseconds since the Unix epoch.
+ */
+uint64_t clock_realtime_ns();
+
+/**
+ * @brief Returns the calibrated TSC frequency in kHz, or zero before #clock_init.
+ */
+uint64_t clock_tsc_khz();
+
+/**
+ * @brief Converts a duration in nanoseconds to TSC cycles.
+ */
+uint64_t clock_ns_to_tsc(uint64_t ns);
+
+/**
+ * @brief Converts a duration in TSC cycles to nanoseconds.
+ */
+uint64_t clock_tsc_to_ns(uint64_t cycles);
+
+/**
+ * @brief Returns the name of the clocksource, "tsc" or "hpet".
+ */
+const char* clock_source();
+
+/**
+ * @brief Measures the cost of reading the monotonic clock and logs the result.
+ */
+void clock_benchmark();
+
+#endif /* CLOCK_H_ */
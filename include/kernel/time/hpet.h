@@ -0,0 +1,62 @@
+/**
+ * @file hpet.h
+ *
+ * @author Fabian Thorand
+ * @date   19.10.2026
+ *
+ * @brief Main counter of the high precision event timer.
+ *
+ * Only the free running main counter is used, as a reference for calibrating the TSC and
+ * as clocksource when the TSC is not invariant. The comparators are left disabled.
+ * The registers are accessed through the mapping of the lower 4 GB, whose memory type
+ * the firmware sets to uncacheable for the MMIO range.
+ */
+#ifndef HPET_H_
+#define HPET_H_
+
+#include <stdint.h>
+
+/// general capabilities and ID register
+#define HPET_REG_CAPABILITIES 0x000
+/// general configuration register
+#define HPET_REG_CONFIG 0x010
+/// main counter value register
+#define HPET_REG_COUNTER 0x0F0
+
+/// the main counter is 64 bits wide
+#define HPET_CAP_64BIT (1 << 13)
+/// counter period in femtoseconds, the upper half of the capabilities
+#define HPET_CAP_PERIOD(caps) ((caps) >> 32)
+/// largest counter period allowed by the specification (100 ns)
+#define HPET_MAX_PERIOD 100000000ull
+/// starts the main counter
+#define HPET_CONFIG_ENABLE 0x1
+
+/// femtoseconds per second
+#define HPET_FS_PER_SEC 1000000000000000ull
+
+/**
+ * @brief Starts the main counter of the HPET reported by ACPI.
+ *
+ * @return zero on success, -1 if there is no usable HPET
+ */
+int hpet_init();
+
+/**
+ * @brief Returns the value of the main counter.
+ *
+ * A 32 bit counter wraps around after about five minutes at the usual 14.3 MHz.
+ */
+uint64_t hpet_read();
+
+/**
+ * @brief Returns the frequency of the main counter in Hz, or zero if there is no HPET.
+ */
+uint64_t hpet_frequency();
+
+/**
+ * @brief Returns non-zero, if the main counter is 64 bits wide.
+ */
+int hpet_is_64bit();
+
+#endif /* HPET_H_ */
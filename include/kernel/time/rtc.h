@@ -0,0 +1,75 @@
+/**
+ * @file rtc.h
+ *
+ * @author Fabian Thorand
+ * @date   19.10.2026
+ *
+ * @brief Reads the wall time from the CMOS real time clock.
+ *
+ * The RTC only has a resolution of one second and is slow to read, so it is read once
+ * by #clock_init, which keeps the wall time with the monotonic clock afterwards.
+ * The RTC is assumed to run in UTC.
+ */
+#ifndef RTC_H_
+#define RTC_H_
+
+#include <stdint.h>
+
+/// CMOS register index port
+#define RTC_PORT_INDEX 0x70
+/// CMOS register data port
+#define RTC_PORT_DATA 0x71
+
+/// register of the seconds
+#define RTC_REG_SECONDS 0x00
+/// register of the minutes
+#define RTC_REG_MINUTES 0x02
+/// register of the hours
+#define RTC_REG_HOURS 0x04
+/// register of the day of the month
+#define RTC_REG_DAY 0x07
+/// register of the month
+#define RTC_REG_MONTH 0x08
+/// register of the year within the century
+#define RTC_REG_YEAR 0x09
+/// status register A
+#define RTC_REG_STATUS_A 0x0A
+/// status register B
+#define RTC_REG_STATUS_B 0x0B
+
+/// status A: an update of the time registers is in progress
+#define RTC_STATUS_A_UPDATE 0x80
+/// status B: the time registers are binary instead of BCD
+#define RTC_STATUS_B_BINARY 0x04
+/// status B: the hours use the 24 hour format
+#define RTC_STATUS_B_24H 0x02
+/// hours in 12 hour format: afternoon
+#define RTC_HOURS_PM 0x80
+
+/**
+ * @brief A calendar time as kept by the RTC.
+ */
+typedef struct {
+    uint32_t year;      ///< year including the century
+    uint8_t  month;     ///< month, 1 to 12
+    uint8_t  day;       ///< day of the month, 1 to 31
+    uint8_t  hour;      ///< hour, 0 to 23
+    uint8_t  minute;    ///< minute, 0 to 59
+    uint8_t  second;    ///< second, 0 to 59
+} rtc_time_t;
+
+/**
+ * @brief Reads the current time from the RTC.
+ *
+ * Waits for an update in progress to finish and repeats the read until two consecutive
+ * reads agree, which takes a few microseconds unless an update just started.
+ * Without a century register reported by ACPI, years before 2000 are not supported.
+ */
+void rtc_read(rtc_time_t* time);
+
+/**
+ * @brief Converts a calendar time to seconds since the Unix epoch.
+ */
+uint64_t rtc_unix_seconds(const rtc_time_t* time);
+
+#endif /* RTC_H_ */
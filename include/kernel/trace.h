@@ -0,0 +1,88 @@
+/**
+ * @file trace.h
+ *
+ * @author Fabian Thorand
+ * @date   19.10.2026
+ *
+ * @brief Binary tracing with deferred formatting.
+ *
+ * #TRACE stores the address of its format string and the raw arguments in the trace buffer
+ * of the current processor. Nothing is formatted in the kernel. The host side tool
+ * \c tools/trace-decode.c resolves the format strings from \c kernel.sys and renders the trace.
+ *
+ * Format strings must be string literals. Arguments of \c %s must point to strings
+ * in the kernel image, otherwise the decoder can only show their address.
+ * Floating point arguments are not supported.
+ *
+ * Tracing is compiled in when \c HE_TRACE is defined and can be switched off at runtime
+ * with #trace_set_enabled.
+ */
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include "common/tracedef.h"
+
+#include <stdint.h>
+
+/// trace buffers of all processors
+extern trace_buffer_t trace_buffers[];
+
+/// non-zero when trace events are recorded
+extern int trace_enabled;
+
+/**
+ * @brief Records a trace event. Use #TRACE instead.
+ *
+ * @param format the format string located in section \c .rodata.trace
+ * @param nargs number of elements in \c args
+ * @param args raw arguments
+ */
+void trace_emit(const char* format, unsigned int nargs, const uint64_t* args);
+
+/**
+ * @brief Enables or disables recording of trace events.
+ */
+void trace_set_enabled(int enabled);
+
+/**
+ * @brief Initializes the trace buffers.
+ */
+void trace_init();
+
+/// converts one argument to its raw representation
+#define TRACE_ARG(x) ((uint64_t)(uintptr_t)(x))
+
+/// counts the arguments (0 to 5)
+#define TRACE_NARGS(...) TRACE_NARGS_(0, ##__VA_ARGS__, 5, 4, 3, 2, 1, 0)
+#define TRACE_NARGS_(z, a, b, c, d, e, n, ...) n
+
+#define TRACE_MAP_0()
+#define TRACE_MAP_1(a) TRACE_ARG(a)
+#define TRACE_MAP_2(a, b) TRACE_ARG(a), TRACE_ARG(b)
+#define TRACE_MAP_3(a, b, c) TRACE_ARG(a), TRACE_ARG(b), TRACE_ARG(c)
+#define TRACE_MAP_4(a, b, c, d) TRACE_ARG(a), TRACE_ARG(b), TRACE_ARG(c), TRACE_ARG(d)
+#define TRACE_MAP_5(a, b, c, d, e) TRACE_MAP_4(a, b, c, d), TRACE_ARG(e)
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+/// applies #TRACE_ARG to all arguments
+#define TRACE_MAP(...) TRACE_CONCAT(TRACE_MAP_, TRACE_NARGS(__VA_ARGS__))(__VA_ARGS__)
+
+#ifdef HE_TRACE
+
+/**
+ * @brief Records a trace event with a printf-like format string and up to five integer or pointer arguments.
+ */
+#define TRACE(fmt, ...) do { \
+    if(trace_enabled) { \
+        static const char trace_fmt_[] __attribute__((section(".rodata.trace"))) = fmt; \
+        const uint64_t trace_args_[] = { 0, TRACE_MAP(__VA_ARGS__) }; \
+        trace_emit(trace_fmt_, TRACE_NARGS(__VA_ARGS__), trace_args_ + 1); \
+    } } while(0)
+
+#else
+
+#define TRACE(fmt, ...)
+
+#endif
+
+#endif /* TRACE_H_ */
@@ -4,8 +4,13 @@
 section .text16.boot
 bits 16
 
+;; export the entry point, the start-up IPI needs its page
+global boot16_ap
+
 ;;; @brief 16 bit entry point for application processors. 
 ;;;
+;;; Must be the first code in .boot16, because the start-up IPI jumps to the beginning of a page.
+;;;
 ;;; @remark The bootstrap processor entry point is implemented in boot32.s,
 ;;; as multiboot compliant bootloaders switch the BSP to 32 bit protected mode.
 ;;;     
@@ -1,5 +1,7 @@
 %include "macros/macros.inc"
 ;;; Macros
+;;; size of the scratch stack of each AP, as a power of two
+%define AP_BOOT_STACK_SHIFT 4
 %macro panic 1 
    mov esi,%1
    jmp boot32_panic
@@ -26,6 +28,7 @@ extern page_phys_pdt
 extern page_kernel_pdt
 extern gdt_data
 extern stack_bottom
+extern ap_boot_stacks
 
 ;;; Function: 
 ;;;   Initializes the BSP (bootstrap processor), switches to long mode and loads the kernel.
@@ -83,10 +86,20 @@ boot32_bsp:
 ;;; Function:
 ;;;     32 bit entry point for application processors. 
 ;;;     Called by boot16_ap in boot16.s.
+;;;     Passes the initial APIC ID in EDI to boot64_ap.
 boot32_ap:
     ;; Assume that this AP supports long mode when the BSP does
     
-    ;; TODO: Setup stack!!!
+    ;; All APs start at the same time, so each uses the scratch stack of
+    ;; AP_BOOT_STACK_SIZE bytes selected by its initial APIC ID. It only
+    ;; has to hold the return address of boot32_prepare.
+    mov   eax, 1
+    cpuid
+    shr   ebx, 24               ; ebx bits 24..31: initial APIC ID
+    mov   edi, ebx
+    inc   ebx
+    shl   ebx, AP_BOOT_STACK_SHIFT
+    lea   esp, [ap_boot_stacks + ebx]
 
     ;; this uses the same GDT and the same PML4T as the BSP
     ;; the PML4T has to be changed after switch to long mode.
@@ -184,12 +197,14 @@ boot32_identity_map:
 ;;;     * enables paging
 boot32_prepare:
     ;; enable the following features in CR4
+    ;;  * OSXMMEXCPT (bit 10)
+    ;;  * OSFXSR (bit 9)
     ;;  * PGE (bit 7)
     ;;  * PAE (bit 5)
     ;;  * PSE (bit 4)
-    ;; ==> 0b 1011 0000 = 0x B0
+    ;; ==> 0b 0110 1011 0000 = 0x 6B0
     mov   eax, cr4
-    or    eax, 0x000000B0
+    or    eax, 0x000006B0
     mov   cr4, eax
 
     ;; set Long Mode bit
@@ -9,6 +9,8 @@ global boot64_ap
 extern multiboot_info
 extern stack_bottom
 extern boot32_gdtr2
+;; stacks allocated by smp.c
+extern smp_ap_stacks
 ;; import C code entry points
 extern main_bsp
 extern main_ap
@@ -37,7 +39,21 @@ boot64_bsp:
     
     halt
     
+;;; @brief 64 bit entry point for application processors.
+;;;
+;;; @param edi Initial APIC ID of the processor.
 boot64_ap:
+    ;; load 64 Bit higher half GDT
+    mov eax, boot32_gdtr2
+    lgdt [eax]
+
+    ;; the upper half of RDI is undefined after the switch to long mode
+    mov edi, edi
+    ;; switch to the stack allocated by the BSP, the APIC ID is the index
+    mov rax, qword smp_ap_stacks
+    mov rsp, [rax + rdi * 8]
+
+    ;; 64 bit call, passing the APIC ID
     mov rax, qword main_ap
     call rax
     
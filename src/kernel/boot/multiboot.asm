@@ -5,11 +5,24 @@ MB_MAGIC        EQU 0x1BADB002  ; Multiboot Magic Value
 
 MB_FLAG_ALIGN   EQU 0x0001      ; align modules on page boundaries (4 KB)
 MB_FLAG_MEMINFO EQU 0x0002      ; request memory information from bootloader
+MB_FLAG_VIDEO   EQU 0x0004      ; request a video mode from bootloader
 
-MB_FLAGS        EQU (MB_FLAG_ALIGN | MB_FLAG_MEMINFO)
+MB_FLAGS        EQU (MB_FLAG_ALIGN | MB_FLAG_MEMINFO | MB_FLAG_VIDEO)
 MB_CHECKSUM     EQU -(MB_MAGIC + MB_FLAGS)
 
+MB_MODE_LINEAR  EQU 0           ; linear framebuffer
+MB_MODE_WIDTH   EQU 1024        ; preferred width in pixels
+MB_MODE_HEIGHT  EQU 768         ; preferred height in pixels
+MB_MODE_DEPTH   EQU 32          ; preferred bits per pixel
+
 MultibootHeader:
    dd MB_MAGIC
    dd MB_FLAGS
    dd MB_CHECKSUM
+   ; address fields, only used when bit 16 of the flags is set
+   dd 0, 0, 0, 0, 0
+   ; graphics fields
+   dd MB_MODE_LINEAR
+   dd MB_MODE_WIDTH
+   dd MB_MODE_HEIGHT
+   dd MB_MODE_DEPTH
@@ -8,6 +8,8 @@
  */
 
 #include "kernel/cpu.h"
+#include "kernel/interrupts/int.h"
+#include "kernel/helium.h"
 #include "kernel/klibc/string.h"
 
 /**
@@ -25,6 +27,20 @@ void cpuid(uint32_t code, cpu_id_t* result) {
                 : "r"(code));
 }
 
+/**
+ * @brief Executes the \c cpuid instruction using the function \c code and the sub-function \c sub.
+ *
+ * @param code The \c cpuid function code.
+ * @param sub The sub-function, passed in \c ecx.
+ * @param result Pointer to a #cpu_id_t structure receiving \c eax, \c ebx, \c ecx and \c edx.
+ */
+void cpuid_sub(uint32_t code, uint32_t sub, cpu_id_t* result) {
+    asm volatile ("cpuid"
+                : "=a"(result->eax), "=b"(result->ebx)
+                  , "=c"(result->ecx), "=d"(result->edx)
+                : "a"(code), "c"(sub));
+}
+
 
 /**
  * @brief Writes the CPU vendor into the supplied buffer.
@@ -55,7 +71,7 @@ int cpu_has_msr() {
  * @brief Reads a 64 bit value from a MSR.
  * @param msr MSR index
  */
-uint64_t cpu_msr_read(uint32_t msr) {
+INT_FAST_HANDLER uint64_t cpu_msr_read(uint32_t msr) {
     uint32_t lo, hi;
     asm volatile("rdmsr"
             : "=a"(lo), "=d"(hi)
@@ -69,7 +85,7 @@ uint64_t cpu_msr_read(uint32_t msr) {
  * @param msr MSR index
  * @param value Value to write into the MSR.
  */
-void cpu_msr_write(uint32_t msr, uint64_t value) {
+INT_FAST_HANDLER void cpu_msr_write(uint32_t msr, uint64_t value) {
     asm volatile("wrmsr"
             : : "c"(msr), "a"(value & 0xFFFFFFFF), "d"(value >> 32));
 }
@@ -95,3 +111,23 @@ uint8_t cpu_inb(uint16_t port) {
     asm volatile ("inb %1, %0" : "=a"(value) : "dN"(port));
     return value;
 }
+
+/**
+ * @brief Reads the time stamp counter.
+ */
+INT_FAST_HANDLER uint64_t cpu_rdtsc() {
+    uint32_t lo, hi;
+    asm volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+/**
+ * @brief Returns the index of the processor executing this function.
+ *
+ * Currently, this is the initial APIC ID reported by \c cpuid.
+ */
+unsigned int cpu_index() {
+    cpu_id_t result;
+    cpuid(1, &result);
+    return (result.ebx >> 24) % HE_MAX_CPUS;
+}
@@ -10,6 +10,11 @@
 #include "kernel/debug.h"
 #include "kernel/info.h"
 #include "kernel/klibc/kstdio.h"
+#include "kernel/interrupts/intstat.h"
+#include "kernel/sync/spinlock.h"
+#include "kernel/sync/rcu.h"
+#include "kernel/sched/sched.h"
+#include "kernel/sched/timer.h"
 
 /**
  * @brief Writes the contents of the info structures to the screen.
@@ -39,5 +44,25 @@ void debug_print_info() {
     }
     kprintf("TOTAL MEM  = %llx\n", total_avail_mem);
 
+    kputs("interrupt statistics\n");
+    kputs("====================\n");
+    intstat_dump();
+
+    kputs("lock statistics\n");
+    kputs("===============\n");
+    lock_stats_dump();
+
+    kputs("rcu\n");
+    kputs("===\n");
+    rcu_dump();
+
+    kputs("scheduler\n");
+    kputs("=========\n");
+    sched_dump();
+
+    kputs("timers\n");
+    kputs("======\n");
+    timer_dump();
+
     kputs("\x1b[0m");
 }
@@ -1,58 +1,66 @@
 #include "kernel/idris_rts/idris_stats.h"
 #include "kernel/klibc/kstdio.h"
 
-//#include <stdio.h>
-//#include <locale.h>
-
 #ifdef IDRIS_ENABLE_STATS
 
+// prints nanoseconds as seconds with three decimals, kprintf has no floating point
+#define STATS_SEC(ns) (ns) / CLOCK_NS_PER_SEC, (ns) / 1000000 % 1000
+
 void print_stats(const Stats * stats) {
-    clock_t total   = clock() - stats->start_time;
-    clock_t mut     = total - stats->init_time - stats->gc_time - stats->exit_time;
-    double  mut_sec = (double)mut   / CLOCKS_PER_SEC;
+    uint64_t total = clock_ns() - stats->start_time;
+    uint64_t mut   = total - stats->init_time - stats->gc_time - stats->exit_time;
 
     int avg_chunk = 0;
     if (stats->alloc_count > 0) {
-        avg_chunk = (int)((double)stats->allocations / (double)stats->alloc_count);
+        avg_chunk = stats->allocations / stats->alloc_count;
     }
 
-    int alloc_rate = 0;
+    uint64_t alloc_rate = 0;
     if (mut > 0) {
-        alloc_rate  = (int)((double)(stats->allocations) / mut_sec);
+        alloc_rate = (uint64_t)stats->allocations * CLOCK_NS_PER_SEC / mut;
     }
-    
-    double gc_percent = 0.0;
-    double productivity = 0.0;
+
+    // in hundredths of a percent
+    uint64_t gc_percent = 0;
+    uint64_t productivity = 0;
     if (total > 0) {
-        gc_percent = 100 * (double)stats->gc_time / (double)total;
-        productivity = 100 * ((double)mut / (double)total);
+        gc_percent = 10000 * stats->gc_time / total;
+        productivity = 10000 * mut / total;
     }
 
-    setlocale(LC_NUMERIC, "");
-    printf("\n");
-    printf("%'20d bytes allocated in the heap\n",  stats->allocations);
-    printf("%'20d bytes copied during GC\n",       stats->copied);
-    printf("%'20d maximum heap size\n",            stats->max_heap_size);
-    printf("%'20d chunks allocated in the heap\n", stats->alloc_count);
-    printf("%'20d average chunk size\n\n",         avg_chunk);
+    kprintf("\n");
+    kprintf("%20d bytes allocated in the heap\n",  stats->allocations);
+    kprintf("%20d bytes copied during GC\n",       stats->copied);
+    kprintf("%20d maximum heap size\n",            stats->max_heap_size);
+    kprintf("%20d chunks allocated in the heap\n", stats->alloc_count);
+    kprintf("%20d average chunk size\n\n",         avg_chunk);
 
-    printf("GC called %d times\n\n", stats->collections);
+    kprintf("GC called %d times\n\n", stats->collections);
 
-    printf("INIT  time: %8.3fs\n",   (double)stats->init_time / CLOCKS_PER_SEC);
-    printf("MUT   time: %8.3fs\n",   mut_sec);
-    printf("GC    time: %8.3fs\n",   (double)stats->gc_time   / CLOCKS_PER_SEC);
-    printf("EXIT  time: %8.3fs\n",   (double)stats->exit_time / CLOCKS_PER_SEC);
-    printf("TOTAL time: %8.3fs\n\n", (double)total            / CLOCKS_PER_SEC);
+    kprintf("INIT  time: %4lu.%03lus\n",   STATS_SEC(stats->init_time));
+    kprintf("MUT   time: %4lu.%03lus\n",   STATS_SEC(mut));
+    kprintf("GC    time: %4lu.%03lus\n",   STATS_SEC(stats->gc_time));
+    kprintf("EXIT  time: %4lu.%03lus\n",   STATS_SEC(stats->exit_time));
+    kprintf("TOTAL time: %4lu.%03lus\n\n", STATS_SEC(total));
 
-    printf("%%GC   time: %.2f%%\n\n", gc_percent);
+    kprintf("%%GC   time: %lu.%02lu%%\n\n", gc_percent / 100, gc_percent % 100);
 
-    printf("Alloc rate %'d bytes per MUT sec\n\n", alloc_rate);
+    kprintf("Alloc rate %lu bytes per MUT sec\n\n", alloc_rate);
 
-    printf("Productivity %.2f%%\n", productivity);
+    kprintf("Productivity %lu.%02lu%%\n", productivity / 100, productivity % 100);
 }
 
 void aggregate_stats(Stats * stats1, const Stats * stats2) {
-    fprintf(stderr, "RTS error: aggregate_stats not implemented");
+    // start_time stays the one of stats1
+    stats1->allocations  += stats2->allocations;
+    stats1->alloc_count  += stats2->alloc_count;
+    stats1->copied       += stats2->copied;
+    stats1->max_heap_size = MAX(stats1->max_heap_size, stats2->max_heap_size);
+    stats1->init_time    += stats2->init_time;
+    stats1->exit_time    += stats2->exit_time;
+    stats1->gc_time      += stats2->gc_time;
+    stats1->max_gc_pause  = MAX(stats1->max_gc_pause, stats2->max_gc_pause);
+    stats1->collections  += stats2->collections;
 }
 
 #else
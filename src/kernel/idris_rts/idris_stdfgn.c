@@ -7,7 +7,7 @@
 //#include <sys/select.h>
 //#include <fcntl.h>
 #include "kernel/klibc/kstdio.h"
-//#include <time.h>
+#include "kernel/time/clock.h"
 
 #define UNUSED(x) ((void)(x))
 
@@ -100,9 +100,8 @@ char* getEnvPair(int i) {
 }
 
 int idris_time() {
-    ///time_t t = time(NULL);
-    //return (int)t;
-    return 0;
+    // seconds since the Unix epoch, like time(NULL)
+    return (int)(clock_realtime_ns() / CLOCK_NS_PER_SEC);
 }
 
 void idris_forceGC(void* vm) {
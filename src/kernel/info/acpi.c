@@ -0,0 +1,237 @@
+/**
+ * @file acpi.c
+ *
+ * @author Fabian Thorand
+ * @date   19.10.2026
+ *
+ * @brief Collects the interrupt controller topology from the ACPI MADT and the timer
+ * hardware from the HPET table and the FADT.
+ *
+ * Only the static tables are read, there is no AML interpreter. All tables are
+ * accessed through the mapping of the lower 4 GB, tables above are ignored.
+ */
+
+#include "kernel/info.h"
+#include "kernel/info/acpi.h"
+#include "kernel/helium.h"
+#include "kernel/mem/vmm.h"
+#include "kernel/klibc/string.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// size of the physical address range mapped at #VMM_PHYS4G_BASE
+#define ACPI_PHYS_LIMIT 0x100000000ull
+/// physical address of the BIOS data area word holding the EBDA segment
+#define ACPI_EBDA_POINTER 0x40E
+/// number of bytes of the EBDA that are searched
+#define ACPI_EBDA_SEARCH_SIZE 0x400
+/// start of the BIOS ROM area that is searched
+#define ACPI_BIOS_START 0xE0000
+/// end of the BIOS ROM area that is searched
+#define ACPI_BIOS_END 0x100000
+/// size of the ACPI 1.0 part of the RSDP
+#define ACPI_RSDP_V1_SIZE 20
+
+/// table containing the processors listed in the ACPI MADT
+he_cpu_t info_cpus[HE_MAX_CPUS];
+/// table containing the I/O APICs listed in the ACPI MADT
+he_ioapic_t info_ioapics[HE_MAX_IOAPICS];
+/// table containing the connection of the ISA IRQs to the I/O APICs
+he_isa_irq_t info_isa_irqs[HE_ISA_IRQS];
+
+/**
+ * @brief Returns a pointer to physical memory or NULL, if the range is not mapped.
+ */
+static void* acpi_phys(uint64_t paddr, uint64_t length) {
+    if(paddr + length > ACPI_PHYS_LIMIT || paddr + length < paddr) {
+        return NULL;
+    }
+    return (void*) (VMM_PHYS4G_BASE + paddr);
+}
+
+/**
+ * @brief Checks that the bytes of a structure sum up to zero.
+ */
+static int acpi_checksum_ok(const void* data, size_t length) {
+    const uint8_t* bytes = data;
+    uint8_t sum = 0;
+    for(size_t i = 0; i < length; i++) {
+        sum += bytes[i];
+    }
+    return sum == 0;
+}
+
+/**
+ * @brief Searches a physical memory range for the RSDP on 16 byte boundaries.
+ */
+static acpi_rsdp_t* acpi_scan_rsdp(uint64_t start, uint64_t end) {
+    for(uint64_t paddr = start; paddr + sizeof(acpi_rsdp_t) <= end; paddr += 16) {
+        acpi_rsdp_t* rsdp = acpi_phys(paddr, sizeof(acpi_rsdp_t));
+        if(memcmp(rsdp->signature, ACPI_RSDP_SIGNATURE, 8) == 0 && acpi_checksum_ok(rsdp, ACPI_RSDP_V1_SIZE)) {
+            return rsdp;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Locates the RSDP in the EBDA or the BIOS ROM area.
+ */
+static acpi_rsdp_t* acpi_find_rsdp() {
+    uint64_t ebda = (uint64_t) *(uint16_t*) acpi_phys(ACPI_EBDA_POINTER, 2) << 4;
+    acpi_rsdp_t* rsdp = NULL;
+    if(ebda) {
+        rsdp = acpi_scan_rsdp(ebda, ebda + ACPI_EBDA_SEARCH_SIZE);
+    }
+    if(!rsdp) {
+        rsdp = acpi_scan_rsdp(ACPI_BIOS_START, ACPI_BIOS_END);
+    }
+    return rsdp;
+}
+
+/**
+ * @brief Returns the table at a physical address, if it has the given signature and a valid checksum.
+ */
+static acpi_sdt_header_t* acpi_table(uint64_t paddr, const char* signature) {
+    acpi_sdt_header_t* header = acpi_phys(paddr, sizeof(acpi_sdt_header_t));
+    if(!header || (signature && memcmp(header->signature, signature, 4) != 0)) {
+        return NULL;
+    }
+    if(!acpi_phys(paddr, header->length) || !acpi_checksum_ok(header, header->length)) {
+        return NULL;
+    }
+    return header;
+}
+
+/**
+ * @brief Finds a table by its signature in the RSDT or XSDT.
+ */
+static acpi_sdt_header_t* acpi_find_table(acpi_rsdp_t* rsdp, const char* signature) {
+    // the XSDT is preferred, because the RSDT cannot point above 4 GB
+    int xsdt = rsdp->revision >= 2 && rsdp->xsdt && acpi_checksum_ok(rsdp, rsdp->length);
+    acpi_sdt_header_t* root = xsdt ? acpi_table(rsdp->xsdt, "XSDT") : acpi_table(rsdp->rsdt, "RSDT");
+    if(!root) {
+        return NULL;
+    }
+    size_t entry_size = xsdt ? 8 : 4;
+    size_t count = (root->length - sizeof(acpi_sdt_header_t)) / entry_size;
+    uint8_t* entries = (uint8_t*) root + sizeof(acpi_sdt_header_t);
+    for(size_t i = 0; i < count; i++) {
+        uint64_t paddr = xsdt ? *(uint64_t*) (entries + i * 8) : *(uint32_t*) (entries + i * 4);
+        acpi_sdt_header_t* table = acpi_table(paddr, signature);
+        if(table) {
+            return table;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Adds a processor to info_cpus, unless it is unusable.
+ */
+static void acpi_add_cpu(uint32_t apic_id, uint32_t acpi_id, uint32_t flags) {
+    if(!(flags & (ACPI_MADT_LAPIC_ENABLED | ACPI_MADT_LAPIC_ONLINE_CAPABLE))) {
+        return;
+    }
+    if(info_table.cpu_count >= HE_MAX_CPUS) {
+        return;
+    }
+    he_cpu_t* cpu = &info_cpus[info_table.cpu_count++];
+    cpu->apic_id = apic_id;
+    cpu->acpi_id = acpi_id;
+    cpu->enabled = (flags & ACPI_MADT_LAPIC_ENABLED) != 0;
+}
+
+/**
+ * @brief Locates the ACPI MADT and stores the processors, I/O APICs and
+ * ISA IRQ overrides in info_cpus, info_ioapics and info_isa_irqs.
+ *
+ * ISA IRQs without override are identity mapped to global system interrupts.
+ * The address of the HPET and the CMOS century register are stored in info_table, if
+ * the firmware reports them.
+ *
+ * @return zero on success, -1 if there is no valid MADT.
+ */
+int info_parse_acpi() {
+    for(int irq = 0; irq < HE_ISA_IRQS; irq++) {
+        info_isa_irqs[irq].gsi = irq;
+        info_isa_irqs[irq].active_low = 0;
+        info_isa_irqs[irq].level = 0;
+    }
+    info_table.cpu_count = 0;
+    info_table.ioapic_count = 0;
+    info_table.hpet_paddr = 0;
+    info_table.rtc_century = 0;
+
+    acpi_rsdp_t* rsdp = acpi_find_rsdp();
+    if(!rsdp) {
+        return -1;
+    }
+    acpi_hpet_t* hpet = (acpi_hpet_t*) acpi_find_table(rsdp, ACPI_HPET_SIGNATURE);
+    if(hpet && hpet->address.space_id == ACPI_GAS_MEMORY) {
+        info_table.hpet_paddr = hpet->address.address;
+    }
+    acpi_fadt_t* fadt = (acpi_fadt_t*) acpi_find_table(rsdp, ACPI_FADT_SIGNATURE);
+    // the century field was added in ACPI 1.0b, older tables end before it
+    if(fadt && fadt->header.length >= sizeof(acpi_fadt_t)) {
+        info_table.rtc_century = fadt->century;
+    }
+
+    acpi_madt_t* madt = (acpi_madt_t*) acpi_find_table(rsdp, ACPI_MADT_SIGNATURE);
+    if(!madt) {
+        return -1;
+    }
+    info_table.lapic_paddr = madt->lapic_address;
+
+    uint8_t* pos = (uint8_t*) madt + sizeof(acpi_madt_t);
+    uint8_t* end = (uint8_t*) madt + madt->header.length;
+    while(pos + sizeof(acpi_madt_entry_t) <= end) {
+        acpi_madt_entry_t* entry = (acpi_madt_entry_t*) pos;
+        if(entry->length < sizeof(acpi_madt_entry_t) || pos + entry->length > end) {
+            break;
+        }
+        switch(entry->type) {
+        case ACPI_MADT_LAPIC: {
+            acpi_madt_lapic_t* lapic = (acpi_madt_lapic_t*) entry;
+            acpi_add_cpu(lapic->apic_id, lapic->acpi_id, lapic->flags);
+            break;
+        }
+        case ACPI_MADT_X2APIC: {
+            acpi_madt_x2apic_t* x2apic = (acpi_madt_x2apic_t*) entry;
+            acpi_add_cpu(x2apic->x2apic_id, x2apic->acpi_uid, x2apic->flags);
+            break;
+        }
+        case ACPI_MADT_IOAPIC: {
+            acpi_madt_ioapic_t* ioapic = (acpi_madt_ioapic_t*) entry;
+            if(info_table.ioapic_count < HE_MAX_IOAPICS) {
+                he_ioapic_t* info = &info_ioapics[info_table.ioapic_count++];
+                info->paddr = ioapic->address;
+                info->id = ioapic->ioapic_id;
+                info->gsi_base = ioapic->gsi_base;
+            }
+            break;
+        }
+        case ACPI_MADT_OVERRIDE: {
+            acpi_madt_override_t* override = (acpi_madt_override_t*) entry;
+            // bus 0 is ISA, conforming polarity and trigger mode mean active high and edge triggered
+            if(override->bus == 0 && override->source < HE_ISA_IRQS) {
+                he_isa_irq_t* irq = &info_isa_irqs[override->source];
+                irq->gsi = override->gsi;
+                irq->active_low = (override->flags & ACPI_MPS_POLARITY_MASK) == ACPI_MPS_POLARITY_LOW;
+                irq->level = (override->flags & ACPI_MPS_TRIGGER_MASK) == ACPI_MPS_TRIGGER_LEVEL;
+            }
+            break;
+        }
+        case ACPI_MADT_LAPIC_ADDRESS: {
+            acpi_madt_lapic_address_t* address = (acpi_madt_lapic_address_t*) entry;
+            info_table.lapic_paddr = address->address;
+            break;
+        }
+        default:
+            break;
+        }
+        pos += entry->length;
+    }
+    return 0;
+}
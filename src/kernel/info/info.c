@@ -106,6 +106,33 @@ void info_parse_mmap(uintptr_t mmap_start, uint32_t mmap_size) {
     info_table.mmap_count = eidx;
 }
 
+/**
+ * @brief Stores the framebuffer set up by the bootloader in info_table.
+ *
+ * Only linear framebuffers with direct RGB colors are recorded, for all
+ * other modes the physical address remains zero.
+ *
+ * @param mbinfo the multiboot information structure
+ */
+void info_parse_framebuffer(multiboot_info_t* mbinfo) {
+    he_framebuffer_t* fb = &info_table.framebuffer;
+    memset(fb, 0, sizeof(he_framebuffer_t));
+    if(!(mbinfo->flags & MULTIBOOT_INFO_FRAMEBUFFER) || mbinfo->framebuffer_type != MULTIBOOT_FRAMEBUFFER_RGB) {
+        return;
+    }
+    fb->paddr = mbinfo->framebuffer_addr;
+    fb->pitch = mbinfo->framebuffer_pitch;
+    fb->width = mbinfo->framebuffer_width;
+    fb->height = mbinfo->framebuffer_height;
+    fb->bpp = mbinfo->framebuffer_bpp;
+    fb->red_shift = mbinfo->red_field_position;
+    fb->red_size = mbinfo->red_mask_size;
+    fb->green_shift = mbinfo->green_field_position;
+    fb->green_size = mbinfo->green_mask_size;
+    fb->blue_shift = mbinfo->blue_field_position;
+    fb->blue_size = mbinfo->blue_mask_size;
+}
+
 /**
  * @brief Allocates length+1 bytes in the string table.
  *
@@ -143,6 +170,8 @@ char* info_string_alloc(size_t length) {
  *  - fills all fields of info_table
  *  - fills info_modules
  *  - fills info_mmap
+ *  - records the framebuffer
+ *  - fills info_cpus, info_ioapics and info_isa_irqs from ACPI
  */
 void info_init() {
     // populate info table
@@ -154,6 +183,13 @@ void info_init() {
     info_parse_modules((multiboot_mod_t*) (uintptr_t) multiboot_info->mods,
             multiboot_info->mods_count);
 
+    info_parse_framebuffer(multiboot_info);
+
+    info_table.cpu_table = info_cpus;
+    info_table.ioapic_table = info_ioapics;
+    info_table.isa_irq_table = info_isa_irqs;
+    info_parse_acpi();
+
     extern uint8_t kernel_end;
     uintptr_t free_paddr_max = (uintptr_t) &kernel_end;
     for(unsigned int i = 0; i < info_table.module_count; i++) {
@@ -28,15 +28,6 @@ static idt64_t* idt_base = NULL;
  * @param dpl Privilege level required for calling this interrupt.
  */
 static void idt_fill_idt64_t(idt64_t* entry, uint8_t type, uintptr_t handler, uint16_t cs, uint8_t dpl) {
-    DEBUGF("[idt_fill_idt64_t]\n");
-    DEBUGF("  entry:   %p\n", entry);
-    DEBUGF("  type:    %x\n", (uint32_t)type);
-    DEBUGF("  handler: %p\n", handler);
-    DEBUGF("  cs:      %x\n", (uint32_t)cs);
-    DEBUGF("  dpl:     %d\n", (uint32_t)dpl);
-
-    MAGIC_BREAK;
-
     entry->offset_low = handler & 0xFFFF;
     entry->offset_middle = (handler >> 16) & 0xFFFF;
     entry->offset_high = (handler >> 32) & 0xFFFFFFFF;
@@ -8,4 +8,166 @@
  */
 
 #include "kernel/interrupts/int.h"
+#include "kernel/interrupts/idt.h"
+#include "kernel/interrupts/softirq.h"
 
+#include "kernel/log.h"
+#include "kernel/panic.h"
+#include "kernel/percpu.h"
+
+#include "kernel/sched/sched.h"
+#include "kernel/sync/rcu.h"
+
+#include <stddef.h>
+
+/// entry stubs defined in isr.asm, #INT_STUB_SIZE bytes apart
+extern char isr_stubs[];
+
+/// registered handler of each vector, read without lock, see rcu.h
+static volatile int_handler_t int_handlers[INT_VECTORS];
+
+/// number of interrupts raised on each vector on each processor
+static PERCPU_DEFINE(uint64_t, int_counters[INT_VECTORS]);
+
+/// names of the exceptions defined by the architecture
+static const char* const int_exception_names[INT_VECTOR_IRQ_BASE] = {
+    "divide error", "debug", "NMI", "breakpoint",
+    "overflow", "bound range exceeded", "invalid opcode", "device not available",
+    "double fault", "coprocessor segment overrun", "invalid TSS", "segment not present",
+    "stack fault", "general protection fault", "page fault", NULL,
+    "x87 floating point error", "alignment check", "machine check", "SIMD floating point error",
+    "virtualization exception", "control protection exception", NULL, NULL,
+    NULL, NULL, NULL, NULL,
+    "hypervisor injection exception", "VMM communication exception", "security exception", NULL
+};
+
+/**
+ * @brief Installs the entry stubs for all vectors in the IDT.
+ */
+void int_init() {
+    for(int vector = 0; vector < INT_VECTORS; vector++) {
+        idt_set_entry(vector, IDT_INT_GATE, (uintptr_t)isr_stubs + vector * INT_STUB_SIZE, 0x8, 0);
+    }
+    idt_reload();
+}
+
+/**
+ * @brief Registers the handler for a vector, replacing any previous handler.
+ *
+ * @param vector the interrupt vector
+ * @param handler the handler, it must be declared with #INT_FAST_HANDLER if \c vector is a fast vector
+ */
+void int_register(uint8_t vector, int_handler_t handler) {
+    RCU_ASSIGN(int_handlers[vector], handler);
+}
+
+/**
+ * @brief Removes the handler of a vector.
+ *
+ * The handler may still run on other processors until #rcu_synchronize returns.
+ */
+void int_unregister(uint8_t vector) {
+    RCU_ASSIGN(int_handlers[vector], NULL);
+}
+
+/**
+ * @brief Returns how often a vector was raised since boot.
+ */
+uint64_t int_count(uint8_t vector) {
+    uint64_t count = 0;
+    for(unsigned int cpu = 0; cpu < HE_MAX_CPUS; cpu++) {
+        if(percpu_offsets[cpu]) {
+            count += *(volatile uint64_t*)PERCPU_REMOTE(int_counters[vector], cpu);
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Returns the name of an exception vector or NULL, if \c vector is not an exception.
+ */
+const char* int_exception_name(uint8_t vector) {
+    return vector < INT_VECTOR_IRQ_BASE ? int_exception_names[vector] : NULL;
+}
+
+/**
+ * @brief Copies the registers in \c frame to the state saved by #PANIC_SAVE_STATE.
+ */
+void int_panic_frame(const int_frame_t* frame) {
+    panic_gprs[0] = frame->rax;
+    panic_gprs[1] = frame->rbx;
+    panic_gprs[2] = frame->rcx;
+    panic_gprs[3] = frame->rdx;
+    panic_gprs[4] = frame->rbp;
+    panic_gprs[5] = frame->rsi;
+    panic_gprs[6] = frame->rdi;
+    panic_gprs[7] = frame->rsp;
+    panic_gprs[8] = frame->r8;
+    panic_gprs[9] = frame->r9;
+    panic_gprs[10] = frame->r10;
+    panic_gprs[11] = frame->r11;
+    panic_gprs[12] = frame->r12;
+    panic_gprs[13] = frame->r13;
+    panic_gprs[14] = frame->r14;
+    panic_gprs[15] = frame->r15;
+    panic_rip = frame->rip;
+    panic_rflags = frame->rflags;
+}
+
+/**
+ * @brief Handles a vector below #INT_VECTOR_FAST_BASE without registered handler.
+ *
+ * Exceptions are fatal, other interrupts are reported. Fast vectors are only counted
+ * by #int_dispatch, because reporting them would clobber the SSE state of the interrupted code.
+ */
+static void int_unhandled(int_frame_t* frame) {
+    if(frame->vector < INT_VECTOR_IRQ_BASE) {
+        const char* name = int_exception_names[frame->vector];
+        int_panicf(frame, "unhandled exception %lu (%s), error code %lx at %lx\n",
+                frame->vector, name ? name : "reserved", frame->error, frame->rip);
+    } else {
+        LOG_WARN(LOG_CAT_INT, "unhandled interrupt %lu at %lx\n", frame->vector, frame->rip);
+    }
+}
+
+/**
+ * @brief Called by the entry stubs to dispatch an interrupt to its handler.
+ *
+ * @return non-zero, if the stub must call #int_return before returning.
+ */
+INT_FAST_HANDLER int int_dispatch(int_frame_t* frame) {
+    // an idle processor must leave its quiescent state before reading anything
+    rcu_irq_enter();
+    uint64_t vector = frame->vector & (INT_VECTORS - 1);
+    // interrupts are disabled, so the counter of this processor needs no atomic operation
+    (*PERCPU_PTR(int_counters[vector]))++;
+#ifdef HE_INT_STATS
+    unsigned int cpu;
+    uint64_t start = INTSTAT_TIMESTAMP(&cpu);
+#endif
+
+    int_handler_t handler = RCU_DEREFERENCE(int_handlers[vector]);
+    if(handler) {
+        handler(frame);
+    } else if(vector < INT_VECTOR_FAST_BASE) {
+        int_unhandled(frame);
+    }
+
+#ifdef HE_INT_STATS
+    intstat_record_handler(cpu, vector, INTSTAT_TIMESTAMP(&cpu) - start);
+#endif
+    // deferred work and preemption only happen when returning to code with interrupts enabled
+    return (frame->rflags & INT_RFLAGS_IF) && (softirq_maybe_pending() || SCHED_RESCHED_PENDING());
+}
+
+/**
+ * @brief Runs deferred work and preempts the current thread, if requested.
+ *
+ * Called by the entry stubs with interrupts disabled and the SSE state saved, when
+ * returning to code with interrupts enabled.
+ */
+void int_return() {
+    softirq_run_irq();
+    // the frame of the interrupted thread stays on its stack until it is resumed
+    sched_preempt_irq();
+}
@@ -0,0 +1,255 @@
+/**
+ * @file intstat.c
+ *
+ * @author Fabian Thorand
+ * @date   19.10.2026
+ *
+ * @brief Histograms of interrupt handler durations, interrupts-disabled spans and timer latency.
+ *
+ * The handler histograms of all vectors take 26 KB per processor and are allocated from the
+ * page frame allocator. The other histograms are small and static.
+ */
+
+#include "kernel/interrupts/intstat.h"
+#include "kernel/interrupts/int.h"
+
+#include "kernel/mem/pfa.h"
+#include "kernel/mem/vmm.h"
+
+#include "kernel/time/clock.h"
+
+#include "kernel/klibc/kstdio.h"
+#include "kernel/klibc/string.h"
+
+#include "kernel/cpu.h"
+#include "kernel/helium.h"
+#include "kernel/percpu.h"
+
+#include <stddef.h>
+
+#ifdef HE_INT_STATS
+
+/// CPUID 0x80000001 EDX: rdtscp is available
+#define INTSTAT_CPUID_RDTSCP (1 << 27)
+
+/**
+ * @brief Handler statistics of one processor.
+ */
+typedef struct {
+    uint32_t buckets[INT_VECTORS][INTSTAT_BUCKETS]; ///< histogram of each vector
+    uint64_t max[INT_VECTORS];                      ///< longest duration of each vector
+} intstat_handlers_t;
+
+/**
+ * @brief Statistics of one processor that are not per vector.
+ */
+typedef struct {
+    uint64_t off_since;                     ///< start of the current interrupts-disabled span or zero
+    const char* off_file;                   ///< location that disabled interrupts
+    int off_line;
+    const char* off_max_file;               ///< location that started the longest span
+    int off_max_line;
+    uint64_t off_max;                       ///< longest interrupts-disabled span
+    uint64_t off[INTSTAT_BUCKETS];          ///< histogram of interrupts-disabled spans
+    uint64_t deadline;                      ///< deadline the timer was armed with or zero
+    uint64_t timer_max;                     ///< largest timer latency
+    uint64_t timer[INTSTAT_BUCKETS];        ///< histogram of timer latencies
+} __attribute__((aligned(64))) intstat_cpu_t;
+
+/// non-zero, when rdtscp is available
+int intstat_have_rdtscp = 0;
+
+/// handler statistics of each processor, NULL until #intstat_init
+static intstat_handlers_t* intstat_handlers = NULL;
+
+/// other statistics of each processor
+static intstat_cpu_t intstat_cpus[HE_MAX_CPUS];
+
+/**
+ * @brief Returns the bucket of a duration.
+ */
+INT_FAST_HANDLER static inline unsigned int intstat_bucket(uint64_t cycles) {
+    if(cycles >> (INTSTAT_MIN_SHIFT + 1) == 0) {
+        return 0;
+    }
+    unsigned int bucket = 63 - __builtin_clzll(cycles) - INTSTAT_MIN_SHIFT;
+    return bucket < INTSTAT_BUCKETS ? bucket : INTSTAT_BUCKETS - 1;
+}
+
+/**
+ * @brief Returns the TSC and the index of the current processor without rdtscp.
+ */
+INT_FAST_HANDLER uint64_t intstat_timestamp_slow(unsigned int* cpu) {
+    // cpu_index executes cpuid, which exits to the hypervisor in a virtual machine
+    *cpu = PERCPU_READ(percpu_index);
+    return cpu_rdtsc();
+}
+
+/**
+ * @brief Records the duration of an interrupt handler.
+ */
+INT_FAST_HANDLER void intstat_record_handler(unsigned int cpu, uint8_t vector, uint64_t cycles) {
+    if(!intstat_handlers || cpu >= HE_MAX_CPUS) {
+        return;
+    }
+    intstat_handlers_t* stats = &intstat_handlers[cpu];
+    stats->buckets[vector][intstat_bucket(cycles)]++;
+    if(cycles > stats->max[vector]) {
+        stats->max[vector] = cycles;
+    }
+}
+
+/**
+ * @brief Records the start of an interrupts-disabled span.
+ */
+INT_FAST_HANDLER void intstat_irq_off(const char* file, int line) {
+    unsigned int cpu;
+    uint64_t now = INTSTAT_TIMESTAMP(&cpu);
+    if(cpu >= HE_MAX_CPUS) {
+        return;
+    }
+    intstat_cpus[cpu].off_since = now;
+    intstat_cpus[cpu].off_file = file;
+    intstat_cpus[cpu].off_line = line;
+}
+
+/**
+ * @brief Records the end of an interrupts-disabled span, if its start was recorded.
+ */
+INT_FAST_HANDLER void intstat_irq_on() {
+    unsigned int cpu;
+    uint64_t now = INTSTAT_TIMESTAMP(&cpu);
+    if(cpu >= HE_MAX_CPUS || !intstat_cpus[cpu].off_since) {
+        return;
+    }
+    intstat_cpu_t* stats = &intstat_cpus[cpu];
+    uint64_t cycles = now - stats->off_since;
+    stats->off_since = 0;
+    stats->off[intstat_bucket(cycles)]++;
+    if(cycles > stats->off_max) {
+        stats->off_max = cycles;
+        stats->off_max_file = stats->off_file;
+        stats->off_max_line = stats->off_line;
+    }
+}
+
+/**
+ * @brief Records the deadline the timer of the current processor was armed with.
+ */
+INT_FAST_HANDLER void intstat_timer_armed(uint64_t deadline) {
+    unsigned int cpu;
+    INTSTAT_TIMESTAMP(&cpu);
+    if(cpu < HE_MAX_CPUS) {
+        intstat_cpus[cpu].deadline = deadline;
+    }
+}
+
+/**
+ * @brief Records the latency of a timer interrupt relative to its deadline.
+ */
+INT_FAST_HANDLER void intstat_timer_fired() {
+    unsigned int cpu;
+    uint64_t now = INTSTAT_TIMESTAMP(&cpu);
+    if(cpu >= HE_MAX_CPUS || !intstat_cpus[cpu].deadline) {
+        return;
+    }
+    intstat_cpu_t* stats = &intstat_cpus[cpu];
+    uint64_t cycles = now > stats->deadline ? now - stats->deadline : 0;
+    stats->deadline = 0;
+    stats->timer[intstat_bucket(cycles)]++;
+    if(cycles > stats->timer_max) {
+        stats->timer_max = cycles;
+    }
+}
+
+/**
+ * @brief Writes the non-empty buckets of a histogram on one line, labeled with their lower bound.
+ */
+static void intstat_print_histogram(const uint64_t* buckets) {
+    for(int b = 0; b < INTSTAT_BUCKETS; b++) {
+        if(buckets[b]) {
+            kprintf(" 2^%d:%lu", b + INTSTAT_MIN_SHIFT, buckets[b]);
+        }
+    }
+    kputs("\n");
+}
+
+/**
+ * @brief Converts cycles to nanoseconds, zero if the TSC frequency is not known yet.
+ */
+static uint64_t intstat_ns(uint64_t cycles) {
+    return clock_tsc_to_ns(cycles);
+}
+
+#endif
+
+/**
+ * @brief Allocates the histograms. Must be called once after the page frame allocator is initialized.
+ */
+void intstat_init() {
+#ifdef HE_INT_STATS
+    cpu_id_t id;
+    cpuid(0x80000000, &id);
+    if(id.eax >= 0x80000001) {
+        cpuid(0x80000001, &id);
+        intstat_have_rdtscp = (id.edx & INTSTAT_CPUID_RDTSCP) != 0;
+    }
+    size_t size = HE_MAX_CPUS * sizeof(intstat_handlers_t);
+    uintptr_t paddr = pfa_alloc_block((size + HE_PAGE_SIZE - 1) / HE_PAGE_SIZE, 0);
+    if(paddr) {
+        intstat_handlers_t* handlers = (intstat_handlers_t*) (VMM_PHYS4G_BASE + paddr);
+        memset(handlers, 0, size);
+        intstat_handlers = handlers;
+    }
+    intstat_init_cpu();
+#endif
+}
+
+/**
+ * @brief Stores the index of the current processor in \c IA32_TSC_AUX. Must be called on every processor.
+ */
+void intstat_init_cpu() {
+#ifdef HE_INT_STATS
+    if(intstat_have_rdtscp) {
+        cpu_msr_write(INTSTAT_MSR_TSC_AUX, cpu_index());
+    }
+#endif
+}
+
+/**
+ * @brief Writes all non-empty histograms to kstdio.
+ */
+void intstat_dump() {
+#ifdef HE_INT_STATS
+    for(unsigned int cpu = 0; cpu < HE_MAX_CPUS; cpu++) {
+        intstat_cpu_t* stats = &intstat_cpus[cpu];
+        if(stats->off_max) {
+            kprintf("cpu %u interrupts disabled: max %lu cycles (%lu ns) at %s:%d\n  ", cpu,
+                    stats->off_max, intstat_ns(stats->off_max), stats->off_max_file, stats->off_max_line);
+            intstat_print_histogram(stats->off);
+        }
+        if(stats->timer_max) {
+            kprintf("cpu %u timer latency: max %lu cycles (%lu ns)\n  ", cpu, stats->timer_max, intstat_ns(stats->timer_max));
+            intstat_print_histogram(stats->timer);
+        }
+        if(!intstat_handlers) {
+            continue;
+        }
+        intstat_handlers_t* handlers = &intstat_handlers[cpu];
+        for(int vector = 0; vector < INT_VECTORS; vector++) {
+            if(!handlers->max[vector]) {
+                continue;
+            }
+            uint64_t buckets[INTSTAT_BUCKETS];
+            for(int b = 0; b < INTSTAT_BUCKETS; b++) {
+                buckets[b] = handlers->buckets[vector][b];
+            }
+            kprintf("cpu %u vector %02x handler: max %lu cycles (%lu ns)\n  ", cpu, vector,
+                    handlers->max[vector], intstat_ns(handlers->max[vector]));
+            intstat_print_histogram(buckets);
+        }
+    }
+#else
+    kputs("interrupt statistics are disabled (HE_INT_STATS)\n");
+#endif
+}
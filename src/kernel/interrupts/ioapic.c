@@ -4,4 +4,296 @@
  * @author Fabian Thorand
  *
  * @brief Interface to I/O APICs.
+ *
+ * The register window of an I/O APIC consists of a select and a data register, so every
+ * access is a pair of writes that must not interleave with another processor. All accesses
+ * are serialized by #ioapic_lock with interrupts disabled.
+ */
+
+#include "kernel/interrupts/ioapic.h"
+#include "kernel/interrupts/pic.h"
+#include "kernel/interrupts/int.h"
+
+#include "kernel/mem/vmm.h"
+
+#include "kernel/sync/spinlock.h"
+
+#include "kernel/helium.h"
+#include "kernel/info.h"
+#include "kernel/log.h"
+
+#include <stddef.h>
+
+/**
+ * @brief State of an I/O APIC.
+ */
+typedef struct {
+    volatile uint32_t* base;    ///< virtual address of the register window
+    uint32_t gsi_base;          ///< first global system interrupt
+    uint32_t gsi_count;         ///< number of redirection entries
+} ioapic_t;
+
+/**
+ * @brief State of a global system interrupt.
+ */
+typedef struct {
+    uint32_t low;           ///< low half of the redirection entry without the mask bit
+    uint32_t apic_id;       ///< processor receiving the interrupt
+    uint8_t  routed;        ///< non-zero, if the interrupt was routed with #ioapic_route
+    uint8_t  masked;        ///< non-zero, if the interrupt is masked
+    uint16_t reserved;
+    uint64_t last_count;    ///< interrupt count at the last rebalance
+} ioapic_gsi_t;
+
+/// the I/O APICs in the system
+static ioapic_t ioapics[HE_MAX_IOAPICS];
+/// number of entries in #ioapics
+static unsigned int ioapic_count = 0;
+/// state of all global system interrupts that can be routed
+static ioapic_gsi_t ioapic_gsis[IOAPIC_MAX_GSIS];
+static LOCK_CLASS(ioapic_lock_class, "ioapic");
+/// serializes accesses to the register windows
+static spinlock_t ioapic_lock = SPINLOCK_INIT(&ioapic_lock_class);
+
+/**
+ * @brief Disables interrupts and acquires #ioapic_lock.
+ * @return non-zero, if interrupts were enabled before.
+ */
+static int ioapic_acquire() {
+    return spinlock_acquire_irqsave(&ioapic_lock);
+}
+
+/**
+ * @brief Releases #ioapic_lock and restores the interrupt flag.
+ */
+static void ioapic_release(int enabled) {
+    spinlock_release_irqrestore(&ioapic_lock, enabled);
+}
+
+/**
+ * @brief Reads an I/O APIC register. The caller must hold #ioapic_lock.
+ */
+static uint32_t ioapic_read(ioapic_t* ioapic, uint8_t reg) {
+    ioapic->base[IOAPIC_IOREGSEL / 4] = reg;
+    return ioapic->base[IOAPIC_IOWIN / 4];
+}
+
+/**
+ * @brief Writes an I/O APIC register. The caller must hold #ioapic_lock.
+ */
+static void ioapic_write(ioapic_t* ioapic, uint8_t reg, uint32_t value) {
+    ioapic->base[IOAPIC_IOREGSEL / 4] = reg;
+    ioapic->base[IOAPIC_IOWIN / 4] = value;
+}
+
+/**
+ * @brief Returns the I/O APIC handling a global system interrupt or NULL.
+ */
+static ioapic_t* ioapic_for_gsi(uint32_t gsi) {
+    for(unsigned int i = 0; i < ioapic_count; i++) {
+        if(gsi >= ioapics[i].gsi_base && gsi < ioapics[i].gsi_base + ioapics[i].gsi_count) {
+            return &ioapics[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Writes the redirection entry of a global system interrupt from its state.
+ * The caller must hold #ioapic_lock.
+ */
+static void ioapic_write_entry(ioapic_t* ioapic, uint32_t gsi) {
+    ioapic_gsi_t* state = &ioapic_gsis[gsi];
+    uint8_t reg = IOAPIC_REG_REDTBL + 2 * (gsi - ioapic->gsi_base);
+    // mask while the entry is inconsistent
+    ioapic_write(ioapic, reg, state->low | IOAPIC_REDIR_MASKED);
+    ioapic_write(ioapic, reg + 1, state->apic_id << 24);
+    ioapic_write(ioapic, reg, state->low | (state->masked ? IOAPIC_REDIR_MASKED : 0));
+}
+
+/**
+ * @brief Masks all inputs of the I/O APICs listed in the MADT and disables the legacy PIC.
+ *
+ * @return zero on success, -1 if there is no I/O APIC.
+ */
+int ioapic_init() {
+    for(unsigned int i = 0; i < info_table.ioapic_count && ioapic_count < HE_MAX_IOAPICS; i++) {
+        he_ioapic_t* info = &info_ioapics[i];
+        ioapic_t* ioapic = &ioapics[ioapic_count++];
+        ioapic->base = (volatile uint32_t*) (VMM_PHYS4G_BASE + info->paddr);
+        ioapic->gsi_base = info->gsi_base;
+
+        int enabled = ioapic_acquire();
+        ioapic->gsi_count = ((ioapic_read(ioapic, IOAPIC_REG_VERSION) >> 16) & 0xFF) + 1;
+        for(uint32_t entry = 0; entry < ioapic->gsi_count; entry++) {
+            ioapic_write(ioapic, IOAPIC_REG_REDTBL + 2 * entry, IOAPIC_REDIR_MASKED);
+        }
+        ioapic_release(enabled);
+
+        LOG_DEBUG(LOG_CAT_INT, "ioapic: id %u at %p, gsi %u-%u\n", info->id, (void*)info->paddr,
+                ioapic->gsi_base, ioapic->gsi_base + ioapic->gsi_count - 1);
+    }
+    if(ioapic_count == 0) {
+        return -1;
+    }
+    pic_disable();
+    return 0;
+}
+
+/**
+ * @brief Returns the global system interrupt an ISA IRQ is connected to.
+ */
+uint32_t ioapic_isa_gsi(uint8_t irq) {
+    return irq < HE_ISA_IRQS ? info_isa_irqs[irq].gsi : irq;
+}
+
+/**
+ * @brief Routes a global system interrupt to a processor and unmasks it.
+ *
+ * @param gsi the global system interrupt
+ * @param active_low non-zero, if the input is active low
+ * @param level non-zero, if the input is level triggered
+ * @param apic_id local APIC ID of the processor receiving the interrupt
+ * @return the vector of the interrupt or -1, if no I/O APIC handles \c gsi.
+ */
+int ioapic_route(uint32_t gsi, int active_low, int level, uint32_t apic_id) {
+    ioapic_t* ioapic = ioapic_for_gsi(gsi);
+    if(!ioapic || gsi >= IOAPIC_MAX_GSIS) {
+        return -1;
+    }
+    int enabled = ioapic_acquire();
+    ioapic_gsi_t* state = &ioapic_gsis[gsi];
+    // fixed delivery to a physical destination
+    state->low = IOAPIC_VECTOR(gsi)
+            | (active_low ? IOAPIC_REDIR_ACTIVE_LOW : 0)
+            | (level ? IOAPIC_REDIR_LEVEL : 0);
+    state->apic_id = apic_id;
+    state->routed = 1;
+    state->masked = 0;
+    state->last_count = int_count(IOAPIC_VECTOR(gsi));
+    ioapic_write_entry(ioapic, gsi);
+    ioapic_release(enabled);
+    return IOAPIC_VECTOR(gsi);
+}
+
+/**
+ * @brief Routes an ISA IRQ, applying the overrides of the MADT.
+ *
+ * @see ioapic_route
+ */
+int ioapic_route_isa(uint8_t irq, uint32_t apic_id) {
+    if(irq >= HE_ISA_IRQS) {
+        return -1;
+    }
+    he_isa_irq_t* isa = &info_isa_irqs[irq];
+    return ioapic_route(isa->gsi, isa->active_low, isa->level, apic_id);
+}
+
+/**
+ * @brief Sets the mask bit of a routed global system interrupt.
+ */
+static void ioapic_set_masked(uint32_t gsi, int masked) {
+    ioapic_t* ioapic = ioapic_for_gsi(gsi);
+    if(!ioapic || gsi >= IOAPIC_MAX_GSIS || !ioapic_gsis[gsi].routed) {
+        return;
+    }
+    int enabled = ioapic_acquire();
+    ioapic_gsis[gsi].masked = masked;
+    ioapic_write(ioapic, IOAPIC_REG_REDTBL + 2 * (gsi - ioapic->gsi_base),
+            ioapic_gsis[gsi].low | (masked ? IOAPIC_REDIR_MASKED : 0));
+    ioapic_release(enabled);
+}
+
+/**
+ * @brief Masks a global system interrupt.
+ */
+void ioapic_mask(uint32_t gsi) {
+    ioapic_set_masked(gsi, 1);
+}
+
+/**
+ * @brief Unmasks a routed global system interrupt.
+ */
+void ioapic_unmask(uint32_t gsi) {
+    ioapic_set_masked(gsi, 0);
+}
+
+/**
+ * @brief Delivers a routed global system interrupt to another processor.
+ *
+ * @return zero on success, -1 if \c gsi is not routed.
+ */
+int ioapic_set_affinity(uint32_t gsi, uint32_t apic_id) {
+    ioapic_t* ioapic = ioapic_for_gsi(gsi);
+    if(!ioapic || gsi >= IOAPIC_MAX_GSIS || !ioapic_gsis[gsi].routed) {
+        return -1;
+    }
+    int enabled = ioapic_acquire();
+    ioapic_gsis[gsi].apic_id = apic_id;
+    // the destination is in the high half, a single write moves the interrupt
+    ioapic_write(ioapic, IOAPIC_REG_REDTBL + 2 * (gsi - ioapic->gsi_base) + 1, apic_id << 24);
+    ioapic_release(enabled);
+    return 0;
+}
+
+/**
+ * @brief Returns the local APIC ID of the processor receiving a global system interrupt.
+ */
+uint32_t ioapic_get_affinity(uint32_t gsi) {
+    return gsi < IOAPIC_MAX_GSIS ? ioapic_gsis[gsi].apic_id : 0;
+}
+
+/**
+ * @brief Distributes the routed interrupts over the given processors.
+ *
+ * The interrupts are assigned in the order of their rate since the last call, each
+ * to the processor with the lowest load so far. Interrupts only move if that
+ * changes the load, so the assignment is stable when the rates are.
+ *
+ * @param apic_ids local APIC IDs of the processors that may receive interrupts
+ * @param count number of entries in \c apic_ids
  */
+void ioapic_rebalance(const uint32_t* apic_ids, unsigned int count) {
+    if(count == 0) {
+        return;
+    }
+    if(count > HE_MAX_CPUS) {
+        count = HE_MAX_CPUS;
+    }
+    uint16_t order[IOAPIC_MAX_GSIS];
+    uint64_t rate[IOAPIC_MAX_GSIS];
+    unsigned int routed = 0;
+
+    // sort the routed interrupts by descending rate
+    for(uint32_t gsi = 0; gsi < IOAPIC_MAX_GSIS; gsi++) {
+        if(!ioapic_gsis[gsi].routed) {
+            continue;
+        }
+        uint64_t total = int_count(IOAPIC_VECTOR(gsi));
+        // every interrupt counts, so idle ones are spread as well
+        rate[gsi] = total - ioapic_gsis[gsi].last_count + 1;
+        ioapic_gsis[gsi].last_count = total;
+        unsigned int i = routed++;
+        for(; i > 0 && rate[order[i - 1]] < rate[gsi]; i--) {
+            order[i] = order[i - 1];
+        }
+        order[i] = gsi;
+    }
+
+    uint64_t load[HE_MAX_CPUS] = { 0 };
+    for(unsigned int i = 0; i < routed; i++) {
+        uint32_t gsi = order[i];
+        unsigned int best = 0;
+        for(unsigned int cpu = 0; cpu < count; cpu++) {
+            // prefer the current processor on ties
+            if(load[cpu] < load[best] || (load[cpu] == load[best] && apic_ids[cpu] == ioapic_gsis[gsi].apic_id)) {
+                best = cpu;
+            }
+        }
+        load[best] += rate[gsi];
+        if(apic_ids[best] != ioapic_gsis[gsi].apic_id) {
+            LOG_DEBUG(LOG_CAT_INT, "ioapic: moving gsi %u from %u to %u\n", gsi, ioapic_gsis[gsi].apic_id, apic_ids[best]);
+            ioapic_set_affinity(gsi, apic_ids[best]);
+        }
+    }
+}
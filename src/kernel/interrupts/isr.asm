@@ -0,0 +1,153 @@
+%include "macros/macros.inc"
+section .text
+bits 64
+
+;;; first vector that uses the fast entry path, must match INT_VECTOR_FAST_BASE in int.h
+%define ISR_FAST_BASE 0xF0
+;;; distance between two entry stubs, must match INT_STUB_SIZE in int.h
+%define ISR_STUB_SIZE 16
+;;; size of the FXSAVE area
+%define ISR_FXSAVE_SIZE 512
+
+;;; @brief Executes swapgs if the saved CS at \c %1 has a non-zero privilege level.
+;;;
+;;; The kernel GS base must be active in the kernel, see percpu.h.
+%macro swapgs_if_user 1
+    test byte %1, 3
+    jz %%kernel
+    swapgs
+%%kernel:
+%endmacro
+
+;; export the entry stubs to @ref int.c
+global isr_stubs
+
+;; import the C dispatcher from @ref int.c
+extern int_dispatch
+;; import deferred work and preemption from @ref int.c
+extern int_return
+
+;;; @brief Entry stubs for all 256 vectors, ISR_STUB_SIZE bytes apart.
+;;;
+;;; Every stub pushes a zero in place of the error code, unless the CPU already pushed one,
+;;; followed by the vector number. Both entry paths then build an int_frame_t on the stack.
+align ISR_STUB_SIZE
+isr_stubs:
+%assign vector 0
+%rep 256
+    align ISR_STUB_SIZE
+%if vector == 8 || (vector >= 10 && vector <= 14) || vector == 17 || vector == 21 || vector == 29 || vector == 30
+    ;; error code pushed by the CPU
+%else
+    push qword 0
+%endif
+    push qword vector
+%if vector >= ISR_FAST_BASE
+    jmp isr_fast
+%else
+    jmp isr_common
+%endif
+%assign vector vector+1
+%endrep
+
+;;; @brief Common entry path that saves all general purpose registers and the SSE state.
+;;;
+;;; Handlers called from here may use any register.
+isr_common:
+    ;; CS is above vector, error code and RIP
+    swapgs_if_user [rsp + 3 * 8]
+    push rax
+    push rbx
+    push rcx
+    push rdx
+    push rsi
+    push rdi
+    push rbp
+    push r8
+    push r9
+    push r10
+    push r11
+    push r12
+    push r13
+    push r14
+    push r15
+
+    ;; the frame is 16 byte aligned, because the CPU aligns the stack before pushing SS
+    mov rdi, rsp
+    sub rsp, ISR_FXSAVE_SIZE
+    fxsave [rsp]
+    cld
+    call int_dispatch
+    test eax, eax
+    jz .restore
+    call int_return
+.restore:
+    fxrstor [rsp]
+    add rsp, ISR_FXSAVE_SIZE
+
+    pop r15
+    pop r14
+    pop r13
+    pop r12
+    pop r11
+    pop r10
+    pop r9
+    pop r8
+    pop rbp
+    pop rdi
+    pop rsi
+    pop rdx
+    pop rcx
+    pop rbx
+    pop rax
+    ;; remove vector and error code
+    add rsp, 16
+    swapgs_if_user [rsp + 8]
+    iretq
+
+;;; @brief Fast entry path that only saves the registers a C function may clobber.
+;;;
+;;; The slots of the callee saved registers are reserved, but not written, so the frame has
+;;; the same layout as in the common path. Handlers must not touch the SSE registers.
+isr_fast:
+    swapgs_if_user [rsp + 3 * 8]
+    sub rsp, 15 * 8
+    mov [rsp + 14 * 8], rax
+    mov [rsp + 12 * 8], rcx
+    mov [rsp + 11 * 8], rdx
+    mov [rsp + 10 * 8], rsi
+    mov [rsp +  9 * 8], rdi
+    mov [rsp +  7 * 8], r8
+    mov [rsp +  6 * 8], r9
+    mov [rsp +  5 * 8], r10
+    mov [rsp +  4 * 8], r11
+
+    mov rdi, rsp
+    cld
+    call int_dispatch
+    test eax, eax
+    jnz .return
+
+.restore:
+    mov r11, [rsp +  4 * 8]
+    mov r10, [rsp +  5 * 8]
+    mov r9,  [rsp +  6 * 8]
+    mov r8,  [rsp +  7 * 8]
+    mov rdi, [rsp +  9 * 8]
+    mov rsi, [rsp + 10 * 8]
+    mov rdx, [rsp + 11 * 8]
+    mov rcx, [rsp + 12 * 8]
+    mov rax, [rsp + 14 * 8]
+    ;; remove registers, vector and error code
+    add rsp, 17 * 8
+    swapgs_if_user [rsp + 8]
+    iretq
+
+    ;; deferred work and other threads may use any register, so the SSE state is saved after all
+.return:
+    sub rsp, ISR_FXSAVE_SIZE
+    fxsave [rsp]
+    call int_return
+    fxrstor [rsp]
+    add rsp, ISR_FXSAVE_SIZE
+    jmp .restore
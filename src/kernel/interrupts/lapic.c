@@ -4,4 +4,423 @@
  * @author Fabian Thorand
  *
  * @brief Interface to local APICs.
+ *
+ * In xAPIC mode, the registers are accessed through the mapping of the lower 4 GB. The MTRRs
+ * set up by the firmware make the APIC page uncacheable, so no separate mapping is needed.
+ */
+
+#include "kernel/interrupts/lapic.h"
+#include "kernel/interrupts/int.h"
+
+#include "kernel/mem/vmm.h"
+
+#include "kernel/sync/rcu.h"
+
+#include "kernel/time/clock.h"
+
+#include "kernel/cpu.h"
+#include "kernel/log.h"
+
+#include <stddef.h>
+
+/// length of one calibration round of the timer in microseconds
+#define LAPIC_CALIBRATE_US 10000
+/// number of calibration rounds, the median is used
+#define LAPIC_CALIBRATE_ROUNDS 5
+
+/// timer divide configuration value for dividing by 16
+#define LAPIC_TIMER_DIVIDE_16 0x3
+/// largest initial count of the timer
+#define LAPIC_TIMER_MAX_COUNT 0xFFFFFFFF
+
+/// number of interrupts measured by #lapic_timer_benchmark and #lapic_ipi_benchmark
+#define LAPIC_BENCHMARK_ROUNDS 64
+
+/// virtual address of the local APIC registers
+static volatile uint32_t* lapic_base = NULL;
+
+/// non-zero, when the local APICs are in x2APIC mode
+static int lapic_x2apic = 0;
+
+/// LVT timer mode used for one-shot deadlines, either #LAPIC_TIMER_TSC_DEADLINE or #LAPIC_TIMER_ONESHOT
+static uint32_t lapic_timer_mode = LAPIC_TIMER_ONESHOT;
+
+/// measured frequency of the APIC timer after division in kHz
+static uint64_t lapic_timer_freq_khz = 0;
+/// converts TSC cycles to APIC timer ticks, 32.32 fixed point
+static uint64_t lapic_tsc_to_timer = 0;
+
+/// function called on timer interrupts
+static volatile lapic_timer_handler_t lapic_timer_handler = NULL;
+
+/// timestamp taken by the benchmark handler
+static volatile uint64_t lapic_benchmark_tsc = 0;
+
+/// sequence number of the last ping sent by #lapic_ipi_benchmark
+static volatile uint64_t lapic_ping_sent = 0;
+/// sequence number of the last ping received
+static volatile uint64_t lapic_ping_received = 0;
+
+/**
+ * @brief Reads a local APIC register.
+ */
+INT_FAST_HANDLER static inline uint32_t lapic_read(uint32_t reg) {
+    if(lapic_x2apic) {
+        return cpu_msr_read(LAPIC_X2APIC_MSR(reg));
+    }
+    return lapic_base[reg / 4];
+}
+
+/**
+ * @brief Writes a local APIC register.
+ */
+INT_FAST_HANDLER static inline void lapic_write(uint32_t reg, uint32_t value) {
+    if(lapic_x2apic) {
+        cpu_msr_write(LAPIC_X2APIC_MSR(reg), value);
+    } else {
+        lapic_base[reg / 4] = value;
+    }
+}
+
+/**
+ * @brief Acknowledges a ping of #lapic_ipi_benchmark.
+ */
+INT_FAST_HANDLER static void lapic_ping_interrupt(int_frame_t* frame) {
+    (void)frame;
+    lapic_ping_received = lapic_ping_sent;
+    lapic_eoi();
+}
+
+/**
+ * @brief Handles timer interrupts.
+ */
+INT_FAST_HANDLER static void lapic_timer_interrupt(int_frame_t* frame) {
+#ifdef HE_INT_STATS
+    intstat_timer_fired();
+#endif
+    lapic_timer_handler_t handler = lapic_timer_handler;
+    if(handler) {
+        handler(frame);
+    }
+    // last, the handler may still hold references
+    rcu_tick((frame->cs & 3) == 3);
+    lapic_eoi();
+}
+
+/**
+ * @brief Programs divider and LVT entry of the timer of the current processor, leaving it stopped.
+ */
+INT_FAST_HANDLER static void lapic_timer_setup() {
+    lapic_write(LAPIC_REG_TIMER_DIVIDE, LAPIC_TIMER_DIVIDE_16);
+    lapic_write(LAPIC_REG_LVT_TIMER, lapic_timer_mode | LAPIC_VECTOR_TIMER);
+    lapic_write(LAPIC_REG_TIMER_INITIAL, 0);
+    if(lapic_timer_mode == LAPIC_TIMER_TSC_DEADLINE) {
+        // orders an MMIO write of the LVT before following writes of the deadline MSR
+        asm volatile ("mfence" ::: "memory");
+        cpu_msr_write(LAPIC_MSR_TSC_DEADLINE, 0);
+    }
+}
+
+/**
+ * @brief Enables the local APIC of the current processor.
+ *
+ * @return zero on success, -1 if the processor has no local APIC.
+ */
+int lapic_init() {
+    cpu_id_t id;
+    cpuid(1, &id);
+    if(!(id.edx & CPUID_1_EDX_APIC) || !(id.edx & CPUID_1_EDX_MSR)) {
+        return -1;
+    }
+
+    uint64_t apic_base = cpu_msr_read(LAPIC_MSR_APIC_BASE);
+    if(!(apic_base & LAPIC_APIC_BASE_ENABLE)) {
+        apic_base |= LAPIC_APIC_BASE_ENABLE;
+        cpu_msr_write(LAPIC_MSR_APIC_BASE, apic_base);
+    }
+    lapic_base = (volatile uint32_t*) (VMM_PHYS4G_BASE + (apic_base & LAPIC_APIC_BASE_ADDR));
+#ifdef HE_X2APIC
+    // switching from xAPIC to x2APIC mode is possible without disabling the APIC first
+    if(id.ecx & CPUID_1_ECX_X2APIC) {
+        cpu_msr_write(LAPIC_MSR_APIC_BASE, apic_base | LAPIC_APIC_BASE_X2APIC);
+        lapic_x2apic = 1;
+    }
+#endif
+
+    // accept all interrupts
+    lapic_write(LAPIC_REG_TPR, 0);
+    lapic_write(LAPIC_REG_LVT_ERROR, LAPIC_LVT_MASKED);
+    lapic_write(LAPIC_REG_SVR, LAPIC_SVR_ENABLE | LAPIC_VECTOR_SPURIOUS);
+    lapic_timer_setup();
+
+    // spurious interrupts need no end of interrupt, the dispatcher only counts them
+    int_register(LAPIC_VECTOR_TIMER, lapic_timer_interrupt);
+    int_register(LAPIC_VECTOR_PING, lapic_ping_interrupt);
+
+    // application processors start in parallel, only the bootstrap processor reports
+    if(apic_base & LAPIC_APIC_BASE_BSP) {
+        LOG_DEBUG(LOG_CAT_INT, "lapic: id %u version %x, %s mode\n",
+                lapic_id(), lapic_read(LAPIC_REG_VERSION) & 0xFF, lapic_x2apic ? "x2APIC" : "xAPIC");
+    }
+    return 0;
+}
+
+/**
+ * @brief Returns the ID of the local APIC of the current processor.
+ */
+uint32_t lapic_id() {
+    // the x2APIC ID uses all 32 bits
+    return lapic_x2apic ? lapic_read(LAPIC_REG_ID) : lapic_read(LAPIC_REG_ID) >> 24;
+}
+
+/**
+ * @brief Returns non-zero, if the local APIC runs in x2APIC mode.
+ */
+int lapic_x2apic_enabled() {
+    return lapic_x2apic;
+}
+
+/**
+ * @brief Writes the interrupt command register, sending an IPI to a single processor.
+ */
+INT_FAST_HANDLER static void lapic_send_icr(uint32_t apic_id, uint32_t command) {
+    if(lapic_x2apic) {
+        // the destination is part of the 64 bit ICR, one write sends the IPI
+        cpu_msr_write(LAPIC_X2APIC_MSR(LAPIC_REG_ICR_LOW), ((uint64_t)apic_id << 32) | command);
+        return;
+    }
+    // an interrupt handler sending an IPI must not run between the two writes
+    int enabled = INT_ENABLED();
+    INT_DISABLE();
+    lapic_write(LAPIC_REG_ICR_HIGH, apic_id << 24);
+    lapic_write(LAPIC_REG_ICR_LOW, command);
+    while(lapic_read(LAPIC_REG_ICR_LOW) & LAPIC_ICR_PENDING) {
+        asm volatile ("pause");
+    }
+    if(enabled) {
+        INT_ENABLE();
+    }
+}
+
+/**
+ * @brief Sends a fixed interrupt to a single processor.
+ *
+ * @param apic_id the local APIC ID of the target processor
+ * @param vector the interrupt vector
+ */
+INT_FAST_HANDLER void lapic_send_ipi(uint32_t apic_id, uint8_t vector) {
+    lapic_send_icr(apic_id, LAPIC_ICR_ASSERT | vector);
+}
+
+/**
+ * @brief Sends an INIT IPI, which resets a processor into the wait-for-SIPI state.
+ */
+void lapic_send_init(uint32_t apic_id) {
+    // current processors need no de-assert, which x2APIC mode does not support anyway
+    lapic_send_icr(apic_id, LAPIC_ICR_ASSERT | LAPIC_ICR_INIT);
+}
+
+/**
+ * @brief Sends a start-up IPI to a processor waiting for one.
+ *
+ * @param apic_id the local APIC ID of the target processor
+ * @param page the processor starts in real mode at physical address \c page * 4096
+ */
+void lapic_send_startup(uint32_t apic_id, uint8_t page) {
+    lapic_send_icr(apic_id, LAPIC_ICR_ASSERT | LAPIC_ICR_STARTUP | page);
+}
+
+/**
+ * @brief Signals the end of interrupt to the local APIC.
+ */
+INT_FAST_HANDLER void lapic_eoi() {
+    lapic_write(LAPIC_REG_EOI, 0);
+}
+
+/**
+ * @brief Sorts a small array in place.
+ */
+static void lapic_sort(uint64_t* values, int count) {
+    for(int i = 1; i < count; i++) {
+        uint64_t value = values[i];
+        int j = i;
+        for(; j > 0 && values[j - 1] > value; j--) {
+            values[j] = values[j - 1];
+        }
+        values[j] = value;
+    }
+}
+
+/**
+ * @brief Calibrates the APIC timer against the TSC and selects the timer mode.
+ *
+ * Must be called once on the bootstrap processor after #lapic_init and #clock_init,
+ * with interrupts disabled.
+ */
+void lapic_timer_init() {
+    uint64_t timer_khz[LAPIC_CALIBRATE_ROUNDS];
+    uint64_t tsc_khz = clock_tsc_khz();
+    uint64_t window = clock_ns_to_tsc(LAPIC_CALIBRATE_US * CLOCK_NS_PER_US);
+
+    // the timer counts down without raising interrupts during calibration
+    lapic_write(LAPIC_REG_TIMER_DIVIDE, LAPIC_TIMER_DIVIDE_16);
+    lapic_write(LAPIC_REG_LVT_TIMER, LAPIC_LVT_MASKED | LAPIC_TIMER_ONESHOT | LAPIC_VECTOR_TIMER);
+
+    for(int round = 0; round < LAPIC_CALIBRATE_ROUNDS; round++) {
+        lapic_write(LAPIC_REG_TIMER_INITIAL, LAPIC_TIMER_MAX_COUNT);
+        uint64_t tsc_start = cpu_rdtsc();
+        uint32_t timer_start = lapic_read(LAPIC_REG_TIMER_CURRENT);
+        uint64_t tsc_end;
+        while((tsc_end = cpu_rdtsc()) - tsc_start < window) {
+            asm volatile ("pause");
+        }
+        uint32_t timer_end = lapic_read(LAPIC_REG_TIMER_CURRENT);
+
+        timer_khz[round] = (uint64_t)(timer_start - timer_end) * tsc_khz / (tsc_end - tsc_start);
+    }
+    lapic_sort(timer_khz, LAPIC_CALIBRATE_ROUNDS);
+    lapic_timer_freq_khz = timer_khz[LAPIC_CALIBRATE_ROUNDS / 2];
+    lapic_tsc_to_timer = (lapic_timer_freq_khz << 32) / tsc_khz;
+
+    cpu_id_t id;
+    cpuid(1, &id);
+    lapic_timer_mode = (id.ecx & CPUID_1_ECX_TSC_DEADLINE) ? LAPIC_TIMER_TSC_DEADLINE : LAPIC_TIMER_ONESHOT;
+    lapic_timer_setup();
+
+    // the spread between the rounds bounds the calibration error
+    LOG_INFO(LOG_CAT_TIME, "lapic: timer %lu kHz (spread %lu ppm), %s mode\n",
+            lapic_timer_freq_khz,
+            (timer_khz[LAPIC_CALIBRATE_ROUNDS - 1] - timer_khz[0]) * 1000000 / lapic_timer_freq_khz,
+            lapic_timer_mode == LAPIC_TIMER_TSC_DEADLINE ? "TSC-deadline" : "one-shot");
+}
+
+/**
+ * @brief Sets the function called on timer interrupts.
+ */
+void lapic_timer_set_handler(lapic_timer_handler_t handler) {
+    lapic_timer_handler = handler;
+}
+
+/**
+ * @brief Converts a number of TSC cycles to an initial count of the APIC timer.
+ */
+INT_FAST_HANDLER static uint32_t lapic_timer_ticks(uint64_t cycles) {
+    uint64_t ticks = ((unsigned __int128)cycles * lapic_tsc_to_timer) >> 32;
+    if(ticks == 0) {
+        return 1;
+    }
+    return ticks > LAPIC_TIMER_MAX_COUNT ? LAPIC_TIMER_MAX_COUNT : ticks;
+}
+
+/**
+ * @brief Arms the timer of the current processor to fire once at an absolute TSC value.
+ *
+ * A deadline in the past fires immediately.
+ */
+INT_FAST_HANDLER void lapic_timer_oneshot(uint64_t deadline) {
+#ifdef HE_INT_STATS
+    intstat_timer_armed(deadline);
+#endif
+    if(lapic_timer_mode == LAPIC_TIMER_TSC_DEADLINE) {
+        // zero would disarm the timer
+        cpu_msr_write(LAPIC_MSR_TSC_DEADLINE, deadline ? deadline : 1);
+    } else {
+        // deadlines beyond the range of the timer fire early and must be re-armed by the handler
+        uint64_t now = cpu_rdtsc();
+        lapic_write(LAPIC_REG_TIMER_INITIAL, lapic_timer_ticks(deadline > now ? deadline - now : 0));
+    }
+}
+
+/**
+ * @brief Lets the timer of the current processor fire periodically.
+ *
+ * @param period the period in TSC cycles
+ */
+void lapic_timer_periodic(uint64_t period) {
+    lapic_write(LAPIC_REG_LVT_TIMER, LAPIC_TIMER_PERIODIC | LAPIC_VECTOR_TIMER);
+    lapic_write(LAPIC_REG_TIMER_INITIAL, lapic_timer_ticks(period));
+}
+
+/**
+ * @brief Stops the timer of the current processor.
+ */
+INT_FAST_HANDLER void lapic_timer_stop() {
+    lapic_timer_setup();
+}
+
+/**
+ * @brief Returns non-zero, if the timer uses the TSC-deadline mode.
+ */
+int lapic_timer_has_deadline() {
+    return lapic_timer_mode == LAPIC_TIMER_TSC_DEADLINE;
+}
+
+/**
+ * @brief Records the time the benchmark interrupt reached its handler.
+ */
+INT_FAST_HANDLER static void lapic_benchmark_handler(int_frame_t* frame) {
+    (void)frame;
+    lapic_benchmark_tsc = cpu_rdtsc();
+}
+
+/**
+ * @brief Measures the round trip time of timer interrupts and logs the result.
+ *
+ * Each round arms an expired deadline and waits for the handler, which measures delivery and entry.
+ * The time until the interrupted loop resumes additionally includes the end of interrupt and the exit path.
+ *
+ * Interrupts must be enabled.
+ */
+void lapic_timer_benchmark() {
+    lapic_timer_handler_t saved = lapic_timer_handler;
+    lapic_timer_handler = lapic_benchmark_handler;
+
+    uint64_t entry_sum = 0, total_sum = 0, total_min = UINT64_MAX;
+    for(int round = 0; round < LAPIC_BENCHMARK_ROUNDS; round++) {
+        lapic_benchmark_tsc = 0;
+        uint64_t start = cpu_rdtsc();
+        lapic_timer_oneshot(start);
+        while(!lapic_benchmark_tsc) {
+            asm volatile ("pause");
+        }
+        uint64_t end = cpu_rdtsc();
+        entry_sum += lapic_benchmark_tsc - start;
+        total_sum += end - start;
+        if(end - start < total_min) {
+            total_min = end - start;
+        }
+    }
+    lapic_timer_handler = saved;
+
+    LOG_INFO(LOG_CAT_TIME, "lapic: timer interrupt round trip %lu cycles (min %lu), %lu cycles until handler\n",
+            total_sum / LAPIC_BENCHMARK_ROUNDS, total_min, entry_sum / LAPIC_BENCHMARK_ROUNDS);
+}
+
+/**
+ * @brief Measures the round trip time of IPIs and logs the result.
+ *
+ * A round ends when the sender observes the write of the handler on the target processor.
+ * Interrupts must be enabled on both processors.
+ *
+ * @param apic_id the local APIC ID of the target processor, which may be the current processor
  */
+void lapic_ipi_benchmark(uint32_t apic_id) {
+    uint64_t sum = 0, min = UINT64_MAX;
+    for(int round = 0; round < LAPIC_BENCHMARK_ROUNDS; round++) {
+        uint64_t seq = lapic_ping_sent + 1;
+        lapic_ping_sent = seq;
+        uint64_t start = cpu_rdtsc();
+        lapic_send_ipi(apic_id, LAPIC_VECTOR_PING);
+        while(lapic_ping_received != seq) {
+            asm volatile ("pause");
+        }
+        uint64_t cycles = cpu_rdtsc() - start;
+        sum += cycles;
+        if(cycles < min) {
+            min = cycles;
+        }
+    }
+    LOG_INFO(LOG_CAT_INT, "lapic: IPI round trip to %s %u %lu cycles (min %lu), %s mode\n",
+            apic_id == lapic_id() ? "itself, APIC ID" : "APIC ID", apic_id,
+            sum / LAPIC_BENCHMARK_ROUNDS, min, lapic_x2apic ? "x2APIC" : "xAPIC");
+}
@@ -5,3 +5,121 @@
  *
  * @brief Interface to legacy PIC.
  */
+
+#include "kernel/interrupts/pic.h"
+#include "kernel/cpu.h"
+
+/// ICW1: initialization, ICW4 follows
+#define PIC_ICW1_INIT 0x11
+/// ICW3 of the master: slave attached to IRQ 2
+#define PIC_ICW3_MASTER 0x04
+/// ICW3 of the slave: cascade identity
+#define PIC_ICW3_SLAVE 0x02
+/// ICW4: 8086 mode
+#define PIC_ICW4_8086 0x01
+/// IRQ of the master the slave is cascaded to
+#define PIC_CASCADE_IRQ 2
+
+/// spurious interrupts are reported on the lowest priority line of each PIC
+#define PIC_SPURIOUS_MASTER 7
+#define PIC_SPURIOUS_SLAVE 15
+
+/// in-service register read command
+#define PIC_CMD_READ_ISR 0x0B
+
+/// current IRQ mask, bit \c n masks IRQ \c n
+static uint16_t pic_irq_mask = 0xFFFF;
+
+/**
+ * @brief Writes the IRQ mask to both PICs.
+ */
+static void pic_write_mask() {
+    cpu_outb(PIC_MASTER_DATA, pic_irq_mask & 0xFF);
+    cpu_outb(PIC_SLAVE_DATA, pic_irq_mask >> 8);
+}
+
+/**
+ * @brief Reads the in-service register of a PIC.
+ */
+static uint8_t pic_read_isr(uint16_t command) {
+    cpu_outb(command, PIC_CMD_READ_ISR);
+    return cpu_inb(command);
+}
+
+/**
+ * @brief Ignores spurious interrupts of the PIC.
+ *
+ * A spurious IRQ is not in service, so the PIC that raised it must not get an EOI.
+ * For a spurious IRQ of the slave, the master still expects one for the cascade.
+ */
+static void pic_spurious_handler(int_frame_t* frame) {
+    if(frame->vector == PIC_VECTOR_BASE + PIC_SPURIOUS_MASTER) {
+        if(pic_read_isr(PIC_MASTER_COMMAND) & (1 << PIC_SPURIOUS_MASTER)) {
+            pic_eoi(PIC_SPURIOUS_MASTER);
+        }
+    } else {
+        if(pic_read_isr(PIC_SLAVE_COMMAND) & (1 << (PIC_SPURIOUS_SLAVE - 8))) {
+            pic_eoi(PIC_SPURIOUS_SLAVE);
+        } else {
+            cpu_outb(PIC_MASTER_COMMAND, PIC_CMD_EOI);
+        }
+    }
+}
+
+/**
+ * @brief Remaps the PIC IRQs to #PIC_VECTOR_BASE, so they do not overlap with exceptions, and masks all of them.
+ */
+void pic_init() {
+    cpu_outb(PIC_MASTER_COMMAND, PIC_ICW1_INIT);
+    cpu_outb(PIC_SLAVE_COMMAND, PIC_ICW1_INIT);
+    cpu_outb(PIC_MASTER_DATA, PIC_VECTOR_BASE);
+    cpu_outb(PIC_SLAVE_DATA, PIC_VECTOR_BASE + 8);
+    cpu_outb(PIC_MASTER_DATA, PIC_ICW3_MASTER);
+    cpu_outb(PIC_SLAVE_DATA, PIC_ICW3_SLAVE);
+    cpu_outb(PIC_MASTER_DATA, PIC_ICW4_8086);
+    cpu_outb(PIC_SLAVE_DATA, PIC_ICW4_8086);
+
+    // only the cascade is enabled
+    pic_irq_mask = 0xFFFF & ~(1 << PIC_CASCADE_IRQ);
+    pic_write_mask();
+
+    int_register(PIC_VECTOR_BASE + PIC_SPURIOUS_MASTER, pic_spurious_handler);
+    int_register(PIC_VECTOR_BASE + PIC_SPURIOUS_SLAVE, pic_spurious_handler);
+}
+
+/**
+ * @brief Masks all IRQ lines including the cascade, used once the I/O APICs take over.
+ *
+ * The spurious interrupt handlers stay installed, because the PIC may still raise
+ * spurious interrupts while all lines are masked.
+ */
+void pic_disable() {
+    pic_irq_mask = 0xFFFF;
+    pic_write_mask();
+}
+
+/**
+ * @brief Masks an IRQ line.
+ */
+void pic_mask(uint8_t irq) {
+    pic_irq_mask |= 1 << irq;
+    pic_write_mask();
+}
+
+/**
+ * @brief Unmasks an IRQ line.
+ */
+void pic_unmask(uint8_t irq) {
+    pic_irq_mask &= ~(1 << irq);
+    pic_write_mask();
+}
+
+/**
+ * @brief Signals the end of interrupt for an IRQ line.
+ */
+void pic_eoi(uint8_t irq) {
+    if(irq >= 8) {
+        cpu_outb(PIC_SLAVE_COMMAND, PIC_CMD_EOI);
+    }
+    cpu_outb(PIC_MASTER_COMMAND, PIC_CMD_EOI);
+}
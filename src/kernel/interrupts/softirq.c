@@ -0,0 +1,173 @@
+/**
+ * @file softirq.c
+ *
+ * @author Fabian Thorand
+ * @date   19.10.2026
+ *
+ * @brief Deferred interrupt work with per-CPU queues.
+ *
+ * Producers push items onto \c incoming of the current processor with a compare-and-swap.
+ * The owner takes the whole stack with one exchange, reverses it and appends it to its
+ * private \c backlog, which is only accessed by the processor running the work.
+ */
+
+#include "kernel/interrupts/softirq.h"
+#include "kernel/interrupts/int.h"
+
+#include "kernel/percpu.h"
+#include "kernel/sched/preempt.h"
+#include "kernel/helium.h"
+
+/**
+ * @brief The deferred work queue of a processor.
+ */
+typedef struct {
+    softirq_work_t* volatile incoming;  ///< items raised by interrupt handlers, newest first
+    softirq_work_t* backlog;            ///< items taken from \c incoming, oldest first
+    softirq_work_t* backlog_tail;       ///< last item of \c backlog
+    volatile int running;               ///< non-zero while the processor runs deferred work
+    uint64_t processed;                 ///< number of items run
+    uint64_t exhausted;                 ///< number of passes that ended because of the budget
+} __attribute__((aligned(64))) softirq_queue_t;
+
+/// the queue of each processor
+static PERCPU_DEFINE(softirq_queue_t, softirq_queue);
+
+/// bit \c n is set when processor \c n may have pending work
+static volatile uint64_t softirq_pending_mask = 0;
+
+/**
+ * @brief Initializes a work item.
+ */
+void softirq_init_work(softirq_work_t* work, softirq_func_t func) {
+    work->next = NULL;
+    work->func = func;
+    work->pending = 0;
+}
+
+/**
+ * @brief Queues a work item on the current processor, if it is not already pending.
+ *
+ * Safe to call from interrupt handlers, including those of fast vectors.
+ *
+ * @return non-zero, if the item was queued.
+ */
+INT_FAST_HANDLER int softirq_raise(softirq_work_t* work) {
+    if(!__sync_bool_compare_and_swap(&work->pending, 0, 1)) {
+        return 0;
+    }
+    unsigned int cpu = PERCPU_READ(percpu_index);
+    softirq_queue_t* queue = PERCPU_PTR(softirq_queue);
+    softirq_work_t* head;
+    do {
+        head = queue->incoming;
+        work->next = head;
+    } while(!__sync_bool_compare_and_swap(&queue->incoming, head, work));
+    __sync_fetch_and_or(&softirq_pending_mask, 1ull << cpu);
+    return 1;
+}
+
+/**
+ * @brief Checks whether any processor may have pending work.
+ *
+ * This is a cheap check for the interrupt return path.
+ */
+INT_FAST_HANDLER int softirq_maybe_pending() {
+    return softirq_pending_mask != 0;
+}
+
+/**
+ * @brief Checks whether the current processor has pending work.
+ *
+ * Called with interrupts disabled, see #sched_idle.
+ */
+int softirq_pending() {
+    return (softirq_pending_mask & (1ull << percpu_cpu())) != 0;
+}
+
+/**
+ * @brief Moves the raised items to the backlog in the order they were raised.
+ */
+static void softirq_collect(softirq_queue_t* queue) {
+    softirq_work_t* list = __sync_lock_test_and_set(&queue->incoming, NULL);
+    if(!list) {
+        return;
+    }
+    softirq_work_t* first = NULL;
+    softirq_work_t* last = list;
+    while(list) {
+        softirq_work_t* next = list->next;
+        list->next = first;
+        first = list;
+        list = next;
+    }
+    if(queue->backlog) {
+        queue->backlog_tail->next = first;
+    } else {
+        queue->backlog = first;
+    }
+    queue->backlog_tail = last;
+}
+
+/**
+ * @brief Runs up to #SOFTIRQ_BUDGET items. Called with interrupts enabled by the owner of \c queue->running.
+ */
+static void softirq_pass(unsigned int cpu, softirq_queue_t* queue) {
+    // clear the pending bit first, a concurrent raise sets it again
+    __sync_fetch_and_and(&softirq_pending_mask, ~(1ull << cpu));
+    softirq_collect(queue);
+
+    int budget = SOFTIRQ_BUDGET;
+    while(queue->backlog && budget > 0) {
+        softirq_work_t* work = queue->backlog;
+        queue->backlog = work->next;
+        // the item may be raised again while it runs
+        __sync_lock_release(&work->pending);
+        work->func(work);
+        queue->processed++;
+        budget--;
+        if(!queue->backlog) {
+            softirq_collect(queue);
+        }
+    }
+    if(queue->backlog) {
+        queue->exhausted++;
+        __sync_fetch_and_or(&softirq_pending_mask, 1ull << cpu);
+    }
+}
+
+/**
+ * @brief Runs one pass of pending work on the current processor with interrupts enabled.
+ *
+ * Does nothing, if the processor is already running deferred work.
+ * Must not be called from interrupt handlers.
+ */
+void softirq_run() {
+    int enabled = int_enabled();
+    INT_DISABLE();
+    softirq_run_irq();
+    if(enabled) {
+        INT_ENABLE();
+    }
+}
+
+/**
+ * @brief Runs one pass of pending work when an interrupt returns.
+ *
+ * Called by #int_return with interrupts disabled and the SSE state saved.
+ */
+void softirq_run_irq() {
+    unsigned int cpu = percpu_cpu();
+    softirq_queue_t* queue = PERCPU_PTR(softirq_queue);
+    if(queue->running || !(softirq_pending_mask & (1ull << cpu))) {
+        return;
+    }
+    queue->running = 1;
+    // the work must finish on this processor before the interrupted thread continues
+    PREEMPT_DISABLE();
+    INT_ENABLE();
+    softirq_pass(cpu, queue);
+    INT_DISABLE();
+    PREEMPT_ENABLE();
+    queue->running = 0;
+}
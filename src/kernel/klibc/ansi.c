@@ -0,0 +1,80 @@
+/**
+ * @file ansi.c
+ *
+ * @author Fabian Thorand
+ * @date   19.10.2026
+ *
+ * @brief Parser for the ANSI color escape sequences understood by the console backends.
+ */
+
+#include "kernel/klibc/ansi.h"
+#include "kernel/klibc/kstdio_screen.h"
+
+/// VGA colors for the ANSI colors 0 to 7
+static const uint8_t ansi_colors[8] = {
+    BLACK, RED, GREEN, YELLOW, BLUE, MAGENTA, CYAN, WHITE
+};
+
+/**
+ * @brief Applies a select graphic rendition parameter to \c color.
+ */
+static void ansi_apply(uint16_t code, uint8_t* color) {
+    if(code == 0) {
+        *color = ANSI_DEFAULT_COLOR;
+    } else if(code >= 30 && code <= 37) {
+        *color = VGASETFG(*color, ansi_colors[code - 30]);
+    } else if(code == 39) {
+        *color = VGASETFG(*color, WHITE);
+    } else if(code >= 40 && code <= 47) {
+        *color = VGASETBG(*color, ansi_colors[code - 40]);
+    } else if(code == 49) {
+        *color = VGASETBG(*color, BLACK);
+    }
+}
+
+/**
+ * @brief Feeds a character to the escape sequence parser.
+ *
+ * Select graphic rendition sequences (<tt>ESC [ n ; ... m</tt>) update \c color,
+ * all other sequences are ignored.
+ *
+ * @param parser the parser state, initially zero
+ * @param chr the next character of the output
+ * @param color the current VGA color byte
+ * @return non-zero if \c chr belongs to an escape sequence and must not be printed.
+ */
+int ansi_parse(ansi_parser_t* parser, int chr, uint8_t* color) {
+    if(chr == '\x1b') {
+        parser->state = 1;
+        parser->code = 0;
+        return 1;
+    }
+    switch(parser->state) {
+    case 1:
+        if(chr == '[') {
+            parser->state = 2;
+            return 1;
+        }
+        // not a control sequence
+        parser->state = 0;
+        return 0;
+    case 2:
+        if(chr >= '0' && chr <= '9') {
+            parser->code = parser->code * 10 + (chr - '0');
+            return 1;
+        }
+        if(chr == ';' || chr == 'm') {
+            ansi_apply(parser->code, color);
+            parser->code = 0;
+            if(chr == 'm') {
+                parser->state = 0;
+            }
+            return 1;
+        }
+        // unsupported sequence, print the rest
+        parser->state = 0;
+        return 0;
+    default:
+        return 0;
+    }
+}
@@ -0,0 +1,114 @@
+/**
+ * @file fbcon_font.c
+ *
+ * @author Fabian Thorand
+ * @date   19.10.2026
+ *
+ * @brief 8x16 bitmap font for the framebuffer console.
+ *
+ * The glyphs were rasterized without anti-aliasing from DejaVu Sans Mono
+ * (Bitstream Vera license). Only printable ASCII characters are defined,
+ * the others are blank. Bit 7 of a byte is the leftmost pixel of a row.
+ */
+
+#include "kernel/klibc/kstdio_fbcon.h"
+
+#include <stdint.h>
+
+const uint8_t fbcon_font[FBCON_FONT_GLYPHS][FBCON_FONT_HEIGHT] = {
+    [0x20] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // space
+    [0x21] = { 0x00, 0x00, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x00, 0x00, 0x08, 0x08, 0x00, 0x00, 0x00, 0x00 }, // !
+    [0x22] = { 0x00, 0x00, 0x14, 0x14, 0x14, 0x14, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // "
+    [0x23] = { 0x00, 0x00, 0x12, 0x12, 0x16, 0x7f, 0x24, 0x24, 0xfe, 0x28, 0x48, 0x48, 0x00, 0x00, 0x00, 0x00 }, // #
+    [0x24] = { 0x00, 0x08, 0x08, 0x3e, 0x49, 0x48, 0x68, 0x3e, 0x0b, 0x09, 0x49, 0x3e, 0x08, 0x08, 0x00, 0x00 }, // $
+    [0x25] = { 0x00, 0x00, 0x60, 0x90, 0x90, 0x62, 0x0c, 0x30, 0x46, 0x09, 0x09, 0x06, 0x00, 0x00, 0x00, 0x00 }, // %
+    [0x26] = { 0x00, 0x00, 0x1c, 0x20, 0x20, 0x30, 0x30, 0x49, 0x45, 0x45, 0x62, 0x3d, 0x00, 0x00, 0x00, 0x00 }, // &
+    [0x27] = { 0x00, 0x00, 0x08, 0x08, 0x08, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '
+    [0x28] = { 0x00, 0x0c, 0x08, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x08, 0x08, 0x04, 0x00, 0x00, 0x00 }, // (
+    [0x29] = { 0x00, 0x30, 0x10, 0x10, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x10, 0x10, 0x20, 0x00, 0x00, 0x00 }, // )
+    [0x2a] = { 0x00, 0x00, 0x08, 0x49, 0x3e, 0x1c, 0x6b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // *
+    [0x2b] = { 0x00, 0x00, 0x00, 0x00, 0x08, 0x08, 0x08, 0x7f, 0x08, 0x08, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00 }, // +
+    [0x2c] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x18, 0x10, 0x20, 0x00, 0x00 }, // ,
+    [0x2d] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // -
+    [0x2e] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x18, 0x00, 0x00, 0x00, 0x00 }, // .
+    [0x2f] = { 0x00, 0x00, 0x02, 0x04, 0x04, 0x04, 0x08, 0x08, 0x10, 0x10, 0x20, 0x20, 0x20, 0x40, 0x00, 0x00 }, // /
+    [0x30] = { 0x00, 0x00, 0x1c, 0x22, 0x41, 0x41, 0x49, 0x41, 0x41, 0x41, 0x22, 0x1c, 0x00, 0x00, 0x00, 0x00 }, // 0
+    [0x31] = { 0x00, 0x00, 0x18, 0x28, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x3e, 0x00, 0x00, 0x00, 0x00 }, // 1
+    [0x32] = { 0x00, 0x00, 0x3e, 0x43, 0x01, 0x01, 0x02, 0x06, 0x0c, 0x10, 0x20, 0x7f, 0x00, 0x00, 0x00, 0x00 }, // 2
+    [0x33] = { 0x00, 0x00, 0x3e, 0x41, 0x01, 0x03, 0x1c, 0x03, 0x01, 0x01, 0x43, 0x3e, 0x00, 0x00, 0x00, 0x00 }, // 3
+    [0x34] = { 0x00, 0x00, 0x06, 0x0a, 0x1a, 0x12, 0x22, 0x42, 0x7f, 0x02, 0x02, 0x02, 0x00, 0x00, 0x00, 0x00 }, // 4
+    [0x35] = { 0x00, 0x00, 0x7e, 0x40, 0x40, 0x7c, 0x42, 0x01, 0x01, 0x01, 0x42, 0x3c, 0x00, 0x00, 0x00, 0x00 }, // 5
+    [0x36] = { 0x00, 0x00, 0x1e, 0x31, 0x60, 0x40, 0x5e, 0x63, 0x41, 0x41, 0x23, 0x1e, 0x00, 0x00, 0x00, 0x00 }, // 6
+    [0x37] = { 0x00, 0x00, 0x7f, 0x03, 0x02, 0x04, 0x04, 0x08, 0x08, 0x10, 0x10, 0x20, 0x00, 0x00, 0x00, 0x00 }, // 7
+    [0x38] = { 0x00, 0x00, 0x3e, 0x41, 0x41, 0x41, 0x3e, 0x63, 0x41, 0x41, 0x63, 0x3e, 0x00, 0x00, 0x00, 0x00 }, // 8
+    [0x39] = { 0x00, 0x00, 0x3c, 0x62, 0x41, 0x41, 0x63, 0x3d, 0x01, 0x03, 0x46, 0x3c, 0x00, 0x00, 0x00, 0x00 }, // 9
+    [0x3a] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x18, 0x00, 0x00, 0x00, 0x18, 0x18, 0x00, 0x00, 0x00, 0x00 }, // :
+    [0x3b] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x18, 0x00, 0x00, 0x00, 0x18, 0x18, 0x10, 0x20, 0x00, 0x00 }, // ;
+    [0x3c] = { 0x00, 0x00, 0x00, 0x00, 0x01, 0x0e, 0x38, 0x40, 0x38, 0x0e, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00 }, // <
+    [0x3d] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x7f, 0x00, 0x00, 0x7f, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // =
+    [0x3e] = { 0x00, 0x00, 0x00, 0x00, 0x40, 0x38, 0x0e, 0x01, 0x0e, 0x38, 0x40, 0x00, 0x00, 0x00, 0x00, 0x00 }, // >
+    [0x3f] = { 0x00, 0x00, 0x38, 0x44, 0x04, 0x0c, 0x18, 0x10, 0x10, 0x00, 0x10, 0x10, 0x00, 0x00, 0x00, 0x00 }, // ?
+    [0x40] = { 0x00, 0x00, 0x1e, 0x33, 0x21, 0x47, 0x49, 0x49, 0x49, 0x49, 0x47, 0x20, 0x30, 0x0e, 0x00, 0x00 }, // @
+    [0x41] = { 0x00, 0x00, 0x08, 0x14, 0x14, 0x14, 0x14, 0x22, 0x3e, 0x22, 0x41, 0x41, 0x00, 0x00, 0x00, 0x00 }, // A
+    [0x42] = { 0x00, 0x00, 0x7e, 0x41, 0x41, 0x41, 0x7e, 0x43, 0x41, 0x41, 0x43, 0x7e, 0x00, 0x00, 0x00, 0x00 }, // B
+    [0x43] = { 0x00, 0x00, 0x1e, 0x21, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x21, 0x1e, 0x00, 0x00, 0x00, 0x00 }, // C
+    [0x44] = { 0x00, 0x00, 0x7c, 0x42, 0x41, 0x41, 0x41, 0x41, 0x41, 0x41, 0x42, 0x7c, 0x00, 0x00, 0x00, 0x00 }, // D
+    [0x45] = { 0x00, 0x00, 0x7f, 0x40, 0x40, 0x40, 0x7f, 0x40, 0x40, 0x40, 0x40, 0x7f, 0x00, 0x00, 0x00, 0x00 }, // E
+    [0x46] = { 0x00, 0x00, 0x7f, 0x40, 0x40, 0x40, 0x7f, 0x40, 0x40, 0x40, 0x40, 0x40, 0x00, 0x00, 0x00, 0x00 }, // F
+    [0x47] = { 0x00, 0x00, 0x1e, 0x21, 0x40, 0x40, 0x40, 0x43, 0x41, 0x41, 0x21, 0x1e, 0x00, 0x00, 0x00, 0x00 }, // G
+    [0x48] = { 0x00, 0x00, 0x41, 0x41, 0x41, 0x41, 0x7f, 0x41, 0x41, 0x41, 0x41, 0x41, 0x00, 0x00, 0x00, 0x00 }, // H
+    [0x49] = { 0x00, 0x00, 0x3e, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x3e, 0x00, 0x00, 0x00, 0x00 }, // I
+    [0x4a] = { 0x00, 0x00, 0x1e, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x46, 0x3c, 0x00, 0x00, 0x00, 0x00 }, // J
+    [0x4b] = { 0x00, 0x00, 0x42, 0x44, 0x48, 0x50, 0x70, 0x48, 0x4c, 0x44, 0x42, 0x41, 0x00, 0x00, 0x00, 0x00 }, // K
+    [0x4c] = { 0x00, 0x00, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x7f, 0x00, 0x00, 0x00, 0x00 }, // L
+    [0x4d] = { 0x00, 0x00, 0x63, 0x63, 0x55, 0x55, 0x55, 0x49, 0x41, 0x41, 0x41, 0x41, 0x00, 0x00, 0x00, 0x00 }, // M
+    [0x4e] = { 0x00, 0x00, 0x61, 0x61, 0x51, 0x51, 0x49, 0x49, 0x45, 0x45, 0x43, 0x43, 0x00, 0x00, 0x00, 0x00 }, // N
+    [0x4f] = { 0x00, 0x00, 0x1c, 0x22, 0x41, 0x41, 0x41, 0x41, 0x41, 0x41, 0x22, 0x1c, 0x00, 0x00, 0x00, 0x00 }, // O
+    [0x50] = { 0x00, 0x00, 0x7e, 0x43, 0x41, 0x41, 0x43, 0x7e, 0x40, 0x40, 0x40, 0x40, 0x00, 0x00, 0x00, 0x00 }, // P
+    [0x51] = { 0x00, 0x00, 0x1c, 0x22, 0x41, 0x41, 0x41, 0x41, 0x41, 0x41, 0x22, 0x1e, 0x06, 0x02, 0x00, 0x00 }, // Q
+    [0x52] = { 0x00, 0x00, 0x7e, 0x43, 0x41, 0x41, 0x43, 0x7c, 0x42, 0x41, 0x41, 0x40, 0x00, 0x00, 0x00, 0x00 }, // R
+    [0x53] = { 0x00, 0x00, 0x1e, 0x61, 0x40, 0x40, 0x30, 0x0e, 0x01, 0x01, 0x43, 0x3e, 0x00, 0x00, 0x00, 0x00 }, // S
+    [0x54] = { 0x00, 0x00, 0x7f, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x00, 0x00, 0x00, 0x00 }, // T
+    [0x55] = { 0x00, 0x00, 0x41, 0x41, 0x41, 0x41, 0x41, 0x41, 0x41, 0x41, 0x63, 0x3e, 0x00, 0x00, 0x00, 0x00 }, // U
+    [0x56] = { 0x00, 0x00, 0x41, 0x41, 0x22, 0x22, 0x22, 0x14, 0x14, 0x14, 0x14, 0x08, 0x00, 0x00, 0x00, 0x00 }, // V
+    [0x57] = { 0x00, 0x00, 0x81, 0x81, 0x81, 0x99, 0x5a, 0x5a, 0x5a, 0x24, 0x24, 0x24, 0x00, 0x00, 0x00, 0x00 }, // W
+    [0x58] = { 0x00, 0x00, 0x41, 0x22, 0x14, 0x14, 0x08, 0x14, 0x14, 0x22, 0x22, 0x41, 0x00, 0x00, 0x00, 0x00 }, // X
+    [0x59] = { 0x00, 0x00, 0x41, 0x22, 0x22, 0x14, 0x1c, 0x08, 0x08, 0x08, 0x08, 0x08, 0x00, 0x00, 0x00, 0x00 }, // Y
+    [0x5a] = { 0x00, 0x00, 0x7f, 0x03, 0x02, 0x04, 0x08, 0x08, 0x10, 0x20, 0x60, 0x7f, 0x00, 0x00, 0x00, 0x00 }, // Z
+    [0x5b] = { 0x00, 0x1c, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1c, 0x00, 0x00, 0x00 }, // [
+    [0x5c] = { 0x00, 0x00, 0x40, 0x20, 0x20, 0x20, 0x10, 0x10, 0x08, 0x08, 0x04, 0x04, 0x04, 0x02, 0x00, 0x00 }, // backslash
+    [0x5d] = { 0x00, 0x38, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x38, 0x00, 0x00, 0x00 }, // ]
+    [0x5e] = { 0x00, 0x00, 0x08, 0x14, 0x22, 0x63, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // ^
+    [0x5f] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0x00 }, // _
+    [0x60] = { 0x30, 0x10, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // `
+    [0x61] = { 0x00, 0x00, 0x00, 0x00, 0x1c, 0x22, 0x02, 0x3e, 0x42, 0x42, 0x46, 0x3a, 0x00, 0x00, 0x00, 0x00 }, // a
+    [0x62] = { 0x00, 0x40, 0x40, 0x40, 0x7c, 0x64, 0x42, 0x42, 0x42, 0x42, 0x64, 0x5c, 0x00, 0x00, 0x00, 0x00 }, // b
+    [0x63] = { 0x00, 0x00, 0x00, 0x00, 0x1c, 0x22, 0x40, 0x40, 0x40, 0x40, 0x22, 0x1c, 0x00, 0x00, 0x00, 0x00 }, // c
+    [0x64] = { 0x00, 0x02, 0x02, 0x02, 0x3e, 0x26, 0x42, 0x42, 0x42, 0x42, 0x26, 0x3a, 0x00, 0x00, 0x00, 0x00 }, // d
+    [0x65] = { 0x00, 0x00, 0x00, 0x00, 0x3c, 0x26, 0x42, 0x7e, 0x40, 0x40, 0x22, 0x1c, 0x00, 0x00, 0x00, 0x00 }, // e
+    [0x66] = { 0x00, 0x0e, 0x10, 0x10, 0x7e, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x00, 0x00, 0x00, 0x00 }, // f
+    [0x67] = { 0x00, 0x00, 0x00, 0x00, 0x3a, 0x26, 0x42, 0x42, 0x42, 0x42, 0x26, 0x3a, 0x02, 0x22, 0x1c, 0x00 }, // g
+    [0x68] = { 0x00, 0x40, 0x40, 0x40, 0x5c, 0x62, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x00, 0x00, 0x00, 0x00 }, // h
+    [0x69] = { 0x00, 0x08, 0x08, 0x00, 0x38, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x7f, 0x00, 0x00, 0x00, 0x00 }, // i
+    [0x6a] = { 0x00, 0x08, 0x08, 0x00, 0x38, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x70, 0x00 }, // j
+    [0x6b] = { 0x00, 0x40, 0x40, 0x40, 0x44, 0x48, 0x50, 0x70, 0x48, 0x48, 0x44, 0x42, 0x00, 0x00, 0x00, 0x00 }, // k
+    [0x6c] = { 0x00, 0xf0, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x0e, 0x00, 0x00, 0x00, 0x00 }, // l
+    [0x6d] = { 0x00, 0x00, 0x00, 0x00, 0x7e, 0x49, 0x49, 0x49, 0x49, 0x49, 0x49, 0x49, 0x00, 0x00, 0x00, 0x00 }, // m
+    [0x6e] = { 0x00, 0x00, 0x00, 0x00, 0x5c, 0x62, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x00, 0x00, 0x00, 0x00 }, // n
+    [0x6f] = { 0x00, 0x00, 0x00, 0x00, 0x3c, 0x66, 0x42, 0x42, 0x42, 0x42, 0x66, 0x3c, 0x00, 0x00, 0x00, 0x00 }, // o
+    [0x70] = { 0x00, 0x00, 0x00, 0x00, 0x5c, 0x64, 0x42, 0x42, 0x42, 0x42, 0x64, 0x7c, 0x40, 0x40, 0x40, 0x00 }, // p
+    [0x71] = { 0x00, 0x00, 0x00, 0x00, 0x3a, 0x26, 0x42, 0x42, 0x42, 0x42, 0x26, 0x3a, 0x02, 0x02, 0x02, 0x00 }, // q
+    [0x72] = { 0x00, 0x00, 0x00, 0x00, 0x3c, 0x32, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x00, 0x00, 0x00, 0x00 }, // r
+    [0x73] = { 0x00, 0x00, 0x00, 0x00, 0x3c, 0x42, 0x40, 0x70, 0x0e, 0x02, 0x42, 0x3c, 0x00, 0x00, 0x00, 0x00 }, // s
+    [0x74] = { 0x00, 0x00, 0x10, 0x10, 0x7e, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x0e, 0x00, 0x00, 0x00, 0x00 }, // t
+    [0x75] = { 0x00, 0x00, 0x00, 0x00, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x46, 0x3a, 0x00, 0x00, 0x00, 0x00 }, // u
+    [0x76] = { 0x00, 0x00, 0x00, 0x00, 0x42, 0x42, 0x24, 0x24, 0x24, 0x18, 0x18, 0x18, 0x00, 0x00, 0x00, 0x00 }, // v
+    [0x77] = { 0x00, 0x00, 0x00, 0x00, 0x81, 0x81, 0x5a, 0x5a, 0x5a, 0x5a, 0x24, 0x24, 0x00, 0x00, 0x00, 0x00 }, // w
+    [0x78] = { 0x00, 0x00, 0x00, 0x00, 0x42, 0x24, 0x18, 0x18, 0x18, 0x24, 0x24, 0x42, 0x00, 0x00, 0x00, 0x00 }, // x
+    [0x79] = { 0x00, 0x00, 0x00, 0x00, 0x42, 0x22, 0x24, 0x24, 0x14, 0x18, 0x08, 0x08, 0x08, 0x10, 0x30, 0x00 }, // y
+    [0x7a] = { 0x00, 0x00, 0x00, 0x00, 0x7e, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x7e, 0x00, 0x00, 0x00, 0x00 }, // z
+    [0x7b] = { 0x00, 0x06, 0x08, 0x08, 0x08, 0x08, 0x08, 0x30, 0x08, 0x08, 0x08, 0x08, 0x08, 0x06, 0x00, 0x00 }, // {
+    [0x7c] = { 0x00, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x00 }, // |
+    [0x7d] = { 0x00, 0x30, 0x08, 0x08, 0x08, 0x08, 0x08, 0x06, 0x08, 0x08, 0x08, 0x08, 0x08, 0x30, 0x00, 0x00 }, // }
+    [0x7e] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x39, 0x46, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // ~
+};
@@ -0,0 +1,280 @@
+/**
+ * @file klog.c
+ *
+ * @author Fabian Thorand
+ * @date   19.10.2026
+ *
+ * @brief Per-CPU kernel log ring buffers.
+ *
+ * Positions in a ring are 64 bit byte counters that never wrap around, the offset
+ * into the ring is the position modulo #KLOG_RING_SIZE. Producers reserve space by
+ * advancing \c head with a compare-and-swap, which makes appending safe even when
+ * an interrupt handler on the same processor logs in between. A record is published by
+ * setting #KLOG_FLAG_COMMITTED. Records have different sizes, so a new header usually
+ * lands on the text of an old record. The consumer therefore zeroes every record it
+ * consumes before advancing \c tail, and a header not yet written never looks committed.
+ */
+
+#include "kernel/klibc/klog.h"
+#include "kernel/klibc/kstdio.h"
+#include "kernel/klibc/string.h"
+
+#include "kernel/sched/sched.h"
+#include "kernel/cpu.h"
+#include "kernel/percpu.h"
+#include "kernel/helium.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+/// mask for calculating offsets into a ring
+#define KLOG_RING_MASK (KLOG_RING_SIZE - 1)
+/// all records are aligned to this size
+#define KLOG_ALIGN sizeof(klog_record_t)
+/// calculates the size of a record with \c length bytes of text
+#define KLOG_RECORD_SIZE(length) ((sizeof(klog_record_t) + (length) + KLOG_ALIGN - 1) & ~(KLOG_ALIGN - 1))
+/// maximum length of the text of one record
+#define KLOG_MAX_LENGTH (KLOG_RING_SIZE / 4)
+
+/**
+ * @brief The log ring of a single processor.
+ */
+typedef struct {
+    volatile uint64_t head;     ///< position where the next record is reserved
+    volatile uint64_t tail;     ///< position of the oldest record not yet consumed
+    volatile uint64_t dropped;  ///< number of records dropped because the ring was full
+    uint64_t reserved;
+    char data[KLOG_RING_SIZE] __attribute__((aligned(16)));
+} klog_ring_t;
+
+/// one log ring per processor
+static klog_ring_t klog_rings[HE_MAX_CPUS];
+
+/// set while a processor is draining the rings
+static volatile int klog_draining = 0;
+
+/// non-zero, when draining is left to a dedicated consumer
+static int klog_async = 0;
+
+/// thread draining the rings in asynchronous mode, \c NULL before #klog_start
+static thread_t* volatile klog_thread = NULL;
+
+/// set when #klog_thread was woken and has not started draining yet
+static volatile int klog_wake = 0;
+
+/// returns the record header at the given position in the ring
+#define KLOG_RECORD_AT(ring,pos) ((volatile klog_record_t*)((ring)->data + ((pos) & KLOG_RING_MASK)))
+
+/**
+ * @brief Appends a record to the log ring of the current processor.
+ *
+ * @param msg the text of the record, it does not need to be null terminated
+ * @param length the number of bytes in \c msg
+ * @return zero on success, -1 if the record was dropped because the ring is full.
+ */
+int klog_append(const char* msg, size_t length) {
+    unsigned int cpu = percpu_cpu();
+    klog_ring_t* ring = &klog_rings[cpu];
+
+    if(length > KLOG_MAX_LENGTH) {
+        length = KLOG_MAX_LENGTH;
+    }
+    uint64_t size = KLOG_RECORD_SIZE(length);
+    uint64_t head, padding;
+
+    // reserve space
+    do {
+        head = ring->head;
+        uint64_t offset = head & KLOG_RING_MASK;
+        // records never wrap around, the rest of the ring is padded instead
+        padding = (offset + size > KLOG_RING_SIZE) ? KLOG_RING_SIZE - offset : 0;
+        if(head + padding + size - ring->tail > KLOG_RING_SIZE) {
+            __sync_fetch_and_add(&ring->dropped, 1);
+            return -1;
+        }
+    } while(!__sync_bool_compare_and_swap(&ring->head, head, head + padding + size));
+
+    if(padding) {
+        volatile klog_record_t* pad = KLOG_RECORD_AT(ring, head);
+        pad->length = 0;
+        pad->size = padding;
+        __sync_synchronize();
+        pad->flags = KLOG_FLAG_COMMITTED | KLOG_FLAG_PADDING;
+        head += padding;
+    }
+
+    volatile klog_record_t* record = KLOG_RECORD_AT(ring, head);
+    record->timestamp = cpu_rdtsc();
+    record->length = length;
+    record->size = size;
+    record->cpu = cpu;
+    memcpy((char*)record + sizeof(klog_record_t), msg, length);
+    // publish the record
+    __sync_synchronize();
+    record->flags = KLOG_FLAG_COMMITTED;
+    return 0;
+}
+
+/**
+ * @brief Appends a record and, unless asynchronous draining is enabled, drains the rings.
+ *
+ * This is the function used by the kstdio output functions.
+ */
+void klog_write(const char* msg, size_t length) {
+    klog_append(msg, length);
+    if(!klog_async) {
+        klog_drain();
+        return;
+    }
+    // one wakeup per batch of records is enough
+    thread_t* thread = klog_thread;
+    if(thread && !__sync_lock_test_and_set(&klog_wake, 1)) {
+        sched_wakeup(thread);
+    }
+}
+
+/**
+ * @brief Zeroes the oldest record of \c ring and advances \c tail past it.
+ */
+static void klog_release(klog_ring_t* ring, volatile klog_record_t* record) {
+    uint64_t size = record->size;
+    memset((void*) record, 0, size);
+    // the space must be clear before producers may reserve it again
+    __sync_synchronize();
+    ring->tail += size;
+}
+
+/**
+ * @brief Returns the oldest committed record of \c ring or NULL, skipping padding records.
+ */
+static volatile klog_record_t* klog_peek(klog_ring_t* ring) {
+    while(ring->tail != ring->head) {
+        volatile klog_record_t* record = KLOG_RECORD_AT(ring, ring->tail);
+        if(!(record->flags & KLOG_FLAG_COMMITTED)) {
+            // the producer is still writing
+            return NULL;
+        }
+        __sync_synchronize();
+        if(!(record->flags & KLOG_FLAG_PADDING)) {
+            return record;
+        }
+        klog_release(ring, record);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Checks if any ring contains a committed record.
+ */
+static int klog_pending() {
+    for(int cpu = 0; cpu < HE_MAX_CPUS; cpu++) {
+        klog_ring_t* ring = &klog_rings[cpu];
+        uint64_t tail = ring->tail;
+        if(tail != ring->head && (KLOG_RECORD_AT(ring, tail)->flags & KLOG_FLAG_COMMITTED)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Outputs all records that are committed. Must only be called by the owner of #klog_draining.
+ */
+static void klog_drain_locked() {
+    while(1) {
+        // the oldest record of all rings goes first
+        klog_ring_t* oldest_ring = NULL;
+        volatile klog_record_t* oldest = NULL;
+        for(int cpu = 0; cpu < HE_MAX_CPUS; cpu++) {
+            klog_ring_t* ring = &klog_rings[cpu];
+            if(ring->dropped) {
+                char msg[64];
+                uint64_t dropped = __sync_lock_test_and_set(&ring->dropped, 0);
+                int len = snprintf(msg, sizeof(msg), "[klog: cpu %d dropped %lld messages]\n", cpu, dropped);
+                kstdio_write(msg, len);
+            }
+            volatile klog_record_t* record = klog_peek(ring);
+            if(record && (!oldest || record->timestamp < oldest->timestamp)) {
+                oldest = record;
+                oldest_ring = ring;
+            }
+        }
+        if(!oldest) {
+            return;
+        }
+        kstdio_write((const char*)oldest + sizeof(klog_record_t), oldest->length);
+        klog_release(oldest_ring, oldest);
+    }
+}
+
+/**
+ * @brief Writes all committed records to the kstdio backends.
+ *
+ * Only one processor drains the rings at a time. If another processor is already
+ * draining, this function returns immediately and the other processor
+ * also outputs the records appended in the meantime.
+ */
+void klog_drain() {
+    // records committed after the last check but before the release
+    // would otherwise stay in the ring until the next call
+    do {
+        if(!__sync_bool_compare_and_swap(&klog_draining, 0, 1)) {
+            return;
+        }
+        klog_drain_locked();
+        __sync_lock_release(&klog_draining);
+    } while(klog_pending());
+}
+
+/**
+ * @brief Writes all committed records to the kstdio backends, even if another processor
+ * is draining them.
+ *
+ * Used by the panic handler, whose processor may have been interrupted while draining.
+ * Records may be output twice if another processor is still draining.
+ */
+void klog_flush() {
+    klog_draining = 1;
+    klog_drain_locked();
+    __sync_lock_release(&klog_draining);
+}
+
+/**
+ * @brief Body of #klog_thread.
+ */
+static void klog_consumer(void* arg) {
+    (void) arg;
+    while(1) {
+        sched_sleep(0);
+        // records appended from now on wake the thread again
+        __sync_lock_release(&klog_wake);
+        klog_drain();
+    }
+}
+
+/**
+ * @brief Starts a consumer thread on the current processor and switches to asynchronous draining.
+ *
+ * Must be called after #sched_start. Logging code then no longer waits for slow
+ * backends like the serial port.
+ *
+ * @return zero on success, -1 if the thread could not be created
+ */
+int klog_start() {
+    thread_t* thread = sched_create("klog", klog_consumer, NULL, percpu_cpu());
+    if(!thread) {
+        return -1;
+    }
+    klog_thread = thread;
+    klog_set_async(1);
+    return 0;
+}
+
+/**
+ * @brief Enables or disables asynchronous draining.
+ *
+ * @param async non-zero to enable asynchronous mode
+ */
+void klog_set_async(int async) {
+    klog_async = async;
+}
@@ -5,64 +5,124 @@
  * @date   May 13, 2014
  *
  * @brief This module contains a basic screen output system.
+ *
+ * Output is appended to the per-CPU log rings (see klog.h), which are drained to
+ * all registered backends. In synchronous mode, output is written to the backends directly.
  */
 
 #include "kernel/klibc/kstdio.h"
+#include "kernel/klibc/klog.h"
 #include "kernel/klibc/string.h"
 #include "kernel/klibc/kstdio_screen.h"
 #include <stdarg.h>
 #include <stdint.h>
 
-static kstdio_backend_t* backend = &kstdio_screen_direct;
+/// the backends receiving the output
+static kstdio_backend_t* backends[KSTDIO_MAX_BACKENDS] = { &kstdio_screen_direct };
+
+/// non-zero when the log rings are bypassed
+static int synchronous = 0;
 
 /**
- * @brief Sets the current backend for kstdio.
+ * @brief Sets the current backend for kstdio. All other backends are removed.
  *
  * @param new_backend The new backend that should be used by output functions.
  * @return The old backend.
  */
 kstdio_backend_t* kstdio_set_backend(kstdio_backend_t* new_backend) {
-    kstdio_backend_t* old = backend;
-    backend = new_backend;
+    kstdio_backend_t* old = backends[0];
+    for(int i = 1; i < KSTDIO_MAX_BACKENDS; i++) {
+        backends[i] = NULL;
+    }
+    backends[0] = new_backend;
     return old;
 }
 
-void kputchar(int ch) {
-    if(backend && backend->kputchar) {
-        backend->kputchar(ch);
+/**
+ * @brief Adds a backend that receives all subsequent output.
+ *
+ * @return zero on success, -1 if the maximum number of backends is reached.
+ */
+int kstdio_add_backend(kstdio_backend_t* backend) {
+    for(int i = 0; i < KSTDIO_MAX_BACKENDS; i++) {
+        if(!backends[i] || backends[i] == backend) {
+            backends[i] = backend;
+            return 0;
+        }
     }
+    return -1;
 }
 
 /**
- * @brief writes a null terminated string to the VGA buffer.
+ * @brief Removes a backend previously added with #kstdio_add_backend.
  */
-void kputs(const char* message) {
-    if(backend && backend->kputsn) {
-        backend->kputs(message);
-    } else if(backend && backend->kputchar) {
-        // output until '\0' terminator or length
-        while (*message) {
-            backend->kputchar(*message);
-            message += 1;
+void kstdio_remove_backend(kstdio_backend_t* backend) {
+    for(int i = 0; i < KSTDIO_MAX_BACKENDS; i++) {
+        if(backends[i] == backend) {
+            backends[i] = NULL;
         }
     }
 }
 
 /**
- * @brief writes a null terminated string to the VGA buffer, but at most \c size characters.
+ * @brief Enables or disables synchronous output.
+ *
+ * Synchronous output bypasses the log rings and writes to the backends directly.
+ * It is used by the panic handler.
  */
-void kputsn(const char* message, size_t length) {
-    if(backend && backend->kputsn) {
-        backend->kputsn(message, length);
-    } else if(backend && backend->kputchar) {
-        // output until '\0' terminator or length
-        while (*message && length--) {
-            backend->kputchar(*message);
-            message += 1;
+void kstdio_set_synchronous(int sync) {
+    synchronous = sync;
+}
+
+/**
+ * @brief Writes exactly \c length bytes to all backends.
+ */
+void kstdio_write(const char* message, size_t length) {
+    for(int i = 0; i < KSTDIO_MAX_BACKENDS; i++) {
+        kstdio_backend_t* backend = backends[i];
+        if(!backend) {
+            continue;
+        }
+        if(backend->kputsn) {
+            backend->kputsn(message, length);
+        } else if(backend->kputchar) {
+            for(size_t j = 0; j < length; j++) {
+                backend->kputchar(message[j]);
+            }
         }
     }
 }
 
+/**
+ * @brief Either writes the \c message to the log or directly to the backends.
+ */
+static void kstdio_output(const char* message, size_t length) {
+    if(synchronous) {
+        kstdio_write(message, length);
+    } else {
+        klog_write(message, length);
+    }
+}
+
+void kputchar(int ch) {
+    char chr = (char) ch;
+    kstdio_output(&chr, 1);
+}
+
+/**
+ * @brief writes a null terminated string to the VGA buffer.
+ */
+void kputs(const char* message) {
+    kstdio_output(message, strlen(message));
+}
+
+/**
+ * @brief writes a null terminated string to the VGA buffer, but at most \c size characters.
+ */
+void kputsn(const char* message, size_t length) {
+    kstdio_output(message, strnlen(message, length));
+}
+
 /**
  * @brief Kernel mode printf, uses #snprintf.
  */
@@ -81,6 +141,12 @@ void kprintf(const char* format, ...) {
  */
 void kvprintf(const char* format, va_list vl) {
     char linebuf[KPRINTF_LINE_MAX];
-    vsnprintf(linebuf, sizeof(linebuf), format, vl);
-    kputs(linebuf);
+    int length = vsnprintf(linebuf, sizeof(linebuf), format, vl);
+    if(length < 0) {
+        return;
+    }
+    if(length >= KPRINTF_LINE_MAX) {
+        length = KPRINTF_LINE_MAX - 1;
+    }
+    kstdio_output(linebuf, length);
 }
@@ -0,0 +1,374 @@
+/**
+ * @file kstdio_fbcon.c
+ *
+ * @author Fabian Thorand
+ * @date   19.10.2026
+ *
+ * @brief Backend for kstdio.h that renders text to a linear framebuffer.
+ *
+ * Like the VGA console, text is written to a ring of character cells in RAM and
+ * scrolling only rotates the ring. #fbcon_flush moves the framebuffer contents up by
+ * all lines scrolled since the last flush at once, then compares the changed part of
+ * each line with the cells currently shown and draws only the characters that differ.
+ * So a scroll costs one move of the framebuffer and drawing the new bottom line.
+ *
+ * Glyphs are not rendered pixel by pixel. For each color pair in use, all glyphs are
+ * rendered once into a cache slot in the pixel format of the framebuffer, so drawing
+ * a character is a copy of 32 bytes per scanline. The framebuffer is only read to scroll.
+ */
+
+#include "kernel/klibc/kstdio_fbcon.h"
+#include "kernel/klibc/kstdio_screen.h"
+#include "kernel/klibc/ansi.h"
+#include "kernel/klibc/string.h"
+#include "kernel/mem/vmm.h"
+
+#include <stdint.h>
+
+/**
+ * @brief All cached glyphs rendered in one color pair.
+ */
+typedef struct {
+    uint32_t pixels[FBCON_CACHED_CHARS][FBCON_FONT_HEIGHT][FBCON_FONT_WIDTH];
+} fbcon_glyphs_t;
+
+/// base of the framebuffer in the physical memory mapping
+static volatile uint8_t* fb_base = NULL;
+/// bytes per scanline
+static uint32_t fb_pitch;
+/// number of text columns
+static uint32_t fbcon_cols;
+/// number of text rows
+static uint32_t fbcon_rows;
+
+/// current output cursor line
+static uint32_t fbcon_line = 0;
+/// current output cursor column
+static uint32_t fbcon_col = 0;
+/// current text color as VGA color byte
+static uint8_t fbcon_color = ANSI_DEFAULT_COLOR;
+/// state of the escape sequence parser
+static ansi_parser_t fbcon_ansi;
+
+/// text cells, logical line \c y is stored in <tt>fbcon_cells[(fbcon_top + y) % fbcon_rows]</tt>
+static uint16_t fbcon_cells[FBCON_MAX_ROWS][FBCON_MAX_COLS];
+/// index of the first logical line in #fbcon_cells
+static uint32_t fbcon_top = 0;
+/// cells as currently shown in the framebuffer, indexed by screen line
+static uint16_t fbcon_shown[FBCON_MAX_ROWS][FBCON_MAX_COLS];
+/// first column of each screen line that may have changed
+static uint16_t fbcon_dirty_start[FBCON_MAX_ROWS];
+/// column after the last one of each screen line that may have changed
+static uint16_t fbcon_dirty_end[FBCON_MAX_ROWS];
+/// number of lines scrolled since the framebuffer was last moved
+static uint32_t fbcon_scrolled = 0;
+
+/// the 16 VGA colors in the pixel format of the framebuffer
+static uint32_t fbcon_palette[16];
+/// rendered glyphs
+static fbcon_glyphs_t fbcon_cache[FBCON_CACHE_SLOTS];
+/// color pair of each cache slot, or -1 if the slot is unused
+static int fbcon_cache_color[FBCON_CACHE_SLOTS];
+/// slot that is replaced next
+static unsigned int fbcon_cache_victim = 0;
+
+/// RGB values of the VGA colors
+static const uint32_t vga_rgb[16] = {
+    0x000000, 0x0000AA, 0x00AA00, 0x00AAAA, 0xAA0000, 0xAA00AA, 0xAA5500, 0xAAAAAA,
+    0x555555, 0x5555FF, 0x55FF55, 0x55FFFF, 0xFF5555, 0xFF55FF, 0xFFFF55, 0xFFFFFF
+};
+
+/// returns the cell line for the logical line \c y
+#define FBCON_LINE(y) (fbcon_cells[(fbcon_top + (y)) % fbcon_rows])
+/// marks the columns <tt>[x0,x1)</tt> of the logical line \c y as dirty
+#define FBCON_MARK(y,x0,x1) { \
+    if((x0) < fbcon_dirty_start[y]) fbcon_dirty_start[y] = (x0); \
+    if((x1) > fbcon_dirty_end[y]) fbcon_dirty_end[y] = (x1); \
+    }
+
+kstdio_backend_t kstdio_fbcon = {fbcon_kputchar, fbcon_kputs, fbcon_kputsn};
+
+/**
+ * @brief Converts an RGB value to a pixel of the framebuffer.
+ */
+static uint32_t fbcon_pixel(const he_framebuffer_t* fb, uint32_t rgb) {
+    uint32_t r = (rgb >> 16) & 0xFF, g = (rgb >> 8) & 0xFF, b = rgb & 0xFF;
+    return ((r >> (8 - fb->red_size)) << fb->red_shift)
+         | ((g >> (8 - fb->green_size)) << fb->green_shift)
+         | ((b >> (8 - fb->blue_size)) << fb->blue_shift);
+}
+
+/**
+ * @brief Returns the glyphs rendered in \c color, rendering them if necessary.
+ */
+static fbcon_glyphs_t* fbcon_glyphs(uint8_t color) {
+    static unsigned int last = 0;
+    if(fbcon_cache_color[last] == color) {
+        return &fbcon_cache[last];
+    }
+    for(unsigned int slot = 0; slot < FBCON_CACHE_SLOTS; slot++) {
+        if(fbcon_cache_color[slot] == color) {
+            last = slot;
+            return &fbcon_cache[slot];
+        }
+    }
+
+    // render all glyphs into the next slot
+    last = fbcon_cache_victim;
+    fbcon_cache_victim = (fbcon_cache_victim + 1) % FBCON_CACHE_SLOTS;
+    fbcon_cache_color[last] = color;
+    fbcon_glyphs_t* glyphs = &fbcon_cache[last];
+    uint32_t fg = fbcon_palette[color & 0x0F];
+    uint32_t bg = fbcon_palette[color >> 4];
+    for(int chr = 0; chr < FBCON_CACHED_CHARS; chr++) {
+        for(int y = 0; y < FBCON_FONT_HEIGHT; y++) {
+            uint8_t bits = fbcon_font[FBCON_FIRST_CHAR + chr][y];
+            for(int x = 0; x < FBCON_FONT_WIDTH; x++) {
+                glyphs->pixels[chr][y][x] = (bits & (0x80 >> x)) ? fg : bg;
+            }
+        }
+    }
+    return glyphs;
+}
+
+/**
+ * @brief Draws the cells <tt>[x0,x1)</tt> of screen line \c y to the framebuffer.
+ */
+static void fbcon_draw(uint32_t y, const uint16_t* line, uint32_t x0, uint32_t x1) {
+    volatile uint8_t* cell = fb_base + (y * FBCON_FONT_HEIGHT) * fb_pitch + x0 * FBCON_FONT_WIDTH * sizeof(uint32_t);
+    for(uint32_t x = x0; x < x1; x++, cell += FBCON_FONT_WIDTH * sizeof(uint32_t)) {
+        uint8_t chr = line[x] & 0xFF;
+        unsigned int glyph = (chr >= FBCON_FIRST_CHAR && chr < FBCON_FONT_GLYPHS) ? chr : '?';
+        const uint64_t* src = (const uint64_t*) fbcon_glyphs(line[x] >> 8)->pixels[glyph - FBCON_FIRST_CHAR];
+        volatile uint8_t* scanline = cell;
+        // one row of a glyph are 32 bytes
+        for(int row = 0; row < FBCON_FONT_HEIGHT; row++, scanline += fb_pitch, src += 4) {
+            volatile uint64_t* dest = (volatile uint64_t*) scanline;
+            dest[0] = src[0];
+            dest[1] = src[1];
+            dest[2] = src[2];
+            dest[3] = src[3];
+        }
+    }
+}
+
+/**
+ * @brief Moves the framebuffer contents up by the lines scrolled since the last call.
+ *
+ * The bottom lines keep their old pixels, so they stay in sync with #fbcon_shown.
+ */
+static void fbcon_move() {
+    uint32_t lines = fbcon_scrolled;
+    fbcon_scrolled = 0;
+    // when everything scrolled out, drawing the differences is cheaper than moving
+    if(lines == 0 || lines >= fbcon_rows) {
+        return;
+    }
+    size_t line_size = (size_t) FBCON_FONT_HEIGHT * fb_pitch;
+    memmove((void*) fb_base, (const void*) (fb_base + lines * line_size), (fbcon_rows - lines) * line_size);
+    memmove(fbcon_shown[0], fbcon_shown[lines], (fbcon_rows - lines) * sizeof(fbcon_shown[0]));
+}
+
+/**
+ * @brief Draws all changed characters to the framebuffer.
+ */
+void fbcon_flush() {
+    fbcon_move();
+    for(uint32_t y = 0; y < fbcon_rows; y++) {
+        uint32_t x = fbcon_dirty_start[y];
+        uint32_t end = fbcon_dirty_end[y];
+        fbcon_dirty_start[y] = FBCON_MAX_COLS;
+        fbcon_dirty_end[y] = 0;
+        const uint16_t* line = FBCON_LINE(y);
+        uint16_t* shown = fbcon_shown[y];
+        // draw runs of characters that differ from the screen contents
+        while(x < end) {
+            if(line[x] == shown[x]) {
+                x++;
+                continue;
+            }
+            uint32_t run = x;
+            while(x < end && line[x] != shown[x]) {
+                shown[x] = line[x];
+                x++;
+            }
+            fbcon_draw(y, line, run, x);
+        }
+    }
+}
+
+/**
+ * @brief Initializes the console for the given framebuffer.
+ *
+ * @return zero on success, -1 if the framebuffer is not supported.
+ * Only 32 bits per pixel below 4 GiB are supported.
+ */
+int fbcon_init(const he_framebuffer_t* fb) {
+    if(!fb->paddr || fb->bpp != 32 || fb->paddr + (uint64_t)fb->pitch * fb->height > 0x100000000) {
+        return -1;
+    }
+    fb_base = (volatile uint8_t*) (VMM_PHYS4G_BASE + fb->paddr);
+    fb_pitch = fb->pitch;
+    fbcon_cols = fb->width / FBCON_FONT_WIDTH;
+    fbcon_rows = fb->height / FBCON_FONT_HEIGHT;
+    if(fbcon_cols > FBCON_MAX_COLS) {
+        fbcon_cols = FBCON_MAX_COLS;
+    }
+    if(fbcon_rows > FBCON_MAX_ROWS) {
+        fbcon_rows = FBCON_MAX_ROWS;
+    }
+    for(int i = 0; i < 16; i++) {
+        fbcon_palette[i] = fbcon_pixel(fb, vga_rgb[i]);
+    }
+    for(int slot = 0; slot < FBCON_CACHE_SLOTS; slot++) {
+        fbcon_cache_color[slot] = -1;
+    }
+    // the framebuffer contents are unknown, draw every cell once
+    memset(fbcon_shown, 0xFF, sizeof(fbcon_shown));
+    fbcon_clear(ANSI_DEFAULT_COLOR);
+    return 0;
+}
+
+/**
+ * @brief Checks whether the console has been initialized by #fbcon_init.
+ */
+int fbcon_enabled() {
+    return fb_base != NULL;
+}
+
+/**
+ * @brief Returns the number of text columns and rows of the console.
+ */
+void fbcon_get_size(uint32_t* cols, uint32_t* rows) {
+    *cols = fbcon_cols;
+    *rows = fbcon_rows;
+}
+
+/**
+ * @brief Clears the screen and sets the default color for subsequent output.
+ *
+ * @param color a VGA color byte, see kstdio_screen.h
+ */
+void fbcon_clear(uint8_t color) {
+    fbcon_color = color;
+    fbcon_line = 0;
+    fbcon_col = 0;
+    fbcon_top = 0;
+    for(uint32_t y = 0; y < fbcon_rows; y++) {
+        for(uint32_t x = 0; x < fbcon_cols; x++) {
+            fbcon_cells[y][x] = (color << 8) | ' ';
+        }
+        fbcon_dirty_start[y] = 0;
+        fbcon_dirty_end[y] = fbcon_cols;
+    }
+    fbcon_flush();
+}
+
+/**
+ * @brief Scrolls the text one line up.
+ *
+ * Only the cell ring is rotated, the framebuffer is moved by the next #fbcon_flush.
+ */
+void fbcon_scroll() {
+    // the old first line becomes the new last line
+    fbcon_top = (fbcon_top + 1) % fbcon_rows;
+    uint16_t* last = FBCON_LINE(fbcon_rows - 1);
+    for(uint32_t x = 0; x < fbcon_cols; x++) {
+        last[x] = (fbcon_color << 8) | ' ';
+    }
+    // unflushed changes move up with their lines, only the new line is completely dirty
+    memmove(fbcon_dirty_start, fbcon_dirty_start + 1, (fbcon_rows - 1) * sizeof(fbcon_dirty_start[0]));
+    memmove(fbcon_dirty_end, fbcon_dirty_end + 1, (fbcon_rows - 1) * sizeof(fbcon_dirty_end[0]));
+    fbcon_dirty_start[fbcon_rows - 1] = 0;
+    fbcon_dirty_end[fbcon_rows - 1] = fbcon_cols;
+    fbcon_scrolled++;
+    fbcon_line -= 1;
+}
+
+/**
+ * @brief Replaces the whole screen contents.
+ *
+ * Only the characters that differ from the current contents are drawn.
+ *
+ * @param lines one line of characters in VGA format for each text row
+ * @param col,line the new cursor position
+ * @param color the new text color
+ */
+void fbcon_load(const uint16_t* const lines[], uint32_t col, uint32_t line, uint8_t color) {
+    for(uint32_t y = 0; y < fbcon_rows; y++) {
+        memcpy(FBCON_LINE(y), lines[y], fbcon_cols * sizeof(uint16_t));
+        fbcon_dirty_start[y] = 0;
+        fbcon_dirty_end[y] = fbcon_cols;
+    }
+    fbcon_col = col;
+    fbcon_line = line;
+    fbcon_color = color;
+    fbcon_flush();
+}
+
+/**
+ * @brief Copies the whole screen contents.
+ *
+ * @param lines receives one line of characters in VGA format for each text row
+ * @param col,line receive the cursor position
+ * @param color receives the text color
+ */
+void fbcon_save(uint16_t* const lines[], uint32_t* col, uint32_t* line, uint8_t* color) {
+    for(uint32_t y = 0; y < fbcon_rows; y++) {
+        memcpy(lines[y], FBCON_LINE(y), fbcon_cols * sizeof(uint16_t));
+    }
+    *col = fbcon_col;
+    *line = fbcon_line;
+    *color = fbcon_color;
+}
+
+/**
+ * @brief Writes a character to the cell ring.
+ */
+static void fbcon_putchar_cells(int chr) {
+    if(ansi_parse(&fbcon_ansi, chr, &fbcon_color)) {
+        return;
+    }
+    if(chr == '\n') {
+        fbcon_col = fbcon_cols;
+    } else {
+        FBCON_LINE(fbcon_line)[fbcon_col] = (uint8_t) chr | (fbcon_color << 8);
+        FBCON_MARK(fbcon_line, fbcon_col, fbcon_col + 1);
+        fbcon_col++;
+    }
+    if(fbcon_col == fbcon_cols) {
+        fbcon_col = 0;
+        fbcon_line += 1;
+        if(fbcon_line == fbcon_rows) {
+            fbcon_scroll();
+        }
+    }
+}
+
+/**
+ * @brief Writes a character to the console.
+ */
+void fbcon_kputchar(int chr) {
+    fbcon_putchar_cells(chr);
+    fbcon_flush();
+}
+
+/**
+ * @brief Writes a null terminated string to the console.
+ */
+void fbcon_kputs(const char* msg) {
+    while(*msg) {
+        fbcon_putchar_cells(*msg++);
+    }
+    fbcon_flush();
+}
+
+/**
+ * @brief Writes \c length characters to the console and updates the framebuffer once.
+ */
+void fbcon_kputsn(const char* msg, size_t length) {
+    while(length--) {
+        fbcon_putchar_cells(*msg++);
+    }
+    fbcon_flush();
+}
@@ -4,6 +4,14 @@
  * @author fabian
  *
  * @brief String formatting functions for kernel mode.
+ *
+ * Format strings are split into specs, each describing a run of literal text followed
+ * by one conversion. Format strings in the read-only part of the kernel image cannot
+ * change, so their specs are parsed once and kept in #fmt_cache. Cache entries are
+ * never replaced or freed, which allows lock-free lookups from any processor.
+ *
+ * Integers are converted from the least significant digit backwards into a small
+ * buffer, two decimal digits per division or one digit per shift for power-of-two radixes.
  */
 
 #include "kernel/klibc/kstdio.h"
@@ -15,48 +23,284 @@
 
 typedef enum { DEFAULT, CHAR, SHORT, LONG, LONGLONG, INTMAX, SIZE, PTRDIFF, POINTER, LONGDOUBLE } fmtsize_t;
 
+/// the value is read from the argument list
+#define FMT_ARG -1
+/// maximum number of literal characters in one spec
+#define FMT_LITERAL_MAX UINT16_MAX
+/// conversion character of the spec terminating a format string
+#define FMT_END 0
+/// conversion character of a spec that only contains literal text
+#define FMT_NONE 1
+
+#define FMT_FLAG_LEFT      0x1  ///< '-' left justify
+#define FMT_FLAG_SIGN      0x2  ///< '+' or ' ' always print a sign
+#define FMT_FLAG_SPACE     0x4  ///< ' ' use a space as positive sign
+#define FMT_FLAG_ZERO      0x8  ///< '0' pad with zeros
+
+/// number of slots in the format cache, must be a power of two
+#define FMT_CACHE_SIZE 128
+/// total number of specs available for cached format strings
+#define FMT_POOL_SIZE 1024
+
+/// checks if the format string at \c ptr is immutable and may be cached
+#ifndef FMT_CACHEABLE
+extern char __TEXT_START, __TEXT_END;
+#define FMT_CACHEABLE(ptr) ((const char*)(ptr) >= &__TEXT_START && (const char*)(ptr) < &__TEXT_END)
+#endif
+
+/**
+ * @brief Literal text followed by one conversion specification.
+ *
+ * Size: 10 bytes
+ */
+typedef struct {
+    uint16_t literal;   ///< number of literal characters in front of the conversion
+    uint8_t  length;    ///< number of characters of the conversion specification
+    uint8_t  flags;     ///< combination of \c FMT_FLAG_* values
+    int16_t  width;     ///< minimum field width or #FMT_ARG
+    int16_t  precision; ///< precision or #FMT_ARG
+    uint8_t  size;      ///< length modifier, one of #fmtsize_t
+    char     conversion;///< conversion character, #FMT_END or #FMT_NONE
+} fmt_spec_t;
+
+/**
+ * @brief Slot of the format cache.
+ */
+typedef struct {
+    const char* volatile format;        ///< the format string owning this slot
+    const fmt_spec_t* volatile specs;   ///< parsed specs, NULL while they are written
+} fmt_cache_entry_t;
+
+/// cached format strings, indexed by a hash of the format pointer
+static fmt_cache_entry_t fmt_cache[FMT_CACHE_SIZE];
+/// storage for the specs of cached format strings
+static fmt_spec_t fmt_pool[FMT_POOL_SIZE];
+/// number of specs used in #fmt_pool
+static volatile int fmt_pool_used = 0;
+
 static const char digits_lower[] = "0123456789abcdef";
 static const char digits_upper[] = "0123456789ABCDEF";
 
+/// all two-digit decimal numbers
+static const char digits_decimal[200] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+/// size of a buffer that holds any 64 bit integer in octal including sign
+#define FMT_NUMBUF 24
+
 /**
- * @brief Converts an unsigned integer value to a decimal string and writes it to the buffer.
+ * @brief Converts an unsigned integer value to a string ending right before \c end.
+ *
+ * @param radix 8, 10 or 16
+ * @return a pointer to the first digit.
  */
-static void uitoa(uint64_t value, char* buf, size_t bufsz, int radix, const char digits[]) {
-    char tmpbuf[68];
-    memset(tmpbuf, 0, sizeof(tmpbuf));
-    int offset = sizeof(tmpbuf) - 1;
-    do {
-        offset -= 1;
-        tmpbuf[offset] = digits[value % radix];
-        value = value / radix;
-    } while(value != 0 && offset > 0);
-    size_t tmplen = sizeof(tmpbuf) - offset;
-    if(tmplen > bufsz) {
-        tmplen = bufsz;
+static char* uitoa(uint64_t value, char* end, int radix, const char digits[]) {
+    char* ptr = end;
+    if(radix == 10) {
+        while(value >= 100) {
+            unsigned int pair = (value % 100) * 2;
+            value /= 100;
+            *--ptr = digits_decimal[pair + 1];
+            *--ptr = digits_decimal[pair];
+        }
+        if(value >= 10) {
+            *--ptr = digits_decimal[value * 2 + 1];
+            *--ptr = digits_decimal[value * 2];
+        } else {
+            *--ptr = '0' + value;
+        }
+    } else {
+        unsigned int shift = radix == 16 ? 4 : 3;
+        unsigned int mask = radix - 1;
+        do {
+            *--ptr = digits[value & mask];
+            value >>= shift;
+        } while(value != 0);
     }
-    memcpy(buf, tmpbuf + offset, tmplen);
+    return ptr;
 }
 
 /**
- * @brief Converts a signed integer value to a decimal string and writes it to the buffer.
+ * @brief Converts a signed integer value to a string ending right before \c end.
+ * @return a pointer to the sign or first digit.
  */
-static void itoa(int64_t value, char* buf, size_t bufsz, int radix, const char digits[], int force_sign, char positive_sign) {
-    int negative = value < 0;
-    if(negative) {
-        value = -value;
-    }
-    if(bufsz > 0 && (negative || force_sign)) {
-        buf[0] = negative ? '-' : positive_sign;
-        buf++;
-        bufsz--;
+static char* itoa(int64_t value, char* end, int force_sign, char positive_sign) {
+    // negate as unsigned, -INT64_MIN does not fit into int64_t
+    uint64_t magnitude = value < 0 ? -(uint64_t)value : (uint64_t)value;
+    char* ptr = uitoa(magnitude, end, 10, digits_lower);
+    if(value < 0) {
+        *--ptr = '-';
+    } else if(force_sign) {
+        *--ptr = positive_sign;
     }
-    uitoa(value, buf, bufsz, radix, digits);
+    return ptr;
 }
 
 int isdigit(int ch) {
     return (ch >= '0') && (ch <= '9');
 }
 
+/**
+ * @brief Parses the literal text at \c format and the conversion specification following it.
+ * @return a pointer to the first character after the specification.
+ */
+static const char* fmt_parse(const char* format, fmt_spec_t* spec) {
+    const char* fmt = format;
+    while(*fmt && *fmt != '%' && fmt - format < FMT_LITERAL_MAX) {
+        fmt++;
+    }
+    spec->literal = fmt - format;
+    spec->flags = 0;
+    spec->width = 0;
+    spec->precision = 6;
+    spec->size = DEFAULT;
+    spec->length = 0;
+    if(!*fmt) {
+        spec->conversion = FMT_END;
+        return fmt;
+    }
+    if(*fmt != '%') {
+        spec->conversion = FMT_NONE;
+        return fmt;
+    }
+    const char* start = fmt;
+
+    // parse flags
+    parse_flag:
+    fmt++;
+    switch(*fmt) {
+    case '-':
+        spec->flags |= FMT_FLAG_LEFT; goto parse_flag;
+    case '+':
+        spec->flags |= FMT_FLAG_SIGN; spec->flags &= ~FMT_FLAG_SPACE; goto parse_flag;
+    case ' ':
+        spec->flags |= FMT_FLAG_SIGN | FMT_FLAG_SPACE; goto parse_flag;
+    //case '#':
+    case '0':
+        spec->flags |= FMT_FLAG_ZERO; goto parse_flag;
+    default:
+        break;
+    }
+
+    // parse width
+    if(*fmt == '*') {
+        spec->width = FMT_ARG;
+        fmt++;
+    } else if(isdigit(*fmt)) {
+        int width = 0;
+        do {
+            width = width * 10 + (*fmt - '0');
+            fmt++;
+        } while(isdigit(*fmt));
+        spec->width = width > INT16_MAX ? INT16_MAX : width;
+    }
+
+    // parse precision
+    if(*fmt == '.') {
+        fmt++;
+        if(*fmt == '*') {
+            spec->precision = FMT_ARG;
+            fmt++;
+        } else if(isdigit(*fmt)) {
+            int precision = 0;
+            do {
+                precision = precision * 10 + (*fmt - '0');
+                fmt++;
+            } while(isdigit(*fmt));
+            spec->precision = precision > INT16_MAX ? INT16_MAX : precision;
+        }
+    }
+
+    // parse length
+    switch(*fmt) {
+    case 'j':
+        spec->size = INTMAX; fmt++; break;
+    case 'z':
+        spec->size = SIZE; fmt++; break;
+    case 't':
+        spec->size = PTRDIFF; fmt++; break;
+    case 'L':
+        spec->size = LONGDOUBLE; fmt++; break;
+    case 'h':
+        fmt++;
+        if(*fmt == 'h') {
+            spec->size = CHAR;
+            fmt++;
+        } else {
+            spec->size = SHORT;
+        }
+        break;
+    case 'l':
+        fmt++;
+        if(*fmt == 'l') {
+            spec->size = LONGLONG;
+            fmt++;
+        } else {
+            spec->size = LONG;
+        }
+        break;
+    default:
+        break;
+    }
+
+    if(!*fmt || fmt - start >= UINT8_MAX) {
+        // incomplete specification at the end of the string
+        spec->conversion = FMT_END;
+        return fmt;
+    }
+    spec->conversion = *fmt++;
+    spec->length = fmt - start;
+    return fmt;
+}
+
+/**
+ * @brief Returns the cached specs of \c format, parsing and caching it if possible.
+ * @return the specs or NULL, when the format string cannot be cached.
+ */
+static const fmt_spec_t* fmt_cache_lookup(const char* format) {
+    if(!FMT_CACHEABLE(format)) {
+        return NULL;
+    }
+    fmt_cache_entry_t* entry = &fmt_cache[((uintptr_t)format >> 3) & (FMT_CACHE_SIZE - 1)];
+    if(entry->format == format) {
+        return entry->specs;
+    }
+    if(entry->format || !__sync_bool_compare_and_swap(&entry->format, NULL, format)) {
+        // the slot belongs to another format string
+        return NULL;
+    }
+
+    // count the specs, then parse them into the pool
+    fmt_spec_t spec;
+    int count = 0;
+    const char* fmt = format;
+    do {
+        fmt = fmt_parse(fmt, &spec);
+        count++;
+    } while(spec.conversion != FMT_END);
+    int first = __sync_fetch_and_add(&fmt_pool_used, count);
+    if(first + count > FMT_POOL_SIZE) {
+        // the slot stays claimed without specs, the format string is parsed on every use
+        return NULL;
+    }
+    fmt = format;
+    for(int i = 0; i < count; i++) {
+        fmt = fmt_parse(fmt, &fmt_pool[first + i]);
+    }
+    __sync_synchronize();
+    entry->specs = &fmt_pool[first];
+    return entry->specs;
+}
+
 int snprintf(char* str, size_t strn, const char* format, ...) {
     va_list arglist;
     va_start(arglist, format);
@@ -65,22 +309,29 @@ int snprintf(char* str, size_t strn, const char* format, ...) {
     return result;
 }
 
-#define SPUTC(ch) { if(outremaining--) { str[outidx++] = ch; } written++; }
-#define SPUTS(s) { const char* tmp_put = s; while(*tmp_put) { SPUTC(*tmp_put); tmp_put++; } }
+#define SPUTC(ch) { if(outremaining) { outremaining--; str[outidx++] = ch; } written++; }
+#define SPUTSN(s,len) { \
+    size_t len_put = (len); \
+    size_t len_copy = len_put < outremaining ? len_put : outremaining; \
+    memcpy(str + outidx, s, len_copy); \
+    outidx += len_copy; \
+    outremaining -= len_copy; \
+    written += len_put; \
+    }
 #define SPAD(cnt,ch) { for(int i = 0; i < cnt; i++) { SPUTC(ch); } }
-#define SPUTSPAD(s,cnt,ch) { \
+#define SPUTSNPAD(s,len,cnt,ch) { \
     const char* tmp_pad = s; \
-    int arglen = strlen(tmp_pad); \
+    int arglen = len; \
     if(arglen >= width) { \
-        SPUTS(tmp_pad); \
+        SPUTSN(tmp_pad, arglen); \
     } else { \
         int diff = cnt - arglen; \
         if(left_justify) { \
-            SPUTS(tmp_pad); \
+            SPUTSN(tmp_pad, arglen); \
             SPAD(diff, ' '); \
         } else { \
             SPAD(diff, ch); \
-            SPUTS(tmp_pad); \
+            SPUTSN(tmp_pad, arglen); \
         } \
     } \
     }
@@ -89,114 +340,57 @@ int vsnprintf(char* str, size_t strn, const char* format, va_list arglist) {
     int written = 0;
     // write index in str
     size_t outidx = 0;
-    // remaining bytes in str
-    size_t outremaining = strn - 1;
+    // remaining bytes in str, excluding the terminator
+    size_t outremaining = strn ? strn - 1 : 0;
     if (!format) {
         format = "";
     }
 
-    for(const char* fmt = format; *fmt; fmt++) {
-        if(*fmt != '%') {
-            SPUTC(*fmt);
-            continue;
+    const fmt_spec_t* cached = fmt_cache_lookup(format);
+    fmt_spec_t parsed;
+    const char* fmt = format;
+    while(1) {
+        const fmt_spec_t* spec;
+        if(cached) {
+            spec = cached++;
+        } else {
+            fmt_parse(fmt, &parsed);
+            spec = &parsed;
         }
-
-        int left_justify = 0;
-        int force_sign = 0;
-        int pad_char = ' ';
-        int positive_sign = '+';
-        int width = 0;
-        int precision = 6;
-        fmtsize_t size = DEFAULT;
-
-        // parse flags
-        parse_flag:
-        fmt++;
-        switch(*fmt) {
-        case '-':
-            left_justify = 1; goto parse_flag;
-        case '+':
-            force_sign = 1; positive_sign = '+'; goto parse_flag;
-        case ' ':
-            force_sign = 1; positive_sign = ' '; goto parse_flag;
-        //case '#':
-        case '0':
-            pad_char = '0'; goto parse_flag;
-        default:
+        SPUTSN(fmt, spec->literal);
+        fmt += spec->literal + spec->length;
+        if(spec->conversion == FMT_END) {
             break;
         }
+        if(spec->conversion == FMT_NONE) {
+            continue;
+        }
 
-        // parse width
-        if(*fmt == '*') {
+        int left_justify = spec->flags & FMT_FLAG_LEFT;
+        int force_sign = spec->flags & FMT_FLAG_SIGN;
+        int pad_char = (spec->flags & FMT_FLAG_ZERO) ? '0' : ' ';
+        int positive_sign = (spec->flags & FMT_FLAG_SPACE) ? ' ' : '+';
+        int width = spec->width;
+        int precision = spec->precision;
+        fmtsize_t size = spec->size;
+
+        if(width == FMT_ARG) {
             width = va_arg(arglist, int);
             if(width < 0) {
                 left_justify = 1;
                 width = -width;
             }
-            fmt++;
-        } else if(isdigit(*fmt)) {
-            do {
-                int val = *fmt - '0';
-                width *= 10;
-                width += val;
-                fmt++;
-            } while(isdigit(*fmt));
         }
-
-        // parse precision
-        if(*fmt == '.') {
-            fmt++;
-            if(*fmt == '*') {
-                precision = va_arg(arglist, int);
-                if(precision < 0) {
-                    precision = -precision;
-                }
-                fmt++;
-            } else if(isdigit(*fmt)) {
-                precision = 0;
-                do {
-                    int val = *fmt - '0';
-                    precision *= 10;
-                    precision += val;
-                    fmt++;
-                } while(isdigit(*fmt));
+        if(precision == FMT_ARG) {
+            precision = va_arg(arglist, int);
+            if(precision < 0) {
+                precision = -precision;
             }
         }
-
-        // parse length
-        switch(*fmt) {
-        case 'j':
-            size = INTMAX; fmt++; break;
-        case 'z':
-            size = SIZE; fmt++; break;
-        case 't':
-            size = PTRDIFF; fmt++; break;
-        case 'L':
-            size = LONGDOUBLE; fmt++; break;
-        case 'h':
-            fmt++;
-            if(*fmt == 'h') {
-                size = CHAR;
-                fmt++;
-            } else {
-                size = SHORT;
-            }
-            break;
-        case 'l':
-            fmt++;
-            if(*fmt == 'l') {
-                size = LONGLONG;
-                fmt++;
-            } else {
-                size = LONG;
-            }
-            break;
-        default:
-            break;
-        }
+        (void) precision;
 
         // parse fmt
-        switch(*fmt) {
+        switch(spec->conversion) {
         case 'd':
         case 'i': { // signed decimal integer
             int64_t arg;
@@ -218,14 +412,14 @@ int vsnprintf(char* str, size_t strn, const char* format, va_list arglist) {
             default:
                 arg = va_arg(arglist, int); break;
             }
-            char tmpbuf[24];
-            memset(tmpbuf, 0, sizeof(tmpbuf));
-            itoa(arg, tmpbuf, sizeof(tmpbuf), 10, digits_lower, force_sign, positive_sign);
-            if(isdigit(tmpbuf[0]) || pad_char == ' ') {
-                SPUTSPAD(tmpbuf, width, pad_char);
+            char tmpbuf[FMT_NUMBUF];
+            char* end = tmpbuf + sizeof(tmpbuf);
+            char* num = itoa(arg, end, force_sign, positive_sign);
+            if(isdigit(num[0]) || pad_char == ' ') {
+                SPUTSNPAD(num, end - num, width, pad_char);
             } else {
-                SPUTC(tmpbuf[0]);
-                SPUTSPAD(tmpbuf+1, width-1, pad_char);
+                SPUTC(num[0]);
+                SPUTSNPAD(num + 1, end - num - 1, width - 1, pad_char);
             }
             break;
         }
@@ -235,7 +429,7 @@ int vsnprintf(char* str, size_t strn, const char* format, va_list arglist) {
         case 'p':
         case 'u': { // unsigned decimal integer
             int radix;
-            switch(*fmt) {
+            switch(spec->conversion) {
             case 'x':
             case 'X':
                 radix = 16; break;
@@ -268,21 +462,20 @@ int vsnprintf(char* str, size_t strn, const char* format, va_list arglist) {
             default:
                 arg = va_arg(arglist, unsigned int); break;
             }
-            char tmpbuf[24];
-            memset(tmpbuf, 0, sizeof(tmpbuf));
-            uitoa(arg, tmpbuf, sizeof(tmpbuf), radix, *fmt == 'X' ? digits_upper : digits_lower);
-            SPUTSPAD(tmpbuf, width, pad_char);
+            char tmpbuf[FMT_NUMBUF];
+            char* end = tmpbuf + sizeof(tmpbuf);
+            char* num = uitoa(arg, end, radix, spec->conversion == 'X' ? digits_upper : digits_lower);
+            SPUTSNPAD(num, end - num, width, pad_char);
             break;
         }
         case 'c': { // character (passed as int)
-            int arg = va_arg(arglist, int);
-            char argtmp[2] = { arg, 0 };
-            SPUTSPAD(argtmp, width, ' ');
+            char arg = va_arg(arglist, int);
+            SPUTSNPAD(&arg, 1, width, ' ');
             break;
         }
         case 's': { // string
             const char* arg = va_arg(arglist, const char*);
-            SPUTSPAD(arg, width, ' ');
+            SPUTSNPAD(arg, strlen(arg), width, ' ');
             break;
         }
         case 'n': { // write number of characters written
@@ -314,10 +507,8 @@ int vsnprintf(char* str, size_t strn, const char* format, va_list arglist) {
         }
 
     }
-    if(outremaining) {
-        SPUTC('\0');
-    } else {
-        str[strn-1] = '\0';
+    if(strn) {
+        str[outidx] = '\0';
     }
     return written;
 }
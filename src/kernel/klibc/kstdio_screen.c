@@ -4,11 +4,20 @@
  * @author Fabian Thorand
  * @date   03.06.2014
  *
- * @brief Backend for kstdio.h that writes directly to VGA memory.
+ * @brief Backend for kstdio.h that writes to VGA memory.
+ *
+ * Characters are written to a shadow buffer in RAM. Lines that have changed are
+ * marked dirty and copied to VGA memory in one batch by #screen_flush.
+ * Scrolling rotates the shadow buffer and moves the CRTC start address one line
+ * further into VGA memory instead of copying the screen contents. Only when the end
+ * of VGA memory is reached, the whole screen is copied back to the beginning.
  */
 
 #include "kernel/klibc/kstdio_screen.h"
 #include "kernel/klibc/kstdio.h"
+#include "kernel/klibc/ansi.h"
+#include "kernel/klibc/string.h"
+#include "kernel/cpu.h"
 
 /// current output cursor line
 uint32_t curline = 0;
@@ -18,11 +27,58 @@ uint32_t curcol = 0;
 /// current text color
 uint8_t screen_color = VGACOLOR(BLACK, WHITE);
 
+/// state of the escape sequence parser
+static ansi_parser_t screen_ansi;
+
 #define COLOR_STACK_SIZE 16
 static uint8_t color_stack[COLOR_STACK_SIZE];
 static int color_stack_index = COLOR_STACK_SIZE;
 
-kstdio_backend_t kstdio_screen_direct = {screen_kputchar, NULL, NULL};
+/// the shadow buffer, logical line \c y is stored in <tt>shadow[(shadow_top + y) % ROWS]</tt>
+static uint16_t shadow[ROWS][COLS];
+/// index of the first logical line in #shadow
+static uint32_t shadow_top = 0;
+/// bit \c y is set when logical line \c y differs from VGA memory
+static uint32_t shadow_dirty = 0;
+/// line in VGA memory that is displayed at the top of the screen
+static uint32_t vga_origin = 0;
+
+/// returns the shadow buffer line for the logical line \c y
+#define SHADOW_LINE(y) (shadow[(shadow_top + (y)) % ROWS])
+/// dirty mask where all lines are set
+#define SHADOW_ALL_DIRTY ((1u << ROWS) - 1)
+
+kstdio_backend_t kstdio_screen_direct = {screen_kputchar, screen_kputs, screen_kputsn};
+
+/**
+ * @brief Sets the CRTC start address to the beginning of line #vga_origin in VGA memory.
+ */
+static void screen_set_origin() {
+    uint16_t start = vga_origin * COLS;
+    cpu_outb(VGA_CRTC_INDEX, VGA_CRTC_START_HIGH);
+    cpu_outb(VGA_CRTC_DATA, start >> 8);
+    cpu_outb(VGA_CRTC_INDEX, VGA_CRTC_START_LOW);
+    cpu_outb(VGA_CRTC_DATA, start & 0xFF);
+}
+
+/**
+ * @brief Copies all dirty lines from the shadow buffer to VGA memory.
+ */
+void screen_flush() {
+    uint32_t dirty = shadow_dirty;
+    shadow_dirty = 0;
+    for(int y = 0; dirty; y++, dirty >>= 1) {
+        if(!(dirty & 1)) {
+            continue;
+        }
+        const uint64_t* src = (const uint64_t*) SHADOW_LINE(y);
+        volatile uint64_t* dest = (volatile uint64_t*) VGAPTR(0, vga_origin + y);
+        // VGA memory is uncached, write as few times as possible
+        for(unsigned int i = 0; i < COLS * sizeof(uint16_t) / sizeof(uint64_t); i++) {
+            dest[i] = src[i];
+        }
+    }
+}
 
 /**
  * @brief Saves the current screen color on a stack and sets the given colors.
@@ -55,81 +111,17 @@ int screen_pop_color() {
 
 
 /**
- * @brief Writes a character to the screen.
+ * @brief Writes a character to the shadow buffer.
  *
  * @param chr the character
  */
-void screen_kputchar(int chr) {
-    volatile uint16_t* dest = VGAPTR(curcol, curline);
-    static int in_escape = 0;
-    static int format_code = 0;
-
-    if(chr == '\x1b') {
-        in_escape = 1;
-        format_code = 0;
-    }
-    switch(in_escape) {
-    case 1:
-        if(chr == '[') {
-            in_escape = 2;
-        }
-        break;
-    case 2:
-        if(chr == 'm') {
-            // escape sequence finished
-            in_escape = 0;
-            switch(format_code) {
-            case 0:
-                screen_color = VGACOLOR(BLACK, WHITE); break;
-            case 30: // set foreground color to black
-                screen_color = VGASETFG(screen_color, BLACK); break;
-            case 31: // set foreground color to red
-                screen_color = VGASETFG(screen_color, RED); break;
-            case 32: // set foreground color to green
-                screen_color = VGASETFG(screen_color, GREEN); break;
-            case 33: // set foreground color to yellow
-                screen_color = VGASETFG(screen_color, YELLOW); break;
-            case 34: // set foreground color to blue
-                screen_color = VGASETFG(screen_color, BLUE); break;
-            case 35: // set foreground color to magenta (purple)
-                screen_color = VGASETFG(screen_color, MAGENTA); break;
-            case 36: // set foreground color to cyan
-                screen_color = VGASETFG(screen_color, CYAN); break;
-            case 37: // set foreground color to white
-            case 39: // set foreground color to default (white)
-                screen_color = VGASETFG(screen_color, WHITE); break;
-            case 40: // set foreground color to black
-                screen_color = VGASETBG(screen_color, BLACK); break;
-            case 41: // set foreground color to red
-                screen_color = VGASETBG(screen_color, RED); break;
-            case 42: // set foreground color to green
-                screen_color = VGASETBG(screen_color, GREEN); break;
-            case 43: // set foreground color to yellow
-                screen_color = VGASETBG(screen_color, YELLOW); break;
-            case 44: // set foreground color to blue
-                screen_color = VGASETBG(screen_color, BLUE); break;
-            case 45: // set foreground color to magenta (purple)
-                screen_color = VGASETBG(screen_color, MAGENTA); break;
-            case 46: // set foreground color to cyan
-                screen_color = VGASETBG(screen_color, CYAN); break;
-            case 47: // set foreground color to white
-            case 49: // set foreground color to default (white)
-                screen_color = VGASETBG(screen_color, WHITE); break;
-            }
-            return;
-        } else if(chr >= '0' && chr <= '9') {
-            format_code *= 10;
-            format_code += chr - '0';
-        } else {
-            in_escape = 0;
-        }
-    }
-
-    if(!in_escape) {
+static void screen_putchar_shadow(int chr) {
+    if(!ansi_parse(&screen_ansi, chr, &screen_color)) {
         if (chr == '\n') {
             curcol = COLS;
         } else {
-            *dest = (uint8_t) chr | (screen_color << 8);
+            SHADOW_LINE(curline)[curcol] = (uint8_t) chr | (screen_color << 8);
+            shadow_dirty |= 1u << curline;
             curcol++;
         }
         if (curcol == COLS) {
@@ -142,6 +134,70 @@ void screen_kputchar(int chr) {
     }
 }
 
+/**
+ * @brief Writes a character to the screen.
+ *
+ * @param chr the character
+ */
+void screen_kputchar(int chr) {
+    screen_putchar_shadow(chr);
+    screen_flush();
+}
+
+/**
+ * @brief Writes a null terminated string to the screen.
+ */
+void screen_kputs(const char* msg) {
+    while(*msg) {
+        screen_putchar_shadow(*msg++);
+    }
+    screen_flush();
+}
+
+/**
+ * @brief Writes \c length characters to the screen and updates VGA memory once.
+ */
+void screen_kputsn(const char* msg, size_t length) {
+    while(length--) {
+        screen_putchar_shadow(*msg++);
+    }
+    screen_flush();
+}
+
+/**
+ * @brief Replaces the whole screen contents.
+ *
+ * @param lines #ROWS lines of #COLS characters in VGA format
+ * @param col,line the new cursor position
+ * @param color the new text color
+ */
+void screen_load(const uint16_t* const lines[], uint32_t col, uint32_t line, uint8_t color) {
+    for(int y = 0; y < ROWS; y++) {
+        memcpy(SHADOW_LINE(y), lines[y], COLS * sizeof(uint16_t));
+    }
+    curcol = col;
+    curline = line;
+    screen_color = color;
+    shadow_dirty = SHADOW_ALL_DIRTY;
+    screen_flush();
+}
+
+/**
+ * @brief Copies the whole screen contents.
+ *
+ * @param lines receives #ROWS lines of #COLS characters in VGA format
+ * @param col,line receive the cursor position
+ * @param color receives the text color
+ */
+void screen_save(uint16_t* const lines[], uint32_t* col, uint32_t* line, uint8_t* color) {
+    for(int y = 0; y < ROWS; y++) {
+        memcpy(lines[y], SHADOW_LINE(y), COLS * sizeof(uint16_t));
+    }
+    *col = curcol;
+    *line = curline;
+    *color = screen_color;
+}
+
 /**
  * Clears the screen with the specified foreground and background color.
  * Sets \c color as the new default \c screen_color
@@ -150,26 +206,46 @@ void screen_kputchar(int chr) {
  * and the lower four bits specify foreground color.
  */
 void screen_clear(uint8_t color) {
-    volatile uint16_t* dest = VGAPTR(0, 0);
     screen_color = color;
     curcol = 0;
     curline = 0;
-    for (int i = 0; i < COLS * ROWS; i++) {
-        dest[i] = (color << 8) | ' ';
+    for (int y = 0; y < ROWS; y++) {
+        for (int x = 0; x < COLS; x++) {
+            shadow[y][x] = (color << 8) | ' ';
+        }
     }
+    shadow_top = 0;
+    vga_origin = 0;
+    screen_set_origin();
+    shadow_dirty = SHADOW_ALL_DIRTY;
+    screen_flush();
 }
 
 /**
- * Scrolls the VGA buffer up by one line and clears the last line with the current \c screen_color.
+ * Scrolls the screen up by one line and clears the last line with the current \c screen_color.
  * It also decreases the current cursor row by one.
+ *
+ * The new line is only written to the shadow buffer, VGA memory is updated by the next #screen_flush.
  */
 void screen_scroll() {
-    for (int i = COLS; i < COLS * ROWS; i++) {
-        ((uint16_t*) VGAMEM)[i - COLS] = ((uint16_t*) VGAMEM)[i];
+    // the old first line becomes the new last line
+    shadow_top = (shadow_top + 1) % ROWS;
+    uint16_t* last = SHADOW_LINE(ROWS - 1);
+    for (int x = 0; x < COLS; x++) {
+        last[x] = (screen_color << 8) | ' ';
     }
-    for (int i = COLS * (ROWS - 1); i < ROWS * COLS; i++) {
-        ((uint16_t*) VGAMEM)[i] = (screen_color << 8) | ' ';
+    shadow_dirty = (shadow_dirty >> 1) | (1u << (ROWS - 1));
+
+    if (vga_origin + ROWS < VGA_LINES) {
+        // let the CRTC display the next line of VGA memory at the top
+        vga_origin += 1;
+    } else {
+        // end of VGA memory reached, start over at the beginning
+        vga_origin = 0;
+        shadow_dirty = SHADOW_ALL_DIRTY;
     }
+    screen_set_origin();
+
     // adjust cursor position
     curline -= 1;
 }
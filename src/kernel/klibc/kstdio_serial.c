@@ -0,0 +1,389 @@
+/**
+ * @file kstdio_serial.c
+ *
+ * @author Fabian Thorand
+ * @date   19.10.2026
+ *
+ * @brief Backend for kstdio.h that writes to a 16550 compatible UART.
+ *
+ * Output is copied into a transmit ring and moved to the UART in bursts of
+ * #SERIAL_FIFO_SIZE bytes, so the line status register is read once per burst
+ * instead of once per character. Once #serial_enable_irq has been called, the
+ * bursts are written by #serial_interrupt whenever the transmit FIFO runs empty
+ * and writers return as soon as their text is in the ring.
+ *
+ * The backends are only called by the processor draining the log rings (see klog.h),
+ * so there is a single producer and the ring needs no lock. The panic handler may
+ * interrupt that producer or run next to it, so it calls #serial_set_direct first,
+ * which bypasses the ring and polls the line status register instead.
+ * Ownership of the transmitter is tracked by #serial_tx_busy: only its owner
+ * writes to the FIFO, and the interrupt handler gives it up when the ring is empty.
+ */
+
+#include "kernel/klibc/kstdio_serial.h"
+#include "kernel/klibc/kstdio.h"
+#include "kernel/klibc/string.h"
+#include "kernel/cpu.h"
+#include "kernel/log.h"
+#include "kernel/interrupts/int.h"
+#include "kernel/time/clock.h"
+
+#include <stdint.h>
+
+/// mask for calculating offsets into the ring
+#define SERIAL_RING_MASK (SERIAL_RING_SIZE - 1)
+/// number of bytes sent by each method of #serial_benchmark, without line feed translation
+#define SERIAL_BENCHMARK_BYTES 2048
+/// length of a line sent by #serial_benchmark, including the line feed
+#define SERIAL_BENCHMARK_LINE 64
+
+/// the transmit ring, positions are byte counters that never wrap around
+static char serial_ring[SERIAL_RING_SIZE];
+/// position where the next byte is written, only advanced by the producer
+static volatile uint64_t serial_head = 0;
+/// position of the next byte sent to the UART, only advanced by the transmitter owner
+static volatile uint64_t serial_tail = 0;
+/// non-zero while the transmitter is owned by the interrupt handler or a writer
+static volatile int serial_tx_busy = 0;
+/// non-zero, when transmission is interrupt driven
+static volatile int serial_irq_mode = 0;
+/// number of processors currently executing #serial_interrupt
+static volatile int serial_in_irq = 0;
+/// non-zero, when a UART was detected by #serial_init
+static int serial_present = 0;
+/// non-zero after #serial_set_direct, output bypasses the ring
+static volatile int serial_direct = 0;
+
+kstdio_backend_t kstdio_serial = {serial_kputchar, serial_kputs, serial_kputsn};
+
+/**
+ * @brief Moves up to #SERIAL_FIFO_SIZE bytes from the ring to the transmit FIFO.
+ *
+ * The caller must own the transmitter and the FIFO must be empty.
+ * @return the number of bytes written.
+ */
+static unsigned int serial_fill_fifo() {
+    uint64_t tail = serial_tail;
+    uint64_t count = serial_head - tail;
+    if(count > SERIAL_FIFO_SIZE) {
+        count = SERIAL_FIFO_SIZE;
+    }
+    for(uint64_t i = 0; i < count; i++) {
+        cpu_outb(SERIAL_COM1 + SERIAL_REG_DATA, serial_ring[(tail + i) & SERIAL_RING_MASK]);
+    }
+    serial_tail = tail + count;
+    return count;
+}
+
+/**
+ * @brief Transmits the contents of the ring by polling the line status register once per burst.
+ */
+static void serial_poll_transmit() {
+    while(serial_tail != serial_head) {
+        while(!(cpu_inb(SERIAL_COM1 + SERIAL_REG_LSR) & SERIAL_LSR_THRE)) {
+            asm volatile("pause");
+        }
+        serial_fill_fifo();
+    }
+}
+
+/**
+ * @brief Starts transmission of the ring contents unless the transmitter is already running.
+ */
+static void serial_kick() {
+    if(serial_direct) {
+        // the ring is abandoned
+        return;
+    }
+    if(!__sync_bool_compare_and_swap(&serial_tx_busy, 0, 1)) {
+        // the interrupt handler is sending, it will pick up the new data
+        return;
+    }
+    if(!serial_irq_mode) {
+        serial_poll_transmit();
+        __sync_lock_release(&serial_tx_busy);
+        return;
+    }
+    // send the first burst now and let the interrupt handler send the rest
+    if(cpu_inb(SERIAL_COM1 + SERIAL_REG_LSR) & SERIAL_LSR_THRE) {
+        serial_fill_fifo();
+    }
+    cpu_outb(SERIAL_COM1 + SERIAL_REG_IER, SERIAL_IER_THRE);
+}
+
+/**
+ * @brief Waits until the transmitter has removed at least one burst from the full ring.
+ */
+static void serial_make_space() {
+    serial_kick();
+    if(!serial_irq_mode) {
+        // polled transmission has emptied the ring
+        return;
+    }
+    if(int_enabled()) {
+        asm volatile("pause");
+        return;
+    }
+    // the interrupt handler might be unable to run on this processor,
+    // so mask the UART interrupt and send one burst by polling
+    cpu_outb(SERIAL_COM1 + SERIAL_REG_IER, 0);
+    while(serial_in_irq) {
+        asm volatile("pause");
+    }
+    while(!(cpu_inb(SERIAL_COM1 + SERIAL_REG_LSR) & SERIAL_LSR_THRE)) {
+        asm volatile("pause");
+    }
+    serial_fill_fifo();
+    if(serial_tx_busy) {
+        cpu_outb(SERIAL_COM1 + SERIAL_REG_IER, SERIAL_IER_THRE);
+    }
+}
+
+/**
+ * @brief Appends \c length bytes to the ring, waiting for space when it is full.
+ */
+static void serial_enqueue(const char* msg, size_t length) {
+    while(length > 0) {
+        uint64_t head = serial_head;
+        uint64_t space = SERIAL_RING_SIZE - (head - serial_tail);
+        if(space == 0) {
+            serial_make_space();
+            continue;
+        }
+        // copy up to the end of the ring or the available space
+        uint64_t offset = head & SERIAL_RING_MASK;
+        uint64_t chunk = SERIAL_RING_SIZE - offset;
+        if(chunk > space) {
+            chunk = space;
+        }
+        if(chunk > length) {
+            chunk = length;
+        }
+        memcpy(serial_ring + offset, msg, chunk);
+        // publish the bytes
+        __sync_synchronize();
+        serial_head = head + chunk;
+        msg += chunk;
+        length -= chunk;
+    }
+}
+
+/**
+ * @brief Writes \c length bytes to the UART, bypassing the ring.
+ */
+static void serial_write_direct(const char* msg, size_t length) {
+    for(size_t i = 0; i < length; i++) {
+        if(i % SERIAL_FIFO_SIZE == 0) {
+            while(!(cpu_inb(SERIAL_COM1 + SERIAL_REG_LSR) & SERIAL_LSR_THRE)) {
+                asm volatile("pause");
+            }
+        }
+        cpu_outb(SERIAL_COM1 + SERIAL_REG_DATA, msg[i]);
+    }
+}
+
+/**
+ * @brief Writes \c length bytes to the ring, or to the UART after #serial_set_direct.
+ */
+static void serial_write(const char* msg, size_t length) {
+    if(serial_direct) {
+        serial_write_direct(msg, length);
+    } else {
+        serial_enqueue(msg, length);
+    }
+}
+
+/**
+ * @brief Initializes COM1 for output with #SERIAL_BAUD baud.
+ *
+ * @return zero on success, -1 if no UART was detected.
+ */
+int serial_init() {
+    uint16_t divisor = 115200 / SERIAL_BAUD;
+    cpu_outb(SERIAL_COM1 + SERIAL_REG_IER, 0);
+    cpu_outb(SERIAL_COM1 + SERIAL_REG_LCR, SERIAL_LCR_DLAB);
+    cpu_outb(SERIAL_COM1 + SERIAL_REG_DLL, divisor & 0xFF);
+    cpu_outb(SERIAL_COM1 + SERIAL_REG_DLM, divisor >> 8);
+    cpu_outb(SERIAL_COM1 + SERIAL_REG_LCR, SERIAL_LCR_8N1);
+    cpu_outb(SERIAL_COM1 + SERIAL_REG_FCR, SERIAL_FCR_ENABLE);
+
+    // check that a UART is present by sending a byte in loopback mode
+    cpu_outb(SERIAL_COM1 + SERIAL_REG_MCR, SERIAL_MCR_LOOPBACK);
+    cpu_outb(SERIAL_COM1 + SERIAL_REG_DATA, 0xAE);
+    if(cpu_inb(SERIAL_COM1 + SERIAL_REG_DATA) != 0xAE) {
+        return -1;
+    }
+    cpu_outb(SERIAL_COM1 + SERIAL_REG_MCR, SERIAL_MCR_DEFAULT);
+    serial_present = 1;
+    return 0;
+}
+
+/**
+ * @brief Switches from polled to interrupt driven transmission.
+ *
+ * Must be called after the interrupt handler #serial_interrupt
+ * has been installed for #SERIAL_COM1_IRQ.
+ */
+void serial_enable_irq() {
+    if(serial_present) {
+        serial_irq_mode = 1;
+    }
+}
+
+/**
+ * @brief Stops using the ring and writes all further output directly to the UART.
+ *
+ * Used by the panic handler, which may have interrupted a writer. Text still in the ring
+ * is sent first, the ring itself is left untouched. Bytes another processor is sending
+ * at the same time may appear twice.
+ */
+void serial_set_direct() {
+    serial_direct = 1;
+    if(!serial_present) {
+        return;
+    }
+    cpu_outb(SERIAL_COM1 + SERIAL_REG_IER, 0);
+    __sync_synchronize();
+    uint64_t tail = serial_tail;
+    uint64_t head = serial_head;
+    // the ring may have been refilled after tail was read
+    if(head - tail > SERIAL_RING_SIZE) {
+        tail = head - SERIAL_RING_SIZE;
+    }
+    while(tail != head) {
+        uint64_t offset = tail & SERIAL_RING_MASK;
+        uint64_t chunk = SERIAL_RING_SIZE - offset;
+        if(chunk > head - tail) {
+            chunk = head - tail;
+        }
+        serial_write_direct(serial_ring + offset, chunk);
+        tail += chunk;
+    }
+}
+
+/**
+ * @brief Interrupt handler of the UART, refills the transmit FIFO from the ring.
+ */
+void serial_interrupt() {
+    __sync_fetch_and_add(&serial_in_irq, 1);
+    uint8_t iir;
+    while(!((iir = cpu_inb(SERIAL_COM1 + SERIAL_REG_IIR)) & SERIAL_IIR_NONE)) {
+        if((iir & SERIAL_IIR_ID_MASK) != SERIAL_IIR_THRE) {
+            // nothing else is enabled, reading the status clears other causes
+            cpu_inb(SERIAL_COM1 + SERIAL_REG_LSR);
+            continue;
+        }
+        if(serial_fill_fifo()) {
+            continue;
+        }
+        // the ring is empty, give up the transmitter
+        cpu_outb(SERIAL_COM1 + SERIAL_REG_IER, 0);
+        __sync_lock_release(&serial_tx_busy);
+        // a writer may have appended data after the ring was found empty
+        __sync_synchronize();
+        if(serial_tail != serial_head) {
+            serial_kick();
+        }
+        break;
+    }
+    __sync_fetch_and_sub(&serial_in_irq, 1);
+}
+
+/**
+ * @brief Writes a character to the serial port.
+ */
+void serial_kputchar(int chr) {
+    char c = (char) chr;
+    serial_kputsn(&c, 1);
+}
+
+/**
+ * @brief Writes a null terminated string to the serial port.
+ */
+void serial_kputs(const char* msg) {
+    serial_kputsn(msg, strlen(msg));
+}
+
+/**
+ * @brief Writes \c length characters to the serial port.
+ *
+ * Line feeds are translated to CR LF for terminals on the other side.
+ */
+void serial_kputsn(const char* msg, size_t length) {
+    if(!serial_present) {
+        return;
+    }
+    const char* end = msg + length;
+    while(msg < end) {
+        const char* lf = memchr(msg, '\n', end - msg);
+        if(!lf) {
+            serial_write(msg, end - msg);
+            break;
+        }
+        serial_write(msg, lf - msg);
+        serial_write("\r\n", 2);
+        msg = lf + 1;
+    }
+    serial_kick();
+}
+
+/**
+ * @brief Converts TSC cycles to microseconds.
+ */
+static uint64_t serial_us(uint64_t cycles) {
+    return clock_tsc_to_ns(cycles) / CLOCK_NS_PER_US;
+}
+
+/**
+ * @brief Waits until the ring is empty and the transmitter is idle.
+ */
+static void serial_wait_idle() {
+    while(serial_tail != serial_head || serial_tx_busy) {
+        asm volatile("pause");
+    }
+}
+
+/**
+ * @brief Compares sending text through the ring with polling the line status before every byte,
+ * which is how characters were written before the ring existed, and logs the result.
+ *
+ * Both methods send the same lines to the serial port. Must be called with interrupts enabled.
+ */
+void serial_benchmark() {
+    if(!serial_present) {
+        return;
+    }
+    static char text[SERIAL_BENCHMARK_BYTES];
+    for(int i = 0; i < SERIAL_BENCHMARK_BYTES; i++) {
+        text[i] = (i % SERIAL_BENCHMARK_LINE == SERIAL_BENCHMARK_LINE - 1) ? '\n' : 'a' + i % 26;
+    }
+
+    serial_wait_idle();
+    while(!__sync_bool_compare_and_swap(&serial_tx_busy, 0, 1)) {
+        asm volatile("pause");
+    }
+    uint64_t start = cpu_rdtsc();
+    for(int i = 0; i < SERIAL_BENCHMARK_BYTES; i++) {
+        // line feeds become CR LF like in serial_kputsn
+        for(int cr = text[i] == '\n'; cr >= 0; cr--) {
+            while(!(cpu_inb(SERIAL_COM1 + SERIAL_REG_LSR) & SERIAL_LSR_THRE)) {
+                asm volatile("pause");
+            }
+            cpu_outb(SERIAL_COM1 + SERIAL_REG_DATA, cr ? '\r' : text[i]);
+        }
+    }
+    uint64_t polled = cpu_rdtsc() - start;
+    __sync_lock_release(&serial_tx_busy);
+
+    serial_wait_idle();
+    start = cpu_rdtsc();
+    serial_kputsn(text, SERIAL_BENCHMARK_BYTES);
+    uint64_t returned = cpu_rdtsc() - start;
+    serial_wait_idle();
+    uint64_t ring = cpu_rdtsc() - start;
+
+    LOG_INFO(LOG_CAT_DEV, "serial: %u bytes polled per byte %lu us, through the ring %lu us "
+            "(writer returned after %lu us, %s), line rate %u bytes/s\n",
+            SERIAL_BENCHMARK_BYTES, serial_us(polled), serial_us(ring), serial_us(returned),
+            serial_irq_mode ? "interrupt driven" : "polled", SERIAL_BAUD / 10);
+}
@@ -5,80 +5,325 @@
  * @date   May 13, 2014
  *
  * @brief This module implements a few important string functions from the C standard.
+ *
+ * The string scanning functions work on one machine word at a time. Words are only
+ * read from aligned addresses, so a read never crosses a page boundary even if
+ * it extends past the end of the string.
+ *
+ * The block functions use \c rep \c movsq and \c rep \c stosq, which run at memory
+ * bandwidth on processors with fast string operations. Their start-up costs more than
+ * a short loop, so blocks below #REP_THRESHOLD bytes are copied one word at a time.
+ * \c tools/string-bench.c compares the functions with the host C library.
+ *
+ * When \c KLIBC_SSE2 is defined, #strlen, #strnlen and #memchr scan 16 bytes at a time
+ * using \c pcmpeqb. The SSE2 paths clobber \c xmm0 and \c xmm1, so they must not be used
+ * from interrupt handlers unless the interrupt entry code preserves the SSE state.
  */
 #include "kernel/klibc/string.h"
 
 #include <stdint.h>
 #include <stddef.h>
 
+/// machine word used for word-at-a-time operations
+typedef unsigned long __attribute__((__may_alias__)) word_t;
+/// machine word for unaligned stores
+typedef unsigned long __attribute__((__may_alias__, __aligned__(1))) uword_t;
+
+#define WORD_SIZE sizeof(word_t)
+#define WORD_MASK (WORD_SIZE - 1)
+/// 0x01 in every byte
+#define WORD_ONES  0x0101010101010101UL
+/// 0x80 in every byte
+#define WORD_HIGHS 0x8080808080808080UL
+/// non-zero iff one of the bytes in \c w is zero
+#define WORD_HAS_ZERO(w) (((w) - WORD_ONES) & ~(w) & WORD_HIGHS)
+/// checks whether \c ptr is word aligned
+#define WORD_ALIGNED(ptr) (((uintptr_t)(ptr) & WORD_MASK) == 0)
+/// blocks of at least this many bytes are handled by \c rep string instructions
+#define REP_THRESHOLD 128
+
+#ifdef KLIBC_SSE2
+
+/**
+ * @brief Compares the 16 byte aligned block at \c block with 16 copies of \c chr.
+ * @return A bit mask where bit \c i is set if byte \c i equals \c chr.
+ */
+static inline unsigned int sse2_match16(const void* block, unsigned char chr) {
+    unsigned int mask;
+    uint64_t pattern = WORD_ONES * chr;
+    asm volatile (
+            "movq %2, %%xmm0\n"
+            "punpcklqdq %%xmm0, %%xmm0\n"
+            "movdqa %1, %%xmm1\n"
+            "pcmpeqb %%xmm1, %%xmm0\n"
+            "pmovmskb %%xmm0, %0\n"
+            : "=r"(mask)
+            : "m"(*(const char(*)[16])block), "r"(pattern)
+            : "xmm0", "xmm1");
+    return mask;
+}
+
+/**
+ * @brief Searches \c chr in at most \c num bytes starting at \c ptr, 16 bytes at a time.
+ * @return the offset of the first match or \c num if there is none.
+ */
+static size_t sse2_find(const char* ptr, unsigned char chr, size_t num) {
+    const char* block = (const char*)((uintptr_t)ptr & ~(uintptr_t)15);
+    size_t skip = ptr - block;
+    // ignore matches in front of ptr
+    unsigned int mask = sse2_match16(block, chr) >> skip << skip;
+    size_t offset = 0;
+    while(1) {
+        if(mask) {
+            offset = (block - ptr) + __builtin_ctz(mask);
+            return offset < num ? offset : num;
+        }
+        block += 16;
+        if((size_t)(block - ptr) >= num) {
+            return num;
+        }
+        mask = sse2_match16(block, chr);
+    }
+}
+
+#endif
+
 void* memset(void* ptr, int value, size_t num) {
-    unsigned char* data = (unsigned char*) ptr;
-    for (size_t i = 0; i < num; i++) {
-        data[i] = (unsigned char) value;
+    word_t pattern = WORD_ONES * (unsigned char) value;
+    if(num < REP_THRESHOLD) {
+        char* d = (char*) ptr;
+        for(; num >= WORD_SIZE; num -= WORD_SIZE, d += WORD_SIZE) {
+            *(uword_t*)d = pattern;
+        }
+        while(num--) {
+            *d++ = (char) value;
+        }
+        return ptr;
     }
+    void* dst = ptr;
+    size_t words = num / WORD_SIZE;
+    size_t bytes = num & WORD_MASK;
+    asm volatile (
+            "rep stosq\n"
+            "mov %3, %%rcx\n"
+            "rep stosb\n"
+            : "+D"(dst), "+c"(words)
+            : "a"(pattern), "r"(bytes)
+            : "memory");
     return ptr;
 }
 
 void* memcpy(void* destination, const void* source, size_t num) {
-    if(destination == source) {
+    if(num < REP_THRESHOLD) {
+        char* d = (char*) destination;
+        const char* s = (const char*) source;
+        for(; num >= WORD_SIZE; num -= WORD_SIZE, d += WORD_SIZE, s += WORD_SIZE) {
+            *(uword_t*)d = *(const uword_t*)s;
+        }
+        while(num--) {
+            *d++ = *s++;
+        }
         return destination;
     }
-    char* dstptr = (char*) destination;
-    char* srcptr = (char*) source;
-    for(size_t i = 0; i < num; i++) {
-        dstptr[i] = srcptr[i];
-    }
+    void* dst = destination;
+    const void* src = source;
+    size_t words = num / WORD_SIZE;
+    size_t bytes = num & WORD_MASK;
+    asm volatile (
+            "rep movsq\n"
+            "mov %3, %%rcx\n"
+            "rep movsb\n"
+            : "+D"(dst), "+S"(src), "+c"(words)
+            : "r"(bytes)
+            : "memory");
     return destination;
 }
 
 void* memmove(void* destination, const void* source, size_t num) {
-    if(source < destination) {
-        char* dstptr = (char*) destination;
-        char* srcptr = (char*) source;
-        while(num--) {
-            dstptr[num] = srcptr[num];
-        }
-        return destination;
-    } else if (source > destination) {
+    if(destination <= source || (const char*) destination >= (const char*) source + num) {
+        // copying forwards does not overwrite unread bytes
         return memcpy(destination, source, num);
-    } else {
-        return destination;
     }
+    // copy backwards, first the bytes behind the last whole word, then the words
+    char* dst = (char*) destination + num - 1;
+    const char* src = (const char*) source + num - 1;
+    size_t bytes = num & WORD_MASK;
+    size_t words = num / WORD_SIZE;
+    asm volatile (
+            "std\n"
+            "rep movsb\n"
+            "sub $7, %%rdi\n"
+            "sub $7, %%rsi\n"
+            "mov %3, %%rcx\n"
+            "rep movsq\n"
+            "cld\n"
+            : "+D"(dst), "+S"(src), "+c"(bytes)
+            : "r"(words)
+            : "memory");
+    return destination;
+}
+
+void* memchr(const void* ptr, int value, size_t num) {
+    const unsigned char* s = (const unsigned char*) ptr;
+    unsigned char chr = (unsigned char) value;
+#ifdef KLIBC_SSE2
+    size_t offset = num ? sse2_find((const char*)s, chr, num) : 0;
+    return offset < num ? (void*)(s + offset) : NULL;
+#else
+    // byte-wise until word aligned
+    while(num && !WORD_ALIGNED(s)) {
+        if(*s == chr) {
+            return (void*) s;
+        }
+        s++, num--;
+    }
+    // word-wise, XOR turns matching bytes into zero bytes
+    word_t pattern = WORD_ONES * chr;
+    const word_t* w = (const word_t*) s;
+    while(num >= WORD_SIZE && !WORD_HAS_ZERO(*w ^ pattern)) {
+        w++;
+        num -= WORD_SIZE;
+    }
+    // remaining bytes
+    s = (const unsigned char*) w;
+    while(num--) {
+        if(*s == chr) {
+            return (void*) s;
+        }
+        s++;
+    }
+    return NULL;
+#endif
+}
+
+int memcmp(const void* ptr1, const void* ptr2, size_t num) {
+    const unsigned char* s1 = (const unsigned char*) ptr1;
+    const unsigned char* s2 = (const unsigned char*) ptr2;
+    if(((uintptr_t)s1 & WORD_MASK) == ((uintptr_t)s2 & WORD_MASK)) {
+        while(num && !WORD_ALIGNED(s1)) {
+            if(*s1 != *s2) {
+                return *s1 - *s2;
+            }
+            s1++, s2++, num--;
+        }
+        // skip equal words, the differing byte is found below
+        while(num >= WORD_SIZE && *(const word_t*)s1 == *(const word_t*)s2) {
+            s1 += WORD_SIZE;
+            s2 += WORD_SIZE;
+            num -= WORD_SIZE;
+        }
+    }
+    while(num--) {
+        if(*s1 != *s2) {
+            return *s1 - *s2;
+        }
+        s1++, s2++;
+    }
+    return 0;
 }
 
 char* strcpy(char* destination, const char* source) {
-    char* olddst = destination;
-    while(*source) {
-        *destination = *source;
-        destination++;
-        source++;
+    char* dst = destination;
+    // byte-wise until the source is word aligned
+    while(!WORD_ALIGNED(source)) {
+        if(!(*dst++ = *source++)) {
+            return destination;
+        }
     }
-    return olddst;
+    // copy whole words as long as they do not contain the terminator
+    const word_t* src = (const word_t*) source;
+    while(!WORD_HAS_ZERO(*src)) {
+        *(uword_t*)dst = *src++;
+        dst += WORD_SIZE;
+    }
+    // copy the last bytes including the terminator
+    source = (const char*) src;
+    while((*dst++ = *source++));
+    return destination;
 }
 
 char* strcat(char* destination, const char* source) {
-    char* dst = destination;
-    while(*dst) dst++;
-    strcpy(dst, source);
+    strcpy(destination + strlen(destination), source);
     return destination;
 }
 
 int strcmp(const char* str1, const char* str2) {
+    if(((uintptr_t)str1 & WORD_MASK) == ((uintptr_t)str2 & WORD_MASK)) {
+        while(!WORD_ALIGNED(str1)) {
+            if(!*str1 || *str1 != *str2) {
+                goto bytewise;
+            }
+            str1++, str2++;
+        }
+        // skip equal words without terminator
+        const word_t* w1 = (const word_t*) str1;
+        const word_t* w2 = (const word_t*) str2;
+        while(*w1 == *w2 && !WORD_HAS_ZERO(*w1)) {
+            w1++, w2++;
+        }
+        str1 = (const char*) w1;
+        str2 = (const char*) w2;
+    }
+bytewise:
     while (*str1 && (*str1 == *str2))
         str1++, str2++;
     return *(const unsigned char*) str1 - *(const unsigned char*) str2;
 }
 
 int strncmp(const char* s1, const char* s2, size_t n) {
-    while (n--)
-        if (*s1++ != *s2++)
-            return *(unsigned char*) (s1 - 1) - *(unsigned char*) (s2 - 1);
+    if(((uintptr_t)s1 & WORD_MASK) == ((uintptr_t)s2 & WORD_MASK)) {
+        while(n && !WORD_ALIGNED(s1)) {
+            if(!*s1 || *s1 != *s2) {
+                goto bytewise;
+            }
+            s1++, s2++, n--;
+        }
+        // skip equal words without terminator
+        const word_t* w1 = (const word_t*) s1;
+        const word_t* w2 = (const word_t*) s2;
+        while(n >= WORD_SIZE && *w1 == *w2 && !WORD_HAS_ZERO(*w1)) {
+            w1++, w2++;
+            n -= WORD_SIZE;
+        }
+        s1 = (const char*) w1;
+        s2 = (const char*) w2;
+    }
+bytewise:
+    while (n--) {
+        if (*s1 != *s2)
+            return *(const unsigned char*) s1 - *(const unsigned char*) s2;
+        if (!*s1)
+            return 0;
+        s1++, s2++;
+    }
     return 0;
 }
 
 size_t strlen(const char* str) {
-    size_t len = 0;
-    while (*str++)
-        len++;
-    return len;
+#ifdef KLIBC_SSE2
+    return sse2_find(str, 0, SIZE_MAX);
+#else
+    const char* s = str;
+    while (!WORD_ALIGNED(s)) {
+        if (!*s)
+            return s - str;
+        s++;
+    }
+    const word_t* w = (const word_t*) s;
+    while (!WORD_HAS_ZERO(*w))
+        w++;
+    s = (const char*) w;
+    while (*s)
+        s++;
+    return s - str;
+#endif
+}
+
+size_t strnlen(const char* str, size_t maxlen) {
+#ifdef KLIBC_SSE2
+    return maxlen ? sse2_find(str, 0, maxlen) : 0;
+#else
+    const char* end = memchr(str, 0, maxlen);
+    return end ? (size_t)(end - str) : maxlen;
+#endif
 }
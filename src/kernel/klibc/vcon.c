@@ -0,0 +1,228 @@
+/**
+ * @file vcon.c
+ *
+ * @author Fabian Thorand
+ * @date   19.10.2026
+ *
+ * @brief Virtual consoles on top of the screen backends.
+ *
+ * A console is a ring of #VCON_LINES lines with the width of the display. Lines are
+ * numbered from the start of the console, line \c n is stored at index
+ * <tt>n % VCON_LINES</tt>. The visible page ends with the cursor line, like on the
+ * display itself.
+ *
+ * The active console forwards its output to the display backend unchanged. Both apply
+ * the same line wrapping and escape sequences, so the display always shows the same
+ * page as the ring. A background console only updates its ring. #vcon_switch passes
+ * the visible page of the new console to the display, which copies one screen of
+ * characters and redraws only what changed.
+ */
+
+#include "kernel/klibc/vcon.h"
+#include "kernel/klibc/kstdio_screen.h"
+#include "kernel/klibc/kstdio_fbcon.h"
+#include "kernel/klibc/string.h"
+#include "kernel/mem/pfa.h"
+#include "kernel/mem/vmm.h"
+#include "kernel/helium.h"
+
+#include <stdint.h>
+
+/// the virtual consoles
+static vcon_t vcons[VCON_COUNT];
+/// the display
+static vcon_display_t vcon_display;
+/// a line of blanks shown below the cursor line of a new console
+static uint16_t* vcon_blank;
+/// index of the console shown on the display
+static unsigned int vcon_current = 0;
+/// number of lines the view of the active console is scrolled back
+static uint64_t vcon_view_offset = 0;
+
+/// returns the storage of line \c n of console \c con
+#define VCON_LINE(con,n) ((con)->cells + ((n) % VCON_LINES) * vcon_display.cols)
+
+/**
+ * @brief Defines the kstdio functions of console \c n.
+ */
+#define VCON_DEFINE_BACKEND(n) \
+    static void vcon##n##_kputchar(int chr) { char c = chr; vcon_write(n, &c, 1); } \
+    static void vcon##n##_kputs(const char* msg) { vcon_write(n, msg, strlen(msg)); } \
+    static void vcon##n##_kputsn(const char* msg, size_t length) { vcon_write(n, msg, length); }
+
+// the backends below are spelled out for each console
+_Static_assert(VCON_COUNT == 4, "define a backend for each virtual console");
+
+VCON_DEFINE_BACKEND(0)
+VCON_DEFINE_BACKEND(1)
+VCON_DEFINE_BACKEND(2)
+VCON_DEFINE_BACKEND(3)
+
+#define VCON_BACKEND(n) { vcon##n##_kputchar, vcon##n##_kputs, vcon##n##_kputsn }
+
+kstdio_backend_t vcon_backends[VCON_COUNT] = {
+    VCON_BACKEND(0), VCON_BACKEND(1), VCON_BACKEND(2), VCON_BACKEND(3)
+};
+
+/**
+ * @brief Fills \c count characters at \c cells with blanks in \c color.
+ */
+static void vcon_fill(uint16_t* cells, uint32_t count, uint8_t color) {
+    for(uint32_t i = 0; i < count; i++) {
+        cells[i] = (color << 8) | ' ';
+    }
+}
+
+/**
+ * @brief Allocates the scrollback buffers and uses the framebuffer console as display
+ * if it is enabled, otherwise the VGA text screen. Console 0 is active afterwards and
+ * holds the current display contents.
+ *
+ * Must be called after #pfa_init.
+ * @return zero on success, -1 if there is not enough memory.
+ */
+int vcon_init() {
+    if(fbcon_enabled()) {
+        vcon_display.backend = &kstdio_fbcon;
+        fbcon_get_size(&vcon_display.cols, &vcon_display.rows);
+        vcon_display.load = fbcon_load;
+        vcon_display.save = fbcon_save;
+    } else {
+        vcon_display.backend = &kstdio_screen_direct;
+        vcon_display.cols = COLS;
+        vcon_display.rows = ROWS;
+        vcon_display.load = screen_load;
+        vcon_display.save = screen_save;
+    }
+
+    // one ring per console and a blank line
+    size_t ring_size = VCON_LINES * vcon_display.cols * sizeof(uint16_t);
+    size_t size = VCON_COUNT * ring_size + vcon_display.cols * sizeof(uint16_t);
+    uintptr_t paddr = pfa_alloc_block((size + HE_PAGE_SIZE - 1) / HE_PAGE_SIZE, 0);
+    if(!paddr) {
+        return -1;
+    }
+    uint8_t* mem = (uint8_t*) (VMM_PHYS4G_BASE + paddr);
+    for(int i = 0; i < VCON_COUNT; i++) {
+        vcon_t* con = &vcons[i];
+        con->cells = (uint16_t*) (mem + i * ring_size);
+        con->line = 0;
+        con->col = 0;
+        con->color = ANSI_DEFAULT_COLOR;
+        memset(&con->ansi, 0, sizeof(con->ansi));
+        vcon_fill(con->cells, VCON_LINES * vcon_display.cols, ANSI_DEFAULT_COLOR);
+    }
+    vcon_blank = (uint16_t*) (mem + VCON_COUNT * ring_size);
+    vcon_fill(vcon_blank, vcon_display.cols, ANSI_DEFAULT_COLOR);
+    // console 0 starts with the output written before, so switching back keeps it
+    vcon_t* con = &vcons[0];
+    uint16_t* lines[vcon_display.rows];
+    for(uint32_t y = 0; y < vcon_display.rows; y++) {
+        lines[y] = VCON_LINE(con, y);
+    }
+    uint32_t line;
+    vcon_display.save(lines, &con->col, &line, &con->color);
+    con->line = line;
+    vcon_current = 0;
+    vcon_view_offset = 0;
+    return 0;
+}
+
+/**
+ * @brief Writes a character to the ring of a console.
+ */
+static void vcon_putchar(vcon_t* con, int chr) {
+    if(ansi_parse(&con->ansi, chr, &con->color)) {
+        return;
+    }
+    if(chr == '\n') {
+        con->col = vcon_display.cols;
+    } else {
+        VCON_LINE(con, con->line)[con->col] = (uint8_t) chr | (con->color << 8);
+        con->col++;
+    }
+    if(con->col == vcon_display.cols) {
+        con->col = 0;
+        con->line++;
+        // the new line replaces the oldest one
+        vcon_fill(VCON_LINE(con, con->line), vcon_display.cols, con->color);
+    }
+}
+
+/**
+ * @brief Writes \c length characters to a virtual console.
+ *
+ * Writes to the same console must not happen concurrently.
+ */
+void vcon_write(unsigned int index, const char* msg, size_t length) {
+    if(index >= VCON_COUNT || !vcons[index].cells) {
+        return;
+    }
+    vcon_t* con = &vcons[index];
+    for(size_t i = 0; i < length; i++) {
+        vcon_putchar(con, msg[i]);
+    }
+    if(index == vcon_current && vcon_view_offset == 0) {
+        vcon_display.backend->kputsn(msg, length);
+    }
+}
+
+/**
+ * @brief Passes the page of console \c con ending \c offset lines above the cursor line to the display.
+ */
+static void vcon_show(vcon_t* con, uint64_t offset) {
+    const uint16_t* lines[vcon_display.rows];
+    uint64_t rows = vcon_display.rows;
+    // the page starts at line 0 until the console has more lines than the display
+    uint64_t top = con->line >= rows ? con->line - rows + 1 - offset : 0;
+    for(uint64_t y = 0; y < rows; y++) {
+        lines[y] = top + y <= con->line ? VCON_LINE(con, top + y) : vcon_blank;
+    }
+    uint32_t cursor = offset ? rows - 1 : con->line - top;
+    vcon_display.load(lines, con->col, cursor, con->color);
+}
+
+/**
+ * @brief Shows the virtual console \c index on the display.
+ */
+void vcon_switch(unsigned int index) {
+    if(index >= VCON_COUNT || !vcons[index].cells) {
+        return;
+    }
+    vcon_current = index;
+    vcon_view_offset = 0;
+    vcon_show(&vcons[index], 0);
+}
+
+/**
+ * @brief Returns the index of the console shown on the display.
+ */
+unsigned int vcon_active() {
+    return vcon_current;
+}
+
+/**
+ * @brief Scrolls the view of the active console back into its history.
+ *
+ * @param lines number of lines to scroll back, negative values scroll forward.
+ * The view returns to the live output when it reaches the cursor line.
+ */
+void vcon_scroll_view(int lines) {
+    vcon_t* con = &vcons[vcon_current];
+    if(!con->cells) {
+        return;
+    }
+    // lines still in the ring above the first visible line
+    uint64_t rows = vcon_display.rows;
+    uint64_t kept = con->line < VCON_LINES ? con->line + 1 : VCON_LINES;
+    uint64_t max_offset = kept > rows ? kept - rows : 0;
+    int64_t offset = (int64_t) vcon_view_offset + lines;
+    if(offset < 0) {
+        offset = 0;
+    }
+    if((uint64_t) offset > max_offset) {
+        offset = max_offset;
+    }
+    vcon_view_offset = offset;
+    vcon_show(con, vcon_view_offset);
+}
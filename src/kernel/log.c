@@ -0,0 +1,75 @@
+/**
+ * @file log.c
+ *
+ * @author Fabian Thorand
+ * @date   19.10.2026
+ *
+ * @brief Kernel logging with per-subsystem categories and levels.
+ */
+
+#include "kernel/log.h"
+
+#include "kernel/klibc/kstdio.h"
+#include "kernel/klibc/string.h"
+
+#include <stdarg.h>
+
+/// runtime level of each category, messages above it are discarded
+uint8_t log_levels[LOG_CAT_COUNT] = {
+    [0 ... LOG_CAT_COUNT - 1] = HE_LOG_LEVEL
+};
+
+/// prefixes of the categories
+static const char* log_category_names[LOG_CAT_COUNT] = {
+    [LOG_CAT_CORE]  = "core",
+    [LOG_CAT_MEM]   = "mem",
+    [LOG_CAT_INT]   = "int",
+    [LOG_CAT_TIME]  = "time",
+    [LOG_CAT_SMP]   = "smp",
+    [LOG_CAT_SCHED] = "sched",
+    [LOG_CAT_DEV]   = "dev",
+};
+
+/// ANSI color escape of each level
+static const char* log_level_colors[LOG_LEVELS] = {
+    [LOG_LEVEL_ERROR] = "\x1b[31m",
+    [LOG_LEVEL_WARN]  = "\x1b[33m",
+    [LOG_LEVEL_INFO]  = "\x1b[0m",
+    [LOG_LEVEL_DEBUG] = "\x1b[36m",
+};
+
+/// escape sequence restoring the default color
+#define LOG_COLOR_RESET "\x1b[0m"
+
+/**
+ * @brief Formats a message with category prefix and level color and writes it
+ * as a single record. Use the \c LOG_* macros instead.
+ */
+void log_printf(log_category_t cat, int level, const char* format, ...) {
+    char buf[KPRINTF_LINE_MAX];
+    // keep room for the color reset
+    const size_t size = sizeof(buf) - sizeof(LOG_COLOR_RESET) + 1;
+    int length = snprintf(buf, size, "%s[%s] ", log_level_colors[level], log_category_names[cat]);
+
+    va_list vl;
+    va_start(vl, format);
+    length += vsnprintf(buf + length, size - length, format, vl);
+    va_end(vl);
+
+    if(length >= (int)size) {
+        length = size - 1;
+    }
+    memcpy(buf + length, LOG_COLOR_RESET, sizeof(LOG_COLOR_RESET));
+    kputsn(buf, length + sizeof(LOG_COLOR_RESET) - 1);
+}
+
+/**
+ * @brief Sets the runtime level of a category.
+ *
+ * Levels above \c HE_LOG_LEVEL have no effect because those messages are not compiled in.
+ */
+void log_set_level(log_category_t cat, int level) {
+    if(cat < LOG_CAT_COUNT) {
+        log_levels[cat] = level;
+    }
+}
@@ -13,15 +13,44 @@
 #include "kernel/info.h"
 #include "kernel/panic.h"
 #include "kernel/cpu.h"
+#include "kernel/trace.h"
+#include "kernel/smp.h"
+#include "kernel/percpu.h"
 
 #include "kernel/mem/pfa.h"
 #include "kernel/mem/vmm.h"
+#include "kernel/mem/tlb.h"
+
+#include "kernel/sync/spinlock.h"
+
+#include "kernel/sched/sched.h"
+#include "kernel/sched/timer.h"
+
+#include "kernel/time/clock.h"
 
 #include "kernel/interrupts/idt.h"
 #include "kernel/interrupts/int.h"
+#include "kernel/interrupts/pic.h"
+#include "kernel/interrupts/lapic.h"
+#include "kernel/interrupts/ioapic.h"
+#include "kernel/interrupts/intstat.h"
 
 #include "kernel/klibc/string.h"
 #include "kernel/klibc/kstdio.h"
+#include "kernel/klibc/klog.h"
+#include "kernel/klibc/kstdio_serial.h"
+#include "kernel/klibc/kstdio_screen.h"
+#include "kernel/klibc/kstdio_fbcon.h"
+#include "kernel/klibc/vcon.h"
+
+/**
+ * @brief Interrupt handler of COM1.
+ */
+static void main_serial_interrupt(int_frame_t* frame) {
+    (void)frame;
+    serial_interrupt();
+    lapic_eoi();
+}
 
 void print_welcome() {
     kputs("\x1b[33m");
@@ -43,23 +72,95 @@ void print_welcome() {
  * @brief 64 bit C entry point for bootstrap processor.
  */
 void main_bsp() {
+    trace_init();
+
+    if(serial_init() == 0) {
+        kstdio_add_backend(&kstdio_serial);
+    }
+
+    // the framebuffer is needed before the first output
+    info_init();
+    if(fbcon_init(&info_table.framebuffer) == 0) {
+        kstdio_remove_backend(&kstdio_screen_direct);
+        kstdio_add_backend(&kstdio_fbcon);
+    }
+
     print_welcome();
 
     kprintf(" * setting up IDT\n");
     idt_init();
+    int_init();
 
-    kprintf(" * parsing system information\n");
-    info_init();
+    kprintf(" * remapping legacy PIC\n");
+    pic_init();
 
     kprintf(" * initializing page frame allocator\n");
     pfa_init();
+    percpu_init();
+    intstat_init();
 
     kprintf(" * initializing virtual memory manager\n");
     vmm_init();
 
+    kprintf(" * initializing scheduler\n");
+    sched_init();
+
+    kprintf(" * initializing virtual consoles\n");
+    if(vcon_init() == 0) {
+        // kernel messages go to the first console, which is displayed now
+        kstdio_remove_backend(&kstdio_screen_direct);
+        kstdio_remove_backend(&kstdio_fbcon);
+        kstdio_add_backend(&vcon_backends[0]);
+    }
+
+    kprintf(" * initializing clocks\n");
+    clock_init();
+
+    kprintf(" * initializing local APIC\n");
+    int have_lapic = lapic_init() == 0;
+    if(have_lapic) {
+        lapic_timer_init();
+        timer_init();
+    } else {
+        kprintf("   no local APIC found\n");
+    }
+
+    kprintf(" * initializing I/O APICs\n");
+    if(have_lapic && ioapic_init() == 0) {
+        // serial output becomes interrupt driven
+        int vector = ioapic_route_isa(SERIAL_COM1_IRQ, lapic_id());
+        if(vector >= 0) {
+            int_register(vector, main_serial_interrupt);
+            serial_enable_irq();
+        }
+    } else {
+        kprintf("   no I/O APIC found\n");
+    }
+
     kprintf(" * enabling interrupts\n");
     INT_ENABLE();
 
+    if(have_lapic) {
+        kprintf(" * starting application processors\n");
+        kprintf("   %u processors online\n", smp_init());
+#ifdef HE_BOOT_BENCHMARKS
+        clock_benchmark();
+        serial_benchmark();
+        lock_benchmark();
+        tlb_benchmark();
+        lapic_timer_benchmark();
+        // a round trip to another processor, the current one only if it is alone
+        uint64_t others = smp_cpu_mask() & ~(1ull << percpu_cpu());
+        lapic_ipi_benchmark(others ? smp_apic_id(__builtin_ctzll(others)) : lapic_id());
+        sched_benchmark();
+        timer_benchmark();
+#endif
+        sched_start();
+        if(klog_start() != 0) {
+            kprintf("   no memory for the log thread, logging stays synchronous\n");
+        }
+    }
+
     kprintf(" * provoking page fault\n");
 
     //*(uint64_t*)(0xFFFFFFFFF0000000) = 0;
@@ -67,11 +168,24 @@ void main_bsp() {
     debug_print_info();
 
     //kpanic("Crash :-)");
+
+    sched_idle();
 }
 
 /**
  * @brief 64 bit C entry point for application processors.
+ *
+ * @param apic_id initial APIC ID of the processor, passed by boot64_ap
  */
-void main_ap() {
-
+void main_ap(uint32_t apic_id) {
+    // GDT and page tables are shared with the bootstrap processor and already loaded
+    percpu_init_cpu();
+    idt_reload();
+    intstat_init_cpu();
+    tlb_init_cpu();
+    sched_init_cpu();
+    lapic_init();
+    smp_ap_checkin(apic_id);
+
+    sched_idle();
 }
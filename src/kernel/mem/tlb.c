@@ -0,0 +1,281 @@
+/**
+ * @file tlb.c
+ *
+ * @author Fabian Thorand
+ * @date   19.10.2026
+ *
+ * @brief Batched TLB shootdown.
+ *
+ * Every processor owns one #tlb_request_t in its per-CPU area. The initiator copies the
+ * batch into its request, sets the bits of the target processors in \c pending and sends
+ * the IPIs. Each target scans the requests of all processors for its bit, invalidates and
+ * clears the bit. A processor waiting for its own request keeps serving the requests of
+ * others, so two processors shooting at each other with interrupts disabled cannot deadlock.
+ */
+
+#include "kernel/mem/tlb.h"
+#include "kernel/mem/vmm.h"
+#include "kernel/mem/pfa.h"
+
+#include "kernel/interrupts/int.h"
+#include "kernel/interrupts/lapic.h"
+
+#include "kernel/sched/preempt.h"
+
+#include "kernel/bits.h"
+#include "kernel/cpu.h"
+#include "kernel/log.h"
+#include "kernel/percpu.h"
+#include "kernel/smp.h"
+
+/// first address of the kernel half, mapped in all address spaces
+#define TLB_KERNEL_HALF 0xFFFF800000000000
+/// page global enable bit in CR4
+#define TLB_CR4_PGE 0x80
+
+/// unmapped scratch area used by #tlb_benchmark
+#define TLB_BENCHMARK_BASE 0xFFFFFFFFC0000000
+/// number of measurements averaged by #tlb_benchmark
+#define TLB_BENCHMARK_ROUNDS 32
+
+/**
+ * @brief A shootdown started by a processor.
+ */
+typedef struct {
+    volatile uint64_t pending;  ///< processors that did not yet invalidate
+    tlb_batch_t batch;          ///< pages to invalidate
+} tlb_request_t;
+
+/// physical address of the PML4T loaded on each processor
+static PERCPU_DEFINE(uintptr_t, tlb_active) = 0;
+/// the last shootdown started by each processor
+static PERCPU_DEFINE(tlb_request_t, tlb_request);
+
+/**
+ * @brief Invalidates the pages of a batch in the TLB of the current processor.
+ */
+INT_FAST_HANDLER static void tlb_invalidate_local(const tlb_batch_t* batch) {
+    if(!batch->full) {
+        for(unsigned int i = 0; i < batch->count; i++) {
+            asm volatile ("invlpg (%0)" : : "r"(batch->pages[i]) : "memory");
+        }
+    } else if(batch->global) {
+        // toggling PGE also drops the global translations
+        uint64_t cr4;
+        asm volatile ("movq %%cr4, %0" : "=r"(cr4));
+        asm volatile ("movq %0, %%cr4" : : "r"(cr4 & ~TLB_CR4_PGE) : "memory");
+        asm volatile ("movq %0, %%cr4" : : "r"(cr4) : "memory");
+    } else {
+        uint64_t cr3;
+        asm volatile ("movq %%cr3, %0" : "=r"(cr3));
+        asm volatile ("movq %0, %%cr3" : : "r"(cr3) : "memory");
+    }
+}
+
+/**
+ * @brief Serves the requests of other processors that target the current processor.
+ */
+INT_FAST_HANDLER static void tlb_process() {
+    uint64_t self = 1ull << PERCPU_READ(percpu_index);
+    uintptr_t active = PERCPU_READ(tlb_active);
+    for(unsigned int cpu = 0; cpu < HE_MAX_CPUS; cpu++) {
+        tlb_request_t* request = PERCPU_REMOTE(tlb_request, cpu);
+        if(!(request->pending & self)) {
+            continue;
+        }
+        // the address space may have been switched since the request was sent
+        if(request->batch.global || request->batch.pml4t == active) {
+            tlb_invalidate_local(&request->batch);
+        }
+        __sync_fetch_and_and(&request->pending, ~self);
+    }
+}
+
+/**
+ * @brief Handles shootdown IPIs.
+ */
+INT_FAST_HANDLER static void tlb_interrupt(int_frame_t* frame) {
+    (void)frame;
+    tlb_process();
+    lapic_eoi();
+}
+
+/**
+ * @brief Registers the shootdown handler and initializes the bootstrap processor.
+ */
+void tlb_init() {
+    int_register(TLB_VECTOR_SHOOTDOWN, tlb_interrupt);
+    tlb_init_cpu();
+}
+
+/**
+ * @brief Records the active address space of the current processor. Must be called on every processor.
+ */
+void tlb_init_cpu() {
+    tlb_activate(vmm_get_pml4t());
+}
+
+/**
+ * @brief Records that the current processor switched to another address space.
+ *
+ * @param pml4t physical address of the PML4T loaded into CR3
+ */
+void tlb_activate(uintptr_t pml4t) {
+    PERCPU_WRITE(tlb_active, pml4t);
+}
+
+/**
+ * @brief Starts an empty batch for an address space.
+ */
+void tlb_batch_init(tlb_batch_t* batch, uintptr_t pml4t) {
+    batch->pml4t = pml4t;
+    batch->global = 0;
+    batch->full = 0;
+    batch->count = 0;
+}
+
+/**
+ * @brief Adds a page to a batch.
+ */
+void tlb_batch_add(tlb_batch_t* batch, uintptr_t vaddr) {
+    if(vaddr >= TLB_KERNEL_HALF) {
+        batch->global = 1;
+    }
+    if(batch->count < TLB_BATCH_PAGES) {
+        batch->pages[batch->count++] = vaddr;
+    } else {
+        batch->full = 1;
+    }
+}
+
+/**
+ * @brief Invalidates a batch locally and on the online processors in \c allowed.
+ */
+static void tlb_batch_flush_mask(tlb_batch_t* batch, uint64_t allowed) {
+    if(!batch->count) {
+        return;
+    }
+    // the request of this processor is reused, a thread preempted in between would lose it
+    PREEMPT_DISABLE();
+    tlb_wait();
+    unsigned int self = percpu_cpu();
+    tlb_request_t* request = PERCPU_PTR(tlb_request);
+    request->batch = *batch;
+    tlb_batch_init(batch, batch->pml4t);
+
+    if(request->batch.global || request->batch.pml4t == PERCPU_READ(tlb_active)) {
+        tlb_invalidate_local(&request->batch);
+    }
+
+    // the page tables were changed before, they must be visible before tlb_active is read
+    asm volatile ("mfence" ::: "memory");
+    uint64_t targets = 0;
+    uint64_t candidates = smp_cpu_mask() & allowed & ~(1ull << self);
+    for(unsigned int cpu = 0; cpu < HE_MAX_CPUS; cpu++) {
+        if((candidates & (1ull << cpu))
+                && (request->batch.global || *PERCPU_REMOTE(tlb_active, cpu) == request->batch.pml4t)) {
+            targets |= 1ull << cpu;
+        }
+    }
+    if(!targets) {
+        PREEMPT_ENABLE();
+        return;
+    }
+    __sync_fetch_and_or(&request->pending, targets);
+    // see smp_init, the IPI does not order the stores above
+    asm volatile ("mfence" ::: "memory");
+    for(unsigned int cpu = 0; cpu < HE_MAX_CPUS; cpu++) {
+        if(targets & (1ull << cpu)) {
+            lapic_send_ipi(smp_apic_id(cpu), TLB_VECTOR_SHOOTDOWN);
+        }
+    }
+    PREEMPT_ENABLE();
+}
+
+/**
+ * @brief Invalidates the pages of a batch on all processors and empties it.
+ *
+ * The local TLB is invalidated on return, the other processors are only notified.
+ * Waits for the previous shootdown of this processor to complete.
+ */
+void tlb_batch_flush(tlb_batch_t* batch) {
+    tlb_batch_flush_mask(batch, ~0ull);
+}
+
+/**
+ * @brief Waits until the last shootdown started on this processor completed everywhere.
+ *
+ * May be called with interrupts disabled, requests of other processors are served while waiting.
+ */
+void tlb_wait() {
+    // a migrated thread would wait for the request of another processor
+    PREEMPT_DISABLE();
+    tlb_request_t* request = PERCPU_PTR(tlb_request);
+    while(request->pending) {
+        tlb_process();
+        asm volatile ("pause");
+    }
+    PREEMPT_ENABLE();
+}
+
+/**
+ * @brief Maps and touches \c count pages, then measures unmapping them with shootdowns to \c allowed.
+ *
+ * @return the cycles spent from the first unmap until all processors invalidated.
+ */
+static uint64_t tlb_benchmark_unmap(uintptr_t frames, unsigned int count, uint64_t allowed) {
+    uintptr_t pml4t = vmm_get_pml4t();
+    for(unsigned int i = 0; i < count; i++) {
+        uintptr_t vaddr = TLB_BENCHMARK_BASE + i * VMM_PAGE_SIZE;
+        vmm_map(pml4t, frames + i * VMM_PAGE_SIZE, vaddr, VMM_LEVEL_1,
+                VMM_FLAG_PRESENT | VMM_FLAG_RW, VMM_FLAG_PRESENT | VMM_FLAG_RW);
+        *(volatile uint64_t*)vaddr = i;
+    }
+
+    uint64_t start = cpu_rdtsc();
+    tlb_batch_t batch;
+    tlb_batch_init(&batch, pml4t);
+    for(unsigned int i = 0; i < count; i++) {
+        uintptr_t vaddr = TLB_BENCHMARK_BASE + i * VMM_PAGE_SIZE;
+        vmm_unmap(pml4t, vaddr);
+        tlb_batch_add(&batch, vaddr);
+    }
+    tlb_batch_flush_mask(&batch, allowed);
+    tlb_wait();
+    return cpu_rdtsc() - start;
+}
+
+/**
+ * @brief Measures the cost of unmapping pages with 1 to all online processors as targets.
+ *
+ * Must be called on the bootstrap processor after #smp_init.
+ */
+void tlb_benchmark() {
+    static const unsigned int sizes[] = { 1, 8, TLB_BATCH_PAGES * 2 };
+    uintptr_t frames = pfa_alloc_block(TLB_BATCH_PAGES * 2, 0);
+    if(!frames) {
+        return;
+    }
+    // only this processor touches the scratch area, so fewer targets than necessary are fine
+    uint64_t remaining = smp_cpu_mask() & ~(1ull << percpu_cpu());
+    uint64_t allowed = 0;
+    while(1) {
+        uint64_t cycles[3];
+        for(int s = 0; s < 3; s++) {
+            uint64_t total = 0;
+            for(int round = 0; round < TLB_BENCHMARK_ROUNDS; round++) {
+                total += tlb_benchmark_unmap(frames, sizes[s], allowed);
+            }
+            cycles[s] = total / TLB_BENCHMARK_ROUNDS;
+        }
+        LOG_INFO(LOG_CAT_MEM, "tlb: %2u cpus, unmap %u pages %lu, %u pages %lu, %u pages (full flush) %lu cycles\n",
+                bits_popcount(allowed) + 1, sizes[0], cycles[0], sizes[1], cycles[1], sizes[2], cycles[2]);
+        if(!remaining) {
+            break;
+        }
+        // add the next online processor as target
+        uint64_t next = remaining & -remaining;
+        allowed |= next;
+        remaining &= ~next;
+    }
+}
@@ -9,44 +9,51 @@
 
 #include "kernel/mem/vmm.h"
 #include "kernel/mem/pfa.h"
+#include "kernel/mem/tlb.h"
 
 #include "kernel/helium.h"
 
 #include "kernel/bits.h"
 
 #include "kernel/debug.h"
+#include "kernel/log.h"
 #include "kernel/panic.h"
+#include "kernel/trace.h"
 
 #include "kernel/klibc/kstdio.h"
 #include "kernel/klibc/string.h"
 
 #include "kernel/interrupts/idt.h"
+#include "kernel/interrupts/int.h"
 
-/// PF handler written in assembly
-extern marker_t vmm_pf_handler_asm;
-/// GPF handler written in assembly
-extern marker_t vmm_gpf_handler_asm;
+/// page fault error code: the page was present
+#define VMM_PF_PRESENT 0x1
+/// page fault error code: the access was a write
+#define VMM_PF_WRITE 0x2
+/// page fault error code: the access happened in user mode
+#define VMM_PF_USER 0x4
+/// page fault error code: the access was an instruction fetch
+#define VMM_PF_FETCH 0x10
 
 /**
- * @brief page fault handler called from assembly
+ * @brief page fault handler
  */
-void vmm_pf_handler() {
+static void vmm_pf_handler(int_frame_t* frame) {
     uintptr_t cr2;
     asm volatile ("movq %%cr2,%0" : "=g"(cr2));
-    //kpanicf("page fault while accessing %p\n", cr2);
-    DEBUGF("page fault while accessing %p\n", cr2);
-    __halt__();
+    int_panicf(frame, "page fault: %s %s %p (%s, %s mode)\n",
+            frame->error & VMM_PF_FETCH ? "executing" : frame->error & VMM_PF_WRITE ? "writing" : "reading",
+            frame->error & VMM_PF_FETCH ? "at" : "to",
+            (void*)cr2,
+            frame->error & VMM_PF_PRESENT ? "protection violation" : "not present",
+            frame->error & VMM_PF_USER ? "user" : "kernel");
 }
 
 /**
- * @brief general protection fault handler called from assembly
+ * @brief general protection fault handler
  */
-void vmm_gpf_handler() {
-    uintptr_t cr2;
-    asm volatile ("movq %%cr2,%0" : "=g"(cr2));
-    //kpanicf("general protection fault while accessing %p\n", cr2);
-    DEBUGF("general protection fault while accessing %p\n", cr2);
-    __halt__();
+static void vmm_gpf_handler(int_frame_t* frame) {
+    int_panicf(frame, "general protection fault, selector %lx\n", frame->error);
 }
 
 /**
@@ -68,15 +75,20 @@ uintptr_t vmm_get_pml4t() {
  * Calling this function also flushes the TLB.
  */
 void vmm_set_pml4t(uintptr_t pml4t) {
-    asm volatile ("movq %0,%%cr3" : "=g"(pml4t));
+    // a shootdown reading the old value must not miss translations cached after the switch
+    tlb_activate(pml4t);
+    asm volatile ("mfence" ::: "memory");
+    asm volatile ("movq %0,%%cr3" : : "r"(pml4t) : "memory");
 }
 
 /**
- * @brief Invalidates the given page.
+ * @brief Invalidates the given page on the current processor only.
  * @param Virtual address of the invalidated page.
+ *
+ * Use #vmm_unmap_range or a tlb_batch_t when other processors may have the page cached.
  */
 void vmm_invalidate(uintptr_t page) {
-    asm volatile ("invlpg %0" :: "g"(page));
+    asm volatile ("invlpg (%0)" : : "r"(page) : "memory");
 }
 
 /**
@@ -179,6 +191,7 @@ int vmm_get_table(uintptr_t pml4t_p, uintptr_t vaddr, int level, uint64_t create
  * @todo Revisit when swapping is implemented, because currently, only the present bit is checked.
  */
 int vmm_map(uintptr_t pml4t_p, uintptr_t paddr, uintptr_t vaddr, int level, uint64_t createFlags, uint64_t mapFlags) {
+    TRACE("vmm_map %p -> %p level %d flags %llx", vaddr, paddr, level, mapFlags);
     if(level == VMM_LEVEL_4) {
         return -3;
     }
@@ -219,6 +232,7 @@ int vmm_map(uintptr_t pml4t_p, uintptr_t paddr, uintptr_t vaddr, int level, uint
  * that the page to unmap is currently swapped out.
  */
 int vmm_unmap(uintptr_t pml4t_p, uintptr_t vaddr) {
+    TRACE("vmm_unmap %p", vaddr);
     // get page table
     uintptr_t table_paddr;
     uint64_t* parent;
@@ -245,23 +259,51 @@ int vmm_unmap(uintptr_t pml4t_p, uintptr_t vaddr) {
     return 0;
 }
 
+/**
+ * @brief Unmaps consecutive pages and invalidates them on all processors.
+ *
+ * @param pml4t_p Physical address of the PML4T.
+ * @param vaddr Virtual address of the first page.
+ * @param count Number of 4 KiB pages.
+ *
+ * @return \c 0 on success, \c -1 if a page table did not exist.
+ *
+ * All pages are invalidated with a single shootdown, ranges of more than #TLB_BATCH_PAGES
+ * pages flush the whole TLB. On return, no processor uses the old translations anymore.
+ */
+int vmm_unmap_range(uintptr_t pml4t_p, uintptr_t vaddr, size_t count) {
+    int ret = 0;
+    tlb_batch_t batch;
+    tlb_batch_init(&batch, pml4t_p);
+    for(size_t i = 0; i < count; i++) {
+        uintptr_t page = vaddr + i * VMM_PAGE_SIZE;
+        if(vmm_unmap(pml4t_p, page) != 0) {
+            ret = -1;
+            continue;
+        }
+        tlb_batch_add(&batch, page);
+    }
+    tlb_batch_flush(&batch);
+    tlb_wait();
+    return ret;
+}
+
 /**
  * @brief Initializes the virtual memory manager.
  */
 void vmm_init() {
-    DEBUGF("[vmm_init]\n");
-    DEBUGF("  PF handler:  %p\n", &vmm_pf_handler_asm);
-    DEBUGF("  GPF handler: %p\n", &vmm_gpf_handler_asm);
+    LOG_DEBUG(LOG_CAT_MEM, "[vmm_init]\n");
     // install page fault handler, needed for virtual memory management
-    idt_set_entry(IDT_VEC_PAGE_FAULT, IDT_INT_GATE, (uintptr_t)&vmm_pf_handler_asm, 0x8, 0);
-    idt_set_entry(IDT_VEC_GEN_PROT_FAULT, IDT_INT_GATE, (uintptr_t)&vmm_gpf_handler_asm, 0x8, 0);
+    int_register(IDT_VEC_PAGE_FAULT, vmm_pf_handler);
+    int_register(IDT_VEC_GEN_PROT_FAULT, vmm_gpf_handler);
+    tlb_init();
 
     // find kernel page tables
     uintptr_t pml4t = vmm_get_pml4t();
-    DEBUGF("  kernel mappings:\n");
+    LOG_DEBUG(LOG_CAT_MEM, "  kernel mappings:\n");
     for(int level = VMM_LEVEL_4; level >= 0; level--) {
         uintptr_t table;
         int ret = vmm_get_table(pml4t, 0xFFFFFFFF80100000, level, 0, &table, 0);
-        DEBUGF("  %d (%d): %p\n", level, ret, table);
+        LOG_DEBUG(LOG_CAT_MEM, "  %d (%d): %p\n", level, ret, (void*)table);
     }
 }
@@ -9,8 +9,12 @@
 
 #include "kernel/panic.h"
 #include "kernel/klibc/kstdio.h"
+#include "kernel/klibc/klog.h"
 // use direct screen backend
 #include "kernel/klibc/kstdio_screen.h"
+#include "kernel/klibc/kstdio_fbcon.h"
+#include "kernel/klibc/vcon.h"
+#include "kernel/klibc/kstdio_serial.h"
 
 #include <stdint.h>
 #include <stdarg.h>
@@ -44,15 +48,35 @@ const char* panic_func;
     kprintf("        cr3: %16llx cr4: %16llx            \n", panic_crs[3], panic_crs[4]); \
     kputs("\n"); }
 
+/**
+ * @brief Switches the display to direct output, bypassing the log rings and the
+ * virtual consoles.
+ *
+ * The records still in the rings are written to the old backends first, so the
+ * messages leading to the panic stay on the display above the panic message.
+ * The serial port keeps receiving all output.
+ */
+static void panic_console() {
+    // a writer interrupted by the panic may own the transmit ring
+    serial_set_direct();
+    klog_flush();
+    kstdio_set_synchronous(1);
+    for(int i = 0; i < VCON_COUNT; i++) {
+        kstdio_remove_backend(&vcon_backends[i]);
+    }
+    kstdio_remove_backend(&kstdio_fbcon);
+    kstdio_remove_backend(&kstdio_screen_direct);
+    kstdio_add_backend(fbcon_enabled() ? &kstdio_fbcon : &kstdio_screen_direct);
+    kputs("\n\x1b[37;41m==================== KERNEL PANIC ====================\n");
+}
+
 /**
  * @brief prints the \c message and the state previously saved with #PANIC_SAVE_STATE to the screen and halts.
  * @param message a message describing the kernel panic.
  * @remark This function does not return.
  */
 void _kpanic(const char* message) {
-    // in case of panic, switch back to direct screen backend
-    kstdio_set_backend(&kstdio_screen_direct);
-    screen_clear(VGACOLOR(WHITE, RED));
+    panic_console();
     kputs(message);
     PANIC_DUMP_STATE();
     __halt__();
@@ -65,9 +89,7 @@ void _kpanic(const char* message) {
  * @remark This function does not return.
  */
 void _kpanicf(const char* message, ...) {
-    // in case of panic, switch back to direct screen backend
-    kstdio_set_backend(&kstdio_screen_direct);
-    screen_clear(VGACOLOR(WHITE, RED));
+    panic_console();
     va_list vl;
     va_start(vl, message);
     kvprintf(message,vl);
@@ -0,0 +1,85 @@
+/**
+ * @file percpu.c
+ *
+ * @author Fabian Thorand
+ * @date   19.10.2026
+ *
+ * @brief Per-CPU variables reached through the GS base.
+ *
+ * The copies are allocated up front for the bootstrap processor and every usable processor
+ * listed by ACPI, because application processors start in parallel and cannot use the
+ * page frame allocator. Code iterating over all processors skips indices without a copy.
+ */
+
+#include "kernel/percpu.h"
+#include "kernel/panic.h"
+#include "kernel/info.h"
+#include "kernel/smp.h"
+#include "kernel/cpu.h"
+
+#include "kernel/mem/pfa.h"
+#include "kernel/mem/vmm.h"
+
+#include "kernel/klibc/string.h"
+
+/// start and end of the template, see linker.ld
+extern marker_t __PERCPU_START, __PERCPU_END;
+
+/// difference between the copy of the current processor and the template
+PERCPU_DEFINE(uintptr_t, percpu_offset) = 0;
+/// index of the current processor, see #percpu_cpu
+PERCPU_DEFINE(unsigned int, percpu_index) = 0;
+
+/// difference between the copy of each processor and the template, zero if there is none
+uintptr_t percpu_offsets[HE_MAX_CPUS];
+
+/**
+ * @brief Copies the template for the processor with the given index, unless it has a copy.
+ */
+static void percpu_alloc(unsigned int cpu) {
+    if(percpu_offsets[cpu]) {
+        return;
+    }
+    uintptr_t start = (uintptr_t)&__PERCPU_START;
+    size_t size = (uintptr_t)&__PERCPU_END - start;
+    size_t pages = (size + HE_PAGE_SIZE - 1) / HE_PAGE_SIZE;
+    uintptr_t paddr = pfa_alloc_block(pages, 0);
+    if(!paddr) {
+        kpanic("out of memory for per-CPU data");
+    }
+    uint8_t* copy = (uint8_t*) (VMM_PHYS4G_BASE + paddr);
+    memcpy(copy, (void*)start, size);
+    percpu_offsets[cpu] = (uintptr_t)copy - start;
+}
+
+/**
+ * @brief Copies the template for every usable processor and sets up the bootstrap processor.
+ *
+ * Must be called once after the page frame allocator is initialized and ACPI was parsed.
+ */
+void percpu_init() {
+    percpu_alloc(cpu_index());
+    for(unsigned int i = 0; i < info_table.cpu_count; i++) {
+        he_cpu_t* cpu = &info_cpus[i];
+        // the same processors that smp_init may start, the index is derived from the APIC ID
+        if(cpu->enabled && cpu->apic_id < SMP_MAX_APIC_ID) {
+            percpu_alloc(cpu->apic_id % HE_MAX_CPUS);
+        }
+    }
+    percpu_init_cpu();
+}
+
+/**
+ * @brief Loads the GS base of the current processor. Must be called on every processor.
+ */
+void percpu_init_cpu() {
+    unsigned int index = cpu_index();
+    if(!percpu_offsets[index]) {
+        kpanic("no per-CPU data for this processor");
+    }
+    // GS is never loaded in user mode yet, its base is zero there
+    cpu_msr_write(PERCPU_MSR_GS_BASE, percpu_offsets[index]);
+    cpu_msr_write(PERCPU_MSR_KERNEL_GS_BASE, 0);
+    PERCPU_WRITE(percpu_offset, percpu_offsets[index]);
+    PERCPU_WRITE(percpu_index, index);
+}
@@ -0,0 +1,53 @@
+/**
+ * @file deque.c
+ *
+ * @author Fabian Thorand
+ * @date   19.10.2026
+ *
+ * @brief Bounded lock-free work-stealing deque after Chase and Lev.
+ *
+ * x86 does not reorder stores with other stores or loads with other loads, so the owner
+ * publishes an item by storing it before \c bottom, and a taker reads \c top before
+ * \c bottom and the item before its compare-and-swap. Compiler barriers suffice for both.
+ * The owner never pops at the bottom, so the fence between its store to \c bottom and
+ * its load of \c top of the original algorithm is not needed.
+ */
+
+#include "kernel/sched/deque.h"
+
+/**
+ * @brief Appends an item at the bottom. Must only be called by the owner.
+ *
+ * @return non-zero on success, zero if the deque is full
+ */
+int deque_push(deque_t* deque, void* item) {
+    int64_t bottom = deque->bottom;
+    // the slot of top may still be read by a taker that did not advance it yet
+    if(bottom - deque->top >= DEQUE_SIZE) {
+        return 0;
+    }
+    deque->items[bottom & (DEQUE_SIZE - 1)] = item;
+    asm volatile ("" : : : "memory");
+    deque->bottom = bottom + 1;
+    return 1;
+}
+
+/**
+ * @brief Takes the oldest item from the top. May be called by any processor.
+ *
+ * @return the item, or \c NULL if the deque is empty
+ */
+void* deque_steal(deque_t* deque) {
+    while(1) {
+        int64_t top = deque->top;
+        asm volatile ("" : : : "memory");
+        if(top >= deque->bottom) {
+            return NULL;
+        }
+        void* item = deque->items[top & (DEQUE_SIZE - 1)];
+        if(__sync_bool_compare_and_swap(&deque->top, top, top + 1)) {
+            return item;
+        }
+        // another taker got the item, try the next one
+    }
+}
@@ -0,0 +1,1117 @@
+/**
+ * @file sched.c
+ *
+ * @author Fabian Thorand
+ * @date   19.10.2026
+ *
+ * @brief Preemptive kernel threads with per-CPU run queues.
+ *
+ * The lock of a run queue is held across the context switch: the old thread acquires it
+ * and the new one releases it in #sched_finish. The states of the threads of a queue and
+ * their \c wakeup flags are only changed with the lock held, so #sched_wakeup on another
+ * processor cannot race with a thread going to sleep.
+ *
+ * Ready threads live in a work-stealing deque (see deque.h) that only the owning processor
+ * pushes to. Threads queued by other processors go to a locked list first, which the owner
+ * moves to the deque when it schedules. A thread switched away from is only pushed after
+ * #sched_switch saved its registers, in #sched_finish, so it cannot be stolen too early.
+ *
+ * Idle processors steal from the deques of the others, trying hyper-thread siblings first,
+ * then the other cores of their package and then the remaining processors, as reported
+ * by CPUID leaf 0xB. A processor that pushes a thread wakes the nearest idle one.
+ *
+ * Without a periodic tick, each run queue remembers the deadline its timer is armed for.
+ * #sched_timer_update recomputes it whenever the number of ready threads may have changed
+ * and after every timer interrupt. It only runs on the owning processor with interrupts
+ * disabled, so the timer fields need no lock. Other processors that queue a thread on a
+ * busy processor without tick send it the reschedule IPI, whose handler updates the timer.
+ *
+ * Each thread is stored at the bottom of its stack block. The page frame allocator cannot
+ * free, so the blocks of exited threads are kept in a list and reused.
+ */
+
+#include "kernel/sched/sched.h"
+#include "kernel/sched/deque.h"
+#include "kernel/sched/preempt.h"
+
+#include "kernel/sync/spinlock.h"
+#include "kernel/sync/rcu.h"
+
+#include "kernel/interrupts/int.h"
+#include "kernel/interrupts/softirq.h"
+#include "kernel/interrupts/lapic.h"
+
+#include "kernel/time/clock.h"
+
+#include "kernel/mem/pfa.h"
+#include "kernel/mem/vmm.h"
+
+#include "kernel/klibc/kstdio.h"
+
+#include "kernel/bits.h"
+#include "kernel/cpu.h"
+#include "kernel/debug.h"
+#include "kernel/helium.h"
+#include "kernel/log.h"
+#include "kernel/panic.h"
+#include "kernel/smp.h"
+
+/// number of context switches measured by #sched_benchmark
+#define SCHED_BENCHMARK_ROUNDS 10000
+/// number of callee saved registers pushed by #sched_switch
+#define SCHED_SWITCH_REGS 6
+/// number of threads forked by each round of #sched_fork_benchmark
+#define SCHED_FORK_THREADS 128
+/// cycles of work done by each forked thread
+#define SCHED_FORK_WORK 50000
+/// largest number of processors measured by #sched_fork_benchmark
+#define SCHED_FORK_MAX_CPUS 16
+
+/// distance of hyper-thread siblings
+#define SCHED_DIST_SMT 0
+/// distance of cores of the same package
+#define SCHED_DIST_CORE 1
+/// distance of processors in different packages
+#define SCHED_DIST_PACKAGE 2
+
+/**
+ * @brief The run queue of a processor.
+ */
+typedef struct {
+    spinlock_t lock;        ///< protects the list, the states of the threads and their \c cpu
+    deque_t queue;          ///< ready threads, pushed by this processor and stolen by idle ones
+    thread_t* head;         ///< first ready thread queued by another processor or not fitting into \c queue
+    thread_t* tail;         ///< last thread of that list
+    unsigned int pending;   ///< number of threads in that list
+    thread_t* current;      ///< running thread
+    thread_t* idle;         ///< idle thread
+    thread_t* prev;         ///< thread switched away from, see #sched_finish
+    uint64_t switches;      ///< number of context switches
+    uint64_t preemptions;   ///< number of context switches when an interrupt returned
+    uint64_t steals;        ///< number of threads stolen from other processors
+    int timer;              ///< non-zero once #sched_start handed the timer to the scheduler
+    int nohz;               ///< non-zero while a thread runs without tick
+    uint64_t tick;          ///< TSC of the next tick, zero if the tick is stopped
+    uint64_t deadline;      ///< TSC the timer is armed for, zero if it is stopped
+    uint64_t interrupts;    ///< number of timer interrupts
+    uint64_t wakeups;       ///< number of times the idle loop left the halt state
+} __attribute__((aligned(64))) sched_rq_t;
+
+/**
+ * @brief Position of a processor in the topology reported by CPUID leaf 0xB.
+ */
+typedef struct {
+    uint32_t core;          ///< x2APIC ID without the SMT bits, equal for hyper-thread siblings
+    uint32_t package;       ///< x2APIC ID without the SMT and core bits
+} sched_topo_t;
+
+/**
+ * @brief State of #sched_benchmark shared with its threads.
+ */
+typedef struct {
+    volatile int done;      ///< number of threads that finished
+    uint64_t cycles;        ///< cycles measured by the first thread to finish
+    uint64_t switches;      ///< context switches during that time
+} sched_bench_t;
+
+/**
+ * @brief A thread forked by #sched_fork_benchmark.
+ */
+typedef struct {
+    uint64_t forked;        ///< TSC when the thread was created
+    uint64_t latency;       ///< cycles from the creation to the start of the thread
+    uint64_t finished;      ///< TSC when the thread finished its work
+} sched_fork_task_t;
+
+/**
+ * @brief Saves the callee saved registers and the stack pointer and resumes another thread.
+ *
+ * Defined in switch.asm.
+ */
+void sched_switch(uintptr_t* save, uintptr_t rsp);
+
+static LOCK_CLASS(sched_rq_class, "sched-rq");
+static LOCK_CLASS(sched_thread_class, "sched-thread");
+
+/// number of nested sections disabling preemption on each processor
+PERCPU_DEFINE(unsigned int, preempt_count) = 0;
+/// non-zero, if the current processor should switch threads when the interrupt returns
+PERCPU_DEFINE(volatile int, sched_resched) = 0;
+/// the run queue of each processor
+static PERCPU_DEFINE(sched_rq_t, sched_rq) = {
+    .lock = SPINLOCK_INIT(&sched_rq_class),
+    .queue = DEQUE_INIT,
+    .head = NULL,
+    .tail = NULL,
+    .pending = 0,
+    .current = NULL,
+    .idle = NULL,
+    .prev = NULL,
+    .switches = 0,
+    .preemptions = 0,
+    .steals = 0,
+    .timer = 0,
+    .nohz = 0,
+    .tick = 0,
+    .deadline = 0,
+    .interrupts = 0,
+    .wakeups = 0
+};
+/// the running thread of each processor, readable with a single instruction
+static PERCPU_DEFINE(thread_t*, sched_thread) = NULL;
+
+/// the boot contexts of the processors
+static thread_t sched_idle_threads[HE_MAX_CPUS];
+/// blocks of exited threads, linked by \c next
+static thread_t* sched_free_threads = NULL;
+/// protects #sched_free_threads and the page frame allocator
+static spinlock_t sched_thread_lock = SPINLOCK_INIT(&sched_thread_class);
+/// last thread number handed out
+static volatile uint64_t sched_next_id = 0;
+
+/// topology of each processor, filled by #sched_init_cpu
+static sched_topo_t sched_topo[HE_MAX_CPUS];
+/// processors that steal threads from each other
+static volatile uint64_t sched_steal_cpus = 0;
+/// processors of #sched_steal_cpus that are idle and look for threads to steal
+static volatile uint64_t sched_idle_cpus = 0;
+/// busy processors whose timer does not tick
+static volatile uint64_t sched_nohz_cpus = 0;
+/// length of a time slice in TSC cycles
+static uint64_t sched_tick_cycles = 0;
+/// monotonic time in nanoseconds when #sched_start was called
+static uint64_t sched_start_ns = 0;
+
+/// threads of #sched_fork_benchmark
+static sched_fork_task_t sched_fork_tasks[SCHED_FORK_THREADS];
+/// number of threads of #sched_fork_benchmark that finished
+static volatile unsigned int sched_fork_done = 0;
+
+/**
+ * @brief Returns how far apart two processors are in the topology.
+ *
+ * @return #SCHED_DIST_SMT, #SCHED_DIST_CORE or #SCHED_DIST_PACKAGE
+ */
+static unsigned int sched_distance(unsigned int a, unsigned int b) {
+    if(sched_topo[a].package != sched_topo[b].package) {
+        return SCHED_DIST_PACKAGE;
+    }
+    return sched_topo[a].core != sched_topo[b].core ? SCHED_DIST_CORE : SCHED_DIST_SMT;
+}
+
+/**
+ * @brief Returns the processor of a set that is nearest to \c self.
+ *
+ * @param cpus a non-empty set of processors
+ */
+static unsigned int sched_nearest(unsigned int self, uint64_t cpus) {
+    unsigned int best = 0;
+    unsigned int best_distance = SCHED_DIST_PACKAGE + 1;
+    while(cpus) {
+        unsigned int cpu = __builtin_ctzll(cpus);
+        cpus &= cpus - 1;
+        unsigned int distance = sched_distance(self, cpu);
+        if(distance < best_distance) {
+            best = cpu;
+            best_distance = distance;
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief Wakes the nearest idle processor, so that it steals from the current one.
+ *
+ * Pairs with #sched_idle: either the idle processor finds the pushed thread or this one
+ * finds the processor idle.
+ */
+static void sched_offer() {
+    if(!sched_steal_cpus) {
+        return;
+    }
+    asm volatile ("mfence" ::: "memory");
+    unsigned int self = percpu_cpu();
+    uint64_t idle = sched_idle_cpus & ~(1ull << self);
+    while(idle) {
+        unsigned int cpu = sched_nearest(self, idle);
+        uint64_t bit = 1ull << cpu;
+        // only the processor clearing the bit sends an IPI
+        if(__sync_fetch_and_and(&sched_idle_cpus, ~bit) & bit) {
+            lapic_send_ipi(smp_apic_id(cpu), SCHED_VECTOR_RESCHED);
+            return;
+        }
+        idle &= ~bit;
+    }
+}
+
+/**
+ * @brief Arms the timer of the current processor for its next event, or stops it.
+ *
+ * The tick only runs while the current thread shares the processor with ready threads, or
+ * while RCU needs it. Otherwise the timer fires for the next tick of the timer wheel.
+ * Called with interrupts disabled.
+ *
+ * Other processors append to \c head without an IPI unless they see \c nohz set, see
+ * #sched_kick. So \c nohz is published before the ready threads are checked again, and
+ * a thread appended in between is either seen here or kicks this processor.
+ */
+INT_FAST_HANDLER static void sched_timer_update(sched_rq_t* rq) {
+    if(!rq->timer) {
+        return;
+    }
+    uint64_t self = 1ull << PERCPU_READ(percpu_index);
+    int busy = rq->current != rq->idle;
+    int tick = (busy && (rq->head || DEQUE_COUNT(&rq->queue) > 0)) || rcu_pending();
+    if(busy && !tick && !rq->nohz) {
+        rq->nohz = 1;
+        // locked, so the checks below cannot pass the store
+        __sync_fetch_and_or(&sched_nohz_cpus, self);
+        tick = rq->head || DEQUE_COUNT(&rq->queue) > 0 || rcu_pending();
+    }
+    if(tick) {
+        if(!rq->tick) {
+            rq->tick = cpu_rdtsc() + sched_tick_cycles;
+        }
+    } else {
+        rq->tick = 0;
+    }
+    uint64_t deadline = rq->tick;
+    uint64_t wake = timer_next();
+    if(wake && (!deadline || wake < deadline)) {
+        deadline = wake;
+    }
+    if(deadline != rq->deadline) {
+        rq->deadline = deadline;
+        if(deadline) {
+            lapic_timer_oneshot(deadline);
+        } else {
+            lapic_timer_stop();
+        }
+    }
+    if(rq->nohz && (!busy || tick)) {
+        rq->nohz = 0;
+        __sync_fetch_and_and(&sched_nohz_cpus, ~self);
+    }
+}
+
+/**
+ * @brief Appends a thread to the list of a run queue.
+ */
+static void sched_append(sched_rq_t* rq, thread_t* thread) {
+    thread->next = NULL;
+    if(rq->tail) {
+        rq->tail->next = thread;
+    } else {
+        rq->head = thread;
+    }
+    rq->tail = thread;
+    rq->pending++;
+}
+
+/**
+ * @brief Queues a ready thread.
+ *
+ * On the processor of the run queue the thread is pushed to the deque, unless older
+ * threads wait in the list. Other processors must not push, they append to the list.
+ */
+static void sched_enqueue(sched_rq_t* rq, thread_t* thread) {
+    thread->state = THREAD_READY;
+    if(rq != PERCPU_PTR(sched_rq)) {
+        sched_append(rq, thread);
+        return;
+    }
+    if(!rq->head && deque_push(&rq->queue, thread)) {
+        sched_offer();
+    } else {
+        sched_append(rq, thread);
+    }
+    // the current thread may need a tick now
+    sched_timer_update(rq);
+}
+
+/**
+ * @brief Removes the next ready thread from the run queue of the current processor.
+ *
+ * Moves the threads of the list to the deque as far as it has room.
+ *
+ * @return the thread, or \c NULL if the queue is empty.
+ */
+static thread_t* sched_dequeue(sched_rq_t* rq) {
+    thread_t* thread = deque_steal(&rq->queue);
+    if(!thread && rq->head) {
+        // a stolen thread is appended to the list and must run here
+        thread = rq->head;
+        rq->head = thread->next;
+        rq->pending--;
+    }
+    int pushed = 0;
+    while(rq->head && deque_push(&rq->queue, rq->head)) {
+        rq->head = rq->head->next;
+        rq->pending--;
+        pushed = 1;
+    }
+    if(!rq->head) {
+        rq->tail = NULL;
+    }
+    if(pushed) {
+        sched_offer();
+    }
+    return thread;
+}
+
+/**
+ * @brief Steals a ready thread from the nearest processor that has one.
+ *
+ * Hyper-thread siblings share the caches, so they are tried first, then the other cores
+ * of the package. Called by the idle thread with interrupts disabled.
+ *
+ * @return the thread, which now belongs to the current processor, or \c NULL
+ */
+static thread_t* sched_steal() {
+    unsigned int self = percpu_cpu();
+    uint64_t victims = sched_steal_cpus & ~(1ull << self);
+    while(victims) {
+        unsigned int cpu = sched_nearest(self, victims);
+        victims &= ~(1ull << cpu);
+        sched_rq_t* rq = PERCPU_REMOTE(sched_rq, cpu);
+        if(DEQUE_COUNT(&rq->queue) <= 0) {
+            continue;
+        }
+        thread_t* thread = deque_steal(&rq->queue);
+        if(thread) {
+            // sched_wakeup finds the run queue through cpu, which changes under the old lock
+            spinlock_acquire(&rq->lock);
+            thread->cpu = self;
+            spinlock_release(&rq->lock);
+            PERCPU_PTR(sched_rq)->steals++;
+            return thread;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Lets a set of processors steal threads from each other, the others stop stealing.
+ */
+static void sched_steal_enable(uint64_t cpus) {
+    sched_steal_cpus = cpus;
+    __sync_fetch_and_and(&sched_idle_cpus, cpus);
+    // idle processors that halted before they were allowed to steal look again
+    unsigned int self = percpu_cpu();
+    cpus &= ~(1ull << self);
+    while(cpus) {
+        unsigned int cpu = __builtin_ctzll(cpus);
+        cpus &= cpus - 1;
+        lapic_send_ipi(smp_apic_id(cpu), SCHED_VECTOR_RESCHED);
+    }
+}
+
+/**
+ * @brief Determines the position of the current processor in the topology.
+ *
+ * Without CPUID leaf 0xB, all processors are treated as cores of one package.
+ */
+static void sched_topo_init(sched_topo_t* topo) {
+    cpu_id_t id;
+    cpuid(0, &id);
+    uint32_t max = id.eax;
+    cpuid(1, &id);
+    uint64_t apic_id = id.ebx >> 24;
+    unsigned int smt_shift = 0;
+    unsigned int core_shift = 32;
+    for(uint32_t level = 0; max >= 0xB; level++) {
+        cpuid_sub(0xB, level, &id);
+        unsigned int type = CPUID_B_ECX_TYPE(id.ecx);
+        if(!type || !(id.ebx & 0xFFFF)) {
+            break;
+        }
+        apic_id = id.edx;
+        // the shift removes the bits of this level and all below it
+        if(type == CPUID_B_TYPE_SMT) {
+            smt_shift = id.eax & CPUID_B_EAX_SHIFT;
+        } else if(type == CPUID_B_TYPE_CORE) {
+            core_shift = id.eax & CPUID_B_EAX_SHIFT;
+        }
+    }
+    topo->core = apic_id >> smt_shift;
+    topo->package = apic_id >> core_shift;
+}
+
+/**
+ * @brief Makes the processor of a run queue reschedule, if it is idle, or start its tick,
+ * if it runs a thread without tick.
+ *
+ * Other threads only run when the current one yields or its time slice ends.
+ */
+static void sched_kick(sched_rq_t* rq, unsigned int cpu) {
+    if(rq->current != rq->idle) {
+        if(cpu != percpu_cpu()) {
+            // the thread must be queued before nohz is read, see sched_timer_update
+            asm volatile ("mfence" ::: "memory");
+            // the IPI handler arms the tick
+            if(rq->nohz) {
+                lapic_send_ipi(smp_apic_id(cpu), SCHED_VECTOR_RESCHED);
+            }
+        }
+        return;
+    }
+    *PERCPU_REMOTE(sched_resched, cpu) = 1;
+    if(cpu != percpu_cpu()) {
+        // see smp_init, the IPI does not order the store above
+        asm volatile ("mfence" ::: "memory");
+        lapic_send_ipi(smp_apic_id(cpu), SCHED_VECTOR_RESCHED);
+    }
+}
+
+/**
+ * @brief Locks the run queue of a thread. Called with interrupts disabled.
+ *
+ * @return the locked run queue
+ */
+static sched_rq_t* sched_lock_thread(thread_t* thread) {
+    // the thread may move to another run queue until its queue is locked
+    while(1) {
+        unsigned int cpu = thread->cpu;
+        sched_rq_t* rq = PERCPU_REMOTE(sched_rq, cpu);
+        spinlock_acquire(&rq->lock);
+        if(thread->cpu == cpu) {
+            return rq;
+        }
+        spinlock_release(&rq->lock);
+    }
+}
+
+/**
+ * @brief Ends the sleep of a thread whose timeout expired. Called by the timer wheel.
+ */
+static void sched_timeout(timer_t* timer) {
+    thread_t* thread = (thread_t*)((uintptr_t)timer - offsetof(thread_t, timer));
+    int enabled = int_enabled();
+    INT_DISABLE();
+    sched_rq_t* rq = sched_lock_thread(thread);
+    if(thread->state == THREAD_SLEEPING) {
+        sched_enqueue(rq, thread);
+        sched_kick(rq, thread->cpu);
+    }
+    spinlock_release(&rq->lock);
+    if(enabled) {
+        INT_ENABLE();
+    }
+}
+
+/**
+ * @brief Allocates the block of a thread.
+ *
+ * @return the block, or \c NULL if no memory was available.
+ */
+static thread_t* sched_alloc() {
+    int enabled = spinlock_acquire_irqsave(&sched_thread_lock);
+    thread_t* thread = sched_free_threads;
+    if(thread) {
+        sched_free_threads = thread->next;
+    } else {
+        uintptr_t block = pfa_alloc_block(SCHED_STACK_PAGES, 0);
+        if(block) {
+            thread = (thread_t*)(VMM_PHYS4G_BASE + block);
+        }
+    }
+    spinlock_release_irqrestore(&sched_thread_lock, enabled);
+    return thread;
+}
+
+/**
+ * @brief Returns the block of a thread for reuse.
+ */
+static void sched_free(thread_t* thread) {
+    int enabled = spinlock_acquire_irqsave(&sched_thread_lock);
+    thread->next = sched_free_threads;
+    sched_free_threads = thread;
+    spinlock_release_irqrestore(&sched_thread_lock, enabled);
+}
+
+/**
+ * @brief Builds a frame at the top of a stack block that #sched_switch returns into \c entry.
+ *
+ * @return the initial stack pointer.
+ */
+static uintptr_t sched_init_stack(thread_t* block, void (*entry)()) {
+    uintptr_t* stack = (uintptr_t*)((uintptr_t)block + SCHED_STACK_PAGES * HE_PAGE_SIZE);
+    // entry is reached like a called function, with a misaligned stack and a return address
+    *--stack = 0;
+    *--stack = (uintptr_t)entry;
+    for(int i = 0; i < SCHED_SWITCH_REGS; i++) {
+        *--stack = 0;
+    }
+    return (uintptr_t)stack;
+}
+
+/**
+ * @brief Completes a context switch on the new thread. Unlocks the run queue.
+ */
+static void sched_finish() {
+    sched_rq_t* rq = PERCPU_PTR(sched_rq);
+    thread_t* prev = rq->prev;
+    rq->prev = NULL;
+    int dead = prev && prev->state == THREAD_DEAD;
+    // the registers of a preempted or yielding thread are saved now, it may be stolen
+    if(prev && prev->state == THREAD_RUNNING && prev != rq->idle) {
+        sched_enqueue(rq, prev);
+    }
+    sched_timer_update(rq);
+    spinlock_release(&rq->lock);
+    // nothing runs on the stack of the exited thread anymore
+    if(dead) {
+        sched_free(prev);
+    }
+}
+
+/**
+ * @brief Switches to the next ready thread.
+ *
+ * Called with interrupts disabled and the run queue locked, the lock is released on return.
+ * The current thread keeps running if no other thread is ready, unless it sleeps or exited.
+ */
+static void sched_schedule(sched_rq_t* rq) {
+    thread_t* prev = rq->current;
+    PERCPU_WRITE(sched_resched, 0);
+    thread_t* next = sched_dequeue(rq);
+    if(!next) {
+        next = prev->state == THREAD_RUNNING ? prev : rq->idle;
+    }
+    if(next == prev) {
+        prev->state = THREAD_RUNNING;
+        sched_timer_update(rq);
+        spinlock_release(&rq->lock);
+        return;
+    }
+    if(prev == rq->idle) {
+        prev->state = THREAD_READY;
+    }
+    next->state = THREAD_RUNNING;
+    rq->current = next;
+    rq->prev = prev;
+    rq->switches++;
+    // a new time slice, the tick is armed again by sched_finish
+    rq->tick = 0;
+    PERCPU_WRITE(sched_thread, next);
+    // threads only switch outside of read-side critical sections
+    rcu_quiescent();
+    sched_switch(&prev->rsp, next->rsp);
+    sched_finish();
+}
+
+/**
+ * @brief First function of every thread, entered from #sched_switch.
+ */
+static void sched_thread_start() {
+    sched_finish();
+    INT_ENABLE();
+    thread_t* self = sched_current();
+    self->func(self->arg);
+    sched_exit();
+}
+
+/**
+ * @brief Ends the time slice of the current thread, if other threads are ready.
+ */
+INT_FAST_HANDLER static void sched_tick(int_frame_t* frame) {
+    (void)frame;
+    sched_rq_t* rq = PERCPU_PTR(sched_rq);
+    uint64_t now = cpu_rdtsc();
+    rq->interrupts++;
+    // the timer is disarmed, it may also have fired early in one-shot mode
+    rq->deadline = 0;
+    // unlocked reads, a stale value only delays the switch to the next tick
+    if(rq->tick && rq->tick <= now) {
+        rq->tick = 0;
+        if(rq->head || DEQUE_COUNT(&rq->queue) > 0) {
+            PERCPU_WRITE(sched_resched, 1);
+        }
+    }
+    timer_interrupt();
+    sched_timer_update(rq);
+}
+
+/**
+ * @brief Handles the reschedule IPI. The switch happens when the interrupt returns.
+ *
+ * Also arms the tick, if threads were queued by other processors meanwhile.
+ */
+INT_FAST_HANDLER static void sched_resched_interrupt(int_frame_t* frame) {
+    (void)frame;
+    sched_timer_update(PERCPU_PTR(sched_rq));
+    lapic_eoi();
+}
+
+/**
+ * @brief Hands the timer of the current processor to the scheduler. Called by #smp_run.
+ */
+static void sched_start_cpu(void* arg) {
+    (void)arg;
+    sched_rq_t* rq = PERCPU_PTR(sched_rq);
+    int enabled = spinlock_acquire_irqsave(&rq->lock);
+    lapic_timer_stop();
+    rq->timer = 1;
+    sched_timer_update(rq);
+    spinlock_release_irqrestore(&rq->lock, enabled);
+}
+
+/**
+ * @brief Makes the boot context of the bootstrap processor its idle thread.
+ *
+ * Must be called after #percpu_init.
+ */
+void sched_init() {
+    int_register(SCHED_VECTOR_RESCHED, sched_resched_interrupt);
+    sched_init_cpu();
+}
+
+/**
+ * @brief Makes the boot context of an application processor its idle thread.
+ */
+void sched_init_cpu() {
+    unsigned int cpu = percpu_cpu();
+    thread_t* idle = &sched_idle_threads[cpu];
+    idle->next = NULL;
+    idle->state = THREAD_RUNNING;
+    idle->cpu = cpu;
+    idle->id = 0;
+    idle->name = "idle";
+    idle->func = NULL;
+    idle->arg = NULL;
+    timer_init_timer(&idle->timer, sched_timeout);
+    idle->wakeup = 0;
+    idle->woken = 0;
+    sched_topo_init(&sched_topo[cpu]);
+
+    sched_rq_t* rq = PERCPU_PTR(sched_rq);
+    rq->idle = idle;
+    rq->current = idle;
+    PERCPU_WRITE(sched_thread, idle);
+}
+
+/**
+ * @brief Starts the timer tick and work stealing on all online processors.
+ *
+ * Must be called on the bootstrap processor after #smp_init. Without a tick, threads
+ * switch only when they yield, sleep or exit.
+ */
+void sched_start() {
+    sched_steal_enable(smp_cpu_mask());
+    if(!clock_tsc_khz()) {
+        return;
+    }
+    sched_tick_cycles = clock_ns_to_tsc(SCHED_TICK_US * CLOCK_NS_PER_US);
+    sched_start_ns = clock_ns();
+    lapic_timer_set_handler(sched_tick);
+    smp_run(sched_start_cpu, NULL);
+    LOG_INFO(LOG_CAT_SCHED, "sched: tickless, %u us time slices on %u processors, %s timer\n",
+            SCHED_TICK_US, smp_cpu_count(), lapic_timer_has_deadline() ? "TSC-deadline" : "one-shot");
+}
+
+/**
+ * @brief Reprograms the LAPIC timer of the current processor after its timer wheel changed.
+ *
+ * Called by timer.c with interrupts disabled.
+ */
+void sched_timer_rearm() {
+    sched_timer_update(PERCPU_PTR(sched_rq));
+}
+
+/**
+ * @brief Makes busy processors without timer tick check whether they need it again.
+ *
+ * Used by RCU when a grace period starts that waits for them.
+ *
+ * @param cpus processors to check, others are ignored
+ */
+void sched_nohz_kick(uint64_t cpus) {
+    cpus &= sched_nohz_cpus;
+    while(cpus) {
+        unsigned int cpu = __builtin_ctzll(cpus);
+        cpus &= cpus - 1;
+        lapic_send_ipi(smp_apic_id(cpu), SCHED_VECTOR_RESCHED);
+    }
+}
+
+/**
+ * @brief Creates a thread and queues it on a processor.
+ *
+ * @param name name for debugging
+ * @param func function executed by the thread
+ * @param arg argument of \c func
+ * @param cpu index of the processor
+ * @return the thread, or \c NULL if no memory was available
+ */
+thread_t* sched_create(const char* name, thread_func_t func, void* arg, unsigned int cpu) {
+    thread_t* thread = sched_alloc();
+    if(!thread) {
+        return NULL;
+    }
+    thread->rsp = sched_init_stack(thread, sched_thread_start);
+    thread->cpu = cpu;
+    thread->id = __sync_add_and_fetch(&sched_next_id, 1);
+    thread->name = name;
+    thread->func = func;
+    thread->arg = arg;
+    timer_init_timer(&thread->timer, sched_timeout);
+    thread->wakeup = 0;
+    thread->woken = 0;
+
+    sched_rq_t* rq = PERCPU_REMOTE(sched_rq, cpu);
+    int enabled = spinlock_acquire_irqsave(&rq->lock);
+    sched_enqueue(rq, thread);
+    sched_kick(rq, cpu);
+    spinlock_release_irqrestore(&rq->lock, enabled);
+    return thread;
+}
+
+/**
+ * @brief Returns the thread running on the current processor.
+ */
+thread_t* sched_current() {
+    return PERCPU_READ(sched_thread);
+}
+
+/**
+ * @brief Lets the other ready threads of the current processor run first.
+ */
+void sched_yield() {
+    kassertf(PREEMPT_ENABLED(), "sched_yield with preemption disabled\n");
+    int enabled = int_enabled();
+    INT_DISABLE();
+    sched_rq_t* rq = PERCPU_PTR(sched_rq);
+    spinlock_acquire(&rq->lock);
+    sched_schedule(rq);
+    if(enabled) {
+        INT_ENABLE();
+    }
+}
+
+/**
+ * @brief Sleeps until #sched_wakeup is called or \c us microseconds passed.
+ *
+ * Returns immediately, if a wakeup arrived since the last sleep.
+ * Must not be called with preemption disabled.
+ *
+ * @param us timeout in microseconds, rounded up to a tick of the timer wheel, zero to sleep
+ * without timeout
+ * @return non-zero, if the thread was woken by #sched_wakeup
+ */
+int sched_sleep(uint64_t us) {
+    kassertf(PREEMPT_ENABLED(), "sched_sleep with preemption disabled\n");
+    int enabled = int_enabled();
+    INT_DISABLE();
+    sched_rq_t* rq = PERCPU_PTR(sched_rq);
+    spinlock_acquire(&rq->lock);
+    thread_t* self = rq->current;
+    kassertf(self != rq->idle, "the idle thread must not sleep\n");
+    int woken = 1;
+    if(self->wakeup) {
+        self->wakeup = 0;
+        spinlock_release(&rq->lock);
+    } else {
+        self->state = THREAD_SLEEPING;
+        self->woken = 0;
+        if(us) {
+            timer_add(&self->timer, cpu_rdtsc() + clock_ns_to_tsc(us * CLOCK_NS_PER_US), 0);
+        }
+        sched_schedule(rq);
+        woken = self->woken;
+        // a late timeout must not end the next sleep
+        if(us) {
+            timer_cancel_sync(&self->timer);
+        }
+    }
+    if(enabled) {
+        INT_ENABLE();
+    }
+    return woken;
+}
+
+/**
+ * @brief Wakes a sleeping thread, or makes its next sleep return immediately.
+ *
+ * May be called with interrupts disabled, but not from fast interrupt handlers.
+ */
+void sched_wakeup(thread_t* thread) {
+    int enabled = int_enabled();
+    INT_DISABLE();
+    sched_rq_t* rq = sched_lock_thread(thread);
+    if(thread->state == THREAD_SLEEPING) {
+        // the sleeping thread cancels its timeout
+        thread->woken = 1;
+        sched_enqueue(rq, thread);
+        sched_kick(rq, thread->cpu);
+    } else {
+        thread->wakeup = 1;
+    }
+    spinlock_release(&rq->lock);
+    if(enabled) {
+        INT_ENABLE();
+    }
+}
+
+/**
+ * @brief Ends the current thread.
+ */
+void sched_exit() {
+    INT_DISABLE();
+    sched_rq_t* rq = PERCPU_PTR(sched_rq);
+    spinlock_acquire(&rq->lock);
+    kassertf(rq->current != rq->idle, "the idle thread must not exit\n");
+    rq->current->state = THREAD_DEAD;
+    sched_schedule(rq);
+    kpanic("exited thread was resumed\n");
+    while(1);
+}
+
+/**
+ * @brief Runs the idle loop of the current processor. Called at the end of the boot code.
+ */
+void sched_idle() {
+    sched_rq_t* rq = PERCPU_PTR(sched_rq);
+    uint64_t self = 1ull << percpu_cpu();
+    while(1) {
+        INT_DISABLE();
+        if(PERCPU_READ(sched_resched)) {
+            if(sched_idle_cpus & self) {
+                __sync_fetch_and_and(&sched_idle_cpus, ~self);
+            }
+            INT_ENABLE();
+            sched_yield();
+            continue;
+        }
+        if(softirq_pending()) {
+            // left over by a pass that ran out of budget, no interrupt returns while halted
+            INT_ENABLE();
+            softirq_run();
+            continue;
+        }
+        if(sched_steal_cpus & self) {
+            // the locked operation orders the bit before the loads of the deques, see sched_offer
+            __sync_fetch_and_or(&sched_idle_cpus, self);
+            thread_t* thread = sched_steal();
+            if(thread) {
+                __sync_fetch_and_and(&sched_idle_cpus, ~self);
+                spinlock_acquire(&rq->lock);
+                sched_append(rq, thread);
+                spinlock_release(&rq->lock);
+                INT_ENABLE();
+                sched_yield();
+                continue;
+            }
+        }
+        // an idle processor holds no RCU references, so grace periods do not wait for it
+        // the timer is armed for the next timer wheel tick only, see sched_timer_update
+        rcu_idle_enter();
+        INT_ENABLE_HALT();
+        rcu_idle_exit();
+        rq->wakeups++;
+    }
+}
+
+/**
+ * @brief Switches threads when an interrupt returns, if it was requested and is allowed.
+ *
+ * Called by #int_return with interrupts disabled and the SSE state saved.
+ */
+void sched_preempt_irq() {
+    if(!PERCPU_READ(sched_resched) || !PREEMPT_ENABLED()) {
+        return;
+    }
+    sched_rq_t* rq = PERCPU_PTR(sched_rq);
+    spinlock_acquire(&rq->lock);
+    rq->preemptions++;
+    sched_schedule(rq);
+}
+
+/// stack pointers of the two contexts of the raw switch measurement
+static uintptr_t sched_bench_rsp[2];
+
+/**
+ * @brief Switches straight back to #sched_benchmark, forever.
+ */
+static void sched_bench_peer() {
+    while(1) {
+        sched_switch(&sched_bench_rsp[1], sched_bench_rsp[0]);
+    }
+}
+
+/**
+ * @brief Yields to the other benchmark thread #SCHED_BENCHMARK_ROUNDS times.
+ */
+static void sched_bench_thread(void* arg) {
+    sched_bench_t* bench = arg;
+    sched_rq_t* rq = PERCPU_PTR(sched_rq);
+    uint64_t switches = rq->switches;
+    uint64_t start = cpu_rdtsc();
+    for(int i = 0; i < SCHED_BENCHMARK_ROUNDS; i++) {
+        sched_yield();
+    }
+    uint64_t cycles = cpu_rdtsc() - start;
+    switches = rq->switches - switches;
+    // the interval of the first thread is covered by the other one completely
+    if(__sync_fetch_and_add(&bench->done, 1) == 0) {
+        bench->cycles = cycles;
+        bench->switches = switches;
+    }
+}
+
+/**
+ * @brief Spins for #SCHED_FORK_WORK cycles and records the start latency.
+ */
+static void sched_fork_thread(void* arg) {
+    sched_fork_task_t* task = arg;
+    uint64_t start = cpu_rdtsc();
+    task->latency = start - task->forked;
+    uint64_t now;
+    while((now = cpu_rdtsc()) - start < SCHED_FORK_WORK) {
+        asm volatile ("pause");
+    }
+    task->finished = now;
+    __sync_fetch_and_add(&sched_fork_done, 1);
+}
+
+/**
+ * @brief Forks #SCHED_FORK_THREADS threads on the current processor and waits for them.
+ *
+ * @param cpus processors allowed to steal the threads
+ * @return cycles until the last thread finished, or zero if not all threads could be created
+ */
+static uint64_t sched_fork_round(uint64_t cpus) {
+    sched_steal_enable(cpus);
+    sched_fork_done = 0;
+    unsigned int cpu = percpu_cpu();
+    unsigned int forked = 0;
+    uint64_t start = cpu_rdtsc();
+    for(; forked < SCHED_FORK_THREADS; forked++) {
+        sched_fork_tasks[forked].forked = cpu_rdtsc();
+        if(!sched_create("fork", sched_fork_thread, &sched_fork_tasks[forked], cpu)) {
+            break;
+        }
+    }
+    // join
+    while(sched_fork_done < forked) {
+        sched_yield();
+    }
+    sched_steal_enable(0);
+    if(forked < SCHED_FORK_THREADS) {
+        return 0;
+    }
+    uint64_t end = start;
+    for(unsigned int i = 0; i < SCHED_FORK_THREADS; i++) {
+        if(sched_fork_tasks[i].finished > end) {
+            end = sched_fork_tasks[i].finished;
+        }
+    }
+    return end - start;
+}
+
+/**
+ * @brief Measures the throughput and the start latency of fork-join rounds when 1, 2, 4,
+ * ... of the online processors steal the forked threads, and logs the results.
+ *
+ * The latencies compare time stamp counters of different processors, which are assumed
+ * to be synchronized.
+ */
+static void sched_fork_benchmark() {
+    uint64_t self = 1ull << percpu_cpu();
+    uint64_t others = smp_cpu_mask() & ~self;
+    uint64_t cpus = self;
+    for(unsigned int count = 1; count <= SCHED_FORK_MAX_CPUS; count *= 2) {
+        while(bits_popcount(cpus) < count && others) {
+            cpus |= others & -others;
+            others &= others - 1;
+        }
+        if(bits_popcount(cpus) < count) {
+            break;
+        }
+        uint64_t cycles = sched_fork_round(cpus);
+        if(!cycles) {
+            LOG_INFO(LOG_CAT_SCHED, "sched: fork-join failed, out of memory\n");
+            return;
+        }
+        // insertion sort for the percentiles
+        uint64_t latency[SCHED_FORK_THREADS];
+        for(unsigned int i = 0; i < SCHED_FORK_THREADS; i++) {
+            uint64_t value = sched_fork_tasks[i].latency;
+            unsigned int j = i;
+            for(; j > 0 && latency[j - 1] > value; j--) {
+                latency[j] = latency[j - 1];
+            }
+            latency[j] = value;
+        }
+        LOG_INFO(LOG_CAT_SCHED, "sched: fork-join on %2u processors: %lu threads/ms, "
+                "start latency p50 %lu p99 %lu max %lu cycles\n", count,
+                (uint64_t)SCHED_FORK_THREADS * 1000000 / clock_tsc_to_ns(cycles),
+                latency[SCHED_FORK_THREADS / 2], latency[SCHED_FORK_THREADS * 99 / 100],
+                latency[SCHED_FORK_THREADS - 1]);
+    }
+}
+
+/**
+ * @brief Measures the cost of context switches on the current processor and the fork-join
+ * throughput with work stealing, and logs the results.
+ *
+ * Must be called before #sched_start.
+ */
+void sched_benchmark() {
+    // bare sched_switch between two stacks
+    thread_t* block = sched_alloc();
+    if(!block) {
+        return;
+    }
+    sched_bench_rsp[1] = sched_init_stack(block, sched_bench_peer);
+    int enabled = int_enabled();
+    INT_DISABLE();
+    uint64_t start = cpu_rdtsc();
+    for(int i = 0; i < SCHED_BENCHMARK_ROUNDS; i++) {
+        sched_switch(&sched_bench_rsp[0], sched_bench_rsp[1]);
+    }
+    uint64_t raw = (cpu_rdtsc() - start) / (2 * SCHED_BENCHMARK_ROUNDS);
+    if(enabled) {
+        INT_ENABLE();
+    }
+    sched_free(block);
+
+    // two threads yielding to each other through the run queue
+    sched_bench_t bench = { .done = 0, .cycles = 0, .switches = 0 };
+    unsigned int cpu = percpu_cpu();
+    int threads = 0;
+    threads += sched_create("bench-a", sched_bench_thread, &bench, cpu) != NULL;
+    threads += sched_create("bench-b", sched_bench_thread, &bench, cpu) != NULL;
+    // the threads use bench, which is on this stack
+    while(bench.done < threads) {
+        sched_yield();
+    }
+    if(threads < 2) {
+        return;
+    }
+    LOG_INFO(LOG_CAT_SCHED, "sched: context switch %lu cycles, yield to another thread %lu cycles\n",
+            raw, bench.switches ? bench.cycles / bench.switches : 0);
+
+    sched_fork_benchmark();
+}
+
+/**
+ * @brief Writes the topology and the number of context switches and steals of each processor to kstdio.
+ */
+void sched_dump() {
+    // rates since sched_start, in hundredths of a second
+    uint64_t centis = sched_start_ns ? (clock_ns() - sched_start_ns) / (CLOCK_NS_PER_SEC / 100) : 0;
+    for(unsigned int cpu = 0; cpu < HE_MAX_CPUS; cpu++) {
+        if(!percpu_offsets[cpu]) {
+            continue;
+        }
+        sched_rq_t* rq = PERCPU_REMOTE(sched_rq, cpu);
+        kprintf("cpu %2u: package %u core %u, %lu switches, %lu preemptions, %lu steals, %ld ready\n",
+                cpu, sched_topo[cpu].package, sched_topo[cpu].core, rq->switches, rq->preemptions,
+                rq->steals, DEQUE_COUNT(&rq->queue) + rq->pending);
+        if(centis) {
+            kprintf("        %lu wakeups/s from idle, %lu timer interrupts/s, %s\n",
+                    rq->wakeups * 100 / centis, rq->interrupts * 100 / centis,
+                    rq->nohz ? "busy without tick" : rq->tick ? "ticking" : "no tick");
+        }
+    }
+}
@@ -0,0 +1,33 @@
+section .text
+bits 64
+
+;; export the context switch to @ref sched.c
+global sched_switch
+
+;;; @brief Saves the callee saved registers of the current thread and resumes another one.
+;;;
+;;; C signature: void sched_switch(uintptr_t* save, uintptr_t rsp)
+;;;
+;;; The caller saved registers, including all SSE registers, are already saved by the
+;;; compiler, because this is a function call. A new thread starts with the frame built
+;;; by sched_create, which returns into sched_thread_start.
+;;;
+;;; @param rdi receives the stack pointer of the current thread
+;;; @param rsi stack pointer of the next thread, saved by an earlier call
+sched_switch:
+    push rbp
+    push rbx
+    push r12
+    push r13
+    push r14
+    push r15
+    mov [rdi], rsp
+
+    mov rsp, rsi
+    pop r15
+    pop r14
+    pop r13
+    pop r12
+    pop rbx
+    pop rbp
+    ret
@@ -0,0 +1,461 @@
+/**
+ * @file timer.c
+ *
+ * @author Fabian Thorand
+ * @date   19.10.2026
+ *
+ * @brief Per-CPU hierarchical timer wheels for timeouts.
+ *
+ * The clock of a wheel is the next tick it has to process. A timer expiring \c delta ticks
+ * after the clock goes to the lowest level whose slots span \c delta, into the slot the
+ * expiry falls in. The slot of level \c n for a given expiry is visited once every
+ * #TIMER_SLOTS^(n+1) ticks, when the clock reaches the start of its range, and its timers
+ * are cascaded into the lower levels then.
+ *
+ * A bitmap per level marks the non-empty slots, so the next tick that has work is found
+ * without scanning: either the next non-empty slot of level 0, or the start of the next
+ * non-empty slot of a higher level. Idle wheels jump their clock straight to it.
+ *
+ * Expired timers are moved to a list of the wheel, and their callbacks run from there
+ * without the lock held. #timer_cancel can remove them until their callback starts.
+ */
+
+#include "kernel/sched/timer.h"
+#include "kernel/sched/sched.h"
+
+#include "kernel/sync/spinlock.h"
+
+#include "kernel/interrupts/int.h"
+#include "kernel/interrupts/softirq.h"
+
+#include "kernel/time/clock.h"
+
+#include "kernel/klibc/kstdio.h"
+
+#include "kernel/cpu.h"
+#include "kernel/debug.h"
+#include "kernel/helium.h"
+#include "kernel/log.h"
+#include "kernel/percpu.h"
+
+/// mask of the slot index of a level
+#define TIMER_SLOT_MASK (TIMER_SLOTS - 1)
+/// slot number of timers in the list of expired timers
+#define TIMER_SLOT_EXPIRED (TIMER_LEVELS * TIMER_SLOTS)
+/// number of ticks spanned by all levels
+#define TIMER_SPAN (1ull << (TIMER_SLOT_BITS * TIMER_LEVELS))
+/// number of timers added and cancelled by #timer_benchmark
+#define TIMER_BENCHMARK_COUNT 1000000
+/// number of timers pending at the same time during #timer_benchmark
+#define TIMER_BENCHMARK_BATCH 1000
+
+/**
+ * @brief The timer wheel of a processor.
+ */
+typedef struct {
+    spinlock_t lock;                                ///< protects the wheel and the timers in it
+    uint64_t clock;                                 ///< next tick to process
+    volatile uint64_t next_tsc;                     ///< TSC of the next tick with work, zero if there is none
+    volatile int raised;                            ///< non-zero while #timer_expire is pending
+    uint64_t pending[TIMER_LEVELS];                 ///< bit \c i of a level is set if its slot \c i is not empty
+    timer_t* slots[TIMER_LEVELS * TIMER_SLOTS];     ///< the timers of each slot
+    timer_t* expired;                               ///< expired timers whose callbacks did not start yet
+    timer_t* volatile running;                      ///< timer whose callback is running
+    unsigned int count;                             ///< number of timers in the slots
+    softirq_work_t work;                            ///< work item running #timer_expire
+    uint64_t expiries;                              ///< number of timers that expired
+    uint64_t cascades;                              ///< number of timers moved to a lower level
+} timer_wheel_t;
+
+static void timer_expire(softirq_work_t* work);
+
+static LOCK_CLASS(timer_wheel_class, "timer-wheel");
+
+/// the timer wheel of each processor
+static PERCPU_DEFINE(timer_wheel_t, timer_wheel) = {
+    .lock = SPINLOCK_INIT(&timer_wheel_class),
+    .clock = 0,
+    .next_tsc = 0,
+    .raised = 0,
+    .expired = NULL,
+    .running = NULL,
+    .count = 0,
+    .work = SOFTIRQ_WORK_INIT(timer_expire),
+    .expiries = 0,
+    .cascades = 0
+};
+
+/// length of a tick in TSC cycles
+static uint64_t timer_tick_cycles = 0;
+
+/// timers of #timer_benchmark
+static timer_t timer_bench_timers[TIMER_BENCHMARK_BATCH];
+
+/**
+ * @brief Inserts a timer at the head of a list.
+ */
+static void timer_link(timer_t** head, timer_t* timer) {
+    timer->next = *head;
+    if(*head) {
+        (*head)->pprev = &timer->next;
+    }
+    *head = timer;
+    timer->pprev = head;
+}
+
+/**
+ * @brief Removes a timer from its list.
+ */
+static void timer_unlink(timer_t* timer) {
+    *timer->pprev = timer->next;
+    if(timer->next) {
+        timer->next->pprev = timer->pprev;
+    }
+    timer->pprev = NULL;
+}
+
+/**
+ * @brief Puts a timer into the slot for its expiry, relative to the clock of the wheel.
+ *
+ * Timers beyond the span of the wheel go to the last slot of the highest level and are
+ * cascaded there again.
+ */
+static void timer_insert(timer_wheel_t* wheel, timer_t* timer) {
+    uint64_t expires = timer->expires > wheel->clock ? timer->expires : wheel->clock;
+    uint64_t delta = expires - wheel->clock;
+    if(delta >= TIMER_SPAN) {
+        delta = TIMER_SPAN - 1;
+        expires = wheel->clock + delta;
+    }
+    unsigned int level = 0;
+    while(delta >> (TIMER_SLOT_BITS * (level + 1))) {
+        level++;
+    }
+    unsigned int index = (expires >> (TIMER_SLOT_BITS * level)) & TIMER_SLOT_MASK;
+    timer->slot = level * TIMER_SLOTS + index;
+    timer_link(&wheel->slots[timer->slot], timer);
+    wheel->pending[level] |= 1ull << index;
+    wheel->count++;
+}
+
+/**
+ * @brief Removes a timer from the slots or the list of expired timers.
+ */
+static void timer_remove(timer_wheel_t* wheel, timer_t* timer) {
+    timer_unlink(timer);
+    if(timer->slot == TIMER_SLOT_EXPIRED) {
+        return;
+    }
+    if(!wheel->slots[timer->slot]) {
+        wheel->pending[timer->slot / TIMER_SLOTS] &= ~(1ull << (timer->slot % TIMER_SLOTS));
+    }
+    wheel->count--;
+}
+
+/**
+ * @brief Returns the distance from \c start to the next set bit of \c mask, wrapping around.
+ *
+ * @param mask a non-zero bitmap of slots
+ */
+static unsigned int timer_next_bit(uint64_t mask, unsigned int start) {
+    uint64_t rotated = start ? (mask >> start) | (mask << (TIMER_SLOTS - start)) : mask;
+    return __builtin_ctzll(rotated);
+}
+
+/**
+ * @brief Returns the next tick at which a timer expires or a slot is cascaded.
+ *
+ * @return the tick, or \c UINT64_MAX if the wheel is empty
+ */
+static uint64_t timer_wheel_next(timer_wheel_t* wheel) {
+    uint64_t clock = wheel->clock;
+    uint64_t next = UINT64_MAX;
+    if(wheel->pending[0]) {
+        next = clock + timer_next_bit(wheel->pending[0], clock & TIMER_SLOT_MASK);
+    }
+    for(unsigned int level = 1; level < TIMER_LEVELS; level++) {
+        if(!wheel->pending[level]) {
+            continue;
+        }
+        unsigned int shift = TIMER_SLOT_BITS * level;
+        uint64_t range = clock >> shift;
+        unsigned int index = range & TIMER_SLOT_MASK;
+        uint64_t distance;
+        if(clock & ((1ull << shift) - 1)) {
+            // the slot of the current range was cascaded when the range began
+            distance = 1 + timer_next_bit(wheel->pending[level], (index + 1) & TIMER_SLOT_MASK);
+        } else {
+            distance = timer_next_bit(wheel->pending[level], index);
+        }
+        uint64_t tick = (range + distance) << shift;
+        if(tick < next) {
+            next = tick;
+        }
+    }
+    return next;
+}
+
+/**
+ * @brief Recomputes #timer_wheel_t::next_tsc after the wheel changed.
+ */
+static void timer_update_next(timer_wheel_t* wheel) {
+    uint64_t tick = timer_wheel_next(wheel);
+    wheel->next_tsc = tick == UINT64_MAX ? 0 : tick * timer_tick_cycles;
+}
+
+/**
+ * @brief Processes all ticks up to \c now and moves the expired timers to the list.
+ */
+static void timer_advance(timer_wheel_t* wheel, uint64_t now) {
+    while(wheel->clock <= now) {
+        uint64_t tick = timer_wheel_next(wheel);
+        if(tick > now) {
+            wheel->clock = now + 1;
+            break;
+        }
+        wheel->clock = tick;
+        // the higher levels first, they may cascade into the slots starting at this tick
+        for(unsigned int level = TIMER_LEVELS - 1; level > 0; level--) {
+            unsigned int shift = TIMER_SLOT_BITS * level;
+            if(tick & ((1ull << shift) - 1)) {
+                continue;
+            }
+            unsigned int index = (tick >> shift) & TIMER_SLOT_MASK;
+            timer_t* timer = wheel->slots[level * TIMER_SLOTS + index];
+            wheel->slots[level * TIMER_SLOTS + index] = NULL;
+            wheel->pending[level] &= ~(1ull << index);
+            while(timer) {
+                timer_t* next = timer->next;
+                wheel->count--;
+                timer_insert(wheel, timer);
+                wheel->cascades++;
+                timer = next;
+            }
+        }
+        unsigned int index = tick & TIMER_SLOT_MASK;
+        while(wheel->slots[index]) {
+            timer_t* timer = wheel->slots[index];
+            timer_remove(wheel, timer);
+            timer->slot = TIMER_SLOT_EXPIRED;
+            timer_link(&wheel->expired, timer);
+            wheel->expiries++;
+        }
+        wheel->clock = tick + 1;
+    }
+}
+
+/**
+ * @brief Runs the callbacks of the expired timers of a wheel.
+ */
+static void timer_expire(softirq_work_t* work) {
+    timer_wheel_t* wheel = (timer_wheel_t*)((uintptr_t)work - offsetof(timer_wheel_t, work));
+    int enabled = int_enabled();
+    INT_DISABLE();
+    spinlock_acquire(&wheel->lock);
+    wheel->raised = 0;
+    timer_advance(wheel, cpu_rdtsc() / timer_tick_cycles);
+    while(wheel->expired) {
+        timer_t* timer = wheel->expired;
+        timer_unlink(timer);
+        wheel->running = timer;
+        spinlock_release(&wheel->lock);
+        INT_ENABLE();
+        // the callback may add the timer again
+        timer->func(timer);
+        INT_DISABLE();
+        spinlock_acquire(&wheel->lock);
+        wheel->running = NULL;
+    }
+    timer_update_next(wheel);
+    spinlock_release(&wheel->lock);
+    sched_timer_rearm();
+    if(enabled) {
+        INT_ENABLE();
+    }
+}
+
+/**
+ * @brief Moves an expiry to the roundest tick at most \c slack ticks later.
+ */
+static uint64_t timer_coalesce(uint64_t expires, uint64_t slack) {
+    uint64_t limit = expires + slack;
+    uint64_t diff = expires ^ limit;
+    if(!diff) {
+        return expires;
+    }
+    // clears the bits below the highest one that differs, which stays in [expires, limit]
+    return limit & ~((1ull << (63 - __builtin_clzll(diff))) - 1);
+}
+
+/**
+ * @brief Converts the tick length to TSC cycles. Must be called after #clock_init.
+ */
+void timer_init() {
+    timer_tick_cycles = clock_ns_to_tsc(TIMER_TICK_US * CLOCK_NS_PER_US);
+    LOG_INFO(LOG_CAT_TIME, "timer: %u us ticks, %u levels of %u slots\n",
+            TIMER_TICK_US, TIMER_LEVELS, TIMER_SLOTS);
+}
+
+/**
+ * @brief Initializes a timer.
+ */
+void timer_init_timer(timer_t* timer, timer_func_t func) {
+    timer->next = NULL;
+    timer->pprev = NULL;
+    timer->expires = 0;
+    timer->func = func;
+    timer->cpu = 0;
+    timer->slot = 0;
+}
+
+/**
+ * @brief Adds a timer to the wheel of the current processor.
+ *
+ * The timer must not be pending. It expires on the first tick at or after \c deadline,
+ * or up to \c slack cycles later on a round tick.
+ *
+ * @param deadline TSC value of the expiry
+ * @param slack number of TSC cycles the expiry may be delayed for coalescing
+ */
+void timer_add(timer_t* timer, uint64_t deadline, uint64_t slack) {
+    kassertf(timer_tick_cycles, "timer_add before timer_init\n");
+    uint64_t expires = timer_coalesce((deadline + timer_tick_cycles - 1) / timer_tick_cycles,
+            slack / timer_tick_cycles);
+
+    int enabled = int_enabled();
+    INT_DISABLE();
+    timer_wheel_t* wheel = PERCPU_PTR(timer_wheel);
+    spinlock_acquire(&wheel->lock);
+    kassertf(!timer->pprev, "timer added twice\n");
+    if(!wheel->count) {
+        // nothing to cascade, an idle wheel starts over at the current tick
+        wheel->clock = cpu_rdtsc() / timer_tick_cycles;
+    }
+    timer->expires = expires;
+    timer->cpu = percpu_cpu();
+    timer_insert(wheel, timer);
+    uint64_t next = wheel->next_tsc;
+    timer_update_next(wheel);
+    spinlock_release(&wheel->lock);
+    if(wheel->next_tsc != next) {
+        sched_timer_rearm();
+    }
+    if(enabled) {
+        INT_ENABLE();
+    }
+}
+
+/**
+ * @brief Removes a pending timer from its wheel.
+ *
+ * @return non-zero, if the timer was pending, zero if it expired or was not added
+ */
+int timer_cancel(timer_t* timer) {
+    if(!timer->pprev) {
+        return 0;
+    }
+    timer_wheel_t* wheel = PERCPU_REMOTE(timer_wheel, timer->cpu);
+    int enabled = spinlock_acquire_irqsave(&wheel->lock);
+    int pending = timer->pprev != NULL;
+    if(pending) {
+        timer_remove(wheel, timer);
+        // a later next tick only costs the owner one needless interrupt
+        timer_update_next(wheel);
+    }
+    spinlock_release_irqrestore(&wheel->lock, enabled);
+    return pending;
+}
+
+/**
+ * @brief Removes a pending timer and waits until its callback finished, if it is running.
+ *
+ * Must not be called by the callback of the timer. Callbacks run with preemption disabled,
+ * so a running callback always belongs to another processor.
+ *
+ * @return non-zero, if the timer was pending
+ */
+int timer_cancel_sync(timer_t* timer) {
+    int pending = timer_cancel(timer);
+    timer_wheel_t* wheel = PERCPU_REMOTE(timer_wheel, timer->cpu);
+    while(wheel->running == timer) {
+        asm volatile ("pause");
+    }
+    return pending;
+}
+
+/**
+ * @brief Returns the TSC value of the next tick the wheel of the current processor must
+ * process, or zero if it is empty.
+ */
+INT_FAST_HANDLER uint64_t timer_next() {
+    timer_wheel_t* wheel = PERCPU_PTR(timer_wheel);
+    // the expiry is already on its way and reprograms the timer afterwards
+    return wheel->raised ? 0 : wheel->next_tsc;
+}
+
+/**
+ * @brief Runs the expired timers of the current processor as deferred work, if the next
+ * tick has come. Called on every LAPIC timer interrupt.
+ */
+INT_FAST_HANDLER void timer_interrupt() {
+    timer_wheel_t* wheel = PERCPU_PTR(timer_wheel);
+    uint64_t next = wheel->next_tsc;
+    if(next && next <= cpu_rdtsc()) {
+        wheel->raised = 1;
+        softirq_raise(&wheel->work);
+    }
+}
+
+/**
+ * @brief Does nothing, the timers of #timer_benchmark never expire.
+ */
+static void timer_bench_func(timer_t* timer) {
+    (void)timer;
+}
+
+/**
+ * @brief Measures the cost of adding and cancelling one million timers and logs the result.
+ */
+void timer_benchmark() {
+    if(!timer_tick_cycles) {
+        return;
+    }
+    // deadlines spread over the lowest three levels
+    uint64_t range = (uint64_t)TIMER_SLOTS * TIMER_SLOTS * TIMER_SLOTS * timer_tick_cycles;
+    uint64_t base = cpu_rdtsc() + range;
+    uint64_t seed = 1;
+    uint64_t add = 0;
+    uint64_t cancel = 0;
+    for(unsigned int i = 0; i < TIMER_BENCHMARK_BATCH; i++) {
+        timer_init_timer(&timer_bench_timers[i], timer_bench_func);
+    }
+    for(unsigned int round = 0; round < TIMER_BENCHMARK_COUNT / TIMER_BENCHMARK_BATCH; round++) {
+        uint64_t start = cpu_rdtsc();
+        for(unsigned int i = 0; i < TIMER_BENCHMARK_BATCH; i++) {
+            seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+            timer_add(&timer_bench_timers[i], base + (seed >> 16) % range, 0);
+        }
+        uint64_t middle = cpu_rdtsc();
+        for(unsigned int i = 0; i < TIMER_BENCHMARK_BATCH; i++) {
+            timer_cancel(&timer_bench_timers[i]);
+        }
+        cancel += cpu_rdtsc() - middle;
+        add += middle - start;
+    }
+    LOG_INFO(LOG_CAT_TIME, "timer: %u timers, add %lu cycles, cancel %lu cycles\n",
+            TIMER_BENCHMARK_COUNT, add / TIMER_BENCHMARK_COUNT, cancel / TIMER_BENCHMARK_COUNT);
+}
+
+/**
+ * @brief Writes the number of timers, expiries and cascades of each processor to kstdio.
+ */
+void timer_dump() {
+    for(unsigned int cpu = 0; cpu < HE_MAX_CPUS; cpu++) {
+        if(!percpu_offsets[cpu]) {
+            continue;
+        }
+        timer_wheel_t* wheel = PERCPU_REMOTE(timer_wheel, cpu);
+        kprintf("cpu %2u: %u timers, %lu expired, %lu cascaded\n",
+                cpu, wheel->count, wheel->expiries, wheel->cascades);
+    }
+}
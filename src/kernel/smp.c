@@ -0,0 +1,262 @@
+/**
+ * @file smp.c
+ *
+ * @author Fabian Thorand
+ * @date   19.10.2026
+ *
+ * @brief Start-up of the application processors.
+ *
+ * All processors receive their INIT and start-up IPIs back to back, so the delays
+ * required between the IPIs are paid once and not once per processor. The bring-up
+ * time is measured from the first INIT to the last check-in and logged.
+ */
+
+#include "kernel/smp.h"
+#include "kernel/bits.h"
+#include "kernel/info.h"
+#include "kernel/cpu.h"
+#include "kernel/log.h"
+
+#include "kernel/percpu.h"
+
+#include "kernel/interrupts/lapic.h"
+#include "kernel/interrupts/softirq.h"
+
+#include "kernel/time/clock.h"
+
+#include "kernel/sync/spinlock.h"
+
+#include "kernel/mem/pfa.h"
+#include "kernel/mem/vmm.h"
+
+/// real mode entry point in boot16.asm
+extern marker_t boot16_ap;
+
+/// initial stack pointers of the application processors indexed by APIC ID, read by boot64_ap
+uintptr_t smp_ap_stacks[SMP_MAX_APIC_ID];
+
+/// bit \c i is set when the processor with index \c i is online
+static volatile uint64_t smp_online = 0;
+/// local APIC ID of each processor index
+static uint32_t smp_ids[HE_MAX_CPUS];
+/// TSC value at the check-in of each processor
+static uint64_t smp_checkin_tsc[HE_MAX_CPUS];
+
+static void smp_run_deferred(softirq_work_t* work);
+
+/// serializes #smp_run
+static spinlock_t smp_run_lock = SPINLOCK_INIT(NULL);
+/// function and argument of the current #smp_run
+static volatile smp_func_t smp_run_func = NULL;
+static void* volatile smp_run_arg = NULL;
+/// number of other processors that returned from #smp_run_func
+static volatile unsigned int smp_run_done = 0;
+/// work item running #smp_run_func on each processor
+static PERCPU_DEFINE(softirq_work_t, smp_run_work) = SOFTIRQ_WORK_INIT(smp_run_deferred);
+
+/**
+ * @brief Converts TSC cycles to microseconds.
+ */
+static uint64_t smp_us(uint64_t cycles) {
+    return clock_tsc_to_ns(cycles) / CLOCK_NS_PER_US;
+}
+
+/**
+ * @brief Waits until all processors in \c mask are online or \c us microseconds passed.
+ *
+ * With an empty mask, it waits the full time.
+ */
+static void smp_wait_online(uint64_t mask, uint64_t us) {
+    uint64_t end = cpu_rdtsc() + clock_ns_to_tsc(us * CLOCK_NS_PER_US);
+    while((!mask || (smp_online & mask) != mask) && cpu_rdtsc() < end) {
+        asm volatile ("pause");
+    }
+}
+
+/**
+ * @brief Runs the function of #smp_run on this processor.
+ */
+static void smp_run_deferred(softirq_work_t* work) {
+    (void)work;
+    smp_run_func(smp_run_arg);
+    __sync_fetch_and_add(&smp_run_done, 1);
+}
+
+/**
+ * @brief Queues #smp_run_work, the function runs when the interrupt returns.
+ */
+INT_FAST_HANDLER static void smp_run_interrupt(int_frame_t* frame) {
+    (void)frame;
+    softirq_raise(PERCPU_PTR(smp_run_work));
+    lapic_eoi();
+}
+
+/**
+ * @brief Starts all application processors and waits until they checked in.
+ *
+ * Must be called on the bootstrap processor after the local APIC timer was calibrated.
+ *
+ * @return the number of online processors, including the bootstrap processor.
+ */
+unsigned int smp_init() {
+    uint32_t bsp_id = lapic_id();
+    unsigned int bsp_index = cpu_index();
+    smp_ids[bsp_index] = bsp_id;
+    smp_checkin_tsc[bsp_index] = cpu_rdtsc();
+    __sync_fetch_and_or(&smp_online, 1ull << bsp_index);
+    int_register(SMP_VECTOR_RUN, smp_run_interrupt);
+
+    uintptr_t entry = (uintptr_t)&boot16_ap;
+    if(!clock_tsc_khz() || (entry & (HE_PAGE_SIZE - 1)) || entry >= 0x100000) {
+        LOG_ERROR(LOG_CAT_SMP, "smp: cannot start processors (entry %p)\n", (void*)entry);
+        return 1;
+    }
+
+    uint32_t targets[HE_MAX_CPUS];
+    unsigned int count = 0;
+    uint64_t expected = 0;
+    for(unsigned int i = 0; i < info_table.cpu_count; i++) {
+        he_cpu_t* cpu = &info_cpus[i];
+        if(!cpu->enabled || cpu->apic_id == bsp_id) {
+            continue;
+        }
+        // the index is derived from the APIC ID, see cpu_index
+        uint64_t bit = 1ull << (cpu->apic_id % HE_MAX_CPUS);
+        if(cpu->apic_id >= SMP_MAX_APIC_ID || (bit & (expected | smp_online))) {
+            LOG_WARN(LOG_CAT_SMP, "smp: ignoring processor with APIC ID %u\n", cpu->apic_id);
+            continue;
+        }
+        uintptr_t stack = pfa_alloc_block(SMP_AP_STACK_PAGES, 0);
+        if(!stack) {
+            LOG_WARN(LOG_CAT_SMP, "smp: out of memory for stacks\n");
+            break;
+        }
+        smp_ap_stacks[cpu->apic_id] = VMM_PHYS4G_BASE + stack + SMP_AP_STACK_PAGES * HE_PAGE_SIZE;
+        targets[count++] = cpu->apic_id;
+        expected |= bit;
+    }
+    if(count == 0) {
+        return 1;
+    }
+
+    // writing the ICR MSR in x2APIC mode does not order the stack table before the IPI
+    asm volatile ("mfence" ::: "memory");
+    uint64_t start = cpu_rdtsc();
+    for(unsigned int i = 0; i < count; i++) {
+        lapic_send_init(targets[i]);
+    }
+    smp_wait_online(0, SMP_INIT_DELAY_US);
+
+    uint64_t startup = cpu_rdtsc();
+    for(unsigned int i = 0; i < count; i++) {
+        lapic_send_startup(targets[i], entry / HE_PAGE_SIZE);
+    }
+    smp_wait_online(expected, SMP_STARTUP_DELAY_US);
+    // the second start-up IPI is only needed when the first one got lost
+    for(unsigned int i = 0; i < count; i++) {
+        if(!(smp_online & (1ull << (targets[i] % HE_MAX_CPUS)))) {
+            lapic_send_startup(targets[i], entry / HE_PAGE_SIZE);
+        }
+    }
+    smp_wait_online(expected, SMP_CHECKIN_TIMEOUT_US);
+
+    uint64_t last = startup;
+    unsigned int online = 0;
+    for(unsigned int i = 0; i < count; i++) {
+        unsigned int index = targets[i] % HE_MAX_CPUS;
+        if(!(smp_online & (1ull << index))) {
+            LOG_WARN(LOG_CAT_SMP, "smp: processor %u did not start\n", targets[i]);
+            continue;
+        }
+        online++;
+        if(smp_checkin_tsc[index] > last) {
+            last = smp_checkin_tsc[index];
+        }
+        LOG_DEBUG(LOG_CAT_SMP, "smp: processor %u online %lu us after start-up IPI\n",
+                targets[i], smp_us(smp_checkin_tsc[index] - startup));
+    }
+    LOG_INFO(LOG_CAT_SMP, "smp: %u of %u processors started in %lu us (%lu us after start-up IPI)\n",
+            online, count, smp_us(last - start), smp_us(last - startup));
+    return smp_cpu_count();
+}
+
+/**
+ * @brief Marks the current application processor as online.
+ *
+ * Called by #main_ap after the processor is initialized.
+ */
+void smp_ap_checkin(uint32_t apic_id) {
+    unsigned int index = cpu_index();
+    smp_ids[index] = apic_id;
+    smp_checkin_tsc[index] = cpu_rdtsc();
+    // full barrier, the bootstrap processor reads the entries once the bit is set
+    __sync_fetch_and_or(&smp_online, 1ull << index);
+}
+
+/**
+ * @brief Returns the number of online processors.
+ */
+unsigned int smp_cpu_count() {
+    return bits_popcount(smp_online);
+}
+
+/**
+ * @brief Returns a mask with bit \c i set, if the processor with index \c i is online.
+ */
+uint64_t smp_cpu_mask() {
+    return smp_online;
+}
+
+/**
+ * @brief Returns the local APIC ID of the online processor with index \c index.
+ */
+uint32_t smp_apic_id(unsigned int index) {
+    return smp_ids[index];
+}
+
+/**
+ * @brief Stores the local APIC IDs of the online processors in the order of their index.
+ *
+ * @param ids receives the IDs
+ * @param max number of entries of \c ids
+ * @return the number of IDs stored
+ */
+unsigned int smp_apic_ids(uint32_t* ids, unsigned int max) {
+    unsigned int count = 0;
+    uint64_t online = smp_online;
+    for(unsigned int index = 0; index < HE_MAX_CPUS && count < max; index++) {
+        if(online & (1ull << index)) {
+            ids[count++] = smp_ids[index];
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Runs a function on all online processors and waits until it returned everywhere.
+ *
+ * The other processors run the function as deferred work (see softirq.h) with
+ * interrupts enabled. Calls are serialized.
+ */
+void smp_run(smp_func_t func, void* arg) {
+    spinlock_acquire(&smp_run_lock);
+    smp_run_func = func;
+    smp_run_arg = arg;
+    smp_run_done = 0;
+
+    uint32_t ids[HE_MAX_CPUS];
+    unsigned int count = smp_apic_ids(ids, HE_MAX_CPUS);
+    uint32_t self = lapic_id();
+    // see smp_init, the IPI does not order the stores above
+    asm volatile ("mfence" ::: "memory");
+    for(unsigned int i = 0; i < count; i++) {
+        if(ids[i] != self) {
+            lapic_send_ipi(ids[i], SMP_VECTOR_RUN);
+        }
+    }
+    func(arg);
+    while(smp_run_done < count - 1) {
+        asm volatile ("pause");
+    }
+    spinlock_release(&smp_run_lock);
+}
@@ -0,0 +1,277 @@
+/**
+ * @file rcu.c
+ *
+ * @author Fabian Thorand
+ * @date   19.10.2026
+ *
+ * @brief Quiescent-state-based read-copy-update.
+ *
+ * Grace periods are numbered. Starting one sets the bits of all online processors in
+ * #rcu_gp_mask, except those that are idle, and each processor clears its own bit on its
+ * next quiescent state. The processor clearing the last bit completes the grace period.
+ * Only one grace period runs at a time, requests made meanwhile start the next one.
+ *
+ * Each processor keeps two lists of callbacks: \c next collects new ones, \c wait holds
+ * those waiting for grace period \c wait_gp. A grace period requested now must start after
+ * the caller removed the object, so its number is one more than the last one started.
+ * All list operations run on the owning processor with interrupts disabled.
+ */
+
+#include "kernel/sync/rcu.h"
+#include "kernel/sync/spinlock.h"
+
+#include "kernel/interrupts/int.h"
+#include "kernel/interrupts/softirq.h"
+
+#include "kernel/sched/sched.h"
+
+#include "kernel/klibc/kstdio.h"
+
+#include "kernel/smp.h"
+
+/**
+ * @brief The callbacks of a processor.
+ */
+typedef struct {
+    rcu_head_t* next;       ///< callbacks without grace period, newest first
+    rcu_head_t* wait;       ///< callbacks waiting for grace period \c wait_gp
+    uint64_t wait_gp;       ///< grace period \c wait must wait for
+    softirq_work_t work;    ///< work item running #rcu_process
+    uint64_t queued;        ///< number of callbacks queued on this processor
+    uint64_t invoked;       ///< number of callbacks run on this processor
+} rcu_cpu_t;
+
+static void rcu_process(softirq_work_t* work);
+
+/// zero while the processor is idle and holds no references
+PERCPU_DEFINE(unsigned int, rcu_watching) = 1;
+/// callbacks of each processor
+static PERCPU_DEFINE(rcu_cpu_t, rcu_cpu) = {
+    .next = NULL,
+    .wait = NULL,
+    .wait_gp = 0,
+    .work = SOFTIRQ_WORK_INIT(rcu_process),
+    .queued = 0,
+    .invoked = 0
+};
+
+/// number of grace periods started
+static volatile uint64_t rcu_gp_seq = 0;
+/// number of grace periods completed
+static volatile uint64_t rcu_gp_done = 0;
+/// highest grace period number requested
+static volatile uint64_t rcu_gp_requested = 0;
+/// processors that did not pass a quiescent state during the current grace period
+static volatile uint64_t rcu_gp_mask = 0;
+
+static LOCK_CLASS(rcu_gp_class, "rcu-gp");
+/// serializes starting grace periods
+static spinlock_t rcu_gp_lock = SPINLOCK_INIT(&rcu_gp_class);
+
+/**
+ * @brief Clears processors from #rcu_gp_mask and completes the grace period if none is left.
+ */
+INT_FAST_HANDLER static void rcu_report(uint64_t cpus) {
+    uint64_t old = __sync_fetch_and_and(&rcu_gp_mask, ~cpus);
+    if((old & cpus) && !(old & ~cpus)) {
+        rcu_gp_done = rcu_gp_seq;
+        // starts the next grace period and runs the callbacks of this processor
+        softirq_raise(&PERCPU_PTR(rcu_cpu)->work);
+    }
+}
+
+/**
+ * @brief Starts a grace period, if one was requested and none is running.
+ */
+static void rcu_gp_start() {
+    int enabled = spinlock_acquire_irqsave(&rcu_gp_lock);
+    if(rcu_gp_done == rcu_gp_seq && rcu_gp_requested > rcu_gp_seq) {
+        uint64_t online = smp_cpu_mask() | (1ull << percpu_cpu());
+        rcu_gp_seq++;
+        // the locked operation orders the mask before the loads of rcu_watching, which
+        // pairs with the fence in rcu_idle_enter: either this processor sees the other one
+        // idle or the other one sees its bit in the mask
+        __sync_fetch_and_or(&rcu_gp_mask, online);
+        uint64_t idle = 0;
+        for(unsigned int cpu = 0; cpu < HE_MAX_CPUS; cpu++) {
+            if((online & (1ull << cpu)) && !*(volatile unsigned int*)PERCPU_REMOTE(rcu_watching, cpu)) {
+                idle |= 1ull << cpu;
+            }
+        }
+        if(idle) {
+            rcu_report(idle);
+        }
+        // processors without tick would not notice the grace period
+        sched_nohz_kick(online & ~idle & ~(1ull << percpu_cpu()));
+    }
+    spinlock_release_irqrestore(&rcu_gp_lock, enabled);
+}
+
+/**
+ * @brief Requests grace period \c gp and starts it, if possible.
+ */
+static void rcu_gp_request(uint64_t gp) {
+    uint64_t old = rcu_gp_requested;
+    while(gp > old && !__sync_bool_compare_and_swap(&rcu_gp_requested, old, gp)) {
+        old = rcu_gp_requested;
+    }
+    rcu_gp_start();
+}
+
+/**
+ * @brief Returns the number of a grace period starting after all preceding stores.
+ */
+static uint64_t rcu_gp_next() {
+    // the removal of the object must be visible before a grace period can start
+    asm volatile ("mfence" : : : "memory");
+    return rcu_gp_seq + 1;
+}
+
+/**
+ * @brief Runs the callbacks whose grace period completed and requests new grace periods.
+ */
+static void rcu_process(softirq_work_t* work) {
+    (void)work;
+    rcu_gp_start();
+
+    int enabled = int_enabled();
+    INT_DISABLE();
+    rcu_cpu_t* rcu = PERCPU_PTR(rcu_cpu);
+    rcu_head_t* ready = NULL;
+    if(rcu->wait && rcu_gp_done >= rcu->wait_gp) {
+        ready = rcu->wait;
+        rcu->wait = NULL;
+    }
+    uint64_t gp = 0;
+    if(!rcu->wait && rcu->next) {
+        rcu->wait = rcu->next;
+        rcu->next = NULL;
+        rcu->wait_gp = gp = rcu_gp_next();
+    }
+    if(enabled) {
+        INT_ENABLE();
+    }
+
+    if(gp) {
+        rcu_gp_request(gp);
+    }
+    uint64_t invoked = 0;
+    while(ready) {
+        rcu_head_t* head = ready;
+        ready = head->next;
+        head->func(head);
+        invoked++;
+    }
+    rcu->invoked += invoked;
+}
+
+/**
+ * @brief Reports a quiescent state of the current processor.
+ *
+ * The caller must not be inside a read-side critical section. Costs one load
+ * unless a grace period waits for this processor.
+ */
+INT_FAST_HANDLER void rcu_quiescent() {
+    uint64_t self = 1ull << PERCPU_READ(percpu_index);
+    if(rcu_gp_mask & self) {
+        rcu_report(self);
+    }
+}
+
+/**
+ * @brief Called on every timer tick.
+ *
+ * @param user non-zero, if the tick interrupted user mode, which is a quiescent state
+ */
+INT_FAST_HANDLER void rcu_tick(int user) {
+    // readers disable preemption, so preemptible code holds no references
+    if(user || PREEMPT_ENABLED()) {
+        rcu_quiescent();
+    }
+    rcu_cpu_t* rcu = PERCPU_PTR(rcu_cpu);
+    if((rcu->wait && rcu_gp_done >= rcu->wait_gp) || (!rcu->wait && rcu->next)) {
+        softirq_raise(&rcu->work);
+    }
+}
+
+/**
+ * @brief Returns non-zero, if RCU needs the timer tick on the current processor.
+ *
+ * This is the case while a grace period waits for the processor or it has callbacks.
+ */
+INT_FAST_HANDLER int rcu_pending() {
+    rcu_cpu_t* rcu = PERCPU_PTR(rcu_cpu);
+    return (rcu_gp_mask & (1ull << PERCPU_READ(percpu_index))) || rcu->next || rcu->wait;
+}
+
+/**
+ * @brief Reports a quiescent state for as long as the current processor stays idle.
+ *
+ * Must be called with interrupts disabled right before halting.
+ */
+void rcu_idle_enter() {
+    PERCPU_WRITE(rcu_watching, 0);
+    // pairs with rcu_gp_start, see there
+    asm volatile ("mfence" : : : "memory");
+    rcu_quiescent();
+}
+
+/**
+ * @brief Leaves the quiescent state of the idle loop.
+ */
+INT_FAST_HANDLER void rcu_idle_exit() {
+    rcu_irq_enter();
+}
+
+/**
+ * @brief Calls \c func after all read-side critical sections running now have ended.
+ *
+ * The callbacks run as deferred work (see softirq.h) on the current processor.
+ * May be called with interrupts disabled, but not from fast interrupt handlers.
+ */
+void rcu_call(rcu_head_t* head, rcu_func_t func) {
+    head->func = func;
+    int enabled = int_enabled();
+    INT_DISABLE();
+    rcu_cpu_t* rcu = PERCPU_PTR(rcu_cpu);
+    head->next = rcu->next;
+    rcu->next = head;
+    rcu->queued++;
+    softirq_raise(&rcu->work);
+    if(enabled) {
+        INT_ENABLE();
+    }
+}
+
+/**
+ * @brief Waits until all read-side critical sections running now have ended.
+ *
+ * Must not be called inside a read-side critical section.
+ */
+void rcu_synchronize() {
+    uint64_t gp = rcu_gp_next();
+    rcu_gp_request(gp);
+    while(rcu_gp_done < gp) {
+        // the caller holds no references, and the grace period may wait for this processor
+        rcu_quiescent();
+        softirq_run();
+        asm volatile ("pause");
+    }
+}
+
+/**
+ * @brief Writes the grace period counters and the number of callbacks to kstdio.
+ */
+void rcu_dump() {
+    uint64_t queued = 0;
+    uint64_t invoked = 0;
+    for(unsigned int cpu = 0; cpu < HE_MAX_CPUS; cpu++) {
+        if(percpu_offsets[cpu]) {
+            queued += PERCPU_REMOTE(rcu_cpu, cpu)->queued;
+            invoked += PERCPU_REMOTE(rcu_cpu, cpu)->invoked;
+        }
+    }
+    kprintf("rcu: %lu grace periods started, %lu completed, %lu requested, waiting for %lx\n",
+            rcu_gp_seq, rcu_gp_done, rcu_gp_requested, rcu_gp_mask);
+    kprintf("rcu: %lu callbacks queued, %lu invoked\n", queued, invoked);
+}
@@ -0,0 +1,212 @@
+/**
+ * @file spinlock.c
+ *
+ * @author Fabian Thorand
+ * @date   19.10.2026
+ *
+ * @brief Lock statistics and the lock benchmark.
+ *
+ * The locks themselves are inline functions in spinlock.h.
+ */
+
+#include "kernel/sync/spinlock.h"
+
+#include "kernel/time/clock.h"
+
+#include "kernel/klibc/kstdio.h"
+
+#include "kernel/cpu.h"
+#include "kernel/log.h"
+#include "kernel/smp.h"
+
+/// duration of each benchmark run in microseconds
+#define LOCK_BENCHMARK_US 10000
+/// iterations between two checks of the deadline
+#define LOCK_BENCHMARK_BATCH 64
+
+/**
+ * @brief Lock types measured by #lock_benchmark.
+ */
+typedef enum {
+    LOCK_BENCH_TICKET,
+    LOCK_BENCH_MCS,
+    LOCK_BENCH_RW_WRITE,
+    LOCK_BENCH_RW_READ,
+    LOCK_BENCH_COUNT
+} lock_bench_kind_t;
+
+/// names of the lock types
+static const char* const lock_bench_names[LOCK_BENCH_COUNT] = {
+    "ticket", "mcs", "rw-write", "rw-read"
+};
+
+/**
+ * @brief State of one benchmark run, shared by the participating processors.
+ */
+typedef struct {
+    lock_bench_kind_t kind;         ///< measured lock type
+    unsigned int active;            ///< number of participating processors
+    volatile unsigned int arrived;  ///< number of processors that entered #lock_bench_run
+    volatile unsigned int ready;    ///< number of participants waiting for the start
+    volatile uint64_t end;          ///< TSC at which the run ends, zero until it started
+    volatile uint64_t ops;          ///< number of critical sections executed
+    spinlock_t ticket;
+    mcs_lock_t mcs;
+    rwlock_t rw;
+    volatile uint64_t shared;       ///< data written in the critical section
+} lock_bench_t;
+
+#ifdef HE_LOCK_STATS
+
+/// list of the classes that recorded an acquisition
+static lock_class_t* volatile lock_classes = NULL;
+
+/**
+ * @brief Raises \c *max to \c value.
+ */
+static void lock_stats_max(volatile uint64_t* max, uint64_t value) {
+    uint64_t old = *max;
+    while(value > old && !__sync_bool_compare_and_swap(max, old, value)) {
+        old = *max;
+    }
+}
+
+/**
+ * @brief Records an acquisition. Use #LOCK_STATS_ACQUIRED instead.
+ *
+ * @return the current TSC.
+ */
+uint64_t lock_stats_acquired(lock_class_t* cls, uint64_t wait_start, int contended) {
+    uint64_t now = cpu_rdtsc();
+    if(!cls) {
+        return now;
+    }
+    if(!cls->registered && __sync_bool_compare_and_swap(&cls->registered, 0, 1)) {
+        lock_class_t* head;
+        do {
+            head = lock_classes;
+            cls->next = head;
+        } while(!__sync_bool_compare_and_swap(&lock_classes, head, cls));
+    }
+    __sync_fetch_and_add(&cls->acquisitions, 1);
+    if(contended) {
+        uint64_t wait = now - wait_start;
+        __sync_fetch_and_add(&cls->contended, 1);
+        __sync_fetch_and_add(&cls->wait_cycles, wait);
+        lock_stats_max(&cls->wait_max, wait);
+    }
+    return now;
+}
+
+/**
+ * @brief Records the end of an exclusive hold. Use #LOCK_STATS_RELEASED instead.
+ */
+void lock_stats_released(lock_class_t* cls, uint64_t acquired) {
+    if(!cls) {
+        return;
+    }
+    uint64_t hold = cpu_rdtsc() - acquired;
+    __sync_fetch_and_add(&cls->hold_cycles, hold);
+    lock_stats_max(&cls->hold_max, hold);
+}
+
+#endif
+
+/**
+ * @brief Writes the statistics of all lock classes that were used to kstdio.
+ */
+void lock_stats_dump() {
+#ifdef HE_LOCK_STATS
+    for(lock_class_t* cls = lock_classes; cls; cls = cls->next) {
+        kprintf("%-16s %lu acquired, %lu contended, wait avg %lu max %lu, hold avg %lu max %lu cycles\n",
+                cls->name, cls->acquisitions, cls->contended,
+                cls->contended ? cls->wait_cycles / cls->contended : 0, cls->wait_max,
+                cls->acquisitions ? cls->hold_cycles / cls->acquisitions : 0, cls->hold_max);
+    }
+#else
+    kputs("lock statistics are disabled (HE_LOCK_STATS)\n");
+#endif
+}
+
+/**
+ * @brief Executes critical sections until the deadline of the run. Called by #smp_run.
+ */
+static void lock_bench_run(void* arg) {
+    lock_bench_t* bench = arg;
+    if(__sync_fetch_and_add(&bench->arrived, 1) >= bench->active) {
+        return;
+    }
+    // the last participant starts the clock
+    if(__sync_add_and_fetch(&bench->ready, 1) == bench->active) {
+        bench->end = cpu_rdtsc() + clock_ns_to_tsc(LOCK_BENCHMARK_US * CLOCK_NS_PER_US);
+    }
+    while(!bench->end) {
+        asm volatile ("pause");
+    }
+
+    uint64_t ops = 0;
+    mcs_node_t node;
+    while(cpu_rdtsc() < bench->end) {
+        for(int i = 0; i < LOCK_BENCHMARK_BATCH; i++) {
+            switch(bench->kind) {
+            case LOCK_BENCH_TICKET:
+                spinlock_acquire(&bench->ticket);
+                bench->shared++;
+                spinlock_release(&bench->ticket);
+                break;
+            case LOCK_BENCH_MCS:
+                mcs_acquire(&bench->mcs, &node);
+                bench->shared++;
+                mcs_release(&bench->mcs, &node);
+                break;
+            case LOCK_BENCH_RW_WRITE:
+                rwlock_write_acquire(&bench->rw);
+                bench->shared++;
+                rwlock_write_release(&bench->rw);
+                break;
+            default:
+                rwlock_read_acquire(&bench->rw);
+                (void)bench->shared;
+                rwlock_read_release(&bench->rw);
+                break;
+            }
+        }
+        ops += LOCK_BENCHMARK_BATCH;
+    }
+    __sync_fetch_and_add(&bench->ops, ops);
+}
+
+/**
+ * @brief Measures the throughput of the lock types with 1 to all online processors.
+ *
+ * Must be called on the bootstrap processor after #smp_init.
+ */
+void lock_benchmark() {
+    static LOCK_CLASS(bench_class, "benchmark");
+    unsigned int cpus = smp_cpu_count();
+    if(!clock_tsc_khz()) {
+        return;
+    }
+    for(unsigned int active = 1; active <= cpus; active++) {
+        uint64_t ops_per_ms[LOCK_BENCH_COUNT];
+        for(int kind = 0; kind < LOCK_BENCH_COUNT; kind++) {
+            lock_bench_t bench = {
+                .kind = kind,
+                .active = active,
+                .arrived = 0,
+                .ready = 0,
+                .end = 0,
+                .ops = 0,
+                .shared = 0
+            };
+            spinlock_init(&bench.ticket, &bench_class);
+            mcs_init(&bench.mcs, &bench_class);
+            rwlock_init(&bench.rw, &bench_class);
+            smp_run(lock_bench_run, &bench);
+            ops_per_ms[kind] = bench.ops * 1000 / LOCK_BENCHMARK_US;
+        }
+        LOG_INFO(LOG_CAT_SMP, "locks: %2u cpus, %s %lu, %s %lu, %s %lu, %s %lu ops/ms\n", active,
+                lock_bench_names[0], ops_per_ms[0], lock_bench_names[1], ops_per_ms[1],
+                lock_bench_names[2], ops_per_ms[2], lock_bench_names[3], ops_per_ms[3]);
+    }
+}
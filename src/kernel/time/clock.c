@@ -0,0 +1,272 @@
+/**
+ * @file clock.c
+ *
+ * @author Fabian Thorand
+ * @date   19.10.2026
+ *
+ * @brief Monotonic and wall clocks on a calibrated clocksource.
+ *
+ * Counter values are converted to nanoseconds with a 32.32 fixed point factor and a
+ * 128 bit product, so there is neither a division nor an overflow on the read path.
+ * The factor has a resolution below one part per billion.
+ */
+
+#include "kernel/time/clock.h"
+#include "kernel/time/hpet.h"
+#include "kernel/time/rtc.h"
+#include "kernel/interrupts/int.h"
+
+#include "kernel/cpu.h"
+#include "kernel/log.h"
+
+/// frequency of the PIT input clock in Hz
+#define PIT_FREQUENCY 1193182
+/// PIT channel 2 data port
+#define PIT_CHANNEL2 0x42
+/// PIT mode/command port
+#define PIT_COMMAND 0x43
+/// PIT command: channel 2, low and high byte, mode 0 (interrupt on terminal count)
+#define PIT_CMD_CHANNEL2_ONESHOT 0xB0
+/// port controlling the gate of PIT channel 2
+#define PIT_GATE_PORT 0x61
+/// gate of channel 2 in #PIT_GATE_PORT
+#define PIT_GATE_ENABLE 0x01
+/// speaker output in #PIT_GATE_PORT
+#define PIT_GATE_SPEAKER 0x02
+/// output of channel 2 in #PIT_GATE_PORT
+#define PIT_GATE_OUTPUT 0x20
+
+/// PIT ticks of one calibration round (10 ms)
+#define CLOCK_PIT_TICKS 11932
+/// length of one calibration round against the HPET in microseconds
+#define CLOCK_CALIBRATE_US 10000
+/// number of calibration rounds, the median is used
+#define CLOCK_CALIBRATE_ROUNDS 5
+
+/// number of reads measured by #clock_benchmark
+#define CLOCK_BENCHMARK_ROUNDS 1000
+
+/// non-zero, if the HPET is the clocksource instead of the TSC
+static int clock_use_hpet = 0;
+/// counter value of the clocksource at #clock_init
+static uint64_t clock_base = 0;
+/// converts counter values of the clocksource to nanoseconds, 32.32 fixed point
+static uint64_t clock_mult = 0;
+
+/// calibrated TSC frequency in Hz
+static uint64_t clock_tsc_hz = 0;
+/// converts TSC cycles to nanoseconds, 32.32 fixed point
+static uint64_t clock_tsc_ns = 0;
+/// converts nanoseconds to TSC cycles, 32.32 fixed point
+static uint64_t clock_ns_tsc = 0;
+
+/// nanoseconds since the Unix epoch at #clock_init
+static uint64_t clock_boot_realtime = 0;
+
+/**
+ * @brief Returns \c num / \c den as 32.32 fixed point number.
+ *
+ * The remainder is shifted separately, so \c num may use all 64 bits.
+ */
+static uint64_t clock_fixed(uint64_t num, uint64_t den) {
+    return ((num / den) << 32) + ((num % den) << 32) / den;
+}
+
+/**
+ * @brief Evaluates to a value multiplied with a 32.32 fixed point factor.
+ *
+ * A macro, so that it can be used on the fast interrupt path.
+ */
+#define CLOCK_SCALE(value, mult) ((uint64_t)(((unsigned __int128)(value) * (mult)) >> 32))
+
+/**
+ * @brief Sorts a small array in place.
+ */
+static void clock_sort(uint64_t* values, int count) {
+    for(int i = 1; i < count; i++) {
+        uint64_t value = values[i];
+        int j = i;
+        for(; j > 0 && values[j - 1] > value; j--) {
+            values[j] = values[j - 1];
+        }
+        values[j] = value;
+    }
+}
+
+/**
+ * @brief Reads the HPET counter together with the TSC value at the time of the read.
+ *
+ * The TSC is read before and after the slow HPET read, the middle is the best estimate.
+ */
+static uint64_t clock_hpet_pair(uint64_t* tsc) {
+    uint64_t before = cpu_rdtsc();
+    uint64_t count = hpet_read();
+    uint64_t after = cpu_rdtsc();
+    *tsc = before + (after - before) / 2;
+    return count;
+}
+
+/**
+ * @brief Measures the TSC frequency in Hz over one round against the HPET.
+ */
+static uint64_t clock_calibrate_hpet() {
+    uint64_t mask = hpet_is_64bit() ? UINT64_MAX : UINT32_MAX;
+    uint64_t ticks = hpet_frequency() * CLOCK_CALIBRATE_US / 1000000;
+    uint64_t tsc_start, tsc_end;
+    uint64_t start = clock_hpet_pair(&tsc_start);
+    uint64_t end;
+    do {
+        end = clock_hpet_pair(&tsc_end);
+    } while(((end - start) & mask) < ticks);
+    return (tsc_end - tsc_start) * hpet_frequency() / ((end - start) & mask);
+}
+
+/**
+ * @brief Starts PIT channel 2 counting down \c ticks without raising an interrupt.
+ */
+static void clock_pit_start(uint16_t ticks) {
+    uint8_t gate = cpu_inb(PIT_GATE_PORT);
+    cpu_outb(PIT_GATE_PORT, (gate & ~PIT_GATE_SPEAKER) | PIT_GATE_ENABLE);
+    cpu_outb(PIT_COMMAND, PIT_CMD_CHANNEL2_ONESHOT);
+    cpu_outb(PIT_CHANNEL2, ticks & 0xFF);
+    cpu_outb(PIT_CHANNEL2, ticks >> 8);
+}
+
+/**
+ * @brief Measures the TSC frequency in Hz over one round against PIT channel 2.
+ */
+static uint64_t clock_calibrate_pit() {
+    clock_pit_start(CLOCK_PIT_TICKS);
+    uint64_t start = cpu_rdtsc();
+    while(!(cpu_inb(PIT_GATE_PORT) & PIT_GATE_OUTPUT)) {
+        asm volatile ("pause");
+    }
+    return (cpu_rdtsc() - start) * PIT_FREQUENCY / CLOCK_PIT_TICKS;
+}
+
+/**
+ * @brief Returns non-zero, if the TSC runs at a constant rate in all power states.
+ */
+static int clock_tsc_invariant() {
+    cpu_id_t id;
+    cpuid(CPUID_EXT_MAX, &id);
+    if(id.eax < CPUID_EXT_POWER) {
+        return 0;
+    }
+    cpuid(CPUID_EXT_POWER, &id);
+    return (id.edx & CPUID_80000007_EDX_INVARIANT_TSC) != 0;
+}
+
+/**
+ * @brief Calibrates the TSC, selects the clocksource and reads the wall time.
+ *
+ * Must be called once on the bootstrap processor with interrupts disabled, after ACPI
+ * was parsed and before #lapic_timer_init.
+ */
+void clock_init() {
+    int have_hpet = hpet_init() == 0;
+
+    uint64_t hz[CLOCK_CALIBRATE_ROUNDS];
+    for(int round = 0; round < CLOCK_CALIBRATE_ROUNDS; round++) {
+        hz[round] = have_hpet ? clock_calibrate_hpet() : clock_calibrate_pit();
+    }
+    clock_sort(hz, CLOCK_CALIBRATE_ROUNDS);
+    clock_tsc_hz = hz[CLOCK_CALIBRATE_ROUNDS / 2];
+    clock_tsc_ns = clock_fixed(CLOCK_NS_PER_SEC, clock_tsc_hz);
+    clock_ns_tsc = clock_fixed(clock_tsc_hz, CLOCK_NS_PER_SEC);
+
+    int invariant = clock_tsc_invariant();
+    // a 32 bit HPET wraps around while the system idles without ticks
+    if(!invariant && have_hpet && hpet_is_64bit()) {
+        clock_use_hpet = 1;
+        clock_mult = clock_fixed(CLOCK_NS_PER_SEC, hpet_frequency());
+        clock_base = hpet_read();
+    } else {
+        clock_mult = clock_tsc_ns;
+        clock_base = cpu_rdtsc();
+    }
+
+    rtc_time_t now;
+    rtc_read(&now);
+    clock_boot_realtime = rtc_unix_seconds(&now) * CLOCK_NS_PER_SEC - clock_ns();
+
+    // the spread between the rounds bounds the calibration error
+    LOG_INFO(LOG_CAT_TIME, "clock: tsc %lu kHz (spread %lu ppm against the %s), %sinvariant, source %s\n",
+            clock_tsc_hz / 1000,
+            (hz[CLOCK_CALIBRATE_ROUNDS - 1] - hz[0]) * 1000000 / clock_tsc_hz,
+            have_hpet ? "HPET" : "PIT", invariant ? "" : "not ", clock_source());
+    if(!invariant && !clock_use_hpet) {
+        LOG_WARN(LOG_CAT_TIME, "clock: no invariant TSC and no 64 bit HPET, time may drift\n");
+    }
+    LOG_INFO(LOG_CAT_TIME, "clock: wall time %04u-%02u-%02u %02u:%02u:%02u UTC\n",
+            now.year, now.month, now.day, now.hour, now.minute, now.second);
+}
+
+/**
+ * @brief Returns the nanoseconds since #clock_init, or zero before it was called.
+ */
+INT_FAST_HANDLER uint64_t clock_ns() {
+    uint64_t count = clock_use_hpet ? hpet_read() : cpu_rdtsc();
+    return CLOCK_SCALE(count - clock_base, clock_mult);
+}
+
+/**
+ * @brief Returns the nanoseconds since the Unix epoch.
+ */
+uint64_t clock_realtime_ns() {
+    return clock_boot_realtime + clock_ns();
+}
+
+/**
+ * @brief Returns the calibrated TSC frequency in kHz, or zero before #clock_init.
+ */
+uint64_t clock_tsc_khz() {
+    return clock_tsc_hz / 1000;
+}
+
+/**
+ * @brief Converts a duration in nanoseconds to TSC cycles.
+ */
+INT_FAST_HANDLER uint64_t clock_ns_to_tsc(uint64_t ns) {
+    return CLOCK_SCALE(ns, clock_ns_tsc);
+}
+
+/**
+ * @brief Converts a duration in TSC cycles to nanoseconds.
+ */
+INT_FAST_HANDLER uint64_t clock_tsc_to_ns(uint64_t cycles) {
+    return CLOCK_SCALE(cycles, clock_tsc_ns);
+}
+
+/**
+ * @brief Returns the name of the clocksource, "tsc" or "hpet".
+ */
+const char* clock_source() {
+    return clock_use_hpet ? "hpet" : "tsc";
+}
+
+/**
+ * @brief Measures the cost of reading the monotonic clock and logs the result.
+ */
+void clock_benchmark() {
+    uint64_t last = clock_ns();
+    uint64_t backwards = 0;
+    uint64_t start = cpu_rdtsc();
+    for(int round = 0; round < CLOCK_BENCHMARK_ROUNDS; round++) {
+        uint64_t now = clock_ns();
+        if(now < last) {
+            backwards++;
+        }
+        last = now;
+    }
+    uint64_t cycles = (cpu_rdtsc() - start) / CLOCK_BENCHMARK_ROUNDS;
+
+    start = cpu_rdtsc();
+    for(int round = 0; round < CLOCK_BENCHMARK_ROUNDS; round++) {
+        asm volatile ("" : : "r"(cpu_rdtsc()));
+    }
+    uint64_t raw = (cpu_rdtsc() - start) / CLOCK_BENCHMARK_ROUNDS;
+
+    LOG_INFO(LOG_CAT_TIME, "clock: clock_ns %lu cycles (rdtsc %lu), source %s, %lu reads went backwards\n",
+            cycles, raw, clock_source(), backwards);
+}
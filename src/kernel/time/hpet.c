@@ -0,0 +1,87 @@
+/**
+ * @file hpet.c
+ *
+ * @author Fabian Thorand
+ * @date   19.10.2026
+ *
+ * @brief Main counter of the high precision event timer.
+ */
+
+#include "kernel/time/hpet.h"
+#include "kernel/interrupts/int.h"
+
+#include "kernel/mem/vmm.h"
+
+#include "kernel/info.h"
+#include "kernel/log.h"
+
+#include <stddef.h>
+
+/// size of the register window
+#define HPET_WINDOW_SIZE 0x400
+/// size of the physical address range mapped at #VMM_PHYS4G_BASE
+#define HPET_PHYS_LIMIT 0x100000000ull
+
+/// virtual address of the HPET registers, \c NULL if there is none
+static volatile uint64_t* hpet_base = NULL;
+
+/// frequency of the main counter in Hz
+static uint64_t hpet_freq = 0;
+
+/// non-zero, if the main counter is 64 bits wide
+static int hpet_64bit = 0;
+
+/**
+ * @brief Starts the main counter of the HPET reported by ACPI.
+ *
+ * @return zero on success, -1 if there is no usable HPET
+ */
+int hpet_init() {
+    uint64_t paddr = info_table.hpet_paddr;
+    if(!paddr || paddr + HPET_WINDOW_SIZE > HPET_PHYS_LIMIT) {
+        return -1;
+    }
+    volatile uint64_t* base = (volatile uint64_t*) (VMM_PHYS4G_BASE + paddr);
+
+    uint64_t caps = base[HPET_REG_CAPABILITIES / 8];
+    uint64_t period = HPET_CAP_PERIOD(caps);
+    // reads of a missing device return all ones
+    if(period == 0 || period > HPET_MAX_PERIOD) {
+        return -1;
+    }
+    base[HPET_REG_CONFIG / 8] |= HPET_CONFIG_ENABLE;
+
+    hpet_base = base;
+    hpet_freq = HPET_FS_PER_SEC / period;
+    hpet_64bit = (caps & HPET_CAP_64BIT) != 0;
+    LOG_INFO(LOG_CAT_TIME, "hpet: %lu Hz, %u bit counter at %p\n",
+            hpet_freq, hpet_64bit ? 64 : 32, (void*) paddr);
+    return 0;
+}
+
+/**
+ * @brief Returns the value of the main counter.
+ *
+ * A 32 bit counter wraps around after about five minutes at the usual 14.3 MHz.
+ */
+INT_FAST_HANDLER uint64_t hpet_read() {
+    if(hpet_64bit) {
+        return hpet_base[HPET_REG_COUNTER / 8];
+    }
+    // the upper half of a 32 bit counter reads as zero
+    return *(volatile uint32_t*) &hpet_base[HPET_REG_COUNTER / 8];
+}
+
+/**
+ * @brief Returns the frequency of the main counter in Hz, or zero if there is no HPET.
+ */
+uint64_t hpet_frequency() {
+    return hpet_freq;
+}
+
+/**
+ * @brief Returns non-zero, if the main counter is 64 bits wide.
+ */
+int hpet_is_64bit() {
+    return hpet_64bit;
+}
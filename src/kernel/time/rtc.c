@@ -0,0 +1,104 @@
+/**
+ * @file rtc.c
+ *
+ * @author Fabian Thorand
+ * @date   19.10.2026
+ *
+ * @brief Reads the wall time from the CMOS real time clock.
+ */
+
+#include "kernel/time/rtc.h"
+
+#include "kernel/info.h"
+#include "kernel/cpu.h"
+
+#include "kernel/klibc/string.h"
+
+/// seconds per day
+#define RTC_SECONDS_PER_DAY 86400ull
+
+/**
+ * @brief Reads a CMOS register.
+ */
+static uint8_t rtc_reg(uint8_t reg) {
+    cpu_outb(RTC_PORT_INDEX, reg);
+    return cpu_inb(RTC_PORT_DATA);
+}
+
+/**
+ * @brief Converts a BCD byte to binary.
+ */
+static uint8_t rtc_bcd(uint8_t value) {
+    return (value >> 4) * 10 + (value & 0xF);
+}
+
+/**
+ * @brief Reads the raw time registers once an update in progress finished.
+ *
+ * @param regs receives the registers of the seconds, minutes, hours, day, month,
+ *             year and century, in this order
+ */
+static void rtc_read_raw(uint8_t regs[7]) {
+    while(rtc_reg(RTC_REG_STATUS_A) & RTC_STATUS_A_UPDATE) {
+        asm volatile ("pause");
+    }
+    regs[0] = rtc_reg(RTC_REG_SECONDS);
+    regs[1] = rtc_reg(RTC_REG_MINUTES);
+    regs[2] = rtc_reg(RTC_REG_HOURS);
+    regs[3] = rtc_reg(RTC_REG_DAY);
+    regs[4] = rtc_reg(RTC_REG_MONTH);
+    regs[5] = rtc_reg(RTC_REG_YEAR);
+    regs[6] = info_table.rtc_century ? rtc_reg(info_table.rtc_century) : 0;
+}
+
+/**
+ * @brief Reads the current time from the RTC.
+ *
+ * Waits for an update in progress to finish and repeats the read until two consecutive
+ * reads agree, which takes a few microseconds unless an update just started.
+ * Without a century register reported by ACPI, years before 2000 are not supported.
+ */
+void rtc_read(rtc_time_t* time) {
+    uint8_t regs[7], check[7];
+    // an update may start between the check of the flag and the reads
+    rtc_read_raw(regs);
+    do {
+        memcpy(check, regs, sizeof(regs));
+        rtc_read_raw(regs);
+    } while(memcmp(check, regs, sizeof(regs)) != 0);
+
+    uint8_t status = rtc_reg(RTC_REG_STATUS_B);
+    // the flag of the afternoon is not part of the BCD value
+    int pm = !(status & RTC_STATUS_B_24H) && (regs[2] & RTC_HOURS_PM);
+    regs[2] &= ~RTC_HOURS_PM;
+    if(!(status & RTC_STATUS_B_BINARY)) {
+        for(int i = 0; i < 7; i++) {
+            regs[i] = rtc_bcd(regs[i]);
+        }
+    }
+    if(!(status & RTC_STATUS_B_24H)) {
+        // 12 AM is midnight, 12 PM is noon
+        regs[2] = (regs[2] % 12) + (pm ? 12 : 0);
+    }
+
+    time->second = regs[0];
+    time->minute = regs[1];
+    time->hour = regs[2];
+    time->day = regs[3];
+    time->month = regs[4];
+    time->year = (info_table.rtc_century ? regs[6] : 20) * 100 + regs[5];
+}
+
+/**
+ * @brief Converts a calendar time to seconds since the Unix epoch.
+ */
+uint64_t rtc_unix_seconds(const rtc_time_t* time) {
+    // days since 1970-01-01 of the proleptic Gregorian calendar, with years starting in March
+    uint64_t year = time->year - (time->month <= 2);
+    uint64_t era = year / 400;
+    uint64_t year_of_era = year - era * 400;
+    uint64_t day_of_year = (153 * (time->month > 2 ? time->month - 3 : time->month + 9) + 2) / 5 + time->day - 1;
+    uint64_t day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    uint64_t days = era * 146097 + day_of_era - 719468;
+    return days * RTC_SECONDS_PER_DAY + time->hour * 3600 + time->minute * 60 + time->second;
+}
@@ -0,0 +1,80 @@
+/**
+ * @file trace.c
+ *
+ * @author Fabian Thorand
+ * @date   19.10.2026
+ *
+ * @brief Binary tracing with deferred formatting.
+ *
+ * Each processor only writes to its own buffer. A slot is reserved with a single
+ * \c xadd instruction without \c lock prefix, which cannot be torn apart by an
+ * interrupt on the same processor. When the buffer is full, the oldest records are overwritten.
+ * Records are stamped with the monotonic clock, which reads zero until #clock_init.
+ *
+ * The buffers can be extracted with the \c trace-dump command from \c emu/.gdbinit
+ * and rendered with \c tools/trace-decode.c.
+ */
+
+#include "kernel/trace.h"
+#include "kernel/percpu.h"
+#include "kernel/helium.h"
+
+#include "kernel/sched/preempt.h"
+
+#include "kernel/time/clock.h"
+
+#include "kernel/klibc/string.h"
+
+/// trace buffers of all processors
+trace_buffer_t trace_buffers[HE_MAX_CPUS];
+
+/// non-zero when trace events are recorded
+int trace_enabled = 0;
+
+/**
+ * @brief Records a trace event. Use #TRACE instead.
+ *
+ * @param format the format string located in section \c .rodata.trace
+ * @param nargs number of elements in \c args
+ * @param args raw arguments
+ */
+void trace_emit(const char* format, unsigned int nargs, const uint64_t* args) {
+    // a thread migrating between picking the buffer and the write would race with its owner
+    PREEMPT_DISABLE();
+    trace_buffer_t* buffer = &trace_buffers[percpu_cpu()];
+    uint64_t slot = 1;
+    // local atomicity is sufficient, only this processor writes to the buffer
+    asm volatile ("xaddq %0, %1" : "+r"(slot), "+m"(buffer->head));
+    trace_record_t* record = &buffer->records[slot & (TRACE_RECORDS - 1)];
+    record->timestamp = clock_ns();
+    record->format = (uintptr_t) format;
+    for(unsigned int i = 0; i < nargs && i < TRACE_MAX_ARGS; i++) {
+        record->args[i] = args[i];
+    }
+    // the decoder ignores the record until its sequence number is written
+    asm volatile ("" : : : "memory");
+    record->sequence = slot + 1;
+    PREEMPT_ENABLE();
+}
+
+/**
+ * @brief Enables or disables recording of trace events.
+ */
+void trace_set_enabled(int enabled) {
+    trace_enabled = enabled;
+}
+
+/**
+ * @brief Initializes the trace buffers.
+ */
+void trace_init() {
+    memset(trace_buffers, 0, sizeof(trace_buffers));
+    for(int cpu = 0; cpu < HE_MAX_CPUS; cpu++) {
+        trace_buffers[cpu].magic = TRACE_MAGIC;
+        trace_buffers[cpu].cpu = cpu;
+        trace_buffers[cpu].clock_khz = TRACE_CLOCK_NS_KHZ;
+    }
+#ifdef HE_TRACE
+    trace_enabled = 1;
+#endif
+}
@@ -0,0 +1,112 @@
+/**
+ * @file fmt-bench.c
+ * @author Fabian Thorand
+ * @date 19.10.2026
+ *
+ * @brief Host benchmark for the kernel's string formatting functions.
+ *
+ * The kernel implementation is compiled into this program and compared with the
+ * host C library, both for correctness and throughput. Build and run on the host:
+ *
+ *     cc -O2 -I include -o fmt-bench tools/fmt-bench.c
+ *     ./fmt-bench [iterations]
+ *
+ * Every format string is measured with and without the format cache.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/// toggles the format cache of the kernel implementation
+static int fmt_bench_cache = 1;
+
+#define FMT_CACHEABLE(ptr) (fmt_bench_cache)
+#define snprintf kernel_snprintf
+#define vsnprintf kernel_vsnprintf
+#define isdigit kernel_isdigit
+#include "../src/kernel/klibc/kstdio_fmt.c"
+#undef snprintf
+#undef vsnprintf
+#undef isdigit
+
+/**
+ * @brief Returns the current time in nanoseconds.
+ */
+static double now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/// formats a fixed set of arguments with the given function
+#define BENCH_ARGS 12345, -678, 0xdeadbeefu, 0xfffff00000001000ull, (size_t) 4096, "pfa"
+
+/// format strings to measure, they must all accept #BENCH_ARGS
+static const char* formats[] = {
+    "%d %d %x %llx %zu %s",
+    "[%8d] %-6d %08X %016llx %zu bytes in %s",
+    "cpu %d: %d faults at %x",
+};
+
+#define NUM_FORMATS (sizeof(formats) / sizeof(formats[0]))
+
+int main(int argc, char** argv) {
+    long iterations = argc > 1 ? strtol(argv[1], NULL, 0) : 1000000;
+    char expected[256], actual[256];
+    int failed = 0;
+
+    for(size_t f = 0; f < NUM_FORMATS; f++) {
+        const char* format = formats[f];
+        int n_expected = snprintf(expected, sizeof(expected), format, BENCH_ARGS);
+        int n_actual = kernel_snprintf(actual, sizeof(actual), format, BENCH_ARGS);
+        if(n_expected != n_actual || strcmp(expected, actual) != 0) {
+            printf("MISMATCH %s  expected (%d) %s  actual (%d) %s\n", format, n_expected, expected, n_actual, actual);
+            failed = 1;
+        }
+
+        double start = now_ns();
+        for(long i = 0; i < iterations; i++) {
+            snprintf(expected, sizeof(expected), format, BENCH_ARGS);
+            asm volatile("" ::: "memory");
+        }
+        double libc = (now_ns() - start) / iterations;
+
+        double kernel[2];
+        for(int cache = 0; cache < 2; cache++) {
+            fmt_bench_cache = cache;
+            start = now_ns();
+            for(long i = 0; i < iterations; i++) {
+                kernel_snprintf(actual, sizeof(actual), format, BENCH_ARGS);
+                asm volatile("" ::: "memory");
+            }
+            kernel[cache] = (now_ns() - start) / iterations;
+        }
+        printf("%-45.45s libc %7.1f ns  kernel %7.1f ns  cached %7.1f ns\n",
+                format, libc, kernel[0], kernel[1]);
+    }
+
+    // edge cases of the integer conversion
+    static const struct { const char* format; long long value; } cases[] = {
+        { "%lld", 0 }, { "%lld", -1 }, { "%lld", -9223372036854775807ll - 1 },
+        { "%llu", -1 }, { "%llo", -1 }, { "%llX", -1 }, { "%+d", 5 }, { "% d", 5 },
+        { "%05d", -42 }, { "%-5d|", 42 }, { "%lld", 99 }, { "%lld", 100 },
+    };
+    for(size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        snprintf(expected, sizeof(expected), cases[i].format, cases[i].value);
+        kernel_snprintf(actual, sizeof(actual), cases[i].format, cases[i].value);
+        if(strcmp(expected, actual) != 0) {
+            printf("MISMATCH %s  expected %s  actual %s\n", cases[i].format, expected, actual);
+            failed = 1;
+        }
+    }
+
+    // truncation
+    int n = kernel_snprintf(actual, 8, "%s", "0123456789");
+    if(n != 10 || strcmp(actual, "0123456") != 0) {
+        printf("MISMATCH truncation %d %s\n", n, actual);
+        failed = 1;
+    }
+    return failed;
+}
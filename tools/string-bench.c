@@ -0,0 +1,304 @@
+/**
+ * @file string-bench.c
+ * @author Fabian Thorand
+ * @date 19.10.2026
+ *
+ * @brief Host test and benchmark for the kernel's string functions.
+ *
+ * The kernel implementation is compiled into this program. It is checked against the
+ * host C library with random lengths and alignments and with strings that end right
+ * before an unmapped page. Its throughput is then compared with the byte loops it
+ * replaced and with the host C library. Build and run on the host:
+ *
+ *     cc -O2 -fno-tree-loop-distribute-patterns -I include -o string-bench tools/string-bench.c
+ *     ./string-bench [iterations]
+ *
+ * Add \c -DKLIBC_SSE2 to test the SSE2 scanning functions. Without
+ * \c -fno-tree-loop-distribute-patterns, the compiler turns the old byte loops into calls
+ * of the host library.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#define memset kernel_memset
+#define memcpy kernel_memcpy
+#define memmove kernel_memmove
+#define memchr kernel_memchr
+#define memcmp kernel_memcmp
+#define strcpy kernel_strcpy
+#define strcat kernel_strcat
+#define strcmp kernel_strcmp
+#define strncmp kernel_strncmp
+#define strlen kernel_strlen
+#define strnlen kernel_strnlen
+#include "../src/kernel/klibc/string.c"
+#undef memset
+#undef memcpy
+#undef memmove
+#undef memchr
+#undef memcmp
+#undef strcpy
+#undef strcat
+#undef strcmp
+#undef strncmp
+#undef strlen
+#undef strnlen
+
+/// size of the test buffers, large enough for the longest string and all alignments
+#define BUFFER_SIZE 1024
+/// maximum length of the random strings and blocks
+#define MAX_LENGTH 300
+/// number of random cases per function
+#define RANDOM_CASES 100000
+
+/**
+ * @brief The byte loops used before the word-at-a-time functions, for comparison.
+ */
+static void* old_memset(void* ptr, int value, size_t num) {
+    unsigned char* data = (unsigned char*) ptr;
+    for (size_t i = 0; i < num; i++) {
+        data[i] = (unsigned char) value;
+    }
+    return ptr;
+}
+
+static void* old_memcpy(void* destination, const void* source, size_t num) {
+    char* dstptr = (char*) destination;
+    const char* srcptr = (const char*) source;
+    for(size_t i = 0; i < num; i++) {
+        dstptr[i] = srcptr[i];
+    }
+    return destination;
+}
+
+static int old_strcmp(const char* str1, const char* str2) {
+    while (*str1 && (*str1 == *str2))
+        str1++, str2++;
+    return *(const unsigned char*) str1 - *(const unsigned char*) str2;
+}
+
+static size_t old_strlen(const char* str) {
+    size_t len = 0;
+    while (*str++)
+        len++;
+    return len;
+}
+
+/// number of failed checks
+static int failures = 0;
+
+/// reports a failed check with the parameters of the case
+#define CHECK(cond, ...) do { \
+    if(!(cond)) { \
+        if(failures++ < 20) { \
+            printf("FAIL %s:%d: ", __func__, __LINE__); \
+            printf(__VA_ARGS__); \
+            putchar('\n'); \
+        } \
+    } } while(0)
+
+/// returns -1, 0 or 1 like the sign of \c x, the functions only agree on the sign
+static int sign(int x) {
+    return (x > 0) - (x < 0);
+}
+
+/**
+ * @brief Fills \c buf with random non-zero bytes from a small alphabet, so strings share prefixes.
+ */
+static void random_fill(char* buf, size_t length) {
+    for(size_t i = 0; i < length; i++) {
+        buf[i] = 'a' + rand() % 4;
+    }
+}
+
+/**
+ * @brief Checks the block functions with random lengths, values and alignments.
+ */
+static void test_memory() {
+    static unsigned char expected[BUFFER_SIZE], actual[BUFFER_SIZE], src[BUFFER_SIZE];
+    for(int i = 0; i < RANDOM_CASES; i++) {
+        size_t length = rand() % MAX_LENGTH;
+        size_t dst_off = rand() % 16, src_off = rand() % 16;
+        int value = rand() & 0xFF;
+        random_fill((char*) src, BUFFER_SIZE);
+        random_fill((char*) expected, BUFFER_SIZE);
+        memcpy(actual, expected, BUFFER_SIZE);
+
+        memset(expected + dst_off, value, length);
+        kernel_memset(actual + dst_off, value, length);
+        CHECK(memcmp(expected, actual, BUFFER_SIZE) == 0, "memset length %zu offset %zu", length, dst_off);
+
+        memcpy(expected + dst_off, src + src_off, length);
+        kernel_memcpy(actual + dst_off, src + src_off, length);
+        CHECK(memcmp(expected, actual, BUFFER_SIZE) == 0, "memcpy length %zu offsets %zu %zu", length, dst_off, src_off);
+
+        // overlapping in both directions
+        size_t from = rand() % 64, to = rand() % 64;
+        memmove(expected + to, expected + from, length);
+        kernel_memmove(actual + to, actual + from, length);
+        CHECK(memcmp(expected, actual, BUFFER_SIZE) == 0, "memmove length %zu from %zu to %zu", length, from, to);
+
+        // a difference at a random position, or none
+        memcpy(actual, expected, BUFFER_SIZE);
+        size_t diff = rand() % (MAX_LENGTH + 1);
+        if(diff < length) {
+            actual[src_off + diff] ^= 1 << (rand() % 8);
+        }
+        CHECK(sign(memcmp(expected + src_off, actual + src_off, length))
+                == sign(kernel_memcmp(expected + src_off, actual + src_off, length)),
+                "memcmp length %zu offset %zu difference at %zu", length, src_off, diff);
+
+        unsigned char chr = expected[src_off + rand() % (length + 1)];
+        CHECK(memchr(expected + src_off, chr, length) == kernel_memchr(expected + src_off, chr, length),
+                "memchr length %zu offset %zu", length, src_off);
+    }
+}
+
+/**
+ * @brief Checks the string functions with random lengths, contents and alignments.
+ */
+static void test_strings() {
+    static char a[BUFFER_SIZE], b[BUFFER_SIZE], expected[BUFFER_SIZE], actual[BUFFER_SIZE];
+    for(int i = 0; i < RANDOM_CASES; i++) {
+        size_t a_len = rand() % MAX_LENGTH, b_len = rand() % MAX_LENGTH;
+        size_t a_off = rand() % 16, b_off = rand() % 16;
+        char* s1 = a + a_off;
+        char* s2 = b + b_off;
+        random_fill(a, BUFFER_SIZE);
+        s1[a_len] = 0;
+        // mostly equal prefixes, so the comparisons run over many words
+        memcpy(b, a, BUFFER_SIZE);
+        memmove(s2, s1, a_len + 1);
+        if(rand() % 2) {
+            random_fill(s2, b_len);
+            s2[b_len] = 0;
+        }
+
+        CHECK(strlen(s1) == kernel_strlen(s1), "strlen length %zu offset %zu", a_len, a_off);
+        size_t maxlen = rand() % MAX_LENGTH;
+        CHECK(strnlen(s1, maxlen) == kernel_strnlen(s1, maxlen),
+                "strnlen length %zu offset %zu maxlen %zu", a_len, a_off, maxlen);
+        CHECK(sign(strcmp(s1, s2)) == sign(kernel_strcmp(s1, s2)),
+                "strcmp offsets %zu %zu", a_off, b_off);
+        size_t n = rand() % MAX_LENGTH;
+        CHECK(sign(strncmp(s1, s2, n)) == sign(kernel_strncmp(s1, s2, n)),
+                "strncmp offsets %zu %zu n %zu", a_off, b_off, n);
+
+        size_t dst_off = rand() % 16;
+        memset(expected, 0x55, BUFFER_SIZE);
+        memset(actual, 0x55, BUFFER_SIZE);
+        strcpy(expected + dst_off, s1);
+        kernel_strcpy(actual + dst_off, s1);
+        CHECK(memcmp(expected, actual, BUFFER_SIZE) == 0, "strcpy length %zu offsets %zu %zu", a_len, dst_off, a_off);
+
+        if(a_len + strlen(s2) + dst_off < BUFFER_SIZE) {
+            strcat(expected + dst_off, s2);
+            kernel_strcat(actual + dst_off, s2);
+            CHECK(memcmp(expected, actual, BUFFER_SIZE) == 0, "strcat offsets %zu %zu", dst_off, b_off);
+        }
+    }
+}
+
+/**
+ * @brief Checks that scanning strings that end right before an unmapped page does not fault.
+ */
+static void test_guard_page() {
+    size_t page = sysconf(_SC_PAGESIZE);
+    char* mem = mmap(NULL, 2 * page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(mem == MAP_FAILED || mprotect(mem + page, page, PROT_NONE) != 0) {
+        printf("FAIL cannot map the guard page\n");
+        failures++;
+        return;
+    }
+    char* other = malloc(page);
+    for(size_t length = 0; length < 64; length++) {
+        char* str = mem + page - length - 1;
+        random_fill(str, length);
+        str[length] = 0;
+        strcpy(other, str);
+        CHECK(kernel_strlen(str) == length, "strlen length %zu", length);
+        CHECK(kernel_strnlen(str, page) == length, "strnlen length %zu", length);
+        CHECK(kernel_memchr(str, 0, length + 1) == str + length, "memchr length %zu", length);
+        CHECK(kernel_strcmp(str, other) == 0, "strcmp length %zu", length);
+        CHECK(kernel_strncmp(str, other, page) == 0, "strncmp length %zu", length);
+        CHECK(kernel_memcmp(str, other, length + 1) == 0, "memcmp length %zu", length);
+    }
+    free(other);
+    munmap(mem, 2 * page);
+}
+
+/**
+ * @brief Returns the current time in nanoseconds.
+ */
+static double now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/// measures \c call and stores the time per call in nanoseconds in \c result
+#define BENCH(result, call) do { \
+    double start_ = now_ns(); \
+    for(long i_ = 0; i_ < iterations; i_++) { \
+        call; \
+        asm volatile("" ::: "memory"); \
+    } \
+    result = (now_ns() - start_) / iterations; \
+    } while(0)
+
+/**
+ * @brief Compares the old byte loops, the kernel functions and the host library.
+ */
+static void benchmark(long iterations) {
+    static const size_t sizes[] = { 16, 64, 256, 4096 };
+    static char src[4096 + 1], dst[4096 + 1], cmp[4096 + 1];
+    printf("%-8s %6s %10s %10s %10s %8s\n", "function", "bytes", "old ns", "kernel ns", "libc ns", "speedup");
+    for(size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        size_t size = sizes[s];
+        random_fill(src, size);
+        src[size] = 0;
+        memcpy(cmp, src, size + 1);
+        volatile size_t sink = 0;
+        double old, kernel, libc;
+
+        BENCH(old, old_memset(dst, s, size));
+        BENCH(kernel, kernel_memset(dst, s, size));
+        BENCH(libc, memset(dst, s, size));
+        printf("%-8s %6zu %10.1f %10.1f %10.1f %7.1fx\n", "memset", size, old, kernel, libc, old / kernel);
+
+        BENCH(old, old_memcpy(dst, src, size));
+        BENCH(kernel, kernel_memcpy(dst, src, size));
+        BENCH(libc, memcpy(dst, src, size));
+        printf("%-8s %6zu %10.1f %10.1f %10.1f %7.1fx\n", "memcpy", size, old, kernel, libc, old / kernel);
+
+        BENCH(old, sink += old_strlen(src));
+        BENCH(kernel, sink += kernel_strlen(src));
+        BENCH(libc, sink += strlen(src));
+        printf("%-8s %6zu %10.1f %10.1f %10.1f %7.1fx\n", "strlen", size, old, kernel, libc, old / kernel);
+
+        BENCH(old, sink += old_strcmp(src, cmp));
+        BENCH(kernel, sink += kernel_strcmp(src, cmp));
+        BENCH(libc, sink += strcmp(src, cmp));
+        printf("%-8s %6zu %10.1f %10.1f %10.1f %7.1fx\n", "strcmp", size, old, kernel, libc, old / kernel);
+    }
+}
+
+int main(int argc, char** argv) {
+    long iterations = argc > 1 ? strtol(argv[1], NULL, 0) : 1000000;
+    srand(1);
+    test_memory();
+    test_strings();
+    test_guard_page();
+    if(failures) {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    benchmark(iterations);
+    return 0;
+}
@@ -0,0 +1,219 @@
+/**
+ * @file trace-decode.c
+ * @author Fabian Thorand
+ * @date 19.10.2026
+ *
+ * @brief Host tool that renders the binary trace buffers of the kernel.
+ *
+ * The format strings are resolved from the kernel image, so the image must be
+ * the one that produced the trace. Build and run on the host:
+ *
+ *     cc -I include -o trace-decode tools/trace-decode.c
+ *     ./trace-decode dist/boot/kernel.sys trace.bin [clock-khz]
+ *
+ * \c trace.bin is a raw copy of \c trace_buffers, e.g. created by the \c trace-dump
+ * command in \c emu/.gdbinit. Timestamps are printed in microseconds relative to the
+ * first record, or in raw clock ticks if the rate of the clock is not known.
+ * The kernel stamps records in nanoseconds, \c clock-khz overrides the rate stored in the dump.
+ */
+
+#include "common/elf64def.h"
+#include "common/tracedef.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// contents of the kernel image
+static unsigned char* image;
+static size_t image_size;
+
+/**
+ * @brief Reads a whole file into memory.
+ */
+static unsigned char* read_file(const char* path, size_t* size) {
+    FILE* f = fopen(path, "rb");
+    if(!f) {
+        perror(path);
+        exit(1);
+    }
+    fseek(f, 0, SEEK_END);
+    *size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    unsigned char* data = malloc(*size + 1);
+    if(!data || fread(data, 1, *size, f) != *size) {
+        fprintf(stderr, "%s: read error\n", path);
+        exit(1);
+    }
+    data[*size] = 0;
+    fclose(f);
+    return data;
+}
+
+/**
+ * @brief Resolves a virtual address in the kernel image to a string.
+ * @return the string or NULL, when the address is not part of an allocated section.
+ */
+static const char* resolve_string(uint64_t vaddr) {
+    Elf64_Ehdr* ehdr = (Elf64_Ehdr*) image;
+    for(int i = 0; i < ehdr->e_shnum; i++) {
+        Elf64_Shdr* shdr = (Elf64_Shdr*) (image + ehdr->e_shoff + i * ehdr->e_shentsize);
+        if(shdr->sh_type != SHT_PROGBITS || !(shdr->sh_flags & SHF_ALLOC)) {
+            continue;
+        }
+        if(vaddr >= shdr->sh_addr && vaddr < shdr->sh_addr + shdr->sh_size) {
+            uint64_t offset = shdr->sh_offset + (vaddr - shdr->sh_addr);
+            if(offset < image_size) {
+                return (const char*) image + offset;
+            }
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Renders one record like the kernel's vsnprintf would have done.
+ */
+static void render(FILE* out, const trace_record_t* record) {
+    const char* fmt = resolve_string(record->format);
+    if(!fmt) {
+        fprintf(out, "<unknown format %#" PRIx64 ">", record->format);
+        return;
+    }
+    int arg = 0;
+    while(*fmt) {
+        if(*fmt != '%') {
+            fputc(*fmt++, out);
+            continue;
+        }
+        // copy the conversion specification
+        char spec[32];
+        size_t len = 0;
+        spec[len++] = *fmt++;
+        while(*fmt && strchr("-+ #0123456789.", *fmt) && len < sizeof(spec) - 8) {
+            spec[len++] = *fmt++;
+        }
+        int longs = 0;
+        while(*fmt && strchr("hljztL", *fmt)) {
+            if(*fmt == 'l' || *fmt == 'j' || *fmt == 'z' || *fmt == 't') {
+                longs = 1;
+            }
+            fmt++;
+        }
+        char conv = *fmt ? *fmt++ : '%';
+        if(conv == '%') {
+            fputc('%', out);
+            continue;
+        }
+        uint64_t value = arg < TRACE_MAX_ARGS ? record->args[arg] : 0;
+        arg++;
+        switch(conv) {
+        case 'd':
+        case 'i':
+            strcpy(spec + len, PRId64);
+            fprintf(out, spec, longs ? (int64_t) value : (int64_t) (int32_t) value);
+            break;
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o':
+            spec[len] = 0;
+            strcat(spec, conv == 'u' ? PRIu64 : conv == 'x' ? PRIx64 : conv == 'X' ? PRIX64 : PRIo64);
+            fprintf(out, spec, longs ? value : (uint64_t) (uint32_t) value);
+            break;
+        case 'p':
+            // the kernel prints pointers as plain hex numbers
+            strcpy(spec + len, PRIx64);
+            fprintf(out, spec, value);
+            break;
+        case 'c':
+            spec[len++] = 'c';
+            spec[len] = 0;
+            fprintf(out, spec, (int) value);
+            break;
+        case 's': {
+            const char* str = resolve_string(value);
+            spec[len++] = 's';
+            spec[len] = 0;
+            if(str) {
+                fprintf(out, spec, str);
+            } else {
+                fprintf(out, "<%#" PRIx64 ">", value);
+            }
+            break;
+        }
+        default:
+            fprintf(out, "<%%%c>", conv);
+            break;
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    if(argc < 3) {
+        fprintf(stderr, "Usage: trace-decode <kernel.sys> <trace.bin> [clock-khz]\n");
+        return 1;
+    }
+    image = read_file(argv[1], &image_size);
+    if(image_size < sizeof(Elf64_Ehdr) || image[EI_MAG0] != 0x7f || memcmp(image + EI_MAG1, "ELF", 3) != 0) {
+        fprintf(stderr, "%s: not an ELF file\n", argv[1]);
+        return 1;
+    }
+    size_t dump_size;
+    trace_buffer_t* buffers = (trace_buffer_t*) read_file(argv[2], &dump_size);
+    size_t nbuffers = dump_size / sizeof(trace_buffer_t);
+    uint64_t clock_khz = argc > 3 ? strtoull(argv[3], NULL, 0) : 0;
+
+    // index of the next unread record for each processor
+    uint64_t* next = calloc(nbuffers, sizeof(uint64_t));
+    for(size_t i = 0; i < nbuffers; i++) {
+        if(buffers[i].magic != TRACE_MAGIC) {
+            next[i] = buffers[i].head;
+            continue;
+        }
+        next[i] = buffers[i].head > TRACE_RECORDS ? buffers[i].head - TRACE_RECORDS : 0;
+        if(!clock_khz) {
+            clock_khz = buffers[i].clock_khz;
+        }
+    }
+
+    // merge the buffers by timestamp
+    uint64_t first = 0;
+    int have_first = 0;
+    while(1) {
+        trace_record_t* oldest = NULL;
+        size_t oldest_cpu = 0;
+        for(size_t i = 0; i < nbuffers; i++) {
+            if(next[i] >= buffers[i].head) {
+                continue;
+            }
+            trace_record_t* record = &buffers[i].records[next[i] % TRACE_RECORDS];
+            if(!oldest || record->timestamp < oldest->timestamp) {
+                oldest = record;
+                oldest_cpu = i;
+            }
+        }
+        if(!oldest) {
+            break;
+        }
+        uint64_t position = next[oldest_cpu]++;
+        if(oldest->sequence != position + 1) {
+            // slot was reserved but not completely written when the dump was taken
+            continue;
+        }
+        if(!have_first) {
+            first = oldest->timestamp;
+            have_first = 1;
+        }
+        uint64_t delta = oldest->timestamp - first;
+        if(clock_khz) {
+            printf("[%2zu] %12.3fus ", oldest_cpu, (double) delta * 1000.0 / (double) clock_khz);
+        } else {
+            printf("[%2zu] %14" PRIu64 " ", oldest_cpu, delta);
+        }
+        render(stdout, oldest);
+        putchar('\n');
+    }
+    return 0;
+}